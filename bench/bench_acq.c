@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <libswiftnav/acq.h>
+#include <libswiftnav/prns.h>
+
+#include "bench_utils.h"
+
+/* 4.096 MHz sample rate, a power of two number of samples per code period. */
+#define SAMPLE_FREQ 4.096e6
+#define N 4096
+#define N_BLOCKS 2
+#define N_PRNS 32
+#define CF_MIN (-5000.0f)
+#define CF_MAX 5000.0f
+#define CF_BIN 500.0f
+#define N_BINS 21
+#define MAX_THREADS 64
+
+static s8 samples[N_BLOCKS * N];
+
+typedef struct {
+  u8 n_sids;
+  gnss_signal_t sids[N_PRNS];
+  acq_result_t results[N_PRNS];
+} job_t;
+
+/* Cold start: a fresh search state with no cached code FFTs. */
+static void *acq_thread(void *arg)
+{
+  job_t *job = arg;
+  size_t size = acq_buff_size(N, job->n_sids, N_BINS);
+  void *buff = malloc(size);
+  acq_t a;
+  acq_init(&a, SAMPLE_FREQ, buff, size);
+  acq_search(&a, samples, N_BLOCKS, CF_MIN, CF_MAX, CF_BIN,
+             job->n_sids, job->sids, job->results);
+  free(buff);
+  return NULL;
+}
+
+static double run(u32 n_threads)
+{
+  static job_t jobs[MAX_THREADS];
+  pthread_t threads[MAX_THREADS];
+
+  for (u32 t = 0; t < n_threads; t++)
+    jobs[t].n_sids = 0;
+  for (u8 i = 0; i < N_PRNS; i++) {
+    job_t *job = &jobs[i % n_threads];
+    job->sids[job->n_sids].constellation = CONSTELLATION_GPS;
+    job->sids[job->n_sids].band = BAND_L1;
+    job->sids[job->n_sids].sat = i + 1;
+    job->n_sids++;
+  }
+
+  double t0 = bench_time();
+  for (u32 t = 0; t < n_threads; t++)
+    pthread_create(&threads[t], NULL, acq_thread, &jobs[t]);
+  for (u32 t = 0; t < n_threads; t++)
+    pthread_join(threads[t], NULL);
+  return bench_time() - t0;
+}
+
+int main(void)
+{
+  /* PRN 7 at 2 kHz Doppler in noise. */
+  gnss_signal_t sid = {.constellation = CONSTELLATION_GPS,
+                       .band = BAND_L1, .sat = 7};
+  const u8 *code = ca_code(sid);
+  for (u32 i = 0; i < N_BLOCKS * N; i++) {
+    double cp = 123.4 + i * 1.023e6 / SAMPLE_FREQ;
+    double s = 2 * get_chip((u8 *)code, (u32)cp % 1023) *
+               cos(2 * M_PI * 2000 * i / SAMPLE_FREQ);
+    samples[i] = (s8)lround(s + (rand() % 13) - 6);
+  }
+
+  long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  u32 n_threads = MIN(MAX(n_cpus, 1), MAX_THREADS);
+
+  printf("Cold start acquisition of %d PRNs, %d x 1 ms non-coherent, "
+         "%d bins, %d samples per ms\n", N_PRNS, N_BLOCKS, N_BINS, N);
+  double t1 = run(1);
+  printf("1 core:   %8.3f s\n", t1);
+  double tn = run(n_threads);
+  printf("%u cores: %8.3f s (speedup %.2f)\n", n_threads, tn, t1 / tn);
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <libswiftnav/code_cache.h>
+#include <libswiftnav/correlate.h>
+#include <libswiftnav/prns.h>
+
+#include "bench_utils.h"
+
+/* 1 ms of samples at 16.368 MHz. */
+#define NUM_SAMPLES 16368
+#define NUM_CHANNELS 12
+#define REPEATS 200
+#define CODE_STEP (1.023e6 / 16.368e6)
+#define CARR_STEP (2 * M_PI * 4.092e6 / 16.368e6)
+
+static s8 samples[NUM_SAMPLES];
+static s8 codes[NUM_CHANNELS][1023];
+static s8 codes_padded[NUM_CHANNELS][1026];
+static u64 cache_buff[NUM_CHANNELS * 40000 / sizeof(u64)];
+
+static const char *impl_names[] = {
+  [CORR_IMPL_GENERIC] = "generic",
+  [CORR_IMPL_AVX2] = "avx2",
+  [CORR_IMPL_AVX512] = "avx512",
+};
+
+static void report(const char *name, const char *mode, u8 n_taps, double dt)
+{
+  double rate = (double)REPEATS * NUM_CHANNELS * NUM_SAMPLES / dt;
+  printf("%-16s %-8s %d taps  %8.2f Msamples/s per channel\n",
+         name, mode, n_taps, rate / 1e6);
+}
+
+int main(void)
+{
+  for (u32 i = 0; i < NUM_SAMPLES; i++)
+    samples[i] = (rand() % 15) - 7;
+  for (u8 c = 0; c < NUM_CHANNELS; c++) {
+    gnss_signal_t sid = {.constellation = CONSTELLATION_GPS,
+                         .band = BAND_L1, .sat = c + 1};
+    const u8 *ca = ca_code(sid);
+    for (u32 i = 0; i < 1023; i++)
+      codes[c][i] = codes_padded[c][i + 1] = get_chip((u8 *)ca, i);
+    codes_padded[c][0] = codes[c][1022];
+    codes_padded[c][1024] = codes[c][0];
+    codes_padded[c][1025] = codes[c][1];
+  }
+
+  printf("%d channels, %d samples per block\n", NUM_CHANNELS, NUM_SAMPLES);
+
+  /* Reference single channel correlator. */
+  double t0 = bench_time();
+  for (u32 r = 0; r < REPEATS; r++) {
+    for (u8 c = 0; c < NUM_CHANNELS; c++) {
+      double code_phase = 0, carr_phase = 0;
+      double I_E, Q_E, I_P, Q_P, I_L, Q_L;
+      u32 n;
+      track_correlate(samples, codes_padded[c], &code_phase, CODE_STEP,
+                      &carr_phase, CARR_STEP,
+                      &I_E, &Q_E, &I_P, &Q_P, &I_L, &Q_L, &n);
+    }
+  }
+  report("track_correlate", "lookup", 3, bench_time() - t0);
+
+  code_cache_t cache;
+  code_cache_init(&cache, cache_buff, sizeof(cache_buff));
+  const code_replica_t *replicas[NUM_CHANNELS];
+  for (u8 c = 0; c < NUM_CHANNELS; c++) {
+    gnss_signal_t sid = {.constellation = CONSTELLATION_GPS,
+                         .band = BAND_L1, .sat = c + 1};
+    replicas[c] = code_cache_get(&cache, sid, CODE_STEP);
+  }
+
+  corr_channel_t ch[NUM_CHANNELS];
+  for (corr_impl_t impl = CORR_IMPL_GENERIC; impl <= CORR_IMPL_AVX512;
+       impl++) {
+    if (!corr_impl_supported(impl))
+      continue;
+    for (u8 use_replica = 0; use_replica < 2; use_replica++) {
+      for (u8 n_taps = 3; n_taps <= 5; n_taps += 2) {
+        for (u8 c = 0; c < NUM_CHANNELS; c++)
+          corr_channel_init(&ch[c], codes[c], 1023, n_taps, 0.5);
+        t0 = bench_time();
+        for (u32 r = 0; r < REPEATS; r++) {
+          for (u8 c = 0; c < NUM_CHANNELS; c++) {
+            ch[c].code_step = CODE_STEP;
+            ch[c].carr_step = CARR_STEP;
+            ch[c].num_samples = NUM_SAMPLES;
+            if (use_replica)
+              ch[c].replica = code_replica_chips(replicas[c],
+                                                 ch[c].code_phase, NULL);
+          }
+          track_correlate_multi(impl, samples, NUM_CHANNELS, ch);
+        }
+        report(impl_names[impl], use_replica ? "replica" : "lookup",
+               n_taps, bench_time() - t0);
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <libswiftnav/constants.h>
+#include <libswiftnav/coord_system.h>
+#include <libswiftnav/dgnss_management.h>
+
+#include "bench_utils.h"
+
+#define N_BASELINES 32
+#define N_SATS 8
+#define N_EPOCHS 300
+#define MAX_THREADS 64
+
+/* Keep the IAR progress messages out of the timings. */
+void log_(u8 level, const char *msg, ...)
+{
+  (void)level;
+  (void)msg;
+}
+
+typedef struct {
+  double b[3];
+  s32 N[N_SATS];
+  dgnss_epoch_t epochs[N_EPOCHS];
+  sdiff_t sdiffs[N_EPOCHS * N_SATS];
+  dgnss_solution_t solutions[N_EPOCHS];
+  dgnss_ctx_t ctx;
+  u8 hyp_buff[AMBIGUITY_TEST_BUFF_SIZE(MAX_HYPOTHESES)];
+} baseline_job_t;
+
+typedef struct {
+  u32 first;
+  u32 stride;
+} thread_job_t;
+
+static baseline_job_t *baselines;
+
+/* Single differences for a static baseline, seen from a receiver on the
+ * equator with the constellation slowly rotating. */
+static void make_sdiffs(const baseline_job_t *j, u32 epoch,
+                        double receiver_ecef[3], sdiff_t *sdiffs)
+{
+  receiver_ecef[0] = WGS84_A;
+  receiver_ecef[1] = 0;
+  receiver_ecef[2] = 0;
+  memset(sdiffs, 0, N_SATS * sizeof(sdiff_t));
+  for (u8 i = 0; i < N_SATS; i++) {
+    double az = 2 * M_PI * i / N_SATS + 1e-3 * epoch;
+    double el = (20 + 60.0 * i / N_SATS) * D2R;
+    double u[3] = {sin(el), cos(el) * sin(az), cos(el) * cos(az)};
+    double range = 0;
+    for (u8 k = 0; k < 3; k++) {
+      sdiffs[i].sat_pos[k] = receiver_ecef[k] + 20200e3 * u[k];
+      range += u[k] * j->b[k];
+    }
+    double noise = ((s32)((epoch * 7 + i * 13) % 11) - 5) / 10.0;
+    sdiffs[i].sid.sat = i + 1;
+    sdiffs[i].pseudorange = -range + noise;
+    sdiffs[i].carrier_phase = range / GPS_L1_LAMBDA_NO_VAC + j->N[i] +
+                              noise * 1e-2;
+    sdiffs[i].snr = 40;
+  }
+}
+
+/* Each thread owns a disjoint set of baselines, and so of contexts. */
+static void *dgnss_thread(void *arg)
+{
+  thread_job_t *job = arg;
+
+  for (u32 n = job->first; n < N_BASELINES; n += job->stride) {
+    baseline_job_t *j = &baselines[n];
+    dgnss_ctx_init(&j->ctx, MAX_HYPOTHESES, j->hyp_buff);
+    j->ctx.settings.code_var_kf = 1;
+    dgnss_ctx_process_epochs(&j->ctx, N_EPOCHS, j->epochs, j->sdiffs,
+                             false, DEFAULT_RAIM_THRESHOLD, j->solutions);
+  }
+  return NULL;
+}
+
+static double run(u32 n_threads)
+{
+  thread_job_t jobs[MAX_THREADS];
+  pthread_t threads[MAX_THREADS];
+
+  double t0 = bench_time();
+  for (u32 t = 0; t < n_threads; t++) {
+    jobs[t].first = t;
+    jobs[t].stride = n_threads;
+    pthread_create(&threads[t], NULL, dgnss_thread, &jobs[t]);
+  }
+  for (u32 t = 0; t < n_threads; t++)
+    pthread_join(threads[t], NULL);
+  return bench_time() - t0;
+}
+
+int main(void)
+{
+  baselines = calloc(N_BASELINES, sizeof(baseline_job_t));
+  srand(1);
+  for (u32 n = 0; n < N_BASELINES; n++) {
+    for (u8 k = 0; k < 3; k++)
+      baselines[n].b[k] = (rand() % 20000) / 10.0 - 1000;
+    for (u8 i = 0; i < N_SATS; i++)
+      baselines[n].N[i] = rand() % 100 - 50;
+    for (u32 e = 0; e < N_EPOCHS; e++) {
+      baselines[n].epochs[e].num_sats = N_SATS;
+      make_sdiffs(&baselines[n], e, baselines[n].epochs[e].receiver_ecef,
+                  &baselines[n].sdiffs[e * N_SATS]);
+    }
+  }
+
+  long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  u32 n_max = MIN(MAX(n_cpus, 1), MAX_THREADS);
+
+  printf("%d baselines, %d sats, %d epochs each\n",
+         N_BASELINES, N_SATS, N_EPOCHS);
+  double t1 = run(1);
+  printf("1 thread:   %8.3f s (%.0f epochs/s)\n",
+         t1, N_BASELINES * N_EPOCHS / t1);
+  for (u32 n_threads = 2; n_threads <= n_max; n_threads *= 2) {
+    double tn = run(n_threads);
+    printf("%2u threads: %8.3f s (speedup %.2f)\n",
+           n_threads, tn, t1 / tn);
+  }
+
+  u32 n_fixed = 0;
+  for (u32 n = 0; n < N_BASELINES; n++)
+    n_fixed += baselines[n].solutions[N_EPOCHS - 1].ret == 1;
+  printf("%u / %d baselines resolved\n", n_fixed, N_BASELINES);
+
+  free(baselines);
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <libswiftnav/lambda.h>
+
+#include "bench_utils.h"
+
+#define N_AMBS 10
+#define N_PROBLEMS 64
+#define N_REPEATS 200
+
+typedef struct {
+  double a[N_AMBS];
+  double Q[N_AMBS * N_AMBS];
+} lambda_problem_t;
+
+static lambda_problem_t problems[N_PROBLEMS];
+/* Keeps the solutions from being optimised away. */
+static volatile double sink;
+
+void log_(u8 level, const char *msg, ...)
+{
+  (void)level;
+  (void)msg;
+}
+
+static double urand(void)
+{
+  return (double)rand() / RAND_MAX - 0.5;
+}
+
+/* Float ambiguities as from a short RTK float solution: the covariance is
+ * dominated by the baseline uncertainty, so the ambiguities are strongly
+ * correlated. */
+static void make_problem(lambda_problem_t *p, double baseline_sigma)
+{
+  double B[N_AMBS * 3];
+  for (u32 i = 0; i < N_AMBS * 3; i++)
+    B[i] = baseline_sigma * urand();
+  for (u32 i = 0; i < N_AMBS; i++) {
+    for (u32 j = 0; j < N_AMBS; j++) {
+      double q = i == j ? 0.01 : 0;
+      for (u32 k = 0; k < 3; k++)
+        q += B[3*i + k] * B[3*j + k];
+      p->Q[i + j * N_AMBS] = q;
+    }
+    p->a[i] = (rand() % 100 - 50) + 0.2 * urand();
+  }
+}
+
+static double run(void)
+{
+  double F[N_AMBS * 2], s[2];
+  double t0 = bench_time();
+  for (u32 r = 0; r < N_REPEATS; r++) {
+    for (u32 n = 0; n < N_PROBLEMS; n++) {
+      lambda_solution(N_AMBS, 2, problems[n].a, problems[n].Q, F, s);
+      sink += F[0];
+    }
+  }
+  return bench_time() - t0;
+}
+
+/* Decorrelation of a covariance that changes slowly from epoch to epoch,
+ * as the float solution converges, cold and warm started. */
+static void run_epochs(double baseline_sigma)
+{
+  static double Qs[N_PROBLEMS][N_AMBS * N_AMBS];
+  double Z[N_AMBS * N_AMBS];
+  lambda_reduction_t r;
+
+  make_problem(&problems[0], baseline_sigma);
+  for (u32 n = 0; n < N_PROBLEMS; n++)
+    for (u32 i = 0; i < N_AMBS * N_AMBS; i++)
+      Qs[n][i] = problems[0].Q[i] * (1 - 0.005 * n) +
+                 (i % (N_AMBS + 1) == 0 ? 1e-3 * n : 0);
+
+  double t0 = bench_time();
+  for (u32 k = 0; k < N_REPEATS; k++)
+    for (u32 n = 0; n < N_PROBLEMS; n++) {
+      lambda_reduction(N_AMBS, Qs[n], Z);
+      sink += Z[0];
+    }
+  double t_cold = bench_time() - t0;
+
+  u32 steps = 0, cold_steps = 0;
+  t0 = bench_time();
+  for (u32 k = 0; k < N_REPEATS; k++) {
+    lambda_reduction_init(&r);
+    for (u32 n = 0; n < N_PROBLEMS; n++) {
+      lambda_reduction_update(&r, N_AMBS, Qs[n]);
+      sink += r.Z[0];
+      steps += r.steps;
+    }
+    cold_steps += r.cold_steps;
+  }
+  double t_warm = bench_time() - t0;
+
+  printf("Baseline sigma %4.1f cycles: reduction cold %.3f s, warm %.3f s "
+         "(%.1f steps/epoch after the first, %u cold)\n",
+         baseline_sigma, t_cold, t_warm,
+         (double)(steps - cold_steps) / (N_REPEATS * (N_PROBLEMS - 1)),
+         cold_steps / N_REPEATS);
+}
+
+int main(void)
+{
+  srand(1);
+  printf("%d ambiguities, %d problems x %d repeats\n",
+         N_AMBS, N_PROBLEMS, N_REPEATS);
+
+  double sigmas[] = {0.5, 5, 50};
+  for (u32 k = 0; k < sizeof(sigmas) / sizeof(sigmas[0]); k++) {
+    for (u32 n = 0; n < N_PROBLEMS; n++)
+      make_problem(&problems[n], sigmas[k]);
+    double t = run();
+    printf("Baseline sigma %4.1f cycles: %8.3f s (%.0f solutions/s)\n",
+           sigmas[k], t, N_PROBLEMS * N_REPEATS / t);
+  }
+
+  for (u32 k = 0; k < sizeof(sigmas) / sizeof(sigmas[0]); k++)
+    run_epochs(sigmas[k]);
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <libswiftnav/orbit_cache.h>
+
+#include "bench_utils.h"
+
+/* One hour of 10 Hz measurements of 12 satellites, with three transmit time
+ * iterations per measurement as in a PVT solution. */
+#define N_SATS 12
+#define N_EPOCHS 36000
+#define ITERATIONS 3
+#define EPOCH_INTERVAL 0.1
+
+static ephemeris_t eph[N_SATS];
+static orbit_cache_t cache;
+/* Keeps the satellite states from being optimised away. */
+static volatile double sink;
+
+/* Only reached from the direct path if an ephemeris is out of date. */
+void log_(u8 level, const char *msg, ...)
+{
+  (void)level;
+  (void)msg;
+}
+
+static void make_ephemeris(ephemeris_t *e, u8 sat)
+{
+  memset(e, 0, sizeof(*e));
+  e->sid.sat = sat;
+  e->sid.band = BAND_L1;
+  e->sid.constellation = CONSTELLATION_GPS;
+  e->toe.wn = 1866;
+  e->toe.tow = 518400;
+  e->fit_interval = 4;
+  e->valid = 1;
+  e->healthy = 1;
+  e->kepler.toc = e->toe;
+  e->kepler.sqrta = 5153.6;
+  e->kepler.ecc = 0.002 * sat;
+  e->kepler.m0 = 0.5 * sat;
+  e->kepler.omega0 = 0.5 * sat;
+  e->kepler.inc = 0.96;
+  e->kepler.crc = 220.0;
+  e->kepler.af0 = 1.2e-4;
+}
+
+static double run(bool use_cache)
+{
+  double pos[3], vel[3], clock_err, clock_rate_err;
+
+  orbit_cache_init(&cache);
+  double t0 = bench_time();
+  for (u32 n = 0; n < N_EPOCHS; n++) {
+    for (u8 i = 0; i < N_SATS; i++) {
+      for (u8 k = 0; k < ITERATIONS; k++) {
+        gps_time_t t = eph[i].toe;
+        t.tow += n * EPOCH_INTERVAL - 0.07 - 1e-5 * k;
+        if (use_cache)
+          orbit_cache_sat_state(&cache, &eph[i], &t, pos, vel,
+                                &clock_err, &clock_rate_err);
+        else
+          calc_sat_state(&eph[i], &t, pos, vel, &clock_err, &clock_rate_err);
+        sink = pos[0];
+      }
+    }
+  }
+  return bench_time() - t0;
+}
+
+int main(void)
+{
+  for (u8 i = 0; i < N_SATS; i++)
+    make_ephemeris(&eph[i], i + 1);
+
+  printf("%d satellites, %d epochs, %d iterations\n",
+         N_SATS, N_EPOCHS, ITERATIONS);
+  double n_states = (double)N_SATS * N_EPOCHS * ITERATIONS;
+  double t = run(false);
+  printf("calc_sat_state        %6.1f ns/state\n", t / n_states * 1e9);
+  t = run(true);
+  printf("orbit_cache_sat_state %6.1f ns/state (%u fits)\n",
+         t / n_states * 1e9, cache.misses);
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <libswiftnav/constants.h>
+#include <libswiftnav/coord_system.h>
+#include <libswiftnav/pvt.h>
+
+#include "bench_utils.h"
+
+#define N_EPOCHS 20000
+#define MAX_THREADS 64
+
+/* Keep solver messages out of the timings. */
+void log_(u8 level, const char *msg, ...)
+{
+  (void)level;
+  (void)msg;
+}
+
+typedef struct {
+  pvt_impl_t impl;
+  u32 first;
+  u32 count;
+} thread_job_t;
+
+static u8 n_used[N_EPOCHS];
+static u32 offset[N_EPOCHS];
+static navigation_measurement_t *nav_meas;
+static s8 ret[N_EPOCHS];
+static gnss_solution soln[N_EPOCHS];
+static dops_t dops[N_EPOCHS];
+
+static double uniform(void)
+{
+  return rand() / (RAND_MAX + 1.0);
+}
+
+/* A receiver somewhere on the ground seeing between 6 and MAX_CHANNELS
+ * satellites, with metre-level pseudorange noise. */
+static u8 make_epoch(navigation_measurement_t *nm)
+{
+  double llh[3] = {(uniform() - 0.5) * M_PI * 0.9,
+                   (uniform() - 0.5) * 2 * M_PI,
+                   uniform() * 1000};
+  double rx[3];
+  wgsllh2ecef(llh, rx);
+  double clock = (uniform() - 0.5) * 1e5;
+
+  double M[3][3];
+  ecef2ned_matrix(llh, M);
+  u8 n = 6 + rand() % (MAX_CHANNELS - 5);
+  memset(nm, 0, n * sizeof(navigation_measurement_t));
+  for (u8 i = 0; i < n; i++) {
+    double az = 2 * M_PI * (i + uniform()) / n;
+    double el = (10 + 75 * uniform()) * D2R;
+    double ned[3] = {cos(el) * cos(az), cos(el) * sin(az), -sin(el)};
+    double range = 20200e3 + 5000e3 * (1 - sin(el));
+    for (u8 k = 0; k < 3; k++) {
+      double u = M[0][k] * ned[0] + M[1][k] * ned[1] + M[2][k] * ned[2];
+      nm[i].sat_pos[k] = rx[k] + range * u;
+    }
+    nm[i].sid.sat = i + 1;
+    nm[i].pseudorange = range + clock + (uniform() - 0.5) * 4;
+  }
+  return n;
+}
+
+static void *pvt_thread(void *arg)
+{
+  thread_job_t *job = arg;
+  calc_PVT_batch(job->impl, job->count, &n_used[job->first],
+                 &nav_meas[offset[job->first]], false, &ret[job->first],
+                 &soln[job->first], &dops[job->first]);
+  return NULL;
+}
+
+static double run(pvt_impl_t impl, u32 n_threads)
+{
+  thread_job_t jobs[MAX_THREADS];
+  pthread_t threads[MAX_THREADS];
+
+  double t0 = bench_time();
+  for (u32 t = 0; t < n_threads; t++) {
+    jobs[t].impl = impl;
+    jobs[t].first = N_EPOCHS * t / n_threads;
+    jobs[t].count = N_EPOCHS * (t + 1) / n_threads - jobs[t].first;
+    pthread_create(&threads[t], NULL, pvt_thread, &jobs[t]);
+  }
+  for (u32 t = 0; t < n_threads; t++)
+    pthread_join(threads[t], NULL);
+  return bench_time() - t0;
+}
+
+int main(void)
+{
+  static const struct {
+    pvt_impl_t impl;
+    const char *name;
+  } impls[] = {
+    {PVT_IMPL_GENERIC, "generic"},
+    {PVT_IMPL_AVX2, "avx2"},
+  };
+
+  nav_meas = calloc(N_EPOCHS * MAX_CHANNELS, sizeof(navigation_measurement_t));
+  srand(1);
+  u32 n_meas = 0;
+  for (u32 e = 0; e < N_EPOCHS; e++) {
+    offset[e] = n_meas;
+    n_used[e] = make_epoch(&nav_meas[n_meas]);
+    n_meas += n_used[e];
+  }
+
+  printf("%d epochs, %.1f measurements each\n",
+         N_EPOCHS, (double)n_meas / N_EPOCHS);
+
+  double t0 = bench_time();
+  for (u32 e = 0; e < N_EPOCHS; e++)
+    ret[e] = calc_PVT(n_used[e], &nav_meas[offset[e]], false, &soln[e],
+                      &dops[e]);
+  double t = bench_time() - t0;
+  printf("calc_PVT:        %8.0f epochs/s\n", N_EPOCHS / t);
+
+  long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  u32 n_max = MIN(MAX(n_cpus, 1), MAX_THREADS);
+
+  for (u32 i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+    if (!pvt_impl_supported(impls[i].impl))
+      continue;
+    for (u32 n_threads = 1; n_threads <= n_max; n_threads *= 2) {
+      t = run(impls[i].impl, n_threads);
+      printf("batch %-7s %2u thread%s %8.0f epochs/s\n", impls[i].name,
+             n_threads, n_threads == 1 ? ": " : "s:", N_EPOCHS / t);
+    }
+  }
+
+  u32 n_valid = 0;
+  for (u32 e = 0; e < N_EPOCHS; e++)
+    n_valid += ret[e] >= 0;
+  printf("%u / %d epochs solved\n", n_valid, N_EPOCHS);
+
+  free(nav_meas);
+  return 0;
+}
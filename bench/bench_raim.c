@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <libswiftnav/baseline.h>
+#include <libswiftnav/constants.h>
+
+#include "bench_utils.h"
+
+#define N_DDS 10
+#define N_PROBLEMS 64
+#define N_REPEATS 2000
+
+typedef struct {
+  double DE[N_DDS * 3];
+  double N[N_DDS];
+  double dd_obs[N_DDS];
+} raim_problem_t;
+
+static raim_problem_t problems[N_PROBLEMS];
+/* Keeps the solutions from being optimised away. */
+static volatile double sink;
+
+/* Double differences for a random sky and baseline, optionally with a
+ * cycle slip on one of them. */
+static void make_problem(raim_problem_t *p, bool slip)
+{
+  double ref[3] = {0, 0, 1};
+  double b[3];
+  for (u8 k = 0; k < 3; k++)
+    b[k] = (rand() % 20000) / 10.0 - 1000;
+  for (u8 i = 0; i < N_DDS; i++) {
+    double az = 2 * M_PI * (rand() % 3600) / 3600;
+    double el = (15 + (rand() % 700) / 10.0) * D2R;
+    double e[3] = {cos(el) * sin(az), cos(el) * cos(az), sin(el)};
+    for (u8 k = 0; k < 3; k++)
+      p->DE[3*i + k] = e[k] - ref[k];
+    p->N[i] = rand() % 100 - 50;
+  }
+  predict_carrier_obs(N_DDS, p->N, p->DE, b, p->dd_obs);
+  for (u8 i = 0; i < N_DDS; i++)
+    p->dd_obs[i] += ((rand() % 1000) / 1000.0 - 0.5) * 0.02;
+  if (slip)
+    p->dd_obs[rand() % N_DDS] += 7;
+}
+
+static double run(void)
+{
+  double b[3];
+  u8 n_used;
+  double t0 = bench_time();
+  for (u32 r = 0; r < N_REPEATS; r++) {
+    for (u32 n = 0; n < N_PROBLEMS; n++) {
+      raim_problem_t *p = &problems[n];
+      lesq_solve_raim(N_DDS, p->dd_obs, p->N, p->DE, b,
+                      false, DEFAULT_RAIM_THRESHOLD, &n_used, 0, 0);
+      sink += b[0];
+    }
+  }
+  return bench_time() - t0;
+}
+
+int main(void)
+{
+  srand(1);
+  printf("%d double differences, %d problems x %d repeats\n",
+         N_DDS, N_PROBLEMS, N_REPEATS);
+
+  for (u32 n = 0; n < N_PROBLEMS; n++)
+    make_problem(&problems[n], false);
+  double t_clean = run();
+  printf("No fault:    %8.3f s (%.0f solutions/s)\n",
+         t_clean, N_PROBLEMS * N_REPEATS / t_clean);
+
+  for (u32 n = 0; n < N_PROBLEMS; n++)
+    make_problem(&problems[n], true);
+  double t_slip = run();
+  printf("Cycle slip:  %8.3f s (%.0f solutions/s)\n",
+         t_slip, N_PROBLEMS * N_REPEATS / t_slip);
+
+  return 0;
+}
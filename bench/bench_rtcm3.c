@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <libswiftnav/constants.h>
+#include <libswiftnav/rtcm3.h>
+
+#include "bench_utils.h"
+
+/* A base station stream of one MSM7 and one 1004 message per epoch with an
+ * ephemeris every ten epochs, parsed in network sized chunks. */
+#define N_EPOCHS 20000
+#define N_SATS 12
+#define CHUNK 1460
+
+static u8 stream[N_EPOCHS * (2 * RTCM3_MAX_FRAME_LEN / 3)];
+
+static rtcm3_obs_msg_t obs;
+static rtcm3_msm_t msm;
+static ephemeris_t eph;
+static u32 n_decoded, n_failed;
+
+static void decode_msg(u16 type, const u8 *msg, u16 len, void *context)
+{
+  (void)len;
+  (void)context;
+  s8 ret;
+  switch (type) {
+  case 1004: ret = rtcm3_decode_1004(msg, &obs); break;
+  case 1019: ret = rtcm3_decode_1019(msg, &eph); break;
+  default: ret = rtcm3_decode_msm(msg, &msm); break;
+  }
+  if (ret < 0)
+    n_failed++;
+  else
+    n_decoded++;
+}
+
+static u32 add_frame(u32 n, u16 len)
+{
+  rtcm3_write_frame(len, &stream[n]);
+  return n + len + 6;
+}
+
+int main(void)
+{
+  memset(&obs, 0, sizeof(obs));
+  obs.n_sat = N_SATS;
+  memset(&msm, 0, sizeof(msm));
+  msm.type = 1077;
+  msm.n_sat = N_SATS;
+  for (u8 i = 0; i < N_SATS; i++) {
+    double range = 20e6 + 2e5 * i;
+    obs.obs[i].sat = 2 * i + 1;
+    msm.sats[i].id = 2 * i + 1;
+    for (u8 b = 0; b < 2; b++) {
+      obs.obs[i].flags[b] = RTCM3_OBS_PR | RTCM3_OBS_CP;
+      obs.obs[i].pseudorange[b] = range + b;
+      obs.obs[i].carrier_phase[b] = range / GPS_L1_LAMBDA + 10.5 * b;
+      obs.obs[i].cnr[b] = 45;
+      rtcm3_msm_cell_t *c = &msm.cells[msm.n_cell++];
+      c->sat = i;
+      c->sig = b ? 16 : 2;
+      c->flags = RTCM3_OBS_PR | RTCM3_OBS_CP | RTCM3_OBS_RATE;
+      c->pseudorange = range + b;
+      c->phase_range = range + 0.3 * b;
+      c->phase_range_rate = 100.0 * i;
+      c->cnr = 45;
+    }
+  }
+  memset(&eph, 0, sizeof(eph));
+  eph.sid.sat = 7;
+  eph.kepler.sqrta = 5153.6;
+
+  u32 n_stream = 0, n_msgs = 0;
+  for (u32 e = 0; e < N_EPOCHS; e++) {
+    obs.tow_ms = msm.epoch = 1000 * e;
+    n_stream = add_frame(n_stream,
+                         rtcm3_encode_msm(&stream[n_stream + 3], &msm));
+    n_stream = add_frame(n_stream,
+                         rtcm3_encode_1004(&stream[n_stream + 3], &obs));
+    n_msgs += 2;
+    if (e % 10 == 0) {
+      n_stream = add_frame(n_stream,
+                           rtcm3_encode_1019(&stream[n_stream + 3], &eph));
+      n_msgs++;
+    }
+  }
+
+  rtcm3_parser_t p;
+  rtcm3_parser_init(&p);
+  double t0 = bench_time();
+  u32 n_frames = 0;
+  for (u32 i = 0; i < n_stream; i += CHUNK)
+    n_frames += rtcm3_parser_process(&p, &stream[i],
+                                     MIN(CHUNK, n_stream - i));
+  double t_parse = bench_time() - t0;
+
+  rtcm3_parser_init(&p);
+  rtcm3_parser_register(&p, 0, decode_msg, NULL);
+  t0 = bench_time();
+  for (u32 i = 0; i < n_stream; i += CHUNK)
+    rtcm3_parser_process(&p, &stream[i], MIN(CHUNK, n_stream - i));
+  double t_decode = bench_time() - t0;
+
+  printf("%u messages, %u bytes, %d byte chunks\n", n_msgs, n_stream, CHUNK);
+  printf("framing only:    %8.0f messages/s (%.1f MB/s)\n",
+         n_frames / t_parse, n_stream / t_parse / 1e6);
+  printf("framing, decode: %8.0f messages/s (%u decoded, %u failed)\n",
+         n_decoded / t_decode, n_decoded, n_failed);
+
+  return 0;
+}
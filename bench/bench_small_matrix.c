@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cblas.h>
+
+#include <libswiftnav/linear_algebra.h>
+#include <libswiftnav/small_matrix.h>
+
+#include "bench_utils.h"
+
+#define D SMAT_MAX_DIM
+
+/* Operands of every kernel: A n by n, B n by n, S symmetric positive
+ * definite n by n, U unit upper triangular n by n. */
+typedef struct {
+  u32 n;
+  double A[D * D], B[D * D], S[D * D], U[D * D], L[D * D], d[D];
+  double C[D * D];
+} work_t;
+
+typedef void (*kernel_fn)(work_t *w);
+
+typedef struct {
+  const char *name;
+  kernel_fn smat;
+  kernel_fn ref;
+  const char *ref_name;
+} bench_kernel_t;
+
+/* Keeps the results from being optimised away. */
+static volatile double sink;
+
+static void mul_smat(work_t *w)
+{
+  smat_mul(w->n, w->n, w->n, w->A, w->B, w->C);
+}
+
+static void mul_la(work_t *w)
+{
+  matrix_multiply(w->n, w->n, w->n, w->A, w->B, w->C);
+}
+
+static void mv_smat(work_t *w)
+{
+  smat_mul(w->n, w->n, 1, w->A, w->B, w->C);
+}
+
+static void mv_blas(work_t *w)
+{
+  cblas_dgemv(CblasRowMajor, CblasNoTrans, w->n, w->n, 1, w->A, w->n,
+              w->B, 1, 0, w->C, 1);
+}
+
+static void ata_smat(work_t *w)
+{
+  smat_ata(w->n, w->n, w->A, w->C);
+}
+
+static void ata_la(work_t *w)
+{
+  double T[D * D];
+  matrix_transpose(w->n, w->n, w->A, T);
+  matrix_multiply(w->n, w->n, w->n, T, w->A, w->C);
+}
+
+static void asat_smat(work_t *w)
+{
+  smat_asat(w->n, w->n, w->A, w->S, w->C);
+}
+
+static void asat_blas(work_t *w)
+{
+  double T[D * D];
+  cblas_dsymm(CblasRowMajor, CblasRight, CblasUpper, w->n, w->n,
+              1, w->S, w->n, w->A, w->n, 0, T, w->n);
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, w->n, w->n, w->n,
+              1, T, w->n, w->A, w->n, 0, w->C, w->n);
+}
+
+static void solve_smat(work_t *w)
+{
+  smat_cholesky(w->n, w->S, w->L);
+  memcpy(w->C, w->B, w->n * sizeof(double));
+  smat_cholesky_solve(w->n, w->L, 1, w->C);
+}
+
+static void solve_ldl(work_t *w)
+{
+  smat_ldl(w->n, w->S, w->L, w->d);
+  memcpy(w->C, w->B, w->n * sizeof(double));
+  smat_ldl_solve(w->n, w->L, w->d, 1, w->C);
+}
+
+static void solve_la(work_t *w)
+{
+  double Si[D * D];
+  matrix_inverse(w->n, w->S, Si);
+  matrix_multiply(w->n, w->n, 1, Si, w->B, w->C);
+}
+
+static void inv_smat(work_t *w)
+{
+  smat_cholesky(w->n, w->S, w->L);
+  smat_cholesky_inverse(w->n, w->L, w->C);
+}
+
+static void inv_la(work_t *w)
+{
+  matrix_inverse(w->n, w->S, w->C);
+}
+
+static void utmv_smat(work_t *w)
+{
+  memcpy(w->C, w->B, w->n * sizeof(double));
+  smat_unit_upper_tmul(w->n, 1, w->U, w->C);
+}
+
+static void utmv_blas(work_t *w)
+{
+  memcpy(w->C, w->B, w->n * sizeof(double));
+  cblas_dtrmv(CblasRowMajor, CblasUpper, CblasTrans, CblasUnit,
+              w->n, w->U, w->n, w->C, 1);
+}
+
+static void au_smat(work_t *w)
+{
+  smat_mul_unit_upper(w->n, w->n, w->A, w->U, w->C);
+}
+
+static void au_la(work_t *w)
+{
+  matrix_multiply(w->n, w->n, w->n, w->A, w->U, w->C);
+}
+
+static const bench_kernel_t kernels[] = {
+  {"A B",         mul_smat,   mul_la,    "matrix_multiply"},
+  {"A x",         mv_smat,    mv_blas,   "cblas_dgemv"},
+  {"A'A",         ata_smat,   ata_la,    "matrix_multiply"},
+  {"A S A'",      asat_smat,  asat_blas, "cblas_dsymm+dgemm"},
+  {"S x = b",     solve_smat, solve_la,  "matrix_inverse"},
+  {"S x = b LDL", solve_ldl,  solve_la,  "matrix_inverse"},
+  {"S^-1",        inv_smat,   inv_la,    "matrix_inverse"},
+  {"U' x",        utmv_smat,  utmv_blas, "cblas_dtrmv"},
+  {"A U",         au_smat,    au_la,     "matrix_multiply"},
+};
+
+static double urand(void)
+{
+  return (double)rand() / RAND_MAX - 0.5;
+}
+
+static void make_work(work_t *w, u32 n)
+{
+  w->n = n;
+  for (u32 i = 0; i < n * n; i++) {
+    w->A[i] = urand();
+    w->B[i] = urand();
+  }
+  for (u32 i = 0; i < n; i++) {
+    for (u32 j = 0; j < n; j++) {
+      double x = i == j ? 0.1 : 0;
+      for (u32 k = 0; k < n; k++)
+        x += w->A[k*n + i] * w->A[k*n + j];
+      w->S[i*n + j] = x;
+      w->U[i*n + j] = i == j ? 1 : (j > i ? urand() : 0);
+    }
+  }
+}
+
+/* Time per call [ns]. */
+static double time_kernel(kernel_fn f, work_t *w)
+{
+  u32 reps = 2000000 / (w->n * w->n) + 10000;
+  for (u32 r = 0; r < reps / 10; r++)
+    f(w);
+  double t0 = bench_time();
+  for (u32 r = 0; r < reps; r++) {
+    f(w);
+    sink += w->C[0];
+  }
+  return (bench_time() - t0) / reps * 1e9;
+}
+
+int main(void)
+{
+  static work_t w;
+  u32 sizes[] = {3, 4, 8, 2 * MAX_CHANNELS - 5, D};
+
+  srand(1);
+  bool avx2 = smat_impl_supported(SMAT_IMPL_AVX2);
+  printf("%-12s %3s %10s %10s %10s  %s\n", "kernel", "n", "smat [ns]",
+         "C [ns]", "ref [ns]", "reference");
+
+  for (u32 k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    for (u32 s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      make_work(&w, sizes[s]);
+      smat_set_impl(SMAT_IMPL_AUTO);
+      double t_smat = time_kernel(kernels[k].smat, &w);
+      smat_set_impl(SMAT_IMPL_GENERIC);
+      double t_generic = avx2 ? time_kernel(kernels[k].smat, &w) : t_smat;
+      smat_set_impl(SMAT_IMPL_AUTO);
+      double t_ref = time_kernel(kernels[k].ref, &w);
+      printf("%-12s %3u %10.1f %10.1f %10.1f  %s\n", kernels[k].name,
+             sizes[s], t_smat, t_generic, t_ref, kernels[k].ref_name);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <libswiftnav/track_bank.h>
+
+#include "bench_utils.h"
+
+/* Loop updates per channel, i.e. 10 s of tracking at 1 kHz. */
+#define UPDATES 10000
+/* Distinct sets of correlations cycled through. */
+#define N_SETS 16
+
+static aided_tl_state_t tl[TRACK_BANK_MAX_CHANNELS];
+static lock_detect_t ld[TRACK_BANK_MAX_CHANNELS];
+static cn0_est_state_t cn0[TRACK_BANK_MAX_CHANNELS];
+static correlation_t cs[N_SETS][TRACK_BANK_MAX_CHANNELS][3];
+static track_bank_t bank;
+/* Keeps the C/N0 computations from being optimised away. */
+static volatile float sink;
+
+static float rand_corr(float amp)
+{
+  return amp * (2.0f * rand() / RAND_MAX - 1.0f);
+}
+
+static void setup(u32 n_channels)
+{
+  track_bank_init(&bank, n_channels);
+  for (u32 i = 0; i < n_channels; i++) {
+    float doppler = rand_corr(4000);
+    aided_tl_init(&tl[i], 1000, doppler / 1540, 1, 0.7, 1,
+                  1540, doppler, 10, 0.7, 1, 5);
+    lock_detect_init(&ld[i], 0.02, 1.5, 50, 150);
+    cn0_est_init(&cn0[i], 1e3, 40, 5, 1e3);
+    track_bank_set_aided(&bank, i, &tl[i], &ld[i], &cn0[i]);
+  }
+}
+
+int main(void)
+{
+  static const u32 channel_counts[] = {12, 32, 128};
+
+  for (u32 s = 0; s < N_SETS; s++) {
+    for (u32 i = 0; i < TRACK_BANK_MAX_CHANNELS; i++) {
+      for (u32 j = 0; j < 3; j++) {
+        cs[s][i][j].I = (j == 1 ? 1000 : 500) + rand_corr(100);
+        cs[s][i][j].Q = rand_corr(100);
+      }
+    }
+  }
+
+  for (u32 k = 0; k < sizeof(channel_counts) / sizeof(channel_counts[0]);
+       k++) {
+    u32 n = channel_counts[k];
+    setup(n);
+    double t0 = bench_time();
+    for (u32 r = 0; r < UPDATES; r++) {
+      for (u32 i = 0; i < n; i++) {
+        correlation_t *c = cs[r % N_SETS][i];
+        aided_tl_update(&tl[i], c);
+        lock_detect_update(&ld[i], c[1].I, c[1].Q, 1e-3);
+        sink = cn0_est(&cn0[i], c[1].I, c[1].Q);
+      }
+    }
+    double dt_scalar = bench_time() - t0;
+
+    t0 = bench_time();
+    for (u32 r = 0; r < UPDATES; r++) {
+      track_bank_update(&bank, cs[r % N_SETS], 1e-3);
+      sink = bank.cn0[0];
+    }
+    double dt_bank = bench_time() - t0;
+
+    printf("%3u channels  per-channel %7.1f ns  bank %7.1f ns  "
+           "per channel update (%.2fx)\n",
+           n, 1e9 * dt_scalar / UPDATES / n, 1e9 * dt_bank / UPDATES / n,
+           dt_scalar / dt_bank);
+  }
+
+  return 0;
+}
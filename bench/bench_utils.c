@@ -0,0 +1,11 @@
+#include <time.h>
+
+#include "bench_utils.h"
+
+/** Monotonic wall clock time in seconds. */
+double bench_time(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
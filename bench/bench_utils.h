@@ -0,0 +1,8 @@
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <libswiftnav/common.h>
+
+double bench_time(void);
+
+#endif /* BENCH_UTILS_H */
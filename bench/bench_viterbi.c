@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <libfec/fec.h>
+
+#include "bench_utils.h"
+
+/* 10 s of L2C CNAV symbols per channel, at 25 bits per second. */
+#define N_CHANNELS 32
+#define N_BITS 250
+#define DECISIONS 64
+#define N_SYMBOLS (2 * N_BITS * N_CHANNELS)
+#define REPEATS 100
+
+static unsigned char syms[N_SYMBOLS];
+/* Keeps the chainback from being optimised away. */
+static volatile unsigned char sink;
+
+static double run(v27_impl_t impl)
+{
+  static v27_t v[N_CHANNELS];
+  static v27_decision_t decisions[N_CHANNELS][DECISIONS];
+  v27_poly_t poly;
+  const signed char poly_bytes[2] = {V27POLYA, -V27POLYB};
+  unsigned char data[DECISIONS / 8];
+
+  v27_poly_init(&poly, poly_bytes);
+  for (int c = 0; c < N_CHANNELS; c++) {
+    v27_init(&v[c], decisions[c], DECISIONS, &poly, 0);
+    v27_set_impl(&v[c], impl);
+  }
+
+  /* Symbol by symbol, as fed by the CNAV decoder. */
+  double t0 = bench_time();
+  for (int r = 0; r < REPEATS; r++) {
+    for (int b = 0; b < N_BITS; b++) {
+      for (int c = 0; c < N_CHANNELS; c++) {
+        v27_update(&v[c], &syms[2 * (b * N_CHANNELS + c)], 1);
+        if (b % 32 == 31) {
+          v27_chainback_likely(&v[c], data, DECISIONS);
+          sink = data[0];
+        }
+      }
+    }
+  }
+  return bench_time() - t0;
+}
+
+int main(void)
+{
+  static const struct {
+    v27_impl_t impl;
+    const char *name;
+  } impls[] = {
+    {V27_IMPL_PORTABLE, "portable"},
+    {V27_IMPL_SSE2, "sse2"},
+    {V27_IMPL_AVX2, "avx2"},
+  };
+
+  for (int i = 0; i < N_SYMBOLS; i++)
+    syms[i] = rand() & 0xff;
+
+  printf("%d channels, %d bits each, %d times\n",
+         N_CHANNELS, N_BITS, REPEATS);
+  for (unsigned i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+    if (!v27_impl_supported(impls[i].impl))
+      continue;
+    double t = run(impls[i].impl);
+    printf("%-10s %8.2f Mbit/s\n", impls[i].name,
+           (double)N_BITS * N_CHANNELS * REPEATS / t * 1e-6);
+  }
+
+  return 0;
+}
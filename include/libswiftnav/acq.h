@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LIBSWIFTNAV_ACQ_H
+#define LIBSWIFTNAV_ACQ_H
+
+#include <stddef.h>
+
+#include <libswiftnav/common.h>
+#include <libswiftnav/fft.h>
+#include <libswiftnav/signal.h>
+
+/** \addtogroup acq
+ * \{ */
+
+/** Result of an acquisition search for one signal. */
+typedef struct {
+  gnss_signal_t sid; /**< Signal searched for. */
+  float cp;          /**< Code phase at the first sample in chips. */
+  float cf;          /**< Carrier frequency in Hz. */
+  float snr;         /**< Ratio of the correlation peak to the mean
+                          correlation power over the search grid. */
+} acq_result_t;
+
+/** Acquisition search state.
+ * Should be initialised with acq_init().
+ */
+typedef struct {
+  u32 n;               /**< Samples per code period, the FFT length. */
+  double sample_freq;  /**< Sample frequency in Hz. */
+  fft_plan_t fft;      /**< FFT plan of length `n`. */
+  fft_cpx_t *baseband; /**< Work area, samples mixed to baseband. */
+  fft_cpx_t *sig_fft;  /**< Work area, FFT of the baseband samples. */
+  fft_cpx_t *prod;     /**< Work area, product of signal and code FFTs. */
+  fft_cpx_t *corr;     /**< Work area, circular correlation. */
+  fft_cpx_t *code_fft[NUM_SATS]; /**< Cached conjugate code FFTs, indexed by
+                                      sid_to_index(), NULL until needed. */
+  u8 *buff;            /**< Storage for the work areas and cached FFTs. */
+  size_t buff_size;    /**< Size of `buff` in bytes. */
+  size_t buff_used;    /**< Bytes of `buff` allocated. */
+} acq_t;
+
+/** \} */
+
+size_t acq_buff_size(u32 n, u32 n_sids, u32 n_bins);
+s8 acq_init(acq_t *a, double sample_freq, void *buff, size_t buff_size);
+s8 acq_search(acq_t *a, const s8 *samples, u32 n_noncoherent,
+              float cf_min, float cf_max, float cf_bin_width,
+              u8 n_sids, const gnss_signal_t *sids, acq_result_t *results);
+
+#endif /* LIBSWIFTNAV_ACQ_H */
@@ -59,6 +59,16 @@ typedef struct {
   double state_cov_D[MAX_STATE_DIM];
   /** A moving average of the log of the weighted sum of squares innovations. */
   double l_sos_avg;
+  /** Number of DDs the cached code block below was built for, 0 if none. */
+  u8 code_block_dim;
+  /** Variance of the phase + code / lambda DD observations the cached code
+   * block was built for. */
+  double code_block_var;
+  /** The U factor of the covariance of the phase + code / lambda DD
+   * observations. Independent of the geometry, so kept between epochs. */
+  double code_block_U[MAX_STATE_DIM * MAX_STATE_DIM];
+  /** The D factor matching `code_block_U`. */
+  double code_block_D[MAX_STATE_DIM];
 } nkf_t;
 
 /** \} */
@@ -13,11 +13,18 @@
 #ifndef LIBSWIFTNAV_AMBIGUITY_TEST_H
 #define LIBSWIFTNAV_AMBIGUITY_TEST_H
 
+#include <libswiftnav/lambda.h>
 #include <libswiftnav/memory_pool.h>
 #include <libswiftnav/sats_management.h>
 
+/** Hypothesis capacity of create_ambiguity_test(). */
 #define MAX_HYPOTHESES 1000
 
+/** Size in bytes of the buffer holding up to `max_hyps` hypotheses, see
+ * ambiguity_test_init(). */
+#define AMBIGUITY_TEST_BUFF_SIZE(max_hyps) \
+  ((max_hyps) * (sizeof(hypothesis_t) + sizeof(void *)))
+
 typedef struct {
   s32 N[MAX_CHANNELS-1];
   float ll;
@@ -37,12 +44,24 @@ typedef struct {
   s32 ambs[MAX_CHANNELS-1];
 } unanimous_amb_check_t; //NOTE maybe do this in a semi-decorrelated space, where more should match sooner.
 
+/** Decorrelations from the last satellite inclusion attempt, used to warm
+ * start the next attempt with the same satellites. */
+typedef struct {
+  sid_set_t float_sids;        /**< Satellites of the float filter. */
+  sid_set_t test_sids;         /**< Satellites already in the test. */
+  gnss_signal_t ref_sid;       /**< Reference satellite. */
+  lambda_reduction_t full;     /**< Of the covariance of all float dds. */
+  lambda_reduction_t addible;  /**< Of the covariance of the addible dds. */
+} decor_cache_t;
+
 typedef struct {
   u8 num_dds;
   memory_pool_t *pool;
+  memory_pool_t pool_storage;
   residual_mtxs_t res_mtxs;
   sats_management_t sats;
   unanimous_amb_check_t amb_check;
+  decor_cache_t decor_cache;
 } ambiguity_test_t;
 
 typedef s64 z_t;
@@ -74,6 +93,9 @@ typedef struct {
 } generate_hypothesis_state_t2;
 
 s8 get_single_hypothesis(ambiguity_test_t *amb_test, s32 *hyp_N);
+s8 ambiguity_test_init(ambiguity_test_t *amb_test, u32 max_hyps, void *buff);
+s8 ambiguity_test_resize(ambiguity_test_t *amb_test, u32 max_hyps, void *buff);
+u32 ambiguity_test_max_hypotheses(ambiguity_test_t *amb_test);
 void create_empty_ambiguity_test(ambiguity_test_t *amb_test);
 void create_ambiguity_test(ambiguity_test_t *amb_test);
 void reset_ambiguity_test(ambiguity_test_t *amb_test);
@@ -111,7 +133,7 @@ z_t float_to_decor(const double *addible_float_cov,
                    u8 num_addible_dds,
                    u8 num_dds_to_add,
                    z_t *lower_bounds, z_t *upper_bounds,
-                   z_t *Z, z_t *Z_inv);
+                   z_t *Z, z_t *Z_inv, lambda_reduction_t *warm);
 // TODO(dsk) delete
 s8 determine_sats_addition(ambiguity_test_t *amb_test,
                            double *float_N_cov, u8 num_float_dds, double *float_N_mean,
@@ -128,6 +150,9 @@ void assign_residual_covariance_inverse(u8 num_dds, double *obs_cov, double *q,
 void assign_r_vec(residual_mtxs_t *res_mtxs, u8 num_dds, double *dd_measurements, double *r_vec);
 void assign_r_mean(residual_mtxs_t *res_mtxs, u8 num_dds, double *hypothesis, double *r_mean);
 double get_quadratic_term(residual_mtxs_t *res_mtxs, u8 num_dds, double *hypothesis, double *r_vec);
+void get_quadratic_terms(const residual_mtxs_t *res_mtxs, u8 num_dds,
+                         u32 n_hyps, const hypothesis_t *hyps,
+                         const double *r_vec, double *q);
 
 void print_hyp(void *arg, element_t *elem);
 void print_intersection_state(intersection_count_t *x);
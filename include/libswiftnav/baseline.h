@@ -66,5 +66,10 @@ s8 lesq_solve_raim(u8 num_dds_u8, const double *dd_obs,
                    const double *N, const double *DE, double b[3],
                    bool disable_raim, double raim_threshold,
                    u8 *n_used, double *residuals, u8 *removed_obs);
+s8 lesq_solve_raim_fde(u8 num_dds, const double *dd_obs,
+                       const double *N, const double *DE, double b[3],
+                       double raim_threshold, u8 max_excluded,
+                       u8 *n_used, double *residuals, bool *excluded,
+                       double *fault_scores);
 
 #endif /* LIBSWIFTNAV_BASELINE_H */
@@ -24,4 +24,63 @@ void bitcopy(void *dst, u32 dst_index,
              const void *src, u32 src_index, u32 count);
 void bitshl(void *buf, u32 size, u32 shift);
 
+/** \addtogroup bits
+ * \{ */
+
+/** Reader of consecutive MSB first bit fields from a buffer.
+ * Loaded bits are kept in an accumulator so that each field is extracted
+ * with a shift and a mask rather than by recomputing its byte offset.
+ * Should be initialised with bitstream_init().
+ */
+typedef struct {
+  const u8 *buff; /**< Buffer being read. */
+  u32 next;       /**< Index of the next byte to load. */
+  u64 acc;        /**< The low `n_acc` bits are loaded but not yet read. */
+  u8 n_acc;       /**< Number of bits loaded but not yet read. */
+} bitstream_t;
+
+void bitstream_init(bitstream_t *s, const u8 *buff, u32 pos);
+
+/** Get the next bit field as an unsigned integer.
+ * Maximum bit field length is 32 bits, i.e. `len <= 32`. Only the bytes
+ * containing the field are read from the buffer.
+ */
+static inline u32 bitstream_getu(bitstream_t *s, u8 len)
+{
+  while (s->n_acc < len) {
+    s->acc = (s->acc << 8) | s->buff[s->next++];
+    s->n_acc += 8;
+  }
+  s->n_acc -= len;
+  return (u32)(s->acc >> s->n_acc) & (u32)((1ull << len) - 1);
+}
+
+/** Get the next bit field as a sign extended signed integer.
+ * Bit field length must be `1 <= len <= 32`.
+ */
+static inline s32 bitstream_gets(bitstream_t *s, u8 len)
+{
+  u32 m = 1u << (len - 1);
+  return (s32)((bitstream_getu(s, len) ^ m) - m);
+}
+
+/** Skip over the next `len` bits. */
+static inline void bitstream_skip(bitstream_t *s, u32 len)
+{
+  if (len <= s->n_acc) {
+    s->n_acc -= len;
+  } else {
+    u32 pos = s->next * 8 - s->n_acc + len;
+    bitstream_init(s, s->buff, pos);
+  }
+}
+
+/** Position of the next bit field in bits from the start of the buffer. */
+static inline u32 bitstream_pos(const bitstream_t *s)
+{
+  return s->next * 8 - s->n_acc;
+}
+
+/** \} */
+
 #endif /* LIBSWIFTNAV_BITS_H */
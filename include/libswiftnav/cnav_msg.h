@@ -92,6 +92,13 @@ bool cnav_msg_decoder_add_symbol(cnav_msg_decoder_t *dec,
                                  unsigned char symbol,
                                  cnav_msg_t *msg,
                                  u32 *delay);
+u32 cnav_msg_decoder_add_symbols(cnav_msg_decoder_t *dec,
+                                 const u8 *symbols,
+                                 u32 n_symbols,
+                                 cnav_msg_t *msgs,
+                                 u32 *delays,
+                                 u32 max_msgs,
+                                 u32 *n_used);
 
 /** \} */
 /** \} */
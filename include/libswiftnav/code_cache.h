@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LIBSWIFTNAV_CODE_CACHE_H
+#define LIBSWIFTNAV_CODE_CACHE_H
+
+#include <stddef.h>
+
+#include <libswiftnav/common.h>
+#include <libswiftnav/signal.h>
+
+/** \addtogroup code_cache
+ * \{ */
+
+/** Maximum number of replicas held by one cache. */
+#define CODE_CACHE_MAX_REPLICAS 64
+
+/** A cached replica is reused for a requested code rate if the two would
+ * drift apart by no more than this many chips over one code period. */
+#define CODE_CACHE_STEP_TOLERANCE 0.01
+
+/** Upsampled code replica of one signal at one code rate.
+ *
+ * Sample `k` of the replica holds the chip at code phase
+ * `(k - margin) * code_step`, wrapping at the code period. The replica covers
+ * two code periods plus `margin` samples either side, so a window of at
+ * least one full period, plus room for the correlator taps, can be taken
+ * starting at any code phase.
+ */
+typedef struct {
+  gnss_signal_t sid; /**< Signal the replica belongs to. */
+  double code_step;  /**< Code phase increment per sample in chips. */
+  u32 code_length;   /**< Number of chips in one code period. */
+  u32 margin;        /**< Padding samples before and after the replica. */
+  u32 num_samples;   /**< Total number of samples including padding. */
+  s8 *chips;         /**< One chip (+/-1) per sample. */
+  u64 *packed;       /**< One bit per sample, set for -1, LSB first. */
+} code_replica_t;
+
+/** Cache of code replicas shared between channels.
+ * Should be initialised with code_cache_init().
+ */
+typedef struct {
+  u8 *buff;          /**< Storage for the replica samples. */
+  size_t buff_size;  /**< Size of `buff` in bytes. */
+  size_t buff_used;  /**< Bytes of `buff` in use. */
+  u32 n_replicas;    /**< Number of replicas generated. */
+  code_replica_t replicas[CODE_CACHE_MAX_REPLICAS]; /**< Replicas. */
+} code_cache_t;
+
+/** \} */
+
+size_t code_cache_replica_size(u32 code_length, double code_step);
+s8 code_cache_init(code_cache_t *cache, void *buff, size_t buff_size);
+void code_cache_clear(code_cache_t *cache);
+const code_replica_t *code_cache_get(code_cache_t *cache, gnss_signal_t sid,
+                                     double code_step);
+
+const s8 *code_replica_chips(const code_replica_t *r, double code_phase,
+                             u32 *num_samples);
+u32 code_replica_packed(const code_replica_t *r, double code_phase,
+                        u32 num_samples, u64 *packed);
+
+#endif /* LIBSWIFTNAV_CODE_CACHE_H */
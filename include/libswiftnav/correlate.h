@@ -14,6 +14,56 @@
 #define LIBSWIFTNAV_CORRELATE_H
 
 #include <libswiftnav/common.h>
+#include <libswiftnav/track.h>
+
+/** \addtogroup corr
+ * \{ */
+
+/** Maximum number of correlator taps per channel. */
+#define CORR_MAX_TAPS 5
+
+/** Maximum offset of any tap from the prompt tap, in chips. */
+#define CORR_MAX_TAP_OFFSET 1.0
+
+/** Correlator kernel implementations. */
+typedef enum {
+  CORR_IMPL_AUTO = 0, /**< Best kernel supported by the host CPU. */
+  CORR_IMPL_GENERIC,  /**< Portable scalar kernel. */
+  CORR_IMPL_AVX2,     /**< 8 samples per iteration, x86 AVX2. */
+  CORR_IMPL_AVX512,   /**< 16 samples per iteration, x86 AVX-512F. */
+} corr_impl_t;
+
+/** State of one channel of the multi-channel correlator.
+ * Should be initialised with corr_channel_init().
+ *
+ * The taps are spaced symmetrically around the prompt tap, i.e. with three
+ * taps and a spacing of 0.5 chips they are the usual early, prompt and late
+ * correlators, with five taps the very-early and very-late correlators are
+ * added at one chip either side of the prompt.
+ *
+ * If `replica` is set the chips are read from that sample-aligned replica
+ * instead of being looked up in `code` from the code phase, with each tap
+ * offset from the prompt by the nearest whole number of samples. See
+ * code_replica_chips().
+ */
+typedef struct {
+  const s8 *code;      /**< Code replica, one chip (+/-1) per element. */
+  const s8 *replica;   /**< Optional upsampled prompt replica, element `i`
+                            aligned with sample `first_sample + i`. */
+  u32 code_length;     /**< Number of chips in `code`, i.e. code period. */
+  double code_phase;   /**< Prompt code phase in chips, updated on return. */
+  double code_step;    /**< Code phase increment per sample in chips. */
+  double carr_phase;   /**< Carrier phase in radians, updated on return. */
+  double carr_step;    /**< Carrier phase increment per sample in radians. */
+  u32 first_sample;    /**< Index of the first sample to integrate. */
+  u32 num_samples;     /**< Number of samples to integrate. */
+  u8 n_taps;           /**< Number of correlator taps. */
+  float tap_spacing;   /**< Spacing between adjacent taps in chips. */
+  correlation_t corr[CORR_MAX_TAPS]; /**< Correlator outputs, earliest tap
+                                          first. */
+} corr_channel_t;
+
+/** \} */
 
 void track_correlate(s8* samples, s8* code,
                      double* init_code_phase, double code_step,
@@ -23,4 +73,11 @@ void track_correlate(s8* samples, s8* code,
                      double* I_L, double* Q_L,
                      u32* num_samples);
 
+void corr_channel_init(corr_channel_t *c, const s8 *code, u32 code_length,
+                       u8 n_taps, float tap_spacing);
+bool corr_impl_supported(corr_impl_t impl);
+corr_impl_t corr_impl_best(void);
+void track_correlate_multi(corr_impl_t impl, const s8 *samples,
+                           u8 n_channels, corr_channel_t *channels);
+
 #endif /* LIBSWIFTNAV_CORRELATE_H */
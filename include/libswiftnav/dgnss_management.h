@@ -39,8 +39,92 @@ typedef struct {
   ambiguities_t float_ambs;
 } ambiguity_state_t;
 
+/** \addtogroup dgnss_management
+ * \{ */
+
+/** State of the float filter and integer ambiguity test of one baseline.
+ * Initialise with dgnss_ctx_init(). */
+typedef struct {
+  dgnss_settings_t settings;          /**< Filter and IAR settings. */
+  nkf_t nkf;                          /**< Float ambiguity filter. */
+  sats_management_t sats_management;  /**< Satellites of the float filter. */
+  ambiguity_test_t ambiguity_test;    /**< Integer ambiguity test. */
+} dgnss_ctx_t;
+
+/** One epoch of a batch passed to dgnss_ctx_process_epochs().
+ * The epoch's sdiffs are stored contiguously after those of the previous
+ * epoch in the batch. */
+typedef struct {
+  u8 num_sats;              /**< Number of sdiffs in this epoch. */
+  double receiver_ecef[3];  /**< Receiver position, ECEF [m]. */
+} dgnss_epoch_t;
+
+/** Baseline output for one epoch of a batch. */
+typedef struct {
+  s8 ret;       /**< dgnss_baseline() return code, 1 fixed, 2 float, < 0 none. */
+  u8 num_used;  /**< Number of sdiffs used in the baseline. */
+  double b[3];  /**< Baseline, ECEF [m]. */
+} dgnss_solution_t;
+
+/** \} */
+
 extern dgnss_settings_t dgnss_settings;
 
+s8 dgnss_ctx_init(dgnss_ctx_t *ctx, u32 max_hyps, void *hyp_buff);
+void dgnss_ctx_start(dgnss_ctx_t *ctx, u8 num_sats, sdiff_t *sdiffs,
+                     double receiver_ecef[3]);
+void dgnss_ctx_update(dgnss_ctx_t *ctx, u8 num_sats, sdiff_t *sdiffs,
+                      double receiver_ecef[3],
+                      bool disable_raim, double raim_threshold);
+u32 dgnss_ctx_process_epochs(dgnss_ctx_t *ctx, u32 n_epochs,
+                             const dgnss_epoch_t *epochs, sdiff_t *sdiffs,
+                             bool disable_raim, double raim_threshold,
+                             dgnss_solution_t *solutions);
+void dgnss_ctx_rebase_ref(dgnss_ctx_t *ctx, u8 num_sdiffs, sdiff_t *sdiffs,
+                          double receiver_ecef[3],
+                          gnss_signal_t old_sids[MAX_CHANNELS],
+                          sdiff_t *corrected_sdiffs);
+s8 dgnss_ctx_iar_resolved(dgnss_ctx_t *ctx);
+u32 dgnss_ctx_iar_num_hyps(dgnss_ctx_t *ctx);
+u32 dgnss_ctx_iar_num_sats(const dgnss_ctx_t *ctx);
+s8 dgnss_ctx_iar_get_single_hyp(dgnss_ctx_t *ctx, double *hyp);
+void dgnss_ctx_reset_iar(dgnss_ctx_t *ctx);
+void dgnss_ctx_init_known_baseline(dgnss_ctx_t *ctx, u8 num_sats,
+                                   sdiff_t *sdiffs, double receiver_ecef[3],
+                                   double b[3]);
+void dgnss_ctx_update_ambiguity_state(dgnss_ctx_t *ctx, ambiguity_state_t *s);
+void dgnss_ctx_measure_amb_kf_b(const dgnss_ctx_t *ctx,
+                                u8 num_sdiffs, sdiff_t *sdiffs,
+                                const double receiver_ecef[3], double *b);
+void dgnss_ctx_measure_b_with_external_ambs(const dgnss_ctx_t *ctx,
+                                            u8 state_dim,
+                                            const double *state_mean,
+                                            u8 num_sdiffs, sdiff_t *sdiffs,
+                                            const double receiver_ecef[3],
+                                            double *b);
+void dgnss_ctx_measure_iar_b_with_external_ambs(dgnss_ctx_t *ctx,
+                                                double *state_mean,
+                                                u8 num_sdiffs,
+                                                sdiff_t *sdiffs,
+                                                double receiver_ecef[3],
+                                                double *b);
+u8 dgnss_ctx_get_amb_kf_de_and_phase(const dgnss_ctx_t *ctx,
+                                     u8 num_sdiffs, sdiff_t *sdiffs,
+                                     double ref_ecef[3],
+                                     double *de, double *phase);
+u8 dgnss_ctx_get_iar_de_and_phase(const dgnss_ctx_t *ctx,
+                                  u8 num_sdiffs, sdiff_t *sdiffs,
+                                  double ref_ecef[3],
+                                  double *de, double *phase);
+u8 dgnss_ctx_iar_pool_contains(dgnss_ctx_t *ctx, double *ambs);
+double dgnss_ctx_iar_pool_ll(dgnss_ctx_t *ctx, u8 num_ambs, double *ambs);
+double dgnss_ctx_iar_pool_prob(dgnss_ctx_t *ctx, u8 num_ambs, double *ambs);
+u8 dgnss_ctx_get_amb_kf_mean(const dgnss_ctx_t *ctx, double *ambs);
+u8 dgnss_ctx_get_amb_kf_cov(const dgnss_ctx_t *ctx, double *cov);
+u8 dgnss_ctx_get_amb_kf_sids(const dgnss_ctx_t *ctx, gnss_signal_t *sids);
+u8 dgnss_ctx_get_amb_test_sids(const dgnss_ctx_t *ctx, gnss_signal_t *sids);
+u8 dgnss_ctx_iar_MLE_ambs(dgnss_ctx_t *ctx, s32 *ambs);
+
 void dgnss_set_settings(double phase_var_test, double code_var_test,
                         double phase_var_kf, double code_var_kf,
                         double amb_drift_var, double amb_init_var,
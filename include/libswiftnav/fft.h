@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LIBSWIFTNAV_FFT_H
+#define LIBSWIFTNAV_FFT_H
+
+#include <libswiftnav/common.h>
+
+/** \addtogroup fft
+ * \{ */
+
+/** Maximum number of radix stages in an FFT plan. */
+#define FFT_MAX_FACTORS 32
+
+/** Largest prime factor of the FFT length that is supported. */
+#define FFT_MAX_RADIX 64
+
+/** Single precision complex number. */
+typedef struct {
+  float re; /**< Real part. */
+  float im; /**< Imaginary part. */
+} fft_cpx_t;
+
+/** Plan for a mixed radix FFT of a given length.
+ * Should be initialised with fft_plan_init().
+ */
+typedef struct {
+  u32 n;                           /**< Transform length. */
+  u32 factors[2 * FFT_MAX_FACTORS]; /**< Radix and stride of each stage. */
+  fft_cpx_t *twiddles;             /**< `n` forward twiddle factors. */
+} fft_plan_t;
+
+/** \} */
+
+s8 fft_plan_init(fft_plan_t *p, u32 n, fft_cpx_t *twiddles);
+void fft_forward(const fft_plan_t *p, const fft_cpx_t *in, fft_cpx_t *out);
+void fft_inverse(const fft_plan_t *p, fft_cpx_t *in, fft_cpx_t *out);
+
+#endif /* LIBSWIFTNAV_FFT_H */
@@ -15,9 +15,51 @@
 #define LIBSWIFTNAV_LAMBDA_H
 
 #include <libswiftnav/common.h>
+#include <libswiftnav/constants.h>
 
+/** Maximum number of float ambiguities handled by the LAMBDA functions. */
+#define LAMBDA_MAX_DIM (MAX_CHANNELS - 1)
+
+/** Limits on the effort of a LAMBDA search. */
+typedef struct {
+  u32 max_nodes;  /**< Maximum number of search tree nodes to visit. */
+  /** If not null, polled every few dozen nodes with `ctx`. The search stops
+   * when it returns true, e.g. when a deadline has passed. */
+  bool (*expired)(void *ctx);
+  void *ctx;      /**< Passed to `expired`. */
+  u32 nodes;      /**< Set to the number of nodes visited by the last call. */
+} lambda_budget_t;
+
+/** LAMBDA reduction of a float ambiguity covariance, kept so that the next
+ * reduction can resume from it. Should be initialised with
+ * lambda_reduction_init(). */
+typedef struct {
+  int n;                                        /**< Dimension, 0 if none. */
+  double Z[LAMBDA_MAX_DIM * LAMBDA_MAX_DIM];    /**< Transform, z = Z'a. */
+  double Zi[LAMBDA_MAX_DIM * LAMBDA_MAX_DIM];   /**< Inverse of Z. */
+  double L[LAMBDA_MAX_DIM * LAMBDA_MAX_DIM];    /**< Z'QZ = L'diag(D)L. */
+  double D[LAMBDA_MAX_DIM];
+  u32 steps;        /**< Gauss transforms and permutations of last update. */
+  u32 cold_steps;   /**< Steps of the last update started from identity. */
+  u32 steps_saved;  /**< Steps the last update saved against cold_steps. */
+} lambda_reduction_t;
+
+void lambda_reduction_init(lambda_reduction_t *r);
+int lambda_reduction_update(lambda_reduction_t *r, int n, const double *Q);
 int lambda_reduction(int n, const double *Q, double *Z);
 int lambda_solution(int n, int m, const double *a, const double *Q, double *F,
                     double *s);
+int lambda_solution_reduced(const lambda_reduction_t *r, int m,
+                            const double *a, lambda_budget_t *budget,
+                            double *F, double *s, int *nfound);
+int lambda_solution_bounded(int n, int m, const double *a, const double *Q,
+                            lambda_budget_t *budget, double *F, double *s,
+                            int *nfound);
+int lambda_partial_reduced(const lambda_reduction_t *r, const double *a,
+                           const double *Q, double p0, double ratio,
+                           lambda_budget_t *budget, double *b, int *nfixed);
+int lambda_partial(int n, const double *a, const double *Q, double p0,
+                   double ratio, lambda_budget_t *budget, double *b,
+                   int *nfixed);
 
 #endif /* LIBSWIFTNAV_LAMBDA_H */
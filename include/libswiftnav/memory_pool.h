@@ -17,6 +17,9 @@
 
 #include <libswiftnav/common.h>
 
+/** Maximum number of elements in a compact memory pool. */
+#define MEMORY_POOL_COMPACT_MAX_ELEMENTS 65535
+
 /* Type for elements of the memory pool, unfortunately typedef doesn't enforce
  * type safety and an opaque struct definition wouldn't be compatible with the
  * flexible member array in node_t. */
@@ -43,13 +46,24 @@ struct _memory_pool {
   node_t *pool;
   node_t *free_nodes_head;
   node_t *allocated_nodes_head;
+  /* Compact mode, elements are stored contiguously at the start of `pool`
+   * and the node lists are unused. */
+  bool compact;
+  u32 n_allocated;
 };
 
 
+/* The heap allocated pools aren't available in the embedded profile. */
+#ifndef LIBSWIFTNAV_EMBEDDED
 memory_pool_t *memory_pool_new(u32 n_elements, size_t element_size);
+memory_pool_t *memory_pool_new_compact(u32 n_elements, size_t element_size);
+void memory_pool_destroy(memory_pool_t *pool);
+#endif
 s8 memory_pool_init(memory_pool_t *new_pool, u32 n_elements,
                     size_t element_size, void *buff);
-void memory_pool_destroy(memory_pool_t *pool);
+s8 memory_pool_init_compact(memory_pool_t *new_pool, u32 n_elements,
+                            size_t element_size, void *buff);
+s8 memory_pool_resize_compact(memory_pool_t *pool, u32 n_elements, void *buff);
 s32 memory_pool_n_free(memory_pool_t *pool);
 s32 memory_pool_n_allocated(memory_pool_t *pool);
 u8 memory_pool_empty(memory_pool_t *pool);
@@ -57,11 +71,13 @@ u32 memory_pool_n_elements(memory_pool_t *pool);
 
 element_t *memory_pool_add(memory_pool_t *pool);
 s32 memory_pool_to_array(memory_pool_t *pool, void *array);
+element_t *memory_pool_elements(memory_pool_t *pool);
 
 s32 memory_pool_map(memory_pool_t *pool, void *arg,
                     void (*f)(void *arg, element_t *elem));
 s32 memory_pool_filter(memory_pool_t *pool, void *arg,
                        s8 (*f)(void *arg, element_t *elem));
+s32 memory_pool_filter_mask(memory_pool_t *pool, const u8 *keep);
 s32 memory_pool_clear(memory_pool_t *pool);
 s32 memory_pool_fold(memory_pool_t *pool, void *x0,
                      void (*f)(void *x, element_t *elem));
@@ -44,6 +44,8 @@ typedef struct {
 
 void nav_msg_init(nav_msg_t *n);
 s32 nav_msg_update(nav_msg_t *n, bool bit_val);
+u32 nav_msg_update_bits(nav_msg_t *n, const u8 *bits, u32 n_bits,
+                        s32 *TOW_ms);
 bool subframe_ready(nav_msg_t *n);
 s8 process_subframe(nav_msg_t *n, ephemeris_t *e);
 
@@ -17,6 +17,7 @@
 #include <libswiftnav/track.h>
 #include <libswiftnav/almanac.h>
 #include <libswiftnav/ephemeris.h>
+#include <libswiftnav/set.h>
 #include <libswiftnav/time.h>
 
 typedef struct {
@@ -30,6 +31,27 @@ typedef struct {
   gnss_signal_t sid;
 } sdiff_t;
 
+/** \addtogroup single_diff
+ * \{ */
+
+/** Observations of one receiver, or single differences, stored in dense
+ * arrays indexed by sid_to_index().
+ * Entry `i` is only meaningful if index `i` is in `sats`.
+ * Should be initialised with obs_store_init().
+ */
+typedef struct {
+  sid_set_t sats;                   /**< Signals present. */
+  double pseudorange[NUM_SATS];     /**< Pseudorange [m]. */
+  double carrier_phase[NUM_SATS];   /**< Carrier phase [cycles]. */
+  double doppler[NUM_SATS];         /**< Doppler [Hz]. */
+  double snr[NUM_SATS];             /**< Signal to noise ratio. */
+  double sat_pos[NUM_SATS][3];      /**< Satellite ECEF position [m]. */
+  double sat_vel[NUM_SATS][3];      /**< Satellite ECEF velocity [m/s]. */
+  u16 lock_counter[NUM_SATS];       /**< Lock counter. */
+} obs_store_t;
+
+/** \} */
+
 int cmp_sdiff(const void *a_, const void *b_);
 int cmp_amb(const void *a_, const void *b_);
 int cmp_amb_sdiff(const void *a_, const void *b_);
@@ -42,6 +64,14 @@ u8 single_diff(u8 n_a, navigation_measurement_t *m_a,
 
 int cmp_sid_sdiff(const void *a, const void *b);
 
+void obs_store_init(obs_store_t *s);
+void obs_store_add_nav_meas(obs_store_t *s, u8 n,
+                            const navigation_measurement_t *m);
+u8 obs_store_single_diff(const obs_store_t *a, const obs_store_t *b,
+                         obs_store_t *sd);
+u8 obs_store_get_sdiffs(const obs_store_t *sd, sdiff_t *sds);
+void sdiffs_to_sid_set(u8 n, const sdiff_t *sdiffs, sid_set_t *s);
+
 u8 make_propagated_sdiffs_wip(u8 n_local, navigation_measurement_t *m_local,
                               u8 n_remote, navigation_measurement_t *m_remote,
                               double remote_pos_ecef[3], sdiff_t *sds);
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LIBSWIFTNAV_ORBIT_CACHE_H
+#define LIBSWIFTNAV_ORBIT_CACHE_H
+
+#include <libswiftnav/common.h>
+#include <libswiftnav/ephemeris.h>
+#include <libswiftnav/signal.h>
+#include <libswiftnav/time.h>
+
+/** \addtogroup orbit_cache
+ * \{ */
+
+/** Length of the GPS time intervals each fit covers [s]. */
+#define ORBIT_CACHE_SPAN 900
+
+/** Number of Chebyshev coefficients in each fit. */
+#define ORBIT_CACHE_COEFFS 8
+
+/** Polynomial fit of one satellite's orbit and clock over one interval. */
+typedef struct {
+  ephemeris_t eph;   /**< Ephemeris the fit was made from. */
+  gps_time_t t_mid;  /**< Middle of the fitted interval. */
+  u8 valid;          /**< Set if the fit is in use. */
+  /** Chebyshev coefficients of the x, y, z position [m], the x, y, z
+   * velocity [m/s] and the clock error [s]. */
+  double c[ORBIT_CACHE_COEFFS][7];
+} orbit_fit_t;
+
+/** Cache of satellite orbit fits, one per satellite.
+ * Should be initialised with orbit_cache_init().
+ */
+typedef struct {
+  orbit_fit_t fits[NUM_SATS]; /**< Fits indexed by sid_to_index(). */
+  u32 hits;                   /**< Lookups answered from a fit. */
+  u32 misses;                 /**< Lookups that needed a new fit. */
+} orbit_cache_t;
+
+/** \} */
+
+void orbit_cache_init(orbit_cache_t *cache);
+s8 orbit_cache_sat_state(orbit_cache_t *cache, const ephemeris_t *e,
+                         const gps_time_t *t, double pos[3], double vel[3],
+                         double *clock_err, double *clock_rate_err);
+
+#endif /* LIBSWIFTNAV_ORBIT_CACHE_H */
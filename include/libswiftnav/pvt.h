@@ -79,10 +79,49 @@ typedef struct __attribute__((packed)) {
   u8 n_used;
 } gnss_solution;
 
+/** Batch PVT kernel implementation. */
+typedef enum {
+  PVT_IMPL_AUTO,    /**< Fastest kernel supported by the host CPU. */
+  PVT_IMPL_GENERIC, /**< Portable C. */
+  PVT_IMPL_AVX2,    /**< x86 AVX2, four measurements per vector. */
+} pvt_impl_t;
+
+/** Maximum number of measurements RAIM can exclude from one solution. */
+#define PVT_RAIM_MAX_EXCLUDED 2
+
+/** RAIM results of a single point solution. */
+typedef struct {
+  /** Residual norm of the solution [m], 0 if not checked. */
+  double residual;
+  /** Horizontal protection level [m], negative if unavailable. */
+  double hpl;
+  /** Vertical protection level [m], negative if unavailable. */
+  double vpl;
+  /** Number of measurements excluded by the repair. */
+  u8 n_excluded;
+  /** Signals of the excluded measurements. */
+  gnss_signal_t excluded_sid[PVT_RAIM_MAX_EXCLUDED];
+} pvt_raim_t;
+
 s8 calc_PVT(const u8 n_used,
             const navigation_measurement_t nav_meas[n_used],
             bool disable_raim,
             gnss_solution *soln,
             dops_t *dops);
+s8 calc_PVT_raim(const u8 n_used,
+                 const navigation_measurement_t nav_meas[n_used],
+                 bool disable_raim,
+                 gnss_solution *soln,
+                 dops_t *dops,
+                 pvt_raim_t *raim);
+bool pvt_impl_supported(pvt_impl_t impl);
+u32 calc_PVT_batch(pvt_impl_t impl,
+                   u32 n_epochs,
+                   const u8 n_used[],
+                   const navigation_measurement_t nav_meas[],
+                   bool disable_raim,
+                   s8 ret[],
+                   gnss_solution soln[],
+                   dops_t dops[]);
 
 #endif /* LIBSWIFTNAV_PVT_H */
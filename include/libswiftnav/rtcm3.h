@@ -14,9 +14,136 @@
 #define LIBSWIFTNAV_RTCM3_H
 
 #include <libswiftnav/common.h>
+#include <libswiftnav/ephemeris.h>
 #include <libswiftnav/time.h>
 #include <libswiftnav/track.h>
 
+/** \addtogroup rtcm3
+ * \{ */
+
+/** Maximum length of an RTCM v3 frame, header, data message and CRC. */
+#define RTCM3_MAX_FRAME_LEN (3 + 1023 + 3)
+
+/** Maximum number of satellites in a 1004 or 1012 message (DF006, DF035). */
+#define RTCM3_MAX_OBS_SATS 31
+
+/** Maximum number of satellites in an MSM message (DF394). */
+#define RTCM3_MSM_MAX_SATS 64
+/** Maximum number of signals in an MSM message (DF395). */
+#define RTCM3_MSM_MAX_SIGS 32
+/** Maximum number of cells in an MSM message (DF396). */
+#define RTCM3_MSM_MAX_CELLS 64
+
+/** Maximum number of message handlers registered with one parser. */
+#define RTCM3_PARSER_MAX_HANDLERS 16
+
+/** \name Observation validity flags
+ * \{ */
+#define RTCM3_OBS_PR   (1 << 0) /**< Pseudorange is valid. */
+#define RTCM3_OBS_CP   (1 << 1) /**< Carrier phase is valid. */
+#define RTCM3_OBS_RATE (1 << 2) /**< Phase range rate is valid. */
+/** \} */
+
+/** L1 and L2 observations of one satellite, as carried by messages 1004
+ * (GPS) and 1012 (GLONASS). Index 0 of each array is L1, index 1 is L2. */
+typedef struct {
+  u8 sat;                  /**< Satellite ID (DF009, DF038). */
+  s8 fcn;                  /**< GLONASS frequency channel number, -7..13
+                                (DF040), 1012 only. */
+  u8 code[2];              /**< Code indicators (DF010, DF016, DF039,
+                                DF046). */
+  u8 flags[2];             /**< Validity flags, `RTCM3_OBS_*`. */
+  double pseudorange[2];   /**< Pseudorange [m]. */
+  double carrier_phase[2]; /**< Carrier phase [cycles]. */
+  u32 lock_time[2];        /**< Minimum lock time [s]. */
+  double cnr[2];           /**< Carrier to noise ratio [dB-Hz], zero if not
+                                computed. */
+} rtcm3_obs_t;
+
+/** Message 1004 (GPS) or 1012 (GLONASS) L1 and L2 observables. */
+typedef struct {
+  u16 id;       /**< Reference station ID (DF003). */
+  u32 tow_ms;   /**< GPS time of week (DF004) or GLONASS time of day
+                     (DF034) [ms]. */
+  u8 sync;      /**< Synchronous GNSS Flag (DF005). */
+  u8 div_free;  /**< Divergence-free Smoothing Indicator (DF007, DF036). */
+  u8 smooth;    /**< Smoothing Interval indicator (DF008, DF037). */
+  u8 n_sat;     /**< Number of satellites (DF006, DF035). */
+  rtcm3_obs_t obs[RTCM3_MAX_OBS_SATS]; /**< Observations. */
+} rtcm3_obs_msg_t;
+
+/** Satellite data of an MSM message. */
+typedef struct {
+  u8 id;       /**< Satellite ID, 1..64 (DF394). */
+  u8 ext_info; /**< Extended satellite information, MSM5 and MSM7 only. */
+} rtcm3_msm_sat_t;
+
+/** Signal data of one cell of an MSM message. */
+typedef struct {
+  u8 sat;                  /**< Index of the satellite in `sats`. */
+  u8 sig;                  /**< Signal ID, 1..32 (DF395). */
+  u8 flags;                /**< Validity flags, `RTCM3_OBS_*`. */
+  u8 half_cycle;           /**< Half-cycle ambiguity indicator (DF420). */
+  double pseudorange;      /**< Pseudorange [m]. */
+  double phase_range;      /**< Phase range [m]. */
+  double phase_range_rate; /**< Phase range rate [m/s], MSM5 and MSM7
+                                only. */
+  u32 lock_time;           /**< Minimum lock time [ms] (DF402, DF407). */
+  double cnr;              /**< Carrier to noise ratio [dB-Hz], zero if not
+                                computed. */
+} rtcm3_msm_cell_t;
+
+/** Multiple Signal Message, MSM4, MSM5 or MSM7 of any constellation.
+ *
+ * Satellites are listed in increasing order of ID and cells in increasing
+ * order of satellite and then signal ID, the order in which they appear in
+ * the message. */
+typedef struct {
+  u16 type;           /**< Message type, e.g. 1074, 1085 or 1127 (DF002). */
+  u16 id;             /**< Reference station ID (DF003). */
+  u32 epoch;          /**< GNSS epoch time, 30 bits, constellation specific
+                           (DF004, DF416 + DF034, DF248, DF427). */
+  u8 multiple;        /**< Multiple Message Bit (DF393). */
+  u8 iods;            /**< Issue of Data Station (DF409). */
+  u8 clock_steering;  /**< Clock Steering Indicator (DF411). */
+  u8 ext_clock;       /**< External Clock Indicator (DF412). */
+  u8 div_free;        /**< Divergence-free Smoothing Indicator (DF417). */
+  u8 smooth;          /**< Smoothing Interval (DF418). */
+  u8 n_sat;           /**< Number of satellites. */
+  u8 n_cell;          /**< Number of cells. */
+  rtcm3_msm_sat_t sats[RTCM3_MSM_MAX_SATS];    /**< Satellite data. */
+  rtcm3_msm_cell_t cells[RTCM3_MSM_MAX_CELLS]; /**< Signal data. */
+} rtcm3_msm_t;
+
+/** Handler for messages found by an RTCM v3 parser.
+ *
+ * \param type    Message type (DF002).
+ * \param msg     Data message, only valid for the duration of the call.
+ * \param len     Length of the data message in bytes.
+ * \param context Context registered with the handler.
+ */
+typedef void (*rtcm3_msg_handler_t)(u16 type, const u8 *msg, u16 len,
+                                    void *context);
+
+/** Incremental RTCM v3 frame parser.
+ * Should be initialised with rtcm3_parser_init().
+ */
+typedef struct {
+  u8 buff[RTCM3_MAX_FRAME_LEN]; /**< Frame split across input chunks. */
+  u16 n_buff;                   /**< Bytes held in `buff`. */
+  u8 n_handlers;                /**< Number of registered handlers. */
+  struct {
+    u16 type;                   /**< Message type, 0 for all messages. */
+    rtcm3_msg_handler_t cb;     /**< Handler function. */
+    void *context;              /**< Handler context. */
+  } handlers[RTCM3_PARSER_MAX_HANDLERS]; /**< Registered handlers. */
+  u32 n_frames;                 /**< Valid frames found. */
+  u32 n_crc_errors;             /**< Frames discarded for a CRC mismatch. */
+  u32 n_skipped;                /**< Bytes skipped while resynchronising. */
+} rtcm3_parser_t;
+
+/** \} */
+
 s16 rtcm3_check_frame(u8 *buff);
 s8 rtcm3_write_frame(u16 len, u8 *buff);
 
@@ -30,4 +157,20 @@ u16 rtcm3_encode_1002(u8 *buff, u16 id, gps_time_t t, u8 n_sat,
 s8 rtcm3_decode_1002(u8 *buff, u16 *id, double *tow, u8 *n_sat,
                      navigation_measurement_t *nm, u8 *sync);
 
+u16 rtcm3_encode_1004(u8 *buff, const rtcm3_obs_msg_t *msg);
+s8 rtcm3_decode_1004(const u8 *buff, rtcm3_obs_msg_t *msg);
+u16 rtcm3_encode_1012(u8 *buff, const rtcm3_obs_msg_t *msg);
+s8 rtcm3_decode_1012(const u8 *buff, rtcm3_obs_msg_t *msg);
+
+s16 rtcm3_encode_msm(u8 *buff, const rtcm3_msm_t *msg);
+s8 rtcm3_decode_msm(const u8 *buff, rtcm3_msm_t *msg);
+
+u16 rtcm3_encode_1019(u8 *buff, const ephemeris_t *e);
+s8 rtcm3_decode_1019(const u8 *buff, ephemeris_t *e);
+
+void rtcm3_parser_init(rtcm3_parser_t *p);
+s8 rtcm3_parser_register(rtcm3_parser_t *p, u16 type,
+                         rtcm3_msg_handler_t cb, void *context);
+u32 rtcm3_parser_process(rtcm3_parser_t *p, const u8 *data, u32 len);
+
 #endif /* LIBSWIFTNAV_RTCM3_H */
@@ -31,6 +31,125 @@
  * */
 typedef int (*cmp_fn) (const void* a, const void* b);
 
+/** Number of 64 bit words in a #sid_set_t. */
+#define SID_SET_WORDS ((NUM_SATS + 63) / 64)
+
+/** Set of signals, as a bitset indexed by sid_to_index().
+ * Members are visited in index order, which is also the sid_compare() order,
+ * so the rank of a member is its position in the equivalent sorted array.
+ * Should be initialised with sid_set_init().
+ */
+typedef struct {
+  u64 words[SID_SET_WORDS]; /**< Bit `i % 64` of word `i / 64` is index i. */
+} sid_set_t;
+
+/** Clear a signal set. */
+static inline void sid_set_init(sid_set_t *s)
+{
+  for (u32 w = 0; w < SID_SET_WORDS; w++)
+    s->words[w] = 0;
+}
+
+/** Add the signal with index `i` to a set. */
+static inline void sid_set_add_index(sid_set_t *s, u32 i)
+{
+  s->words[i / 64] |= 1ull << (i % 64);
+}
+
+/** Add a signal to a set. */
+static inline void sid_set_add(sid_set_t *s, gnss_signal_t sid)
+{
+  sid_set_add_index(s, sid_to_index(sid));
+}
+
+/** Remove a signal from a set. */
+static inline void sid_set_remove(sid_set_t *s, gnss_signal_t sid)
+{
+  u32 i = sid_to_index(sid);
+  s->words[i / 64] &= ~(1ull << (i % 64));
+}
+
+/** Test if the signal with index `i` is in a set. */
+static inline bool sid_set_contains_index(const sid_set_t *s, u32 i)
+{
+  return (s->words[i / 64] >> (i % 64)) & 1;
+}
+
+/** Test if a signal is in a set. */
+static inline bool sid_set_contains(const sid_set_t *s, gnss_signal_t sid)
+{
+  return sid_set_contains_index(s, sid_to_index(sid));
+}
+
+/** Number of signals in a set. */
+static inline u32 sid_set_count(const sid_set_t *s)
+{
+  u32 n = 0;
+  for (u32 w = 0; w < SID_SET_WORDS; w++)
+    n += __builtin_popcountll(s->words[w]);
+  return n;
+}
+
+/** Intersection, `out = a & b`. `out` may alias `a` or `b`. */
+static inline void sid_set_and(sid_set_t *out, const sid_set_t *a,
+                               const sid_set_t *b)
+{
+  for (u32 w = 0; w < SID_SET_WORDS; w++)
+    out->words[w] = a->words[w] & b->words[w];
+}
+
+/** Union, `out = a | b`. `out` may alias `a` or `b`. */
+static inline void sid_set_or(sid_set_t *out, const sid_set_t *a,
+                              const sid_set_t *b)
+{
+  for (u32 w = 0; w < SID_SET_WORDS; w++)
+    out->words[w] = a->words[w] | b->words[w];
+}
+
+/** Difference, `out = a & ~b`. `out` may alias `a` or `b`. */
+static inline void sid_set_andnot(sid_set_t *out, const sid_set_t *a,
+                                  const sid_set_t *b)
+{
+  for (u32 w = 0; w < SID_SET_WORDS; w++)
+    out->words[w] = a->words[w] & ~b->words[w];
+}
+
+/** Test if two signal sets have the same members. */
+static inline bool sid_set_equal(const sid_set_t *a, const sid_set_t *b)
+{
+  for (u32 w = 0; w < SID_SET_WORDS; w++)
+    if (a->words[w] != b->words[w])
+      return false;
+  return true;
+}
+
+/** Number of members of a set with index less than `i`. */
+static inline u32 sid_set_rank(const sid_set_t *s, u32 i)
+{
+  u32 n = 0;
+  for (u32 w = 0; w < i / 64; w++)
+    n += __builtin_popcountll(s->words[w]);
+  if (i % 64)
+    n += __builtin_popcountll(s->words[i / 64] & ((1ull << (i % 64)) - 1));
+  return n;
+}
+
+/** Index of the first member of a set with index at least `i`, or
+ * `NUM_SATS` if there is none. Members can be visited in order with
+ *
+ *     for (u32 i = sid_set_next(s, 0); i < NUM_SATS; i = sid_set_next(s, i+1))
+ */
+static inline u32 sid_set_next(const sid_set_t *s, u32 i)
+{
+  while (i < NUM_SATS) {
+    u64 word = s->words[i / 64] >> (i % 64);
+    if (word)
+      return i + __builtin_ctzll(word);
+    i = (i / 64 + 1) * 64;
+  }
+  return NUM_SATS;
+}
+
 /** \} */
 
 int cmp_s32_s32(const void * a, const void * b);
@@ -38,6 +157,9 @@ int cmp_s32_s32(const void * a, const void * b);
 bool is_set(u8 n, size_t sz, const void *set, cmp_fn cmp);
 bool is_sid_set(u8 len, const gnss_signal_t *sids);
 
+void sid_set_from_sids(sid_set_t *s, u32 n, const gnss_signal_t *sids);
+u32 sid_set_select(const sid_set_t *s, u32 k);
+
 s32 intersection_map(u32 na, size_t sa, const void *as,
                      u32 nb, size_t sb, const void *bs,
                      cmp_fn cmp, void *context,
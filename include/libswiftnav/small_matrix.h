@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LIBSWIFTNAV_SMALL_MATRIX_H
+#define LIBSWIFTNAV_SMALL_MATRIX_H
+
+#include <libswiftnav/common.h>
+#include <libswiftnav/constants.h>
+
+/** \addtogroup small_matrix
+ * \{ */
+
+/** Largest matrix dimension supported by the kernels needing workspace, that
+ * of the stacked carrier phase and pseudorange double differences. This
+ * covers the observation dimension of the ambiguity filter, #MAX_OBS_DIM. */
+#define SMAT_MAX_DIM (2 * (MAX_CHANNELS - 1))
+
+/** Small matrix kernel implementations. */
+typedef enum {
+  SMAT_IMPL_AUTO = 0, /**< Best kernels supported by the host CPU. */
+  SMAT_IMPL_GENERIC,  /**< Portable C. */
+  SMAT_IMPL_AVX2,     /**< 4 columns per iteration, x86 AVX2. */
+} smat_impl_t;
+
+/** \} */
+
+bool smat_impl_supported(smat_impl_t impl);
+void smat_set_impl(smat_impl_t impl);
+
+void smat_mul(u32 n, u32 m, u32 p, const double *a, const double *b,
+              double *c);
+void smat_mul_abt(u32 n, u32 m, u32 p, const double *a, const double *b,
+                  double *c);
+void smat_ata(u32 n, u32 m, const double *a, double *c);
+void smat_asat(u32 n, u32 m, const double *a, const double *s, double *c);
+
+s8 smat_cholesky(u32 n, const double *a, double *l);
+void smat_cholesky_solve(u32 n, const double *l, u32 p, double *b);
+void smat_cholesky_inverse(u32 n, const double *l, double *b);
+s8 smat_ldl(u32 n, const double *a, double *l, double *d);
+void smat_ldl_solve(u32 n, const double *l, const double *d, u32 p,
+                    double *b);
+
+void smat_unit_upper_mul(u32 n, u32 p, const double *u, double *b);
+void smat_unit_upper_tmul(u32 n, u32 p, const double *u, double *b);
+void smat_mul_unit_upper(u32 n, u32 m, const double *a, const double *u,
+                         double *c);
+
+void smat_left_null_basis(u32 n, u32 m, const double *a, double *q);
+
+#endif /* LIBSWIFTNAV_SMALL_MATRIX_H */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#ifndef LIBSWIFTNAV_TRACK_BANK_H
+#define LIBSWIFTNAV_TRACK_BANK_H
+
+#include <libswiftnav/common.h>
+#include <libswiftnav/track.h>
+
+/** \addtogroup track_bank
+ * \{ */
+
+/** Maximum number of channels held by one tracking loop bank. */
+#define TRACK_BANK_MAX_CHANNELS 128
+
+/** Tracking loop type of a bank channel. */
+typedef enum {
+  TRACK_LOOP_AIDED,  /**< aided_tl_update() */
+  TRACK_LOOP_SIMPLE, /**< simple_tl_update() */
+  TRACK_LOOP_COMP,   /**< comp_tl_update() */
+} track_loop_t;
+
+/** Tracking loop, lock detector and \f$ C / N_0 \f$ estimator state of a
+ * group of channels, stored as one array per field.
+ *
+ * Should be initialised with track_bank_init() and the channels loaded with
+ * track_bank_set_aided(), track_bank_set_simple() or track_bank_set_comp().
+ * After each track_bank_update() the loop outputs can be read directly from
+ * the `code_freq`, `carr_freq`, `cn0`, `outo` and `outp` arrays.
+ */
+typedef struct {
+  u32 n_channels;                              /**< Channels in use. */
+  u8 loop_type[TRACK_BANK_MAX_CHANNELS];       /**< track_loop_t per channel. */
+
+  float code_freq[TRACK_BANK_MAX_CHANNELS];    /**< Code frequency output. */
+  float carr_freq[TRACK_BANK_MAX_CHANNELS];    /**< Carrier frequency output. */
+
+  float carr_b0[TRACK_BANK_MAX_CHANNELS];      /**< Carrier filter coefficient. */
+  float carr_b1[TRACK_BANK_MAX_CHANNELS];      /**< Carrier filter coefficient. */
+  float carr_igain[TRACK_BANK_MAX_CHANNELS];   /**< FLL aiding integral gain. */
+  float carr_prev[TRACK_BANK_MAX_CHANNELS];    /**< Previous carrier error. */
+  float carr_y[TRACK_BANK_MAX_CHANNELS];       /**< Carrier filter output. */
+  float code_b0[TRACK_BANK_MAX_CHANNELS];      /**< Code filter coefficient. */
+  float code_b1[TRACK_BANK_MAX_CHANNELS];      /**< Code filter coefficient. */
+  float code_prev[TRACK_BANK_MAX_CHANNELS];    /**< Previous code error. */
+  float code_y[TRACK_BANK_MAX_CHANNELS];       /**< Code filter output. */
+  float prev_I[TRACK_BANK_MAX_CHANNELS];       /**< Previous prompt I, for FLL. */
+  float prev_Q[TRACK_BANK_MAX_CHANNELS];       /**< Previous prompt Q, for FLL. */
+  float carr_to_code[TRACK_BANK_MAX_CHANNELS]; /**< Carrier to code scale. */
+  float A[TRACK_BANK_MAX_CHANNELS];            /**< Complementary filter gain. */
+  u32 sched[TRACK_BANK_MAX_CHANNELS];          /**< Gain scheduling count. */
+  u32 n[TRACK_BANK_MAX_CHANNELS];              /**< Iteration counter. */
+
+  float ld_k1[TRACK_BANK_MAX_CHANNELS];        /**< Lock detect LPF coefficient. */
+  float ld_k2[TRACK_BANK_MAX_CHANNELS];        /**< Lock detect I scale factor. */
+  float ld_yi[TRACK_BANK_MAX_CHANNELS];        /**< Lock detect I path LPF. */
+  float ld_yq[TRACK_BANK_MAX_CHANNELS];        /**< Lock detect Q path LPF. */
+  u16 ld_lo[TRACK_BANK_MAX_CHANNELS];          /**< Optimistic count threshold. */
+  u16 ld_lp[TRACK_BANK_MAX_CHANNELS];          /**< Pessimistic count threshold. */
+  u16 ld_pcount1[TRACK_BANK_MAX_CHANNELS];     /**< Lock detect counter. */
+  u16 ld_pcount2[TRACK_BANK_MAX_CHANNELS];     /**< Lock detect counter. */
+  u8 outo[TRACK_BANK_MAX_CHANNELS];            /**< Optimistic lock indicator. */
+  u8 outp[TRACK_BANK_MAX_CHANNELS];            /**< Pessimistic lock indicator. */
+
+  float cn0_log_bw[TRACK_BANK_MAX_CHANNELS];   /**< Noise bandwidth in dBHz. */
+  float cn0_b[TRACK_BANK_MAX_CHANNELS];        /**< C/N0 IIR filter coeff. */
+  float cn0_a[TRACK_BANK_MAX_CHANNELS];        /**< C/N0 IIR filter coeff. */
+  float cn0_I_prev_abs[TRACK_BANK_MAX_CHANNELS]; /**< Previous abs. prompt I. */
+  float cn0_Q_prev_abs[TRACK_BANK_MAX_CHANNELS]; /**< Previous abs. prompt Q. */
+  float cn0_nsr[TRACK_BANK_MAX_CHANNELS];      /**< Noise-to-signal ratio. */
+  float cn0_xn[TRACK_BANK_MAX_CHANNELS];       /**< Last pre-filter NSR sample. */
+  float cn0[TRACK_BANK_MAX_CHANNELS];          /**< C/N0 output in dBHz. */
+
+  /* Per-update scratch space. */
+  float prompt_I[TRACK_BANK_MAX_CHANNELS];     /**< Prompt in-phase correlation. */
+  float prompt_Q[TRACK_BANK_MAX_CHANNELS];     /**< Prompt quadrature correlation. */
+  float carr_err[TRACK_BANK_MAX_CHANNELS];     /**< Costas discriminator. */
+  float freq_err[TRACK_BANK_MAX_CHANNELS];     /**< Frequency discriminator. */
+  float code_err[TRACK_BANK_MAX_CHANNELS];     /**< DLL discriminator. */
+} track_bank_t;
+
+/** \} */
+
+s8 track_bank_init(track_bank_t *b, u32 n_channels);
+void track_bank_set_aided(track_bank_t *b, u32 i, const aided_tl_state_t *tl,
+                          const lock_detect_t *ld, const cn0_est_state_t *cn0);
+void track_bank_set_simple(track_bank_t *b, u32 i, const simple_tl_state_t *tl,
+                           const lock_detect_t *ld, const cn0_est_state_t *cn0);
+void track_bank_set_comp(track_bank_t *b, u32 i, const comp_tl_state_t *tl,
+                         const lock_detect_t *ld, const cn0_est_state_t *cn0);
+void track_bank_get_aided(const track_bank_t *b, u32 i, aided_tl_state_t *tl,
+                          lock_detect_t *ld, cn0_est_state_t *cn0);
+void track_bank_get_simple(const track_bank_t *b, u32 i, simple_tl_state_t *tl,
+                           lock_detect_t *ld, cn0_est_state_t *cn0);
+void track_bank_get_comp(const track_bank_t *b, u32 i, comp_tl_state_t *tl,
+                         lock_detect_t *ld, cn0_est_state_t *cn0);
+void track_bank_update(track_bank_t *b, correlation_t cs[][3], float DT);
+
+#endif /* LIBSWIFTNAV_TRACK_BANK_H */
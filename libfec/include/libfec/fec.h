@@ -22,6 +22,16 @@ typedef struct {
   unsigned int w[2];
 } v27_decision_t;
 
+/* Butterfly implementations of the r=1/2 k=7 decoder. All produce
+ * bit-identical metrics and decisions.
+ */
+typedef enum {
+  V27_IMPL_AUTO,                  /* Fastest supported by the host CPU */
+  V27_IMPL_PORTABLE,              /* Portable C */
+  V27_IMPL_SSE2,                  /* x86 SSE2 */
+  V27_IMPL_AVX2,                  /* x86 AVX2 */
+} v27_impl_t;
+
 /* State info for instance of r=1/2 k=7 Viterbi decoder
  */
 typedef struct {
@@ -33,12 +43,15 @@ typedef struct {
   v27_decision_t *decisions;      /* Beginning of decisions for block */
   unsigned int decisions_index;   /* Index of current decision */
   unsigned int decisions_count;   /* Number of decisions in history */
+  v27_impl_t impl;                /* Butterfly implementation in use */
 } v27_t;
 
 void v27_poly_init(v27_poly_t *poly, const signed char polynomial[2]);
 
 void v27_init(v27_t *v, v27_decision_t *decisions, unsigned int decisions_count,
               const v27_poly_t *poly, unsigned char initial_state);
+int v27_impl_supported(v27_impl_t impl);
+void v27_set_impl(v27_t *v, v27_impl_t impl);
 void v27_update(v27_t *v, const unsigned char *syms, int nbits);
 void v27_chainback_fixed(v27_t *v, unsigned char *data, unsigned int nbits,
                          unsigned char final_state);
@@ -7,6 +7,16 @@
 
 #include <libfec/fec.h>
 
+/* The SIMD butterflies are compiled with per-function target attributes and
+ * selected at runtime, independent of the flags the library is built with.
+ * They keep the 32 bit metrics of the portable decoder, so the metrics and
+ * decisions are bit-identical.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define V27_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
 static inline int parity(int x)
 {
   x ^= x >> 16;
@@ -53,6 +63,7 @@ void v27_init(v27_t *v, v27_decision_t *decisions, unsigned int decisions_count,
   v->decisions = decisions;
   v->decisions_index = 0;
   v->decisions_count = decisions_count;
+  v27_set_impl(v, V27_IMPL_AUTO);
 
   for(i = 0; i < 64; i++)
     v->old_metrics[i] = 63;
@@ -76,18 +87,38 @@ unsigned int metric,m0,m1,decision;\
     d->w[i/16] |= decision << ((2*i+1)&31);\
 }
 
-/** Update a v27_t decoder with a block of symbols.
- *
- * \param v Structure to update.
- * \param syms Array of symbols to use. Must contain two symbols per bit.
- *             0xff = strong 1, 0x00 = strong 0.
- * \param nbits Number of bits corresponding to the provided symbols.
- */
-void v27_update(v27_t *v, const unsigned char *syms, int nbits)
+/* Renormalize if needed, then advance to the next bit */
+static inline void v27_next_bit(v27_t *v)
 {
-  unsigned char sym0, sym1;
   unsigned int *tmp;
-  int normalize = 0;
+
+  /* Normalize metrics if they are nearing overflow */
+  if(v->new_metrics[0] > (1<<30)) {
+    int i;
+    unsigned int minmetric = 1<<31;
+
+    for(i=0; i<64; i++) {
+      if(v->new_metrics[i] < minmetric)
+        minmetric = v->new_metrics[i];
+    }
+
+    for(i=0; i<64; i++)
+      v->new_metrics[i] -= minmetric;
+  }
+
+  /* Advance decision index */
+  if(++v->decisions_index >= v->decisions_count)
+    v->decisions_index = 0;
+
+  /* Swap pointers to old and new metrics */
+  tmp = v->old_metrics;
+  v->old_metrics = v->new_metrics;
+  v->new_metrics = tmp;
+}
+
+static void v27_update_portable(v27_t *v, const unsigned char *syms, int nbits)
+{
+  unsigned char sym0, sym1;
 
   while(nbits--) {
     v27_decision_t *d = &v->decisions[v->decisions_index];
@@ -129,30 +160,239 @@ void v27_update(v27_t *v, const unsigned char *syms, int nbits)
     BFLY(30);
     BFLY(31);
 
-    /* Normalize metrics if they are nearing overflow */
-    if(v->new_metrics[0] > (1<<30)) {
-      int i;
-      unsigned int minmetric = 1<<31;
+    v27_next_bit(v);
+  }
+}
+
+#ifdef V27_X86_DISPATCH
+
+/* SSE2 butterflies, four states per vector.
+ * m0 - (2*metric - 510) and m1 + (2*metric - 510) of the portable version
+ * are formed directly as old + (510 - metric) and old + metric, which is
+ * the same modulo 2^32.
+ */
+__attribute__((target("sse2")))
+static void v27_update_sse2(v27_t *v, const unsigned char *syms, int nbits)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i c510 = _mm_set1_epi32(510);
+  const __m128i c0lo = _mm_loadu_si128((const __m128i *)&v->poly->c0[0]);
+  const __m128i c0hi = _mm_loadu_si128((const __m128i *)&v->poly->c0[16]);
+  const __m128i c1lo = _mm_loadu_si128((const __m128i *)&v->poly->c1[0]);
+  const __m128i c1hi = _mm_loadu_si128((const __m128i *)&v->poly->c1[16]);
+
+  while(nbits--) {
+    v27_decision_t *d = &v->decisions[v->decisions_index];
+    __m128i s0 = _mm_set1_epi8((char)*syms++);
+    __m128i s1 = _mm_set1_epi8((char)*syms++);
+    __m128i metric16[4];
+    unsigned int w[2] = {0, 0};
+    int g;
+
+    /* Branch metrics of all 32 butterflies as 16 bit values */
+    __m128i x0 = _mm_xor_si128(c0lo, s0);
+    __m128i x1 = _mm_xor_si128(c1lo, s1);
+    metric16[0] = _mm_add_epi16(_mm_unpacklo_epi8(x0, zero),
+                                _mm_unpacklo_epi8(x1, zero));
+    metric16[1] = _mm_add_epi16(_mm_unpackhi_epi8(x0, zero),
+                                _mm_unpackhi_epi8(x1, zero));
+    x0 = _mm_xor_si128(c0hi, s0);
+    x1 = _mm_xor_si128(c1hi, s1);
+    metric16[2] = _mm_add_epi16(_mm_unpacklo_epi8(x0, zero),
+                                _mm_unpacklo_epi8(x1, zero));
+    metric16[3] = _mm_add_epi16(_mm_unpackhi_epi8(x0, zero),
+                                _mm_unpackhi_epi8(x1, zero));
 
-      for(i=0; i<64; i++) {
-        if(v->new_metrics[i] < minmetric)
-          minmetric = v->new_metrics[i];
-      }
+    for(g = 0; g < 8; g++) {
+      __m128i metric = (g & 1) ? _mm_unpackhi_epi16(metric16[g/2], zero)
+                               : _mm_unpacklo_epi16(metric16[g/2], zero);
+      __m128i anti = _mm_sub_epi32(c510, metric);
+      __m128i o0 = _mm_loadu_si128((const __m128i *)&v->old_metrics[4*g]);
+      __m128i o1 = _mm_loadu_si128((const __m128i *)&v->old_metrics[4*g+32]);
 
-      for(i=0; i<64; i++)
-        v->new_metrics[i] -= minmetric;
+      __m128i m0 = _mm_add_epi32(o0, metric);
+      __m128i m1 = _mm_add_epi32(o1, anti);
+      __m128i d0 = _mm_cmpgt_epi32(_mm_sub_epi32(m0, m1), zero);
+      __m128i n0 = _mm_or_si128(_mm_and_si128(d0, m1), _mm_andnot_si128(d0, m0));
 
-      normalize += minmetric;
+      m0 = _mm_add_epi32(o0, anti);
+      m1 = _mm_add_epi32(o1, metric);
+      __m128i d1 = _mm_cmpgt_epi32(_mm_sub_epi32(m0, m1), zero);
+      __m128i n1 = _mm_or_si128(_mm_and_si128(d1, m1), _mm_andnot_si128(d1, m0));
+
+      _mm_storeu_si128((__m128i *)&v->new_metrics[8*g],
+                       _mm_unpacklo_epi32(n0, n1));
+      _mm_storeu_si128((__m128i *)&v->new_metrics[8*g+4],
+                       _mm_unpackhi_epi32(n0, n1));
+
+      unsigned int bits =
+        _mm_movemask_ps(_mm_castsi128_ps(_mm_unpacklo_epi32(d0, d1))) |
+        _mm_movemask_ps(_mm_castsi128_ps(_mm_unpackhi_epi32(d0, d1))) << 4;
+      w[g/4] |= bits << (8*(g%4));
     }
+    d->w[0] = w[0];
+    d->w[1] = w[1];
+
+    v27_next_bit(v);
+  }
+}
+
+/* AVX2 butterflies, eight states per vector. */
+__attribute__((target("avx2")))
+static void v27_update_avx2(v27_t *v, const unsigned char *syms, int nbits)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i c510 = _mm256_set1_epi32(510);
+  const __m256i c0 = _mm256_loadu_si256((const __m256i *)v->poly->c0);
+  const __m256i c1 = _mm256_loadu_si256((const __m256i *)v->poly->c1);
+
+  while(nbits--) {
+    v27_decision_t *d = &v->decisions[v->decisions_index];
+    __m256i s0 = _mm256_set1_epi8((char)*syms++);
+    __m256i s1 = _mm256_set1_epi8((char)*syms++);
+    unsigned char metric8[2][32] __attribute__((aligned(32)));
+    unsigned int w[2] = {0, 0};
+    int g;
 
-    /* Advance decision index */
-    if(++v->decisions_index >= v->decisions_count)
-      v->decisions_index = 0;
+    /* Branch metric = (c0 ^ sym0) + (c1 ^ sym1), kept as two byte halves
+     * and widened per group */
+    _mm256_store_si256((__m256i *)metric8[0], _mm256_xor_si256(c0, s0));
+    _mm256_store_si256((__m256i *)metric8[1], _mm256_xor_si256(c1, s1));
 
-    /* Swap pointers to old and new metrics */
-    tmp = v->old_metrics;
-    v->old_metrics = v->new_metrics;
-    v->new_metrics = tmp;
+    for(g = 0; g < 4; g++) {
+      __m256i metric = _mm256_add_epi32(
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&metric8[0][8*g])),
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&metric8[1][8*g])));
+      __m256i anti = _mm256_sub_epi32(c510, metric);
+      __m256i o0 = _mm256_loadu_si256((const __m256i *)&v->old_metrics[8*g]);
+      __m256i o1 = _mm256_loadu_si256((const __m256i *)&v->old_metrics[8*g+32]);
+
+      __m256i m0 = _mm256_add_epi32(o0, metric);
+      __m256i m1 = _mm256_add_epi32(o1, anti);
+      __m256i d0 = _mm256_cmpgt_epi32(_mm256_sub_epi32(m0, m1), zero);
+      __m256i n0 = _mm256_blendv_epi8(m0, m1, d0);
+
+      m0 = _mm256_add_epi32(o0, anti);
+      m1 = _mm256_add_epi32(o1, metric);
+      __m256i d1 = _mm256_cmpgt_epi32(_mm256_sub_epi32(m0, m1), zero);
+      __m256i n1 = _mm256_blendv_epi8(m0, m1, d1);
+
+      /* Interleave to state order 2i, 2i+1 across the 128 bit lanes */
+      __m256i lo = _mm256_unpacklo_epi32(n0, n1);
+      __m256i hi = _mm256_unpackhi_epi32(n0, n1);
+      _mm256_storeu_si256((__m256i *)&v->new_metrics[16*g],
+                          _mm256_permute2x128_si256(lo, hi, 0x20));
+      _mm256_storeu_si256((__m256i *)&v->new_metrics[16*g+8],
+                          _mm256_permute2x128_si256(lo, hi, 0x31));
+
+      lo = _mm256_unpacklo_epi32(d0, d1);
+      hi = _mm256_unpackhi_epi32(d0, d1);
+      unsigned int bits =
+        _mm256_movemask_ps(_mm256_castsi256_ps(
+          _mm256_permute2x128_si256(lo, hi, 0x20))) |
+        _mm256_movemask_ps(_mm256_castsi256_ps(
+          _mm256_permute2x128_si256(lo, hi, 0x31))) << 8;
+      w[g/2] |= bits << (16*(g%2));
+    }
+    d->w[0] = w[0];
+    d->w[1] = w[1];
+
+    v27_next_bit(v);
+  }
+}
+
+/* Index of the first state with the minimum metric, vectorized */
+__attribute__((target("avx2")))
+static unsigned char v27_best_state_avx2(const unsigned int *metrics)
+{
+  __m256i m[8];
+  __m256i vmin;
+  int i;
+
+  for(i = 0; i < 8; i++)
+    m[i] = _mm256_loadu_si256((const __m256i *)&metrics[8*i]);
+  vmin = m[0];
+  for(i = 1; i < 8; i++)
+    vmin = _mm256_min_epu32(vmin, m[i]);
+  vmin = _mm256_min_epu32(vmin, _mm256_shuffle_epi32(vmin, _MM_SHUFFLE(1, 0, 3, 2)));
+  vmin = _mm256_min_epu32(vmin, _mm256_shuffle_epi32(vmin, _MM_SHUFFLE(2, 3, 0, 1)));
+  vmin = _mm256_min_epu32(vmin, _mm256_permute2x128_si256(vmin, vmin, 0x01));
+
+  for(i = 0; i < 8; i++) {
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+                 _mm256_cmpeq_epi32(m[i], vmin)));
+    if(mask)
+      return 8*i + __builtin_ctz(mask);
+  }
+  return 0;
+}
+
+#endif /* V27_X86_DISPATCH */
+
+/** Check whether a butterfly implementation can run on the host CPU.
+ *
+ * \param impl Implementation to check.
+ * \return Nonzero if `impl` may be passed to v27_set_impl().
+ */
+int v27_impl_supported(v27_impl_t impl)
+{
+  switch(impl) {
+  case V27_IMPL_AUTO:
+  case V27_IMPL_PORTABLE:
+    return 1;
+#ifdef V27_X86_DISPATCH
+  case V27_IMPL_SSE2:
+    return __builtin_cpu_supports("sse2");
+  case V27_IMPL_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return 0;
+  }
+}
+
+/** Select the butterfly implementation used by a v27_t decoder.
+ * v27_init() selects V27_IMPL_AUTO. The decoded output does not depend on
+ * the implementation.
+ *
+ * \param v Structure to modify.
+ * \param impl Implementation to use, must be supported by the host CPU, see
+ *             v27_impl_supported(). V27_IMPL_AUTO selects the fastest one.
+ */
+void v27_set_impl(v27_t *v, v27_impl_t impl)
+{
+  if(impl == V27_IMPL_AUTO) {
+    if(v27_impl_supported(V27_IMPL_AVX2))
+      impl = V27_IMPL_AVX2;
+    else if(v27_impl_supported(V27_IMPL_SSE2))
+      impl = V27_IMPL_SSE2;
+    else
+      impl = V27_IMPL_PORTABLE;
+  }
+  v->impl = impl;
+}
+
+/** Update a v27_t decoder with a block of symbols.
+ *
+ * \param v Structure to update.
+ * \param syms Array of symbols to use. Must contain two symbols per bit.
+ *             0xff = strong 1, 0x00 = strong 0.
+ * \param nbits Number of bits corresponding to the provided symbols.
+ */
+void v27_update(v27_t *v, const unsigned char *syms, int nbits)
+{
+  switch(v->impl) {
+#ifdef V27_X86_DISPATCH
+  case V27_IMPL_AVX2:
+    v27_update_avx2(v, syms, nbits);
+    break;
+  case V27_IMPL_SSE2:
+    v27_update_sse2(v, syms, nbits);
+    break;
+#endif
+  default:
+    v27_update_portable(v, syms, nbits);
+    break;
   }
 }
 
@@ -203,6 +443,14 @@ void v27_chainback_likely(v27_t *v, unsigned char *data, unsigned int nbits)
   int i;
   unsigned int best_metric = 0xffffffff;
   unsigned char best_state = 0;
+
+#ifdef V27_X86_DISPATCH
+  if(v->impl == V27_IMPL_AVX2) {
+    v27_chainback_fixed(v, data, nbits, v27_best_state_avx2(v->new_metrics));
+    return;
+  }
+#endif
+
   for(i=0; i<64; i++)
   {
     if(v->new_metrics[i] < best_metric)
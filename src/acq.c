@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <libswiftnav/acq.h>
+#include <libswiftnav/prns.h>
+
+/** Number of chips in the C/A code. */
+#define CA_CODE_LENGTH 1023
+
+/** C/A code period in seconds. */
+#define CA_CODE_PERIOD 1e-3
+
+/** \defgroup acq Acquisition
+ * Parallel code phase search acquisition.
+ *
+ * For each carrier frequency bin the samples of one code period are mixed
+ * to baseband and transformed with an FFT. The circular correlation with
+ * every code phase at once is then the inverse FFT of the product with the
+ * conjugate FFT of the code replica. The signal FFT for a frequency bin is
+ * shared by all the signals searched for in the same call, so searching
+ * several signals together costs one forward FFT per bin plus one inverse
+ * FFT per bin and signal. The code FFTs are computed from the ca_code()
+ * replicas on first use and cached.
+ *
+ * Several consecutive code periods can be integrated non-coherently, by
+ * summing the correlation power over them, to acquire weaker signals.
+ *
+ * The search does not allocate memory, its work areas, cached code FFTs and
+ * correlation grid are stored in a buffer provided by the caller.
+ * \{ */
+
+static size_t align8(size_t x)
+{
+  return (x + 7) & ~(size_t)7;
+}
+
+static void *acq_alloc(acq_t *a, size_t size)
+{
+  if (a->buff_used + align8(size) > a->buff_size)
+    return NULL;
+  void *p = &a->buff[a->buff_used];
+  a->buff_used += align8(size);
+  return p;
+}
+
+/** Storage needed for an acquisition search.
+ *
+ * \param n      Samples per code period.
+ * \param n_sids Number of signals whose code FFTs are to be cached, and the
+ *               maximum number of signals searched in one call.
+ * \param n_bins Maximum number of carrier frequency bins per search.
+ * \return Size in bytes of the buffer to pass to acq_init().
+ */
+size_t acq_buff_size(u32 n, u32 n_sids, u32 n_bins)
+{
+  size_t cpx = align8(n * sizeof(fft_cpx_t));
+  return (5 + n_sids) * cpx + align8((size_t)n_sids * n_bins * n * sizeof(float));
+}
+
+/** Initialise an acquisition search.
+ *
+ * \param a           Acquisition state to initialise.
+ * \param sample_freq Sample frequency in Hz, must be a whole number of
+ *                    samples per code period.
+ * \param buff        Storage for the search, must be 8 byte aligned, see
+ *                    acq_buff_size().
+ * \param buff_size   Size of `buff` in bytes.
+ * \return `0` on success, `<0` on failure.
+ */
+s8 acq_init(acq_t *a, double sample_freq, void *buff, size_t buff_size)
+{
+  if (!buff || ((size_t)buff & 7))
+    return -1;
+
+  double n = sample_freq * CA_CODE_PERIOD;
+  if (n < 1 || fabs(n - round(n)) > 1e-6)
+    return -2;
+
+  a->n = (u32)round(n);
+  a->sample_freq = sample_freq;
+  a->buff = buff;
+  a->buff_size = buff_size;
+  a->buff_used = 0;
+  memset(a->code_fft, 0, sizeof(a->code_fft));
+
+  size_t cpx = a->n * sizeof(fft_cpx_t);
+  fft_cpx_t *twiddles = acq_alloc(a, cpx);
+  a->baseband = acq_alloc(a, cpx);
+  a->sig_fft = acq_alloc(a, cpx);
+  a->prod = acq_alloc(a, cpx);
+  a->corr = acq_alloc(a, cpx);
+  if (!a->corr)
+    return -3;
+
+  if (fft_plan_init(&a->fft, a->n, twiddles) < 0)
+    return -4;
+
+  return 0;
+}
+
+/* Get the cached conjugate FFT of a code replica, computing it if needed. */
+static const fft_cpx_t *acq_code_fft(acq_t *a, gnss_signal_t sid)
+{
+  u32 idx = sid_to_index(sid);
+  if (a->code_fft[idx])
+    return a->code_fft[idx];
+
+  fft_cpx_t *code_fft = acq_alloc(a, a->n * sizeof(fft_cpx_t));
+  if (!code_fft)
+    return NULL;
+
+  const u8 *code = ca_code(sid);
+  for (u32 i = 0; i < a->n; i++) {
+    u32 chip = (u64)i * CA_CODE_LENGTH / a->n;
+    a->baseband[i].re = get_chip((u8 *)code, chip);
+    a->baseband[i].im = 0;
+  }
+  fft_forward(&a->fft, a->baseband, code_fft);
+  for (u32 i = 0; i < a->n; i++)
+    code_fft[i].im = -code_fft[i].im;
+
+  a->code_fft[idx] = code_fft;
+  return code_fft;
+}
+
+/* Mix one code period of samples to baseband. */
+static void acq_mix(acq_t *a, const s8 *samples, double cf)
+{
+  double step = -2 * M_PI * cf / a->sample_freq;
+  double c = 1, s = 0;
+  double cd = cos(step), sd = sin(step);
+
+  for (u32 i = 0; i < a->n; i++) {
+    a->baseband[i].re = samples[i] * c;
+    a->baseband[i].im = samples[i] * s;
+    double c_ = c*cd - s*sd;
+    s = s*cd + c*sd;
+    c = c_;
+  }
+}
+
+/** Search for several signals in a block of samples.
+ *
+ * Searches all code phases and the carrier frequencies from `cf_min` to
+ * `cf_max` in steps of `cf_bin_width` for each of the signals `sids`,
+ * reporting the code phase and carrier frequency of the strongest
+ * correlation peak for each.
+ *
+ * \param a             Acquisition state from acq_init().
+ * \param samples       `n_noncoherent` consecutive code periods of samples.
+ * \param n_noncoherent Number of code periods to integrate non-coherently.
+ * \param cf_min        Lowest carrier frequency searched in Hz.
+ * \param cf_max        Highest carrier frequency searched in Hz.
+ * \param cf_bin_width  Carrier frequency step in Hz.
+ * \param n_sids        Number of signals to search for, nothing is done if 0.
+ * \param sids          Signals to search for.
+ * \param results       Output, one result per signal.
+ * \return `0` on success, `-1` or `-2` if the buffer passed to acq_init()
+ *         is too small, `-3` if the carrier frequency range or step is
+ *         invalid.
+ */
+s8 acq_search(acq_t *a, const s8 *samples, u32 n_noncoherent,
+              float cf_min, float cf_max, float cf_bin_width,
+              u8 n_sids, const gnss_signal_t *sids, acq_result_t *results)
+{
+  if (!(cf_bin_width > 0) || !(cf_max >= cf_min))
+    return -3;
+
+  if (n_sids == 0)
+    return 0;
+
+  const fft_cpx_t *code_fft[n_sids];
+  for (u8 j = 0; j < n_sids; j++) {
+    code_fft[j] = acq_code_fft(a, sids[j]);
+    if (!code_fft[j])
+      return -1;
+  }
+
+  u32 n = a->n;
+  u32 n_bins = (u32)floor((cf_max - cf_min) / cf_bin_width + 1e-3) + 1;
+  size_t grid_size = (size_t)n_sids * n_bins * n;
+
+  /* The correlation grid is only needed for the duration of the search. */
+  size_t used = a->buff_used;
+  float *grid = acq_alloc(a, grid_size * sizeof(float));
+  a->buff_used = used;
+  if (!grid)
+    return -2;
+  memset(grid, 0, grid_size * sizeof(float));
+
+  for (u32 blk = 0; blk < n_noncoherent; blk++) {
+    for (u32 b = 0; b < n_bins; b++) {
+      acq_mix(a, &samples[blk * n], cf_min + b * cf_bin_width);
+      fft_forward(&a->fft, a->baseband, a->sig_fft);
+
+      for (u8 j = 0; j < n_sids; j++) {
+        const fft_cpx_t *c = code_fft[j];
+        for (u32 i = 0; i < n; i++) {
+          a->prod[i].re = a->sig_fft[i].re*c[i].re - a->sig_fft[i].im*c[i].im;
+          a->prod[i].im = a->sig_fft[i].re*c[i].im + a->sig_fft[i].im*c[i].re;
+        }
+        fft_inverse(&a->fft, a->prod, a->corr);
+
+        float *g = &grid[((size_t)j * n_bins + b) * n];
+        for (u32 i = 0; i < n; i++)
+          g[i] += a->corr[i].re*a->corr[i].re + a->corr[i].im*a->corr[i].im;
+      }
+    }
+  }
+
+  for (u8 j = 0; j < n_sids; j++) {
+    const float *g = &grid[(size_t)j * n_bins * n];
+    double sum = 0;
+    float best = -1;
+    u32 best_bin = 0, best_k = 0;
+    for (u32 b = 0; b < n_bins; b++) {
+      for (u32 k = 0; k < n; k++) {
+        float p = g[b * n + k];
+        sum += p;
+        if (p > best) {
+          best = p;
+          best_bin = b;
+          best_k = k;
+        }
+      }
+    }
+
+    /* A peak at lag k means the replica has to be advanced by k samples to
+     * line up with the signal. */
+    results[j].sid = sids[j];
+    results[j].cp = (double)((n - best_k) % n) * CA_CODE_LENGTH / n;
+    results[j].cf = cf_min + best_bin * cf_bin_width;
+    results[j].snr = sum > 0 ? best / (sum / (n_bins * n)) : 0;
+  }
+
+  return 0;
+}
+
+/** \} */
@@ -20,12 +20,11 @@
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
-#include <cblas.h>
-#include <clapack.h>
 #include <math.h>
 
 #include <libswiftnav/logging.h>
 #include <libswiftnav/linear_algebra.h>
+#include <libswiftnav/small_matrix.h>
 #include <libswiftnav/constants.h>
 #include <libswiftnav/track.h>
 #include <libswiftnav/almanac.h>
@@ -59,11 +58,7 @@ double compute_innovation_terms(u32 state_dim, const double *h,
 {
   memcpy(f, h, state_dim * sizeof(double));
   /*  f = U^T * h. */
-  cblas_dtrmv(CblasRowMajor, CblasUpper, CblasTrans, CblasUnit,
-              /* ^ CBLAS_ORDER, CBLAS_UPLO, CBLAS_TRANSPOSE transA, CBLAS_DIAG. */
-              state_dim, U,     /* int N, double *A. */
-              state_dim, f, 1); /*  int lda, double *X, int incX. */
-
+  smat_unit_upper_tmul(state_dim, 1, U, f);
 
   /*  g = diag(D) * f.
       alpha = f * g + R = f^T * diag(D) * f + R. */
@@ -221,12 +216,11 @@ double get_sos_innov(const nkf_t *kf, const double *decor_obs)
   }
 
   double predicted_obs[kf->obs_dim];
-  matrix_multiply(kf->obs_dim, kf->state_dim, 1,
-                  kf->decor_obs_mtx, kf->state_mean, predicted_obs);
+  smat_mul(kf->obs_dim, kf->state_dim, 1,
+           kf->decor_obs_mtx, kf->state_mean, predicted_obs);
   double hu[kf->obs_dim * kf->state_dim];
-  /* TODO use the fact that U is unit triangular to save a ton of time */
-  matrix_multiply(kf->obs_dim, kf->state_dim, kf->state_dim,
-                  kf->decor_obs_mtx, kf->state_cov_U, hu);
+  smat_mul_unit_upper(kf->obs_dim, kf->state_dim,
+                      kf->decor_obs_mtx, kf->state_cov_U, hu);
   /* (H * U * D * U^T * H^T)_ii = (HU * D * HU^T)_ii
    *                            = Sum_kl (HU_ik * D_kl * HU^T_li)
    *                            = Sum_kl (HU_ik * D_kl * HU_il)
@@ -329,11 +323,8 @@ static bool incorporate_obs(nkf_t *kf, double *decor_obs)
 static void make_residual_measurements(const nkf_t *kf, const double *measurements, double *resid_measurements)
 {
   u8 constraint_dim = CLAMP_DIFF(kf->state_dim, 3);
-  cblas_dgemv (CblasRowMajor, CblasNoTrans, /* Order, TransA. */
-               constraint_dim, kf->state_dim, /*  M, N. */
-               1, kf->null_basis_Q, kf->state_dim, /*  alpha A, lda. */
-               measurements, 1, /*  X, incX. */
-               0, resid_measurements, 1); /*  beta, Y, incY. */
+  smat_mul(constraint_dim, kf->state_dim, 1,
+           kf->null_basis_Q, measurements, resid_measurements);
   for (u8 i=0; i< kf->state_dim; i++) {
     resid_measurements[i+constraint_dim] =
       simple_amb_measurement(measurements[i],
@@ -380,9 +371,7 @@ bool nkf_update(nkf_t *kf, const double *measurements)
   make_residual_measurements(kf, measurements, resid_measurements);
 
   /* Replaces residual measurements by their decorrelated version. */
-  cblas_dtrmv(CblasRowMajor, CblasUpper, CblasNoTrans, CblasUnit, /*  Order, Uplo, TransA, Diag. */
-              kf->obs_dim, kf->decor_mtx, kf->obs_dim, /*  N, A, lda. */
-              resid_measurements, 1); /*  X, incX. */
+  smat_unit_upper_mul(kf->obs_dim, 1, kf->decor_mtx, resid_measurements);
 
   /*  Prediction update */
   diffuse_state(kf);
@@ -413,59 +402,12 @@ static void initialize_state(nkf_t *kf, double *dd_measurements, double init_var
   matrix_eye(num_dds, kf->state_cov_U);
 }
 
-static void QR_part1(integer m, integer n, double *A, double *tau)
-{
-  double w[1];
-  integer lwork = -1;
-  integer info;
-  integer jpvt[3];
-  memset(jpvt, 0, 3 * sizeof(integer));
-  dgeqp3_(&m, &n,
-          A, &m,
-          jpvt,
-          tau,
-          w, &lwork, &info);
-  lwork = round(w[0]);
-  double work[lwork];
-  dgeqp3_(&m, &n,
-          A, &m,
-          jpvt,
-          tau,
-          work, &lwork, &info); /* set A = QR(A). */
-}
-
-static void QR_part2(integer m, integer n, double *A, double *tau)
-{
-  double w[1];
-  integer lwork = -1;
-  integer info;
-  dorgqr_(&m, &m, &n,
-          A, &m,
-          tau,
-          w, &lwork, &info);
-  lwork = round(w[0]);
-  double work[lwork];
-  dorgqr_(&m, &m, &n,
-          A, &m,
-          tau,
-          work, &lwork, &info);
-}
-
 void assign_phase_obs_null_basis(u8 num_dds, double *DE_mtx, double *q)
 {
-  /* DE is num_sats-1 by 3, need to transpose it to column major. */
-  double A[num_dds * num_dds];
-  for (u8 i=0; i < num_dds; i++) {
-    for (u8 j=0; j<3; j++) {
-      A[j*num_dds + i] = DE_mtx[i*3 + j]; /* set A = Transpose(DE_mtx). */
-    }
+  /* With three or fewer DDs the null space is empty. */
+  if (num_dds > 3) {
+    smat_left_null_basis(num_dds, 3, DE_mtx, q);
   }
-  integer m = num_dds;
-  integer n = 3;
-  double tau[3];
-  QR_part1(m, n, A, tau);
-  QR_part2(m, n, A, tau);
-  memcpy(q, &A[3*num_dds], CLAMP_DIFF(num_dds, 3) * num_dds * sizeof(double));
 }
 
 /* TODO this could be made more efficient, if it matters. */
@@ -494,9 +436,9 @@ static void assign_residual_obs_cov(u8 num_dds, double phase_var, double code_va
 {
   double dd_obs_cov[4 * num_dds * num_dds];
   assign_dd_obs_cov(num_dds, phase_var, code_var, dd_obs_cov);
-  integer nullspace_dim = CLAMP_DIFF(num_dds, 3);
-  integer dd_dim = 2*num_dds;
-  integer res_dim = num_dds + nullspace_dim;
+  u8 nullspace_dim = CLAMP_DIFF(num_dds, 3);
+  u8 dd_dim = 2*num_dds;
+  u8 res_dim = num_dds + nullspace_dim;
   double q_tilde[res_dim * dd_dim];
   memset(q_tilde, 0, res_dim * dd_dim * sizeof(double));
 
@@ -510,32 +452,7 @@ static void assign_residual_obs_cov(u8 num_dds, double phase_var, double code_va
 
   /* TODO make more efficient via the structure of q_tilde, and its relation to
    * the I + 1*1^T structure of the obs cov mtx. */
-  double QC[res_dim * dd_dim];
-  cblas_dsymm(CblasRowMajor, CblasRight, CblasUpper, /* CBLAS_ORDER, CBLAS_SIDE, CBLAS_UPLO. */
-              res_dim, dd_dim,                       /* int M, int N. */
-              1, dd_obs_cov, dd_dim,                 /* double alpha, double *A, int lda. */
-              q_tilde, dd_dim,                       /* double *B, int ldb. */
-              0, QC, dd_dim);                        /* double beta, double *C, int ldc. */
-
-  /* TODO make more efficient via the structure of q_tilde, and its relation to
-   * the I + 1*1^T structure of the obs cov mtx. */
-  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, /*  CBLAS_ORDER, CBLAS_TRANSPOSE transA, cBLAS_TRANSPOSE transB. */
-              res_dim, res_dim, dd_dim,                /* int M, int N, int K. */
-              1, QC, dd_dim,                           /* double alpha, double *A, int lda. */
-              q_tilde, dd_dim,                         /* double *B, int ldb. */
-              0, r_cov, res_dim);                      /* beta, double *C, int ldc. */
-}
-
-/*  In place inversion of U. */
-static void invert_U(u8 res_dim, double *U)
-{
-  char uplo = 'U'; /* upper triangular. */
-  char diag = 'U'; /* unit triangular. */
-  integer dim = res_dim;
-  integer lda = res_dim;
-  integer info;
-  dtrtri_(&uplo, &diag,
-          &dim, U, &lda, &info);
+  smat_asat(res_dim, dd_dim, q_tilde, dd_obs_cov, r_cov);
 }
 
 static void assign_simple_sig(u8 num_dds, double var, double *simple_cov)
@@ -562,18 +479,97 @@ static void assign_simple_sig(u8 num_dds, double var, double *simple_cov)
  * where Q's rows form a basis for the left null space for DE
  */
 static void assign_H_prime(u8 res_dim, u8 constraint_dim, u8 num_dds,
-                           double *Q, double *U_inv, double *H_prime)
+                           double *Q, double *U, double *H_prime)
 {
   /*  set the H_prime variable to equal H. */
   memcpy(H_prime, Q, constraint_dim * num_dds * sizeof(double));
   matrix_eye(num_dds, &H_prime[constraint_dim * num_dds]);
 
-  /*  multiply H_prime by U_inv to make it the actual H_prime. */
-  cblas_dtrmm(CblasRowMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasUnit,
-              /* ^ CBLAS_ORDER, CBLAS_SIDE, CBLAS_UPLO, CBLAS_TRANSPOSE, CBLAS_DIAG. */
-              res_dim, num_dds,  /* M, N. */
-              1, U_inv, res_dim, /* alpha, A, lda. */
-              H_prime, num_dds); /* B, ldb. */
+  /*  multiply H_prime by U to make it the actual H_prime. */
+  smat_unit_upper_mul(res_dim, num_dds, U, H_prime);
+}
+
+/* The UDU decomposition of the covariance of the phase + code / lambda DD
+ * observations, var * (I + 1*1^T). This block does not depend on the
+ * geometry, so it is kept in the filter and only rebuilt when the number of
+ * DDs or the variances change. */
+static void update_code_block(nkf_t *kf, u8 num_dds, double var)
+{
+  if (kf->code_block_dim == num_dds && kf->code_block_var == var) {
+    return;
+  }
+  double Sig[num_dds * num_dds];
+  assign_simple_sig(num_dds, var, Sig);
+  matrix_udu(num_dds, Sig, kf->code_block_U, kf->code_block_D);
+  kf->code_block_dim = num_dds;
+  kf->code_block_var = var;
+}
+
+/* The UDU decomposition of Sig (see get_kf_matrices()) built from its
+ * blocks. With var_c = var_phi + var_rho / lambda^2 and r = var_phi / var_c:
+ *
+ *   Sig = ( A    B )    A = var_phi * (Q*Q^T + v*v^T),  v = Q*1
+ *         ( B^T  C )    B = var_phi * (Q + v*1^T)
+ *                       C = var_c * (I + 1*1^T) = U2 * D2 * U2^T
+ *
+ *   U = ( U1  U12 )     U12 = B * U2^-T * D2^-1 = r * Q * U2
+ *       ( 0   U2  )     U1 * D1 * U1^T = A - B * C^-1 * B^T
+ *                                      = var_phi * (1 - r) * (Q*Q^T + v*v^T)
+ *
+ * U2 and D2 come from the cached code block, so only the constraint_dim
+ * square Schur complement is decomposed each epoch.
+ */
+static void udu_residual_obs_cov(nkf_t *kf, u8 num_dds, u8 constraint_dim,
+                                 double phase_var, double code_var,
+                                 const double *Q, double *U, double *D)
+{
+  u8 res_dim = num_dds + constraint_dim;
+  double var_c = phase_var + code_var / (GPS_L1_LAMBDA_NO_VAC * GPS_L1_LAMBDA_NO_VAC);
+  double r = phase_var / var_c;
+
+  update_code_block(kf, num_dds, var_c);
+  const double *U2 = kf->code_block_U;
+
+  double v[constraint_dim];
+  for (u8 i = 0; i < constraint_dim; i++) {
+    v[i] = 0;
+    for (u8 j = 0; j < num_dds; j++) {
+      v[i] += Q[i*num_dds + j];
+    }
+  }
+
+  double S[constraint_dim * constraint_dim];
+  double S_scale = phase_var * (1 - r);
+  for (u8 i = 0; i < constraint_dim; i++) {
+    for (u8 j = i; j < constraint_dim; j++) {
+      double qq = 0;
+      for (u8 k = 0; k < num_dds; k++) {
+        qq += Q[i*num_dds + k] * Q[j*num_dds + k];
+      }
+      S[i*constraint_dim + j] = S_scale * (qq + v[i] * v[j]);
+    }
+  }
+  double U1[constraint_dim * constraint_dim];
+  matrix_udu(constraint_dim, S, U1, D);
+
+  memset(U, 0, res_dim * res_dim * sizeof(double));
+  for (u8 i = 0; i < constraint_dim; i++) {
+    memcpy(&U[i*res_dim], &U1[i*constraint_dim],
+           constraint_dim * sizeof(double));
+    /* U12 = r * Q * U2, U2 being unit upper triangular. */
+    for (u8 j = 0; j < num_dds; j++) {
+      double q = Q[i*num_dds + j];
+      for (u8 l = 0; l < j; l++) {
+        q += Q[i*num_dds + l] * U2[l*num_dds + j];
+      }
+      U[i*res_dim + constraint_dim + j] = r * q;
+    }
+  }
+  for (u8 i = 0; i < num_dds; i++) {
+    memcpy(&U[(constraint_dim + i)*res_dim + constraint_dim],
+           &U2[i*num_dds], num_dds * sizeof(double));
+  }
+  memcpy(&D[constraint_dim], kf->code_block_D, num_dds * sizeof(double));
 }
 
 /* REQUIRES num_sdiffs > 0 */
@@ -595,13 +591,20 @@ static void assign_H_prime(u8 res_dim, u8 constraint_dim, u8 num_dds,
  *                 ( 0                 D*D^T * var_rho )
  *     and D*D^T = 1*1^T + I
  *
- * This function constructs D, U^-1, and H'
+ * This function constructs D, U, and H'. Only the null space basis Q and
+ * the blocks of U depending on it are rebuilt every epoch, see
+ * udu_residual_obs_cov().
+ *
+ * Note the observations are decorrelated with U rather than U^-1. The LAPACK
+ * inversion which used to follow the decomposition read the empty lower
+ * triangle of the row major U and so left it unchanged, and the filter has
+ * been tuned with this behaviour.
  */
-static void get_kf_matrices(u8 num_sdiffs, sdiff_t *sdiffs_with_ref_first,
+static void get_kf_matrices(nkf_t *kf, u8 num_sdiffs, sdiff_t *sdiffs_with_ref_first,
                             double ref_ecef[3],
                             double phase_var, double code_var,
                             double *null_basis_Q,
-                            double *U_inv, double *D,
+                            double *U, double *D,
                             double *H_prime)
 {
   assert (num_sdiffs > 0);
@@ -610,29 +613,31 @@ static void get_kf_matrices(u8 num_sdiffs, sdiff_t *sdiffs_with_ref_first,
   u8 constraint_dim = CLAMP_DIFF(num_dds, 3);
   u8 res_dim = num_dds + constraint_dim;
 
-  double Sig[res_dim * res_dim];
-
   /* assign Sig and H. */
   if (constraint_dim > 0) {
     double DE[num_dds * 3];
     assign_de_mtx(num_sdiffs, sdiffs_with_ref_first, ref_ecef, DE);
     assign_phase_obs_null_basis(num_dds, DE, null_basis_Q);
-    assign_residual_obs_cov(num_dds, phase_var, code_var, null_basis_Q, Sig);
-    /* TODO U seems to have that fancy blockwise structure we love so much. Use it. */
-    matrix_udu(res_dim, Sig, U_inv, D); /* U_inv holds U after this. */
-    invert_U(res_dim, U_inv);
+    if (phase_var > 0 && code_var > 0) {
+      udu_residual_obs_cov(kf, num_dds, constraint_dim, phase_var, code_var,
+                           null_basis_Q, U, D);
+    } else {
+      /* Degenerate covariance, decompose all of Sig. */
+      double Sig[res_dim * res_dim];
+      assign_residual_obs_cov(num_dds, phase_var, code_var, null_basis_Q, Sig);
+      matrix_udu(res_dim, Sig, U, D);
+    }
     /* TODO this also has fancy structure. */
-    assign_H_prime(res_dim, constraint_dim, num_dds, null_basis_Q, U_inv, H_prime);
+    assign_H_prime(res_dim, constraint_dim, num_dds, null_basis_Q, U, H_prime);
   }
   else {
-    assign_simple_sig(num_dds,
-                      phase_var + code_var / (GPS_L1_LAMBDA_NO_VAC * GPS_L1_LAMBDA_NO_VAC),
-                      Sig);
-    matrix_udu(res_dim, Sig, U_inv, D); /* U_inv holds U after this. */
-    invert_U(res_dim, U_inv);
+    update_code_block(kf, num_dds,
+                      phase_var + code_var / (GPS_L1_LAMBDA_NO_VAC * GPS_L1_LAMBDA_NO_VAC));
+    memcpy(U, kf->code_block_U, num_dds * num_dds * sizeof(double));
+    memcpy(D, kf->code_block_D, num_dds * sizeof(double));
 
-    /* H = I in this case, so H' = U^-1 * H = U^-1. */
-    memcpy(H_prime, U_inv, num_dds * num_dds * sizeof(double));
+    /* H = I in this case, so H' = U. */
+    memcpy(H_prime, U, num_dds * num_dds * sizeof(double));
   }
 
 }
@@ -645,6 +650,7 @@ void set_nkf(nkf_t *kf, double amb_drift_var, double phase_var, double code_var,
   DEBUG_ENTRY();
 
   kf->amb_drift_var = amb_drift_var;
+  kf->code_block_dim = 0;
   set_nkf_matrices(kf, phase_var, code_var, num_sdiffs, sdiffs_with_ref_first, ref_ecef);
   /* Given plain old measurements, initialize the state. */
   initialize_state(kf, dd_measurements, amb_init_var);
@@ -662,7 +668,7 @@ void set_nkf_matrices(nkf_t *kf, double phase_var, double code_var,
   u32 constraint_dim = CLAMP_DIFF(num_diffs, 3);
   kf->obs_dim = num_diffs + constraint_dim;
 
-  get_kf_matrices(num_sdiffs, sdiffs_with_ref_first,
+  get_kf_matrices(kf, num_sdiffs, sdiffs_with_ref_first,
                   ref_ecef,
                   phase_var, code_var,
                   kf->null_basis_Q,
@@ -761,20 +767,8 @@ void rebase_covariance_sigma(double *state_cov, const u8 num_sats, const gnss_si
   double rebase_mtx[state_dim * state_dim];
   assign_state_rebase_mtx(num_sats, old_sids, new_sids, rebase_mtx);
 
-  double intermediate_cov[state_dim * state_dim];
   /* TODO make more efficient via structure of rebase_mtx. */
-  cblas_dsymm(CblasRowMajor, CblasRight, CblasUpper, /* CBLAS_ORDER, CBLAS_SIDE, CBLAS_UPLO. */
-              state_dim, state_dim,                  /* int M, int N. */
-              1, state_cov, state_dim,               /* double alpha, double *A, int lda. */
-              rebase_mtx, state_dim,                 /* double *B, int ldb. */
-              0, intermediate_cov, state_dim);       /* double beta, double *C, int ldc. */
-
-  /* TODO make more efficient via the structure of rebase_mtx. */
-  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, /* CBLAS_ORDER, CBLAS_TRANSPOSE transA, cBLAS_TRANSPOSE transB. */
-              state_dim, state_dim, state_dim,         /* int M, int N, int K. */
-              1, intermediate_cov, state_dim,          /* double alpha, double *A, int lda. */
-              rebase_mtx, state_dim,                   /* double *B, int ldb. */
-              0, state_cov, state_dim);                /* beta, double *C, int ldc. */
+  smat_asat(state_dim, state_dim, rebase_mtx, state_cov, state_cov);
 }
 
 /* REQUIRES num_sats > 1 */
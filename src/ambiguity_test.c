@@ -11,9 +11,8 @@
  */
 
 #include <assert.h>
-#include <clapack.h>
 #include <inttypes.h>
-#include <cblas.h>
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -22,6 +21,7 @@
 #include <libswiftnav/common.h>
 #include <libswiftnav/constants.h>
 #include <libswiftnav/linear_algebra.h>
+#include <libswiftnav/small_matrix.h>
 #include <libswiftnav/observation.h>
 #include <libswiftnav/amb_kf.h>
 #include <libswiftnav/lambda.h>
@@ -35,6 +35,16 @@
 #define NUM_SEARCH_STDS 5
 #define LOG_PROB_RAT_THRESHOLD -90
 #define SINGLE_OBS_CHISQ_THRESHOLD 20
+/* Hypotheses evaluated together by one pass of the quadratic term kernel,
+ * one per vector lane. */
+#define QUAD_BLOCK_SIZE 16
+/* Hypotheses evaluated per call to get_quadratic_terms() when updating the
+ * pool. */
+#define QUAD_CHUNK_SIZE 256
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QUAD_X86_DISPATCH
+#endif
 
 // TODO delete?
 static void matrix_multiply_z_t(u32 n, u32 m, u32 p, const z_t *a,
@@ -43,22 +53,99 @@ static void matrix_multiply_z_t(u32 n, u32 m, u32 p, const z_t *a,
   matrix_multiply_s64(n,m,p,a,b,c);
 }
 
+/* Set of the signals in `sids`, false if any isn't a valid signal. */
+static bool sids_to_set(u8 n, const gnss_signal_t *sids, sid_set_t *s)
+{
+  for (u8 i = 0; i < n; i++) {
+    if (!sid_valid(sids[i])) {
+      return false;
+    }
+  }
+  sid_set_from_sids(s, n, sids);
+  return true;
+}
+
+/* Forget the decorrelations of the last satellite inclusion attempt. */
+static void reset_decor_cache(decor_cache_t *c)
+{
+  sid_set_init(&c->float_sids);
+  sid_set_init(&c->test_sids);
+  lambda_reduction_init(&c->full);
+  lambda_reduction_init(&c->addible);
+}
+
 /** \defgroup ambiguity_test Integer Ambiguity Resolution
  * Integer ambiguity resolution using bayesian hypothesis testing.
  * \{ */
-void create_empty_ambiguity_test(ambiguity_test_t *amb_test)
+/** Initialise an empty ambiguity test.
+ * The hypotheses are stored in a compact memory pool backed by `buff`, which
+ * belongs to this ambiguity test alone and must stay valid for as long as it
+ * is in use. Its size is given by #AMBIGUITY_TEST_BUFF_SIZE. The capacity can
+ * later be changed with ambiguity_test_resize().
+ *
+ * \param amb_test  The ambiguity test to initialise.
+ * \param max_hyps  Maximum number of hypotheses, at most
+ *                  #MEMORY_POOL_COMPACT_MAX_ELEMENTS.
+ * \param buff      Buffer of #AMBIGUITY_TEST_BUFF_SIZE(`max_hyps`) bytes.
+ * \return          `0` on success, `<0` on failure.
+ */
+s8 ambiguity_test_init(ambiguity_test_t *amb_test, u32 max_hyps, void *buff)
 {
-  static u8 pool_buff[MAX_HYPOTHESES*(sizeof(hypothesis_t) + sizeof(void *))];
-  static memory_pool_t pool;
-  amb_test->pool = &pool;
-  memory_pool_init(amb_test->pool, MAX_HYPOTHESES, sizeof(hypothesis_t), pool_buff);
+  amb_test->pool = NULL;
+  if (max_hyps == 0) {
+    return -1;
+  }
+  if (memory_pool_init_compact(&amb_test->pool_storage, max_hyps,
+                               sizeof(hypothesis_t), buff) < 0) {
+    return -1;
+  }
+  amb_test->pool = &amb_test->pool_storage;
 
   amb_test->sats.num_sats = 0;
   amb_test->amb_check.initialized = 0;
+  reset_decor_cache(&amb_test->decor_cache);
+  return 0;
+}
+
+/** Initialise an empty ambiguity test with the default capacity.
+ * Holds up to #MAX_HYPOTHESES hypotheses in a statically allocated buffer
+ * which is shared by every ambiguity test created this way, use
+ * ambiguity_test_init() to give an ambiguity test storage of its own.
+ *
+ * \param amb_test  The ambiguity test to initialise.
+ */
+void create_empty_ambiguity_test(ambiguity_test_t *amb_test)
+{
+  static u8 pool_buff[AMBIGUITY_TEST_BUFF_SIZE(MAX_HYPOTHESES)];
+  ambiguity_test_init(amb_test, MAX_HYPOTHESES, pool_buff);
 }
+
+/** As create_empty_ambiguity_test(), but starting from a single hypothesis
+ * with no satellites, see reset_ambiguity_test().
+ *
+ * \param amb_test  The ambiguity test to initialise.
+ */
 void create_ambiguity_test(ambiguity_test_t *amb_test)
 {
   create_empty_ambiguity_test(amb_test);
+  reset_ambiguity_test(amb_test);
+}
+
+/** Restart an ambiguity test, keeping its storage.
+ * An ambiguity test which has not been initialised is set up with
+ * create_empty_ambiguity_test() first.
+ *
+ * \param amb_test  The ambiguity test to reset.
+ */
+void reset_ambiguity_test(ambiguity_test_t *amb_test)
+{
+  if (amb_test->pool == NULL) {
+    create_empty_ambiguity_test(amb_test);
+  }
+  memory_pool_clear(amb_test->pool);
+  amb_test->sats.num_sats = 0;
+  amb_test->amb_check.initialized = 0;
+  reset_decor_cache(&amb_test->decor_cache);
 
   /* Initialize pool with single element with num_dds = 0, i.e.
    * zero length N vector, i.e. no satellites. When we take the
@@ -69,9 +156,76 @@ void create_ambiguity_test(ambiguity_test_t *amb_test)
   empty_element->ll = 0;
 }
 
+/** Detach an ambiguity test from its hypothesis buffer.
+ * The buffer itself is owned by the caller of ambiguity_test_init() and is
+ * not freed.
+ *
+ * \param amb_test  The ambiguity test to destroy.
+ */
 void destroy_ambiguity_test(ambiguity_test_t *amb_test)
 {
-  memory_pool_destroy(amb_test->pool);
+  amb_test->pool = NULL;
+}
+
+static s32 compare_hyp_ll_desc(void *arg, element_t *a, element_t *b)
+{
+  (void) arg;
+  float ll_a = ((hypothesis_t *) a)->ll;
+  float ll_b = ((hypothesis_t *) b)->ll;
+  return (ll_a < ll_b) - (ll_a > ll_b);
+}
+
+static s8 keep_first_n(void *arg, element_t *elem)
+{
+  (void) elem;
+  u32 *n = (u32 *) arg;
+  if (*n == 0) {
+    return 0;
+  }
+  (*n)--;
+  return 1;
+}
+
+/** Change the hypothesis capacity of an ambiguity test.
+ * Moves the hypotheses into `buff`, which then replaces the buffer the
+ * ambiguity test was using. If there are more hypotheses than fit in the
+ * new capacity only the `max_hyps` most likely ones are kept, and the pool is
+ * left sorted by decreasing likelihood.
+ *
+ * `buff` may be the current buffer, e.g. to shrink the capacity in place.
+ *
+ * \param amb_test  The ambiguity test to resize.
+ * \param max_hyps  New maximum number of hypotheses, at most
+ *                  #MEMORY_POOL_COMPACT_MAX_ELEMENTS.
+ * \param buff      Buffer of #AMBIGUITY_TEST_BUFF_SIZE(`max_hyps`) bytes.
+ * \return          `0` on success, `<0` on failure, in which case the
+ *                  ambiguity test is unchanged.
+ */
+s8 ambiguity_test_resize(ambiguity_test_t *amb_test, u32 max_hyps, void *buff)
+{
+  /* Check everything memory_pool_resize_compact() can fail on before the
+   * hypotheses are filtered, so that a failure leaves the test unchanged. */
+  if (!amb_test->pool->compact || max_hyps == 0 ||
+      max_hyps > MEMORY_POOL_COMPACT_MAX_ELEMENTS || !buff) {
+    return -1;
+  }
+
+  if (memory_pool_n_allocated(amb_test->pool) > (s32)max_hyps) {
+    memory_pool_sort(amb_test->pool, NULL, &compare_hyp_ll_desc);
+    u32 n_keep = max_hyps;
+    memory_pool_filter(amb_test->pool, &n_keep, &keep_first_n);
+  }
+
+  return memory_pool_resize_compact(amb_test->pool, max_hyps, buff) < 0 ? -1 : 0;
+}
+
+/** Returns the maximum number of hypotheses the ambiguity test can hold.
+ * \param amb_test    The ambiguity test.
+ * \return            Its hypothesis capacity.
+ */
+u32 ambiguity_test_max_hypotheses(ambiguity_test_t *amb_test)
+{
+  return memory_pool_n_elements(amb_test->pool);
 }
 
 /** Gets the hypothesis out of an ambiguity test struct, if there is only one.
@@ -378,7 +532,7 @@ typedef struct {
   unanimous_amb_check_t *unanimous_amb_check; /**< A struct to check which int ambs are agreed upon among all hyps. */
 } hyp_filter_t;
 
-/** A mapAccum styled function to update the hypothesis log-likelihoods and find the greatest LL.
+/** Updates the hypothesis log-likelihoods and finds the greatest LL.
  * Simultaneously performs a map, doing a Bayesian update of the log likelihoods
  * of each hypothesis, while performing a fold on those updated log likelihoods
  * to find the likelihood of the MLE hypothesis.
@@ -386,25 +540,38 @@ typedef struct {
  * If a single observation was sufficiently unlikely to come from this hypothesis, we reject
  * the hypothesis. (In addition to the accumulated relative likelihood that is filtered upon later).
  *
- * To be given to memory_pool_fold().
+ * The quadratic terms are evaluated by get_quadratic_terms() a chunk of
+ * hypotheses at a time, straight out of the pool's element array, and the
+ * rejected hypotheses are dropped in one pass with memory_pool_filter_mask().
  *
- * \param x     Points to a hyp_filter_t containing the accumulator and everything needed for the map.
- * \param elem  The hypothesis to be mapAccum'd.
+ * \param x     The accumulator and everything needed for the map.
+ * \param pool  The hypothesis pool, must be a compact pool.
  */
-static s8 update_and_get_max_ll(void *x_, element_t *elem) {
-  hyp_filter_t *x = (hyp_filter_t *) x_;
-  hypothesis_t *hyp = (hypothesis_t *) elem;
-  double hypothesis_N[x->num_dds];
+static void update_and_get_max_ll(hyp_filter_t *x, memory_pool_t *pool)
+{
+  u32 n = memory_pool_n_allocated(pool);
+  hypothesis_t *hyps = (hypothesis_t *) memory_pool_elements(pool);
+  assert(hyps != NULL);
+  if (n == 0) {
+    return;
+  }
 
-  for (u8 i=0; i < x->num_dds; i++) {
-    hypothesis_N[i] = hyp->N[i];
+  u8 keep[n];
+  double q[QUAD_CHUNK_SIZE];
+  for (u32 i = 0; i < n; i += QUAD_CHUNK_SIZE) {
+    u32 n_chunk = MIN(QUAD_CHUNK_SIZE, n - i);
+    get_quadratic_terms(x->res_mtxs, x->num_dds, n_chunk, &hyps[i],
+                        x->r_vec, q);
+    for (u32 k = 0; k < n_chunk; k++) {
+      hypothesis_t *hyp = &hyps[i + k];
+      hyp->ll += q[k];
+      x->max_ll = MAX(x->max_ll, hyp->ll);
+      keep[i + k] = (fabs(q[k]) < SINGLE_OBS_CHISQ_THRESHOLD);
+      /* Doesn't appear to need a dependence on d.o.f. to be effective.
+       * We should revisit SINGLE_OBS_CHISQ_THRESHOLD when our noise model is tighter. */
+    }
   }
-  double q = get_quadratic_term(x->res_mtxs, x->num_dds, hypothesis_N, x->r_vec);
-  hyp->ll += q;
-  x->max_ll = MAX(x->max_ll, hyp->ll);
-  return (abs(q) < SINGLE_OBS_CHISQ_THRESHOLD);
-  /* Doesn't appear to need a dependence on d.o.f. to be effective.
-   * We should revisit SINGLE_OBS_CHISQ_THRESHOLD when our noise model is tighter. */
+  memory_pool_filter_mask(pool, keep);
 }
 
 /** Keeps track of which integer ambiguities are uninimously agreed upon in the pool.
@@ -504,7 +671,7 @@ void test_ambiguities(ambiguity_test_t *amb_test, double *dd_measurements)
   x.unanimous_amb_check = &amb_test->amb_check;
   x.unanimous_amb_check->initialized = 0;
 
-  memory_pool_filter(amb_test->pool, (void *) &x, &update_and_get_max_ll);
+  update_and_get_max_ll(&x, amb_test->pool);
   memory_pool_filter(amb_test->pool, (void *) &x, &filter_and_renormalize);
   if (memory_pool_empty(amb_test->pool)) {
     log_debug("Ambiguity pool empty");
@@ -676,7 +843,7 @@ u8 ambiguity_update_reference(ambiguity_test_t *amb_test, const u8 num_sdiffs, c
     log_debug("updating iar reference sat");
     changed_ref = 1;
     if (sats_management_code == NEW_REF_START_OVER) {
-      create_ambiguity_test(amb_test);
+      reset_ambiguity_test(amb_test);
     }
     else {
       gnss_signal_t new_sids[amb_test->sats.num_sats];
@@ -993,7 +1160,8 @@ static s32 add_sats(ambiguity_test_t *amb_test,
   s.x = x;
   s.Z_new_inv = x->Z2_inv;
   remap_sids(amb_test, ref_sid, x->new_dim, added_sids, &s);
-  s32 count = memory_pool_product_generator(amb_test->pool, &s, MAX_HYPOTHESES, sizeof(s),
+  s32 count = memory_pool_product_generator(amb_test->pool, &s,
+                  ambiguity_test_max_hypotheses(amb_test), sizeof(s),
                   &intersection_init,
                   &intersection_generate_next_hypothesis1,
                   &intersection_hypothesis_prod);
@@ -1037,7 +1205,8 @@ static u8 inclusion_loop_body(
        memory_pool_t *pool, u8 state_dim, u8 num_addible_dds,
        const double *ordered_N_cov, const double *ordered_N_mean,
        const double *addible_cov, const double *addible_mean,
-       intersection_count_t *x, u32 *full_size_return)
+       intersection_count_t *x, u32 *full_size_return,
+       decor_cache_t *warm)
 {
   x->new_dim = num_dds_to_add;
   s32 current_num_hyps = memory_pool_n_allocated(pool);
@@ -1055,7 +1224,8 @@ static u8 inclusion_loop_body(
   u32 full_size =
     float_to_decor(ordered_N_cov, ordered_N_mean,
         state_dim, full_dim,
-        x->box_lower_bounds, x->box_upper_bounds, x->Z1, x->Z1_inv);
+        x->box_lower_bounds, x->box_upper_bounds, x->Z1, x->Z1_inv,
+        warm ? &warm->full : NULL);
 
 
   /* Useful for debugging. */
@@ -1064,7 +1234,8 @@ static u8 inclusion_loop_body(
   u32 box_size =
     float_to_decor(addible_cov, addible_mean,
       num_addible_dds, num_dds_to_add,
-      x->itr_lower_bounds, x->itr_upper_bounds, x->Z2, x->Z2_inv);
+      x->itr_lower_bounds, x->itr_upper_bounds, x->Z2, x->Z2_inv,
+      warm ? &warm->addible : NULL);
 
   compute_Z(num_current_dds, num_dds_to_add, x->Z1, x->Z2_inv, x->Z);
 
@@ -1232,12 +1403,30 @@ u8 ambiguity_sat_inclusion(ambiguity_test_t *amb_test, const u8 num_dds_in_inter
 
   u32 full_size = 0;
 
+  /* Attempts to add all the addible dds are warm started from the last one,
+   * as long as the satellites haven't changed since. */
+  decor_cache_t *cache = &amb_test->decor_cache;
+  sid_set_t float_sid_set, test_sid_set;
+  if (!sids_to_set(float_sats->num_sats, float_sids, &float_sid_set) ||
+      !sids_to_set(MAX(amb_test->sats.num_sats, 1) - 1,
+                   &amb_test->sats.sids[1], &test_sid_set)) {
+    reset_decor_cache(cache);
+    cache = NULL;
+  } else if (!sid_set_equal(&cache->float_sids, &float_sid_set) ||
+             !sid_set_equal(&cache->test_sids, &test_sid_set) ||
+             !sid_is_equal(cache->ref_sid, ref_sid)) {
+    reset_decor_cache(cache);
+    cache->float_sids = float_sid_set;
+    cache->test_sids = test_sid_set;
+    cache->ref_sid = ref_sid;
+  }
+
   /* Check to see if min_dds_to_add will not fit. If so, don't bother
    * iterating through all the sats below. */
   u8 fits = inclusion_loop_body(
       min_dds_to_add, amb_test->pool, state_dim, num_addible_dds,
       N_cov_ordered, N_mean_ordered, addible_float_cov, addible_float_mean,
-      &x, &full_size);
+      &x, &full_size, min_dds_to_add == num_addible_dds ? cache : NULL);
   if (fits == 0) {
     return 0;
   }
@@ -1250,7 +1439,7 @@ u8 ambiguity_sat_inclusion(ambiguity_test_t *amb_test, const u8 num_dds_in_inter
     u8 fits = inclusion_loop_body(
         num_dds_to_add, amb_test->pool, state_dim, num_addible_dds,
         N_cov_ordered, N_mean_ordered, addible_float_cov, addible_float_mean,
-        &x, &full_size);
+        &x, &full_size, num_dds_to_add == num_addible_dds ? cache : NULL);
 
     if (fits == 1) {
       /* Sats should be added. The struct x contains new_dim, the correct
@@ -1356,11 +1545,14 @@ z_t float_to_decor(const double *addible_float_cov,
                    u8 num_addible_dds,
                    u8 num_dds_to_add,
                    z_t *lower_bounds, z_t *upper_bounds,
-                   z_t *Z, z_t *Z_inv)
+                   z_t *Z, z_t *Z_inv, lambda_reduction_t *warm)
 {
   u8 dim = num_dds_to_add;
-  double Z_[dim * dim];
-  double Z_inv_[dim * dim];
+  lambda_reduction_t cold;
+  if (!warm) {
+    lambda_reduction_init(&cold);
+    warm = &cold;
+  }
 
   double added_float_cov[num_dds_to_add * num_dds_to_add];
   for (u8 i=0; i<num_dds_to_add; i++) {
@@ -1374,7 +1566,10 @@ z_t float_to_decor(const double *addible_float_cov,
     }
   }
 
-  lambda_reduction(num_dds_to_add, added_float_cov, Z_);
+  /* On failure the reduction leaves the identity transform. */
+  lambda_reduction_update(warm, num_dds_to_add, added_float_cov);
+  /* Read row major, this is the transpose of the column major reduction. */
+  const double *Z_ = warm->Z;
 
   double decor_float_cov_diag[num_dds_to_add];
 
@@ -1409,8 +1604,7 @@ z_t float_to_decor(const double *addible_float_cov,
 
   if (Z_inv) {
     round_matrix(dim, dim, Z_, Z);
-    matrix_inverse(dim, Z_, Z_inv_);
-    round_matrix(dim, dim, Z_inv_, Z_inv);
+    round_matrix(dim, dim, warm->Zi, Z_inv);
   }
 
   return new_hyp_set_cardinality;
@@ -1443,7 +1637,8 @@ s8 determine_sats_addition(ambiguity_test_t *amb_test,
                                                  float_N_mean,
                                                  num_float_dds,
                                                  *num_dds_to_add,
-                                                 lower_bounds, upper_bounds, Z, Z_inv);
+                                                 lower_bounds, upper_bounds, Z, Z_inv,
+                                                 NULL);
     if (new_hyp_set_cardinality <= max_new_hyps_cardinality) {
       return 1;
     }
@@ -1484,7 +1679,7 @@ u8 ambiguity_update_sats(ambiguity_test_t *amb_test, const u8 num_sdiffs,
   DEBUG_ENTRY();
 
   if (num_sdiffs < 2) {
-    create_ambiguity_test(amb_test);
+    reset_ambiguity_test(amb_test);
     log_debug("< 2 sdiffs, starting over");
     DEBUG_EXIT();
     return 0; // I chose 0 because it doesn't lead to anything dynamic
@@ -1502,14 +1697,14 @@ u8 ambiguity_update_sats(ambiguity_test_t *amb_test, const u8 num_sdiffs,
      changed_sats=1;
     }
   } else {
-    create_ambiguity_test(amb_test);//we don't have what we need
+    reset_ambiguity_test(amb_test);//we don't have what we need
   }
 
   u8 intersection_ndxs[num_sdiffs];
   u8 num_dds_in_intersection = find_indices_of_intersection_sats(amb_test, num_sdiffs, sdiffs_with_ref_first, intersection_ndxs);
   /* Reset the ambiguity test if we have no sats in common with the last step */
   if (amb_test->sats.num_sats > 1 && num_dds_in_intersection == 0) {
-    create_ambiguity_test(amb_test);
+    reset_ambiguity_test(amb_test);
   }
 
   /* Project out and lost satellites if there were any. */
@@ -1521,7 +1716,7 @@ u8 ambiguity_update_sats(ambiguity_test_t *amb_test, const u8 num_sdiffs,
     u8 incl = ambiguity_sat_inclusion(amb_test, num_dds_in_intersection,
                 float_sats, float_mean, float_cov_U, float_cov_D);
     if (incl == 2) {
-      create_ambiguity_test(amb_test);
+      reset_ambiguity_test(amb_test);
       changed_sats = 1;
     } else if (incl == 1) {
       changed_sats = 1;
@@ -1553,32 +1748,27 @@ u8 find_indices_of_intersection_sats(const ambiguity_test_t *amb_test, const u8
       }
       printf("}\n");
     }
-    printf("(i, j, k, amb_test->sats.prns[i], sdiffs_with_ref_first[j].prn)\n");
   }
-  u8 i = 1;
-  u8 j = 1;
-  u8 k = 0;
-  while (i < amb_test->sats.num_sats && j < num_sdiffs) {
-    if (sid_is_equal(amb_test->sats.sids[i], sdiffs_with_ref_first[j].sid)) {
-      log_debug("(%u, \t%u, \t%u, \t%u, \t%u)\t\t\tamb_test->sats.prns[i] == sdiffs_with_ref_first[j].prn; i,j,k++",
-                i, j, k, amb_test->sats.sids[i], sdiffs_with_ref_first[j].sid.sat);
-      intersection_ndxs[k] = i-1;
-      i++;
-      j++;
-      k++;
-    }
-    else if (sid_compare(amb_test->sats.sids[i], sdiffs_with_ref_first[j].sid) < 0) {
-      log_debug("(%u, \t%u, \t%u, \t%u, \t%u)\t\t\tamb_test->sats.prns[i] <  sdiffs_with_ref_first[j].prn; i++",
-                i, j, k, amb_test->sats.sids[i], sdiffs_with_ref_first[j].sid.sat);
-      i++;
-    }
-    else {
-      log_debug("(%u, \t%u, \t%u, \t%u, \t%u)\t\t\tamb_test->sats.prns[i] >  sdiffs_with_ref_first[j].prn; j++",
-                i, j, k, amb_test->sats.sids[i], sdiffs_with_ref_first[j].sid.sat);
-      j++;
-    }
+  /* Without a reference sat, sdiffs_with_ref_first isn't populated. */
+  if (amb_test->sats.num_sats < 2) {
+    DEBUG_EXIT();
+    return 0;
   }
 
+  /* The non-reference satellites of both lists are sorted, so the index of
+   * a common satellite in the ambiguity test is its rank in that set. */
+  sid_set_t amb_set, sdiff_set, common;
+  sid_set_from_sids(&amb_set, amb_test->sats.num_sats - 1,
+                    &amb_test->sats.sids[1]);
+  sdiffs_to_sid_set(MAX(num_sdiffs, 1) - 1, &sdiffs_with_ref_first[1],
+                    &sdiff_set);
+  sid_set_and(&common, &amb_set, &sdiff_set);
+
+  u8 k = 0;
+  for (u32 i = sid_set_next(&common, 0); i < NUM_SATS;
+       i = sid_set_next(&common, i + 1))
+    intersection_ndxs[k++] = sid_set_rank(&amb_set, i);
+
   DEBUG_EXIT();
   return k;
 }
@@ -1717,7 +1907,8 @@ void add_sats_old(ambiguity_test_t *amb_test,
   }
   memcpy(x0.Z_inv, Z_inv, num_added_dds * num_added_dds * sizeof(z_t));
   /* Take the product of our current hypothesis state with the generator, recorrelating the new ones as we go. */
-  memory_pool_product_generator(amb_test->pool, &x0, MAX_HYPOTHESES, sizeof(x0),
+  memory_pool_product_generator(amb_test->pool, &x0,
+                                ambiguity_test_max_hypotheses(amb_test), sizeof(x0),
                                 &no_init, &generate_next_hypothesis, &hypothesis_prod);
   log_info("IAR: updates to %"PRIu32"", memory_pool_n_allocated(amb_test->pool));
   if (DEBUG) {
@@ -1735,67 +1926,39 @@ void init_residual_matrices(residual_mtxs_t *res_mtxs, u8 num_dds, double *DE_mt
 
 void assign_residual_covariance_inverse(u8 num_dds, double *obs_cov, double *q, double *r_cov_inv) //TODO make this more efficient (e.g. via page 3/6.2-3/2014 of ian's notebook)
 {
-  integer dd_dim = 2*num_dds;
-  integer res_dim = num_dds + CLAMP_DIFF(num_dds, 3);
+  u8 dd_dim = 2*num_dds;
+  u8 res_dim = num_dds + CLAMP_DIFF(num_dds, 3);
   u32 nullspace_dim = CLAMP_DIFF(num_dds, 3);
   double q_tilde[res_dim * dd_dim];
   memset(q_tilde, 0, res_dim * dd_dim * sizeof(double));
-  // MAT_PRINTF(obs_cov, dd_dim, dd_dim);
 
-  // MAT_PRINTF(q, nullspace_dim, num_dds);
   for (u8 i=0; i<nullspace_dim; i++) {
     memcpy(&q_tilde[i*dd_dim], &q[i*num_dds], num_dds * sizeof(double));
   }
-  // MAT_PRINTF(q_tilde, res_dim, dd_dim);
   for (u8 i=0; i<num_dds; i++) {
     q_tilde[(i+nullspace_dim)*dd_dim + i] = 1;
     q_tilde[(i+nullspace_dim)*dd_dim + i+num_dds] = -1 / GPS_L1_LAMBDA_NO_VAC;
   }
-  // MAT_PRINTF(q_tilde, res_dim, dd_dim);
 
   //TODO make more efficient via the structure of q_tilde, and it's relation to the I + 1*1^T structure of the obs cov mtx
-  double QC[res_dim * dd_dim];
-  cblas_dsymm(CblasRowMajor, CblasRight, CblasUpper, //CBLAS_ORDER, CBLAS_SIDE, CBLAS_UPLO
-              res_dim, dd_dim, // int M, int N
-              1, obs_cov, dd_dim, // double alpha, double *A, int lda
-              q_tilde, dd_dim, // double *B, int ldb
-              0, QC, dd_dim); // double beta, double *C, int ldc
-  // MAT_PRINTF(QC, res_dim, dd_dim);
+  double r_cov[res_dim * res_dim];
+  smat_asat(res_dim, dd_dim, q_tilde, obs_cov, r_cov);
+  for (u32 i=0; i < (u32)res_dim * res_dim; i++) {
+    r_cov[i] *= 2;
+  }
 
-  //TODO make more efficient via the structure of q_tilde, and it's relation to the I + 1*1^T structure of the obs cov mtx
-  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, // CBLAS_ORDER, CBLAS_TRANSPOSE transA, cBLAS_TRANSPOSE transB
-              res_dim, res_dim, dd_dim, // int M, int N, int K
-              2, QC, dd_dim, // double alpha, double *A, int lda
-              q_tilde, dd_dim, //double *B, int ldb
-              0, r_cov_inv, res_dim); //beta, double *C, int ldc
-  // MAT_PRINTF(r_cov_inv, res_dim, res_dim);
-
-  // dpotrf_(char *uplo, __CLPK_integer *n, __CLPK_doublereal *a, __CLPK_integer *
-  //       lda, __CLPK_integer *info)
-  //dpotri_(char *uplo, __CLPK_integer *n, __CLPK_doublereal *a, __CLPK_integer *
-  //        lda, __CLPK_integer *info)
-  char uplo = 'L'; //actually this makes it upper. the lapack stuff is all column major, but we're good since we're operiating on symmetric matrices
-  integer info;
-  dpotrf_(&uplo, &res_dim, r_cov_inv, &res_dim, &info);
-  // printf("info: %i\n", (int) info);
-  // MAT_PRINTF(r_cov_inv, res_dim, res_dim);
-  dpotri_(&uplo, &res_dim, r_cov_inv, &res_dim, &info);
-  for (u8 i=0; i < res_dim; i++) {
-    for (u8 j=0; j < i; j++) {
-      r_cov_inv[i*res_dim + j] = r_cov_inv[j*res_dim + i];
-    }
+  double L[res_dim * res_dim];
+  if (smat_cholesky(res_dim, r_cov, L) == 0) {
+    smat_cholesky_inverse(res_dim, L, r_cov_inv);
+  } else {
+    matrix_inverse(res_dim, r_cov, r_cov_inv);
   }
-  // printf("info: %i\n", (int) info);
-  // MAT_PRINTF(r_cov_inv, res_dim, res_dim);
 }
 
 void assign_r_vec(residual_mtxs_t *res_mtxs, u8 num_dds, double *dd_measurements, double *r_vec)
 {
-  cblas_dgemv(CblasRowMajor, CblasNoTrans,
-              res_mtxs->null_space_dim, num_dds,
-              1, res_mtxs->null_projector, num_dds,
-              dd_measurements, 1,
-              0, r_vec, 1);
+  smat_mul(res_mtxs->null_space_dim, num_dds, 1, res_mtxs->null_projector,
+           dd_measurements, r_vec);
   for (u8 i=0; i< num_dds; i++) {
     r_vec[i + res_mtxs->null_space_dim] =
       simple_amb_measurement(dd_measurements[i],
@@ -1805,11 +1968,8 @@ void assign_r_vec(residual_mtxs_t *res_mtxs, u8 num_dds, double *dd_measurements
 
 void assign_r_mean(residual_mtxs_t *res_mtxs, u8 num_dds, double *hypothesis, double *r_mean)
 {
-  cblas_dgemv(CblasRowMajor, CblasNoTrans,
-              res_mtxs->null_space_dim, num_dds,
-              1, res_mtxs->null_projector, num_dds,
-              hypothesis, 1,
-              0, r_mean, 1);
+  smat_mul(res_mtxs->null_space_dim, num_dds, 1, res_mtxs->null_projector,
+           hypothesis, r_mean);
   memcpy(&r_mean[res_mtxs->null_space_dim], hypothesis, num_dds * sizeof(double));
 }
 
@@ -1824,11 +1984,8 @@ double get_quadratic_term(residual_mtxs_t *res_mtxs, u8 num_dds, double *hypothe
   }
   // VEC_PRINTF(r, res_mtxs->res_dim);
   double half_sig_dot_r[res_mtxs->res_dim];
-  cblas_dsymv(CblasRowMajor, CblasUpper,
-                 res_mtxs->res_dim,
-                 1, res_mtxs->half_res_cov_inv, res_mtxs->res_dim,
-                 r, 1,
-                 0, half_sig_dot_r, 1);
+  smat_mul(res_mtxs->res_dim, res_mtxs->res_dim, 1, res_mtxs->half_res_cov_inv,
+           r, half_sig_dot_r);
   // VEC_PRINTF(half_sig_dot_r, res_mtxs->res_dim);
   double quad_term = 0;
   for (u32 i=0; i<res_mtxs->res_dim; i++) {
@@ -1837,6 +1994,139 @@ double get_quadratic_term(residual_mtxs_t *res_mtxs, u8 num_dds, double *hypothe
   return quad_term;
 }
 
+/* Quadratic terms of a block of up to QUAD_BLOCK_SIZE hypotheses.
+ *
+ * The block is transposed so that each row of `r` holds one residual
+ * component for all hypotheses of the block, turning the products with the
+ * null space projector and the inverse residual covariance into
+ * matrix-matrix products whose inner loops run along the hypotheses. Each
+ * lane is computed independently so the results do not depend on the vector
+ * width the loops are compiled for. Only the upper triangle of the
+ * (symmetric) `half_res_cov_inv` is read.
+ */
+static inline __attribute__((always_inline))
+void quadratic_terms_block(const residual_mtxs_t *res_mtxs, u8 num_dds,
+                           u32 n, const hypothesis_t *hyps,
+                           const double *r_vec, double *q)
+{
+  u32 null_dim = res_mtxs->null_space_dim;
+  u32 res_dim = res_mtxs->res_dim;
+  const double *proj = res_mtxs->null_projector;
+  const double *half_inv = res_mtxs->half_res_cov_inv;
+  double N[MAX_CHANNELS-1][QUAD_BLOCK_SIZE];
+  double r[2*MAX_CHANNELS-5][QUAD_BLOCK_SIZE];
+  double t[QUAD_BLOCK_SIZE];
+  double acc[QUAD_BLOCK_SIZE];
+
+  /* Pad a partial block by repeating its last hypothesis. */
+  for (u32 b = 0; b < QUAD_BLOCK_SIZE; b++) {
+    const hypothesis_t *hyp = &hyps[MIN(b, n - 1)];
+    for (u8 j = 0; j < num_dds; j++) {
+      N[j][b] = hyp->N[j];
+    }
+  }
+
+  /* r = r_vec - r_mean, see assign_r_mean(). */
+  for (u32 k = 0; k < null_dim; k++) {
+    for (u32 b = 0; b < QUAD_BLOCK_SIZE; b++) {
+      t[b] = 0;
+    }
+    for (u8 j = 0; j < num_dds; j++) {
+      double p = proj[k*num_dds + j];
+      for (u32 b = 0; b < QUAD_BLOCK_SIZE; b++) {
+        t[b] += p * N[j][b];
+      }
+    }
+    for (u32 b = 0; b < QUAD_BLOCK_SIZE; b++) {
+      r[k][b] = r_vec[k] - t[b];
+    }
+  }
+  for (u8 j = 0; j < num_dds; j++) {
+    for (u32 b = 0; b < QUAD_BLOCK_SIZE; b++) {
+      r[null_dim + j][b] = r_vec[null_dim + j] - N[j][b];
+    }
+  }
+
+  /* r^T A r = sum_i r_i (A_ii r_i + 2 sum_{j>i} A_ij r_j) */
+  for (u32 b = 0; b < QUAD_BLOCK_SIZE; b++) {
+    acc[b] = 0;
+  }
+  for (u32 i = 0; i < res_dim; i++) {
+    for (u32 b = 0; b < QUAD_BLOCK_SIZE; b++) {
+      t[b] = 0;
+    }
+    for (u32 j = i + 1; j < res_dim; j++) {
+      double a = half_inv[i*res_dim + j];
+      for (u32 b = 0; b < QUAD_BLOCK_SIZE; b++) {
+        t[b] += a * r[j][b];
+      }
+    }
+    double a_ii = half_inv[i*res_dim + i];
+    for (u32 b = 0; b < QUAD_BLOCK_SIZE; b++) {
+      acc[b] += r[i][b] * (a_ii * r[i][b] + 2 * t[b]);
+    }
+  }
+
+  for (u32 b = 0; b < n; b++) {
+    q[b] = -acc[b];
+  }
+}
+
+static void quadratic_terms_generic(const residual_mtxs_t *res_mtxs,
+                                    u8 num_dds, u32 n_hyps,
+                                    const hypothesis_t *hyps,
+                                    const double *r_vec, double *q)
+{
+  for (u32 i = 0; i < n_hyps; i += QUAD_BLOCK_SIZE) {
+    quadratic_terms_block(res_mtxs, num_dds,
+                          MIN(QUAD_BLOCK_SIZE, n_hyps - i), &hyps[i],
+                          r_vec, &q[i]);
+  }
+}
+
+#ifdef QUAD_X86_DISPATCH
+__attribute__((target("avx2")))
+static void quadratic_terms_avx2(const residual_mtxs_t *res_mtxs,
+                                 u8 num_dds, u32 n_hyps,
+                                 const hypothesis_t *hyps,
+                                 const double *r_vec, double *q)
+{
+  for (u32 i = 0; i < n_hyps; i += QUAD_BLOCK_SIZE) {
+    quadratic_terms_block(res_mtxs, num_dds,
+                          MIN(QUAD_BLOCK_SIZE, n_hyps - i), &hyps[i],
+                          r_vec, &q[i]);
+  }
+}
+#endif
+
+/** Batched version of get_quadratic_term().
+ *
+ * Evaluates the quadratic term of the residual log likelihood for a whole
+ * array of hypotheses, `QUAD_BLOCK_SIZE` at a time, with the block laid
+ * out across the SIMD lanes. An AVX2 kernel is selected at runtime where
+ * the host supports it; it gives identical results to the generic kernel.
+ * The results agree with get_quadratic_term() to rounding error.
+ *
+ * \param res_mtxs  Residual matrices, see init_residual_matrices().
+ * \param num_dds   Number of ambiguities in each hypothesis.
+ * \param n_hyps    Number of hypotheses.
+ * \param hyps      Array of `n_hyps` hypotheses.
+ * \param r_vec     Transformed measurement, see assign_r_vec().
+ * \param q         Output array of `n_hyps` quadratic terms.
+ */
+void get_quadratic_terms(const residual_mtxs_t *res_mtxs, u8 num_dds,
+                         u32 n_hyps, const hypothesis_t *hyps,
+                         const double *r_vec, double *q)
+{
+#ifdef QUAD_X86_DISPATCH
+  if (__builtin_cpu_supports("avx2")) {
+    quadratic_terms_avx2(res_mtxs, num_dds, n_hyps, hyps, r_vec, q);
+    return;
+  }
+#endif
+  quadratic_terms_generic(res_mtxs, num_dds, n_hyps, hyps, r_vec, q);
+}
+
 void print_hyp(void *arg, element_t *elem)
 {
   u8 num_dds = *( (u8 *) arg );
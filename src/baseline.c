@@ -14,14 +14,13 @@
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
-#include <cblas.h>
-#include <clapack.h>
 
 #include <libswiftnav/logging.h>
 #include <libswiftnav/constants.h>
 #include <libswiftnav/baseline.h>
 #include <libswiftnav/amb_kf.h>
 #include <libswiftnav/linear_algebra.h>
+#include <libswiftnav/small_matrix.h>
 #include <libswiftnav/filter_utils.h>
 #include <libswiftnav/set.h>
 #include <libswiftnav/sats_management.h> /* choose_reference_sat */
@@ -229,7 +228,7 @@ void amb_from_baseline(u8 num_dds, const double *DE, const double *dd_obs,
  * \return            0 on success,
  *                   -1 if there were insufficient observations to calculate the
  *                      baseline (the solution was under-constrained),
- *                   -2 if an error occurred
+ *                   -2 if the geometry is singular
  */
 s8 lesq_solution_float(u8 num_dds_u8, const double *dd_obs, const double *N,
                        const double *DE, double b[3], double *resid)
@@ -250,112 +249,119 @@ s8 lesq_solution_float(u8 num_dds_u8, const double *dd_obs, const double *N,
     assert(isfinite(DE[i]));
   }
 
-  integer num_dds = num_dds_u8;
-  double DET[num_dds * 3];
-  matrix_transpose(num_dds, 3, DE, DET);
-
-  double phase_ranges[MAX(num_dds,3)];
+  u8 num_dds = num_dds_u8;
+  double phase_ranges[num_dds];
   for (u8 i=0; i< num_dds; i++) {
     phase_ranges[i] = dd_obs[i] - N[i];
   }
 
-  s32 ldb = (s32) MAX(num_dds,3);
-  integer jpvt[3] = {0, 0, 0};
-  double rcond = 1e-12;
-  s32 rank;
-  s32 info;
-  s32 three = 3;
-  s32 one = 1;
-
-  /* From LAPACK DGELSY documentation:
-   * The unblocked strategy requires that:
-   *   LWORK >= MAX( MN+3*N+1, 2*MN+NRHS )
-   *   where MN = MIN( M, N )
-   *
-   * Therefore:
-   *   M >= 3, N = 3, NRHS = 1
-   *   MN = 3
-   *   LWORK >= 13
-   */
-  s32 lwork = 13;
-  double work[lwork];
-
-  /* DGELSY solves:
-   *   argmin || A.x - B ||
-   * under the l2 norm, where
-   *   A <- DE
-   *   B <- phase_ranges = dd_obs - N
-   *   M <- num_dds
-   *   N <- 3
-   *   NRHS <- 1
-   *
-   * the baseline result x is returned in the first 3 elements of phase_ranges.
-   */
-  dgelsy_(&num_dds, &three, &one, /* M, N, NRHS. */
-          DET, &num_dds,          /* A, LDA. */
-          phase_ranges, &ldb,     /* B, LDB. */
-          jpvt, &rcond,           /* JPVT, RCOND. */
-          &rank,                  /* RANK. */
-          work, &lwork,           /* WORK, LWORK. */
-          &info);                 /* INFO. */
-
-  if (info != 0) {
-    log_error("dgelsy returned error %"PRId32"", info);
+  /* Solve the normal equations DE' * DE * x = DE' * (dd_obs - N) by
+   * Cholesky factorisation, the baseline being x * lambda. */
+  double DEtDE[9], L[9], x[3];
+  smat_ata(num_dds, 3, DE, DEtDE);
+  if (smat_cholesky(3, DEtDE, L) < 0) {
+    log_error("lesq_solution_float: singular geometry");
     return -2;
   }
+  smat_mul(1, num_dds, 3, phase_ranges, DE, x);
+  smat_cholesky_solve(3, L, 1, x);
 
-  assert(num_dds == num_dds_u8);
-
-  b[0] = phase_ranges[0] * GPS_L1_LAMBDA_NO_VAC;
-  b[1] = phase_ranges[1] * GPS_L1_LAMBDA_NO_VAC;
-  b[2] = phase_ranges[2] * GPS_L1_LAMBDA_NO_VAC;
+  b[0] = x[0] * GPS_L1_LAMBDA_NO_VAC;
+  b[1] = x[1] * GPS_L1_LAMBDA_NO_VAC;
+  b[2] = x[2] * GPS_L1_LAMBDA_NO_VAC;
 
   if (resid) {
-    /* Calculate Least Squares Residuals */
-
-    /* resid <= dd_obs - N
-     * alpha <= - 1.0 / GPS_L1_LAMBDA_NO_VAC
-     * beta <= 1.0
-     * resid <= beta * resid + alpha * (DE . b)
+    /* Calculate Least Squares Residuals
+     *
+     * resid <= dd_obs - N - DE . b / lambda
      */
+    double predicted[num_dds];
+    smat_mul(num_dds, 3, 1, DE, x, predicted);
     for (u8 i=0; i<num_dds; i++) {
-      resid[i] = dd_obs[i] - N[i];
+      resid[i] = phase_ranges[i] - predicted[i];
     }
-    cblas_dgemv(
-      CblasRowMajor, CblasNoTrans, num_dds, 3,
-      -1.0 / GPS_L1_LAMBDA_NO_VAC, DE, 3, b, 1,
-      1.0, resid, 1
-    );
   }
 
   return 0;
 }
 
-static void drop_i(u32 index, u32 len, u32 size, const double *from, double *to)
+/* Inverse of the normal matrix DE' * DE of the baseline least squares
+ * problem, by cofactors. Returns -1 if it is singular. */
+static s8 lesq_normal_inverse(u8 num_dds, const double *DE, double Ninv[9])
 {
-  memcpy(to, from, index*size*sizeof(double));
-  memcpy(to + index*size,
-         from + (index + 1)*size,
-         (len - index - 1)*size*sizeof(double));
+  double M[9];
+  smat_ata(num_dds, 3, DE, M);
+
+  double c00 = M[4]*M[8] - M[5]*M[5];
+  double c01 = M[2]*M[5] - M[1]*M[8];
+  double c02 = M[1]*M[5] - M[2]*M[4];
+  double det = M[0]*c00 + M[1]*c01 + M[2]*c02;
+  if (!(fabs(det) > 1e-12 * M[0]*M[4]*M[8]))
+    return -1;
+
+  Ninv[0] = c00 / det;
+  Ninv[1] = Ninv[3] = c01 / det;
+  Ninv[2] = Ninv[6] = c02 / det;
+  Ninv[4] = (M[0]*M[8] - M[2]*M[2]) / det;
+  Ninv[5] = Ninv[7] = (M[1]*M[2] - M[0]*M[5]) / det;
+  Ninv[8] = (M[0]*M[4] - M[1]*M[1]) / det;
+  return 0;
 }
 
-static s8 lesq_without_i(u8 dropped_dd, u8 num_dds, const double *dd_obs,
-                         const double *N, const double *DE, double b[3],
-                         double *resid)
+/* Leverage h = a' Ninv a of the dd with unit vector difference `a`, and
+ * g = Ninv a. */
+static double lesq_leverage(const double Ninv[9], const double a[3],
+                            double g[3])
 {
-  assert(num_dds > 3);
-  assert(num_dds < MAX_CHANNELS);
-
-  u8 new_dds = num_dds - 1;
-  double new_obs[new_dds];
-  double new_N[new_dds];
-  double new_DE[new_dds * 3];
+  for (u8 i = 0; i < 3; i++)
+    g[i] = Ninv[3*i] * a[0] + Ninv[3*i + 1] * a[1] + Ninv[3*i + 2] * a[2];
+  return vector_dot(3, a, g);
+}
 
-  drop_i(dropped_dd, num_dds, 1, dd_obs, new_obs);
-  drop_i(dropped_dd, num_dds, 1, N, new_N);
-  drop_i(dropped_dd, num_dds, 3, DE, new_DE);
+/* Residual sum of squares after dropping each of the used dds in turn, and
+ * the standardized residual of each, from a single solution.
+ *
+ * Dropping dd i with residual r_i and leverage h_i reduces the residual sum
+ * of squares by r_i^2 / (1 - h_i). Dds whose removal would leave the
+ * geometry singular get an infinite sum of squares and a zero score. */
+static void lesq_leave_one_out(u8 num_dds, const double *DE,
+                               const double Ninv[9], const double *resid,
+                               const bool *used, double ssr,
+                               double *ssr_without, double *scores)
+{
+  for (u8 i = 0; i < num_dds; i++) {
+    double g[3];
+    double h = lesq_leverage(Ninv, &DE[3*i], g);
+    bool singular = !used[i] || !(1 - h > 1e-9);
+    if (ssr_without)
+      ssr_without[i] = singular ? INFINITY : ssr - resid[i]*resid[i] / (1 - h);
+    if (scores)
+      scores[i] = singular ? 0 :
+                  fabs(resid[i]) / sqrt(DEFAULT_PHASE_VAR_KF * (1 - h));
+  }
+}
 
-  return lesq_solution_float(new_dds, new_obs, new_N, new_DE, b, resid);
+/* Remove a used dd from a solution, updating the baseline, the residuals of
+ * all dds and the inverse normal matrix. The dropped dd's residual becomes
+ * its prediction residual. Returns the new residual sum of squares. */
+static double lesq_drop(u8 dropped_dd, u8 num_dds, const double *DE,
+                        double Ninv[9], double *resid, bool *used,
+                        double ssr, double b[3])
+{
+  double g[3];
+  double h = lesq_leverage(Ninv, &DE[3*dropped_dd], g);
+  double w = resid[dropped_dd] / (1 - h);
+
+  for (u8 i = 0; i < 3; i++)
+    b[i] -= GPS_L1_LAMBDA_NO_VAC * w * g[i];
+  for (u8 j = 0; j < num_dds; j++)
+    resid[j] += vector_dot(3, &DE[3*j], g) * w;
+  for (u8 i = 0; i < 3; i++)
+    for (u8 j = 0; j < 3; j++)
+      Ninv[3*i + j] += g[i] * g[j] / (1 - h);
+
+  used[dropped_dd] = false;
+  return ssr - resid[dropped_dd] * resid[dropped_dd] * (1 - h);
 }
 
 /** Approximate chi square test
@@ -383,6 +389,12 @@ static bool chi_test(double threshold, u8 num_dds,
   return norm < threshold;
 }
 
+/* chi_test() from the residual sum of squares. */
+static bool chi_test_ssr(double threshold, double ssr)
+{
+  return sqrt(ssr / DEFAULT_PHASE_VAR_KF) < threshold;
+}
+
 /** Calculate lesq baseline with raim check/repair
  *
  * \param num_dds_u8 Number of double difference observations
@@ -408,7 +420,7 @@ static bool chi_test(double threshold, u8 num_dds,
  *    -`0`: solution with all dd's ok
  *
  *   -`-1`: < 3 dds
- *   -`-2`: dgelsy  error (see lesq_solution_float)
+ *   -`-2`: singular geometry (see lesq_solution_float)
  *   -`-3`: raim check failed, repair failed
  *   -`-4`: raim check failed, not enough sats for repair
  */
@@ -421,7 +433,7 @@ s8 lesq_solve_raim(u8 num_dds_u8, const double *dd_obs,
                    bool disable_raim, double raim_threshold,
                    u8 *n_used, double *ret_residuals, u8 *removed_obs)
 {
-  integer num_dds = num_dds_u8;
+  u8 num_dds = num_dds_u8;
   double residuals[num_dds];
   double residual;
 
@@ -461,29 +473,45 @@ s8 lesq_solve_raim(u8 num_dds_u8, const double *dd_obs,
     return -4;
   }
 
+  /* The solutions without each dd follow from the full one in closed form,
+   * see lesq_leave_one_out(). */
+  double Ninv[9];
+  if (lesq_normal_inverse(num_dds, DE, Ninv) < 0) {
+    if (n_used) {
+      *n_used = 0;
+    }
+    return -3;
+  }
+  bool used[num_dds];
+  memset(used, true, sizeof(used));
+  double ssr = vector_dot(num_dds, residuals, residuals);
+  double ssr_without[num_dds];
+  lesq_leave_one_out(num_dds, DE, Ninv, residuals, used, ssr,
+                     ssr_without, NULL);
+
   u8 num_passing = 0;
   u8 bad_sat = -1;
-  u8 new_dds = num_dds - 1;
 
   for (u8 i = 0; i < num_dds; i++) {
-    if (0 == lesq_without_i(i, num_dds, dd_obs, N, DE, b, residuals)) {
-      if (chi_test(raim_threshold, new_dds, residuals, &residual)) {
-        num_passing++;
-        bad_sat = i;
-      }
+    if (chi_test_ssr(raim_threshold, ssr_without[i])) {
+      num_passing++;
+      bad_sat = i;
     }
   }
 
   if (num_passing == 1) {
     /* bad_sat holds index of bad dd
      * Return solution without bad_sat. */
-    /* Recalculate this solution. */
-    (void)lesq_without_i(bad_sat, num_dds, dd_obs, N, DE, b, residuals);
+    lesq_drop(bad_sat, num_dds, DE, Ninv, residuals, used, ssr, b);
     if (removed_obs) {
       *removed_obs = bad_sat;
     }
     if (ret_residuals) {
-      memcpy(ret_residuals, residuals, (num_dds-1) * sizeof(double));
+      for (u8 i = 0, j = 0; i < num_dds; i++) {
+        if (used[i]) {
+          ret_residuals[j++] = residuals[i];
+        }
+      }
     }
     if (n_used) {
       *n_used = num_dds-1;
@@ -505,6 +533,112 @@ s8 lesq_solve_raim(u8 num_dds_u8, const double *dd_obs,
   }
 }
 
+/** Calculate lesq baseline with fault detection and exclusion of up to
+ * `max_excluded` double differences.
+ *
+ * While the solution fails the same chi square test as lesq_solve_raim(),
+ * the dd whose removal reduces the residual sum of squares the most is
+ * excluded. All exclusions are computed from the first solution by
+ * downdating its normal equations, so only one least squares problem is
+ * solved however many dds are tested or excluded.
+ *
+ * \param num_dds      Number of double difference observations
+ * \param dd_obs       Double differenced carrier phase observations in
+ *                     cycles, length `num_dds`
+ * \param N            Carrier phase ambiguity vector, length `num_dds`
+ * \param DE           Double differenced matrix of unit vectors to the
+ *                     satellites, length `3 * num_dds`
+ * \param b            The output baseline in meters.
+ * \param raim_threshold Test threshold for check
+ * \param max_excluded Maximum number of dds to exclude
+ * \param n_used       If not null, outputs num obs used in solution
+ * \param residuals    If not null, outputs the residuals in cycles of all
+ *                     `num_dds` dds against the final solution
+ * \param excluded     If not null, outputs which of the `num_dds` dds were
+ *                     excluded
+ * \param fault_scores If not null, outputs the standardized residual of each
+ *                     of the `num_dds` dds in the solution using all of them,
+ *                     zero for those that can't be tested
+ * \return As lesq_solve_raim(), except that 1 is returned if the solution
+ *         was repaired by excluding one or more dds, and -3 if it still
+ *         failed the check after excluding `max_excluded` dds.
+ */
+s8 lesq_solve_raim_fde(u8 num_dds, const double *dd_obs,
+                       const double *N, const double *DE, double b[3],
+                       double raim_threshold, u8 max_excluded,
+                       u8 *n_used, double *residuals, bool *excluded,
+                       double *fault_scores)
+{
+  assert(num_dds < MAX_CHANNELS);
+
+  double resid[MAX(num_dds, 1)];
+  bool used[MAX(num_dds, 1)];
+  memset(used, true, sizeof(used));
+  u8 num_used = num_dds;
+  s8 ret;
+
+  if (n_used) {
+    *n_used = 0;
+  }
+  if (fault_scores) {
+    memset(fault_scores, 0, num_dds * sizeof(double));
+  }
+
+  ret = lesq_solution_float(num_dds, dd_obs, N, DE, b, resid);
+  if (ret != 0) {
+    return ret;
+  }
+
+  double Ninv[9];
+  double ssr = vector_dot(num_dds, resid, resid);
+  if (num_dds == 3) {
+    ret = 2;
+  } else if (lesq_normal_inverse(num_dds, DE, Ninv) < 0) {
+    return -3;
+  } else {
+    if (fault_scores) {
+      lesq_leave_one_out(num_dds, DE, Ninv, resid, used, ssr,
+                         NULL, fault_scores);
+    }
+    while (!chi_test_ssr(raim_threshold, ssr)) {
+      if (num_dds - num_used >= max_excluded) {
+        return -3;
+      }
+      if (num_used < 5) {
+        return -4;
+      }
+      double ssr_without[num_dds];
+      lesq_leave_one_out(num_dds, DE, Ninv, resid, used, ssr,
+                         ssr_without, NULL);
+      u8 worst = 0;
+      for (u8 i = 1; i < num_dds; i++) {
+        if (ssr_without[i] < ssr_without[worst]) {
+          worst = i;
+        }
+      }
+      if (isinf(ssr_without[worst])) {
+        return -3;
+      }
+      ssr = lesq_drop(worst, num_dds, DE, Ninv, resid, used, ssr, b);
+      num_used--;
+    }
+    ret = num_used < num_dds ? 1 : 0;
+  }
+
+  if (n_used) {
+    *n_used = num_used;
+  }
+  if (residuals) {
+    memcpy(residuals, resid, num_dds * sizeof(double));
+  }
+  if (excluded) {
+    for (u8 i = 0; i < num_dds; i++) {
+      excluded[i] = !used[i];
+    }
+  }
+  return ret;
+}
+
 /** A least squares solution for baseline from phases using the KF state.
  * This uses the current state of the KF and a set of phase observations to
  * solve for the current baseline.
@@ -532,7 +666,7 @@ s8 least_squares_solve_b_external_ambs(u8 num_dds_u8, const double *state_mean,
 {
   DEBUG_ENTRY();
 
-  integer num_dds = num_dds_u8;
+  u8 num_dds = num_dds_u8;
   double DE[num_dds * 3];
   assign_de_mtx(num_dds+1, sdiffs_with_ref_first, ref_ecef, DE);
 
@@ -611,10 +745,23 @@ s8 baseline_(u8 num_sdiffs, const sdiff_t *sdiffs, const double ref_ecef[3],
   ambiguity_t intersection_ambs[num_ambs];
   sdiff_t intersection_sdiffs[num_ambs];
 
-  s32 intersection_size = intersection(
-      num_ambs,   sizeof(ambiguity_t), single_ambs, intersection_ambs,
-      num_sdiffs, sizeof(sdiff_t),     sdiffs,      intersection_sdiffs,
-      cmp_amb_sdiff);
+  /* Both inputs are sets, so an element's index is its rank in the set of
+   * their signals. */
+  sid_set_t amb_set, sdiff_set, common;
+  sid_set_init(&amb_set);
+  for (u8 i = 0; i < num_ambs; i++)
+    sid_set_add(&amb_set, single_ambs[i].sid);
+  sdiffs_to_sid_set(num_sdiffs, sdiffs, &sdiff_set);
+  sid_set_and(&common, &amb_set, &sdiff_set);
+
+  s32 intersection_size = 0;
+  for (u32 i = sid_set_next(&common, 0); i < NUM_SATS;
+       i = sid_set_next(&common, i + 1), intersection_size++) {
+    intersection_ambs[intersection_size] =
+      single_ambs[sid_set_rank(&amb_set, i)];
+    intersection_sdiffs[intersection_size] =
+      sdiffs[sid_set_rank(&sdiff_set, i)];
+  }
 
   if (intersection_size < 4) {
     /* For a position solution, we need at least 4 sats. */
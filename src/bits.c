@@ -49,14 +49,18 @@ u8 parity(u32 x)
  */
 u32 getbitu(const u8 *buff, u32 pos, u8 len)
 {
-    u32 bits = 0;
-
-    for (u32 i = pos; i < pos + len; i++) {
-      bits = (bits << 1) +
-             ((buff[i/8] >> (7 - i%8)) & 1u);
-    }
-
-    return bits;
+  if (len == 0)
+    return 0;
+
+  /* Load the bytes containing the field, at most five. */
+  const u8 *p = &buff[pos / 8];
+  u32 end = pos % 8 + len;
+  u32 n_bytes = (end + 7) / 8;
+  u64 bits = 0;
+  for (u32 i = 0; i < n_bytes; i++)
+    bits = (bits << 8) | p[i];
+
+  return (u32)(bits >> (n_bytes * 8 - end)) & (0xFFFFFFFFu >> (32 - len));
 }
 
 /** Get bit field from buffer as a signed integer.
@@ -198,4 +202,25 @@ void bitcopy(void *dst, u32 dst_index, const void *src, u32 src_index,
   }
 }
 
+/** Initialise a bit stream reader.
+ * The first bit field read is the one at bit position `pos` from the start
+ * of the buffer. The buffer is read as fields are extracted and must stay
+ * valid while the reader is in use.
+ *
+ * \param s    Bit stream reader to initialise.
+ * \param buff Buffer to read from.
+ * \param pos  Position in buffer of the first bit field in bits.
+ */
+void bitstream_init(bitstream_t *s, const u8 *buff, u32 pos)
+{
+  s->buff = buff;
+  s->next = pos / 8;
+  s->acc = 0;
+  s->n_acc = 0;
+  if (pos % 8) {
+    s->acc = buff[s->next++];
+    s->n_acc = 8 - pos % 8;
+  }
+}
+
 /** \} */
@@ -129,34 +129,52 @@ static void _cnav_rescan_preamble(cnav_v27_part_t *part)
 }
 
 /**
- * Feed a symbol into Viterbi decoder instance.
+ * Number of symbols a decoder component accepts before the next decoding step.
+ *
+ * \param[in] part Decoder object
+ *
+ * \return Symbols to add until the symbol buffer is full.
+ *
+ * \private
+ */
+static size_t _cnav_symbols_needed(const cnav_v27_part_t *part)
+{
+  if (part->init) {
+    return (GPS_L2C_V27_INIT_BITS + GPS_L2C_V27_DECODE_BITS) * 2 -
+           part->n_symbols;
+  }
+  return GPS_L2C_V27_DECODE_BITS * 2 - part->n_symbols;
+}
+
+/**
+ * Feed symbols into Viterbi decoder instance.
  *
  * The method uses block Viterbi decoder. It first accumulates initial number of
  * symbols, and after that runs decoding every time the buffer is full. Only
  * some of the decoded symbols are used.
  *
- * \param[in,out] part Decoder object
- * \param[in]     s    Symbol (0x00 - Hard 0, 0xFF - Hard 1)
+ * At most one decoding step is performed per call: \a n must not exceed
+ * _cnav_symbols_needed().
+ *
+ * \param[in,out] part    Decoder object
+ * \param[in]     symbols Symbols (0x00 - Hard 0, 0xFF - Hard 1)
+ * \param[in]     n       Number of symbols
  *
  * \return None
  *
  * \private
  */
-static void _cnav_add_symbol(cnav_v27_part_t *part, u8 ch)
+static void _cnav_add_symbols(cnav_v27_part_t *part, const u8 *symbols,
+                              size_t n)
 {
-  part->symbols[part->n_symbols++] = ch;
+  memcpy(&part->symbols[part->n_symbols], symbols, n);
+  part->n_symbols += n;
 
-  if (part->init) {
-    /* Initial step - load more symbols without decoding. */
-    if (part->n_symbols < (GPS_L2C_V27_INIT_BITS + GPS_L2C_V27_DECODE_BITS) * 2) {
-      return;
-    }
-    part->init = false;
-  }
-  else if (part->n_symbols < GPS_L2C_V27_DECODE_BITS * 2) {
+  if (_cnav_symbols_needed(part) > 0) {
     /* Wait until decoding block is accumulated */
     return;
   }
+  part->init = false;
 
   /* Feed accumulated symbols into the buffer, reset the number of accumulated
    * symbols. */
@@ -341,7 +359,8 @@ void cnav_msg_decoder_init(cnav_msg_decoder_t *dec)
            0);
   dec->part1.init = true;
   dec->part2.init = true;
-  _cnav_add_symbol(&dec->part2, 0x80);
+  const u8 pad = 0x80;
+  _cnav_add_symbols(&dec->part2, &pad, 1);
 }
 
 /**
@@ -365,29 +384,114 @@ void cnav_msg_decoder_init(cnav_msg_decoder_t *dec)
  *
  * \retval true  The message has been decoded. ToW parameter is available.
  * \retval false More data is required.
+ *
+ * \sa cnav_msg_decoder_add_symbols
  */
 bool cnav_msg_decoder_add_symbol(cnav_msg_decoder_t *dec,
                                  u8                  symbol,
                                  cnav_msg_t         *msg,
                                  u32                *pdelay)
 {
-  _cnav_add_symbol(&dec->part1, symbol);
-  _cnav_add_symbol(&dec->part2, symbol);
-
-  if (dec->part1.message_lock) {
-    /* Flush data in decoder. */
-    dec->part2.n_decoded = 0;
-    dec->part2.n_symbols = 0;
-    return _cnav_msg_decode(&dec->part1, msg, pdelay);
+  return cnav_msg_decoder_add_symbols(dec, &symbol, 1, msg, pdelay, 1,
+                                      NULL) > 0;
+}
+
+/**
+ * Adds a block of received symbols to decoder.
+ *
+ * Equivalent to calling cnav_msg_decoder_add_symbol() for each symbol in turn
+ * and collecting the decoded messages, but the symbols are copied into the
+ * Viterbi decoders a decoding block at a time and the preamble search and
+ * CRC check run once per decoding step rather than once per symbol.
+ *
+ * Decoding stops early once \a max_msgs messages have been produced; the
+ * remaining symbols can be passed in a further call.
+ *
+ * The delays are given relative to the last consumed symbol, so the time of
+ * that symbol is
+ * \code
+ * symbolTime_ms = msgs[i].tow * 6000 + delays[i] * 20
+ * \endcode
+ *
+ * \param[in,out] dec       Decoder object.
+ * \param[in]     symbols   Symbol value probabilities, where 0x00 - 100% of 0,
+ *                          0xFF - 100% of 1.
+ * \param[in]     n_symbols Number of symbols in \a symbols.
+ * \param[out]    msgs      Buffer for up to \a max_msgs decoded messages.
+ * \param[out]    delays    Buffer for the delay of each decoded message in
+ *                          symbols.
+ * \param[in]     max_msgs  Capacity of \a msgs and \a delays.
+ * \param[out]    n_used    Number of symbols consumed, may be NULL.
+ *
+ * \return Number of decoded messages.
+ */
+u32 cnav_msg_decoder_add_symbols(cnav_msg_decoder_t *dec,
+                                 const u8           *symbols,
+                                 u32                 n_symbols,
+                                 cnav_msg_t         *msgs,
+                                 u32                *delays,
+                                 u32                 max_msgs,
+                                 u32                *n_used)
+{
+  u32 n_msgs = 0;
+  u32 i = 0;
+
+  while (i < n_symbols && n_msgs < max_msgs) {
+    /* While one component holds the message lock, the other one is flushed
+     * after every symbol, so only the last symbol of a chunk survives in it.
+     * Chunks end at the next decoding step of a component that is fed, which
+     * is the only place where the lock state can change. */
+    cnav_v27_part_t *locked = NULL;
+    cnav_v27_part_t *flushed = NULL;
+    if (dec->part1.message_lock) {
+      locked = &dec->part1;
+      flushed = &dec->part2;
+    } else if (dec->part2.message_lock) {
+      locked = &dec->part2;
+      flushed = &dec->part1;
+    }
+
+    size_t n = n_symbols - i;
+    if (NULL != locked) {
+      n = MIN(n, _cnav_symbols_needed(locked));
+      _cnav_add_symbols(locked, &symbols[i], n);
+      _cnav_add_symbols(flushed, &symbols[i + n - 1], 1);
+    } else {
+      n = MIN(n, _cnav_symbols_needed(&dec->part1));
+      n = MIN(n, _cnav_symbols_needed(&dec->part2));
+      _cnav_add_symbols(&dec->part1, &symbols[i], n);
+      _cnav_add_symbols(&dec->part2, &symbols[i], n);
+    }
+    i += n;
+
+    bool ret = false;
+    if (dec->part1.message_lock) {
+      /* Flush data in decoder. */
+      dec->part2.n_decoded = 0;
+      dec->part2.n_symbols = 0;
+      ret = _cnav_msg_decode(&dec->part1, &msgs[n_msgs], &delays[n_msgs]);
+    } else if (dec->part2.message_lock) {
+      /* Flush data in decoder. */
+      dec->part1.n_decoded = 0;
+      dec->part1.n_symbols = 0;
+      ret = _cnav_msg_decode(&dec->part2, &msgs[n_msgs], &delays[n_msgs]);
+    }
+    if (ret) {
+      /* Delay is counted from the end of the chunk. */
+      delays[n_msgs] -= i;
+      n_msgs++;
+    }
   }
-  if (dec->part2.message_lock) {
-    /* Flush data in decoder. */
-    dec->part1.n_decoded = 0;
-    dec->part1.n_symbols = 0;
-    return _cnav_msg_decode(&dec->part2, msg, pdelay);
+
+  /* Make the delays relative to the last consumed symbol. */
+  for (u32 k = 0; k < n_msgs; k++) {
+    delays[k] += i;
   }
 
-  return false;
+  if (NULL != n_used) {
+    *n_used = i;
+  }
+  return n_msgs;
 }
 
 /**
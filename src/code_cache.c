@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <libswiftnav/code_cache.h>
+#include <libswiftnav/correlate.h>
+#include <libswiftnav/prns.h>
+
+/** Number of chips in the C/A code. */
+#define CA_CODE_LENGTH 1023
+
+/** \defgroup code_cache Code Replica Cache
+ * Precomputed, upsampled spreading code replicas.
+ *
+ * Rather than looking up the chip for each sample from the code phase, the
+ * correlators can read chips straight from a replica that has already been
+ * sampled at the receiver sample rate. Replicas are generated lazily the
+ * first time a signal is requested at a given code rate and then shared by
+ * every channel tracking that signal at a similar rate, which in practice
+ * means every channel, as code Doppler is far too small to matter over one
+ * code period.
+ *
+ * Each replica is stored both as one signed byte per sample, suitable for
+ * vector loads, and packed one bit per sample for XOR / popcount based
+ * correlators.
+ *
+ * The cache does not allocate memory, its storage is provided by the caller
+ * and replicas are never freed individually. The cache is not thread safe.
+ * \{ */
+
+static size_t align8(size_t x)
+{
+  return (x + 7) & ~(size_t)7;
+}
+
+static u32 replica_margin(double code_step)
+{
+  return (u32)ceil(CORR_MAX_TAP_OFFSET / code_step) + 1;
+}
+
+static u32 replica_samples(u32 code_length, double code_step)
+{
+  return (u32)ceil(2 * code_length / code_step) +
+         2 * replica_margin(code_step);
+}
+
+/** Storage required for one replica.
+ *
+ * \param code_length Number of chips in one code period.
+ * \param code_step   Code phase increment per sample in chips.
+ * \return Number of bytes of cache storage used by the replica.
+ */
+size_t code_cache_replica_size(u32 code_length, double code_step)
+{
+  u32 n = replica_samples(code_length, code_step);
+  /* One guard word so that unaligned windows can always read the word
+   * following the last one they use. */
+  return align8(n) + ((n + 63) / 64 + 1) * sizeof(u64);
+}
+
+/** Initialise a code replica cache.
+ * This function does not allocate memory, replicas are stored in the buffer
+ * passed in. Use code_cache_replica_size() to size it for the signals and
+ * code rates in use.
+ *
+ * \param cache     Cache to initialise.
+ * \param buff      Storage for the replicas, must be 8 byte aligned.
+ * \param buff_size Size of `buff` in bytes.
+ * \return `0` on success, `<0` on failure.
+ */
+s8 code_cache_init(code_cache_t *cache, void *buff, size_t buff_size)
+{
+  if (!cache)
+    return -1;
+  if (!buff || ((size_t)buff & 7))
+    return -2;
+
+  cache->buff = buff;
+  cache->buff_size = buff_size;
+  code_cache_clear(cache);
+  return 0;
+}
+
+/** Discard all replicas held by a cache.
+ * Any pointers previously returned by the cache become invalid.
+ *
+ * \param cache Cache to clear.
+ */
+void code_cache_clear(code_cache_t *cache)
+{
+  cache->buff_used = 0;
+  cache->n_replicas = 0;
+}
+
+static void replica_generate(code_replica_t *r, const u8 *code)
+{
+  memset(r->packed, 0, ((r->num_samples + 63) / 64 + 1) * sizeof(u64));
+
+  for (u32 k = 0; k < r->num_samples; k++) {
+    double phase = ((double)k - r->margin) * r->code_step;
+    s32 chip = (s32)floor(phase) % (s32)r->code_length;
+    if (chip < 0)
+      chip += r->code_length;
+    r->chips[k] = get_chip((u8 *)code, chip);
+    if (r->chips[k] < 0)
+      r->packed[k / 64] |= (u64)1 << (k % 64);
+  }
+}
+
+/** Get the replica of a signal at a given code rate.
+ * A cached replica is returned if one exists for `sid` with a code rate
+ * within #CODE_CACHE_STEP_TOLERANCE, otherwise a new one is generated.
+ *
+ * \param cache     Code replica cache.
+ * \param sid       Signal, currently only GPS and SBAS L1 C/A are supported.
+ * \param code_step Code phase increment per sample in chips.
+ * \return Pointer to the replica, or NULL if the cache is full.
+ */
+const code_replica_t *code_cache_get(code_cache_t *cache, gnss_signal_t sid,
+                                     double code_step)
+{
+  for (u32 i = 0; i < cache->n_replicas; i++) {
+    code_replica_t *r = &cache->replicas[i];
+    if (sid_is_equal(r->sid, sid) &&
+        fabs(code_step - r->code_step) * r->code_length / code_step <=
+          CODE_CACHE_STEP_TOLERANCE)
+      return r;
+  }
+
+  if (cache->n_replicas >= CODE_CACHE_MAX_REPLICAS)
+    return NULL;
+  size_t size = code_cache_replica_size(CA_CODE_LENGTH, code_step);
+  if (cache->buff_used + size > cache->buff_size)
+    return NULL;
+
+  code_replica_t *r = &cache->replicas[cache->n_replicas++];
+  r->sid = sid;
+  r->code_step = code_step;
+  r->code_length = CA_CODE_LENGTH;
+  r->margin = replica_margin(code_step);
+  r->num_samples = replica_samples(CA_CODE_LENGTH, code_step);
+  r->chips = (s8 *)&cache->buff[cache->buff_used];
+  r->packed = (u64 *)&cache->buff[cache->buff_used + align8(r->num_samples)];
+  cache->buff_used += size;
+
+  replica_generate(r, ca_code(sid));
+  return r;
+}
+
+/* Index of the replica sample closest to a code phase. */
+static u32 replica_offset(const code_replica_t *r, double code_phase)
+{
+  double p = fmod(code_phase, r->code_length);
+  if (p < 0)
+    p += r->code_length;
+  return r->margin + (u32)lround(p / r->code_step);
+}
+
+/** Get a sample-aligned window of a replica.
+ * The window starts at the replica sample closest to `code_phase`, so the
+ * chips are offset from the exact code phase by at most half a sample.
+ * Samples before the returned pointer are also valid for up to
+ * #CORR_MAX_TAP_OFFSET chips, for use by early correlator taps.
+ *
+ * \param r           Replica from code_cache_get().
+ * \param code_phase  Code phase of the first sample in chips.
+ * \param num_samples Returns the number of valid samples in the window,
+ *                    always at least one code period.
+ * \return Pointer to the first sample of the window.
+ */
+const s8 *code_replica_chips(const code_replica_t *r, double code_phase,
+                             u32 *num_samples)
+{
+  u32 o = replica_offset(r, code_phase);
+  if (num_samples)
+    *num_samples = r->num_samples - r->margin - o;
+  return &r->chips[o];
+}
+
+/** Extract a bit-packed, sample-aligned window of a replica.
+ * Bit `k % 64` of word `k / 64` of the output is set if the chip at sample
+ * `k` of the window is -1. Unused bits of the final word are cleared.
+ *
+ * \param r           Replica from code_cache_get().
+ * \param code_phase  Code phase of the first sample in chips.
+ * \param num_samples Number of samples to extract.
+ * \param packed      Output buffer of at least `(num_samples + 63) / 64`
+ *                    words.
+ * \return Number of samples extracted, limited to the samples available in
+ *         the window, see code_replica_chips().
+ */
+u32 code_replica_packed(const code_replica_t *r, double code_phase,
+                        u32 num_samples, u64 *packed)
+{
+  u32 o = replica_offset(r, code_phase);
+  u32 n = MIN(num_samples, r->num_samples - r->margin - o);
+  u32 shift = o % 64;
+  const u64 *src = &r->packed[o / 64];
+
+  for (u32 w = 0; w < (n + 63) / 64; w++) {
+    packed[w] = src[w] >> shift;
+    if (shift)
+      packed[w] |= src[w + 1] << (64 - shift);
+  }
+  if (n % 64)
+    packed[n / 64] &= ((u64)1 << (n % 64)) - 1;
+  return n;
+}
+
+/** \} */
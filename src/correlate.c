@@ -11,11 +11,20 @@
  */
 
 #include <math.h>
+#include <assert.h>
 
 #ifdef __SSSE3__
 #include <tmmintrin.h>
 #endif
 
+/* The AVX2 and AVX-512 kernels are compiled with per-function target
+ * attributes and selected at runtime, so they are available regardless of
+ * the architecture flags the library itself was built with. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CORR_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
 #include <libswiftnav/correlate.h>
 
 /** \defgroup corr Correlation
@@ -154,4 +163,446 @@ void track_correlate(s8* samples, s8* code,
 
 #endif /* !__SSSE3__ */
 
+/** Working state of a channel while it is being correlated. */
+typedef struct {
+  float off[CORR_MAX_TAPS];   /**< Tap offsets from prompt in chips. */
+  s32 shift[CORR_MAX_TAPS];   /**< Tap offsets from prompt in samples, when
+                                   reading from an upsampled replica. */
+  float acc_I[CORR_MAX_TAPS]; /**< In-phase accumulators. */
+  float acc_Q[CORR_MAX_TAPS]; /**< Quadrature accumulators. */
+  double code_phase;          /**< Prompt code phase of the next sample. */
+  float carr_sin;             /**< Carrier sine at the next sample. */
+  float carr_cos;             /**< Carrier cosine at the next sample. */
+  float sin_delta;            /**< Sine of the carrier phase step. */
+  float cos_delta;            /**< Cosine of the carrier phase step. */
+} corr_state_t;
+
+static void corr_state_init(corr_state_t *st, const corr_channel_t *c)
+{
+  for (u8 j = 0; j < c->n_taps; j++) {
+    st->off[j] = (j - (c->n_taps - 1) / 2.0f) * c->tap_spacing;
+    st->shift[j] = c->replica ? lround(st->off[j] / c->code_step) : 0;
+    st->acc_I[j] = st->acc_Q[j] = 0;
+  }
+  st->code_phase = fmod(c->code_phase, c->code_length);
+  if (st->code_phase < 0)
+    st->code_phase += c->code_length;
+  st->carr_sin = sin(c->carr_phase);
+  st->carr_cos = cos(c->carr_phase);
+  st->sin_delta = sin(c->carr_step);
+  st->cos_delta = cos(c->carr_step);
+}
+
+/* Accumulate samples `first` to `first + n - 1` of the channel's window one
+ * at a time. Used by the generic kernel and to finish off the samples left
+ * over by the vector kernels. */
+static void corr_run_generic(corr_state_t *st, const corr_channel_t *c,
+                             const s8 *samples, u32 first, u32 n)
+{
+  s32 len = c->code_length;
+
+  for (u32 i = first; i < first + n; i++) {
+    float baseband_I = st->carr_sin * samples[i];
+    float baseband_Q = st->carr_cos * samples[i];
+
+    for (u8 j = 0; j < c->n_taps; j++) {
+      s8 chip;
+      if (c->replica) {
+        chip = c->replica[(s32)i + st->shift[j]];
+      } else {
+        s32 idx = (s32)floor(st->code_phase + st->off[j]);
+        if (idx < 0)
+          idx += len;
+        else if (idx >= len)
+          idx -= len;
+        chip = c->code[idx];
+      }
+      st->acc_I[j] += chip * baseband_I;
+      st->acc_Q[j] += chip * baseband_Q;
+    }
+
+    float carr_sin_ = st->carr_sin*st->cos_delta + st->carr_cos*st->sin_delta;
+    float carr_cos_ = st->carr_cos*st->cos_delta - st->carr_sin*st->sin_delta;
+    float i_mag = (3.0f - carr_sin_*carr_sin_ - carr_cos_*carr_cos_) / 2.0f;
+    st->carr_sin = carr_sin_ * i_mag;
+    st->carr_cos = carr_cos_ * i_mag;
+
+    st->code_phase += c->code_step;
+    if (st->code_phase >= len)
+      st->code_phase -= len;
+  }
+}
+
+static void corr_state_finish(const corr_state_t *st, corr_channel_t *c)
+{
+  for (u8 j = 0; j < c->n_taps; j++) {
+    c->corr[j].I = st->acc_I[j];
+    c->corr[j].Q = st->acc_Q[j];
+  }
+  c->code_phase = st->code_phase;
+  c->carr_phase = fmod(c->carr_phase + c->num_samples*c->carr_step, 2*M_PI);
+}
+
+static void corr_channel_generic(const s8 *samples, corr_channel_t *c)
+{
+  corr_state_t st;
+  corr_state_init(&st, c);
+  corr_run_generic(&st, c, &samples[c->first_sample], 0, c->num_samples);
+  corr_state_finish(&st, c);
+}
+
+#ifdef CORR_X86_DISPATCH
+
+/* The vector kernels look up the chips for a whole group of `width` samples
+ * and all taps in a single window of `width` consecutive chips, starting
+ * CORR_MAX_TAP_OFFSET chips before the prompt chip of the first sample.
+ * Returns true if the code rate is low enough for that window to cover the
+ * group, or if the chips are read from an upsampled replica instead. */
+static bool corr_vector_ok(const corr_channel_t *c, u32 width)
+{
+  if (c->replica)
+    return true;
+  float off_max = (c->n_taps - 1) / 2.0f * c->tap_spacing;
+  return c->code_step >= 0 && c->code_length >= width &&
+         (width - 1) * c->code_step + off_max + CORR_MAX_TAP_OFFSET + 1
+           < width;
+}
+
+/* Returns a pointer to `width` consecutive chips starting at chip `base`,
+ * copying them into `tmp` when the window wraps around the code period. */
+static const s8 *corr_code_window(const corr_channel_t *c, s32 base,
+                                  u32 width, s8 *tmp)
+{
+  s32 len = c->code_length;
+  if (base >= 0 && base + (s32)width <= len)
+    return &c->code[base];
+  for (u32 k = 0; k < width; k++) {
+    s32 idx = (base + (s32)k) % len;
+    tmp[k] = c->code[idx < 0 ? idx + len : idx];
+  }
+  return tmp;
+}
+
+__attribute__((target("avx2")))
+static float corr_hsum_avx2(__m256 v)
+{
+  __m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  x = _mm_hadd_ps(x, x);
+  x = _mm_hadd_ps(x, x);
+  return _mm_cvtss_f32(x);
+}
+
+__attribute__((target("avx2")))
+static void corr_channel_avx2(const s8 *samples, corr_channel_t *c)
+{
+  const s8 *s = &samples[c->first_sample];
+  corr_state_t st;
+  corr_state_init(&st, c);
+
+  u32 n_vec = corr_vector_ok(c, 8) ? c->num_samples - c->num_samples % 8 : 0;
+
+  if (n_vec) {
+    float lane_sin[8], lane_cos[8], lane_code[8];
+    for (u32 k = 0; k < 8; k++) {
+      lane_sin[k] = sin(c->carr_phase + k*c->carr_step);
+      lane_cos[k] = cos(c->carr_phase + k*c->carr_step);
+      lane_code[k] = k*c->code_step;
+    }
+    __m256 v_sin = _mm256_loadu_ps(lane_sin);
+    __m256 v_cos = _mm256_loadu_ps(lane_cos);
+    const __m256 v_lane_code = _mm256_loadu_ps(lane_code);
+    const __m256 v_sd = _mm256_set1_ps(sin(8*c->carr_step));
+    const __m256 v_cd = _mm256_set1_ps(cos(8*c->carr_step));
+    const __m256 v_three = _mm256_set1_ps(3.0f);
+    const __m256 v_half = _mm256_set1_ps(0.5f);
+
+    __m256 v_off[CORR_MAX_TAPS], v_I[CORR_MAX_TAPS], v_Q[CORR_MAX_TAPS];
+    for (u8 j = 0; j < c->n_taps; j++) {
+      v_off[j] = _mm256_set1_ps(st.off[j] + CORR_MAX_TAP_OFFSET);
+      v_I[j] = v_Q[j] = _mm256_setzero_ps();
+    }
+
+    for (u32 i = 0; i < n_vec; i += 8) {
+      /* Mix the samples down to baseband. */
+      __m256 smp = _mm256_cvtepi32_ps(
+          _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)&s[i])));
+      __m256 b_I = _mm256_mul_ps(smp, v_sin);
+      __m256 b_Q = _mm256_mul_ps(smp, v_cos);
+
+      if (c->replica) {
+        /* Load the chips for each tap straight from the replica. */
+        for (u8 j = 0; j < c->n_taps; j++) {
+          const s8 *r = &c->replica[(s32)i + st.shift[j]];
+          __m256 chips = _mm256_cvtepi32_ps(
+              _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)r)));
+          v_I[j] = _mm256_add_ps(v_I[j], _mm256_mul_ps(chips, b_I));
+          v_Q[j] = _mm256_add_ps(v_Q[j], _mm256_mul_ps(chips, b_Q));
+        }
+      } else {
+        /* Fetch the chips covering this group and permute them into place
+         * for each tap. */
+        double chip = floor(st.code_phase);
+        __m256 v_ph = _mm256_add_ps(_mm256_set1_ps(st.code_phase - chip),
+                                    v_lane_code);
+        s8 tmp[8];
+        const s8 *win = corr_code_window(c, (s32)chip - CORR_MAX_TAP_OFFSET,
+                                         8, tmp);
+        __m256i v_win = _mm256_cvtepi8_epi32(
+            _mm_loadl_epi64((const __m128i *)win));
+
+        for (u8 j = 0; j < c->n_taps; j++) {
+          __m256i rel = _mm256_cvttps_epi32(_mm256_add_ps(v_ph, v_off[j]));
+          __m256 chips = _mm256_cvtepi32_ps(
+              _mm256_permutevar8x32_epi32(v_win, rel));
+          v_I[j] = _mm256_add_ps(v_I[j], _mm256_mul_ps(chips, b_I));
+          v_Q[j] = _mm256_add_ps(v_Q[j], _mm256_mul_ps(chips, b_Q));
+        }
+      }
+
+      /* Rotate all lanes on by 8 carrier steps. */
+      __m256 ns = _mm256_add_ps(_mm256_mul_ps(v_sin, v_cd),
+                                _mm256_mul_ps(v_cos, v_sd));
+      __m256 nc = _mm256_sub_ps(_mm256_mul_ps(v_cos, v_cd),
+                                _mm256_mul_ps(v_sin, v_sd));
+      __m256 mag = _mm256_mul_ps(v_half, _mm256_sub_ps(v_three,
+                     _mm256_add_ps(_mm256_mul_ps(ns, ns),
+                                   _mm256_mul_ps(nc, nc))));
+      v_sin = _mm256_mul_ps(ns, mag);
+      v_cos = _mm256_mul_ps(nc, mag);
+
+      st.code_phase += 8*c->code_step;
+      if (st.code_phase >= c->code_length)
+        st.code_phase -= c->code_length;
+    }
+
+    for (u8 j = 0; j < c->n_taps; j++) {
+      st.acc_I[j] = corr_hsum_avx2(v_I[j]);
+      st.acc_Q[j] = corr_hsum_avx2(v_Q[j]);
+    }
+    st.carr_sin = _mm256_cvtss_f32(v_sin);
+    st.carr_cos = _mm256_cvtss_f32(v_cos);
+  }
+
+  corr_run_generic(&st, c, s, n_vec, c->num_samples - n_vec);
+  corr_state_finish(&st, c);
+}
+
+__attribute__((target("avx512f")))
+static void corr_channel_avx512(const s8 *samples, corr_channel_t *c)
+{
+  const s8 *s = &samples[c->first_sample];
+  corr_state_t st;
+  corr_state_init(&st, c);
+
+  u32 n_vec = corr_vector_ok(c, 16) ? c->num_samples - c->num_samples % 16 : 0;
+
+  if (n_vec) {
+    float lane_sin[16], lane_cos[16], lane_code[16];
+    for (u32 k = 0; k < 16; k++) {
+      lane_sin[k] = sin(c->carr_phase + k*c->carr_step);
+      lane_cos[k] = cos(c->carr_phase + k*c->carr_step);
+      lane_code[k] = k*c->code_step;
+    }
+    __m512 v_sin = _mm512_loadu_ps(lane_sin);
+    __m512 v_cos = _mm512_loadu_ps(lane_cos);
+    const __m512 v_lane_code = _mm512_loadu_ps(lane_code);
+    const __m512 v_sd = _mm512_set1_ps(sin(16*c->carr_step));
+    const __m512 v_cd = _mm512_set1_ps(cos(16*c->carr_step));
+    const __m512 v_three = _mm512_set1_ps(3.0f);
+    const __m512 v_half = _mm512_set1_ps(0.5f);
+
+    __m512 v_off[CORR_MAX_TAPS], v_I[CORR_MAX_TAPS], v_Q[CORR_MAX_TAPS];
+    for (u8 j = 0; j < c->n_taps; j++) {
+      v_off[j] = _mm512_set1_ps(st.off[j] + CORR_MAX_TAP_OFFSET);
+      v_I[j] = v_Q[j] = _mm512_setzero_ps();
+    }
+
+    for (u32 i = 0; i < n_vec; i += 16) {
+      /* Mix the samples down to baseband. */
+      __m512 smp = _mm512_cvtepi32_ps(
+          _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)&s[i])));
+      __m512 b_I = _mm512_mul_ps(smp, v_sin);
+      __m512 b_Q = _mm512_mul_ps(smp, v_cos);
+
+      if (c->replica) {
+        /* Load the chips for each tap straight from the replica. */
+        for (u8 j = 0; j < c->n_taps; j++) {
+          const s8 *r = &c->replica[(s32)i + st.shift[j]];
+          __m512 chips = _mm512_cvtepi32_ps(
+              _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)r)));
+          v_I[j] = _mm512_fmadd_ps(chips, b_I, v_I[j]);
+          v_Q[j] = _mm512_fmadd_ps(chips, b_Q, v_Q[j]);
+        }
+      } else {
+        /* Fetch the chips covering this group and permute them into place
+         * for each tap. */
+        double chip = floor(st.code_phase);
+        __m512 v_ph = _mm512_add_ps(_mm512_set1_ps(st.code_phase - chip),
+                                    v_lane_code);
+        s8 tmp[16];
+        const s8 *win = corr_code_window(c, (s32)chip - CORR_MAX_TAP_OFFSET,
+                                         16, tmp);
+        __m512i v_win = _mm512_cvtepi8_epi32(
+            _mm_loadu_si128((const __m128i *)win));
+
+        for (u8 j = 0; j < c->n_taps; j++) {
+          __m512i rel = _mm512_cvttps_epi32(_mm512_add_ps(v_ph, v_off[j]));
+          __m512 chips = _mm512_cvtepi32_ps(
+              _mm512_permutexvar_epi32(rel, v_win));
+          v_I[j] = _mm512_fmadd_ps(chips, b_I, v_I[j]);
+          v_Q[j] = _mm512_fmadd_ps(chips, b_Q, v_Q[j]);
+        }
+      }
+
+      /* Rotate all lanes on by 16 carrier steps. */
+      __m512 ns = _mm512_add_ps(_mm512_mul_ps(v_sin, v_cd),
+                                _mm512_mul_ps(v_cos, v_sd));
+      __m512 nc = _mm512_sub_ps(_mm512_mul_ps(v_cos, v_cd),
+                                _mm512_mul_ps(v_sin, v_sd));
+      __m512 mag = _mm512_mul_ps(v_half, _mm512_sub_ps(v_three,
+                     _mm512_add_ps(_mm512_mul_ps(ns, ns),
+                                   _mm512_mul_ps(nc, nc))));
+      v_sin = _mm512_mul_ps(ns, mag);
+      v_cos = _mm512_mul_ps(nc, mag);
+
+      st.code_phase += 16*c->code_step;
+      if (st.code_phase >= c->code_length)
+        st.code_phase -= c->code_length;
+    }
+
+    for (u8 j = 0; j < c->n_taps; j++) {
+      st.acc_I[j] = _mm512_reduce_add_ps(v_I[j]);
+      st.acc_Q[j] = _mm512_reduce_add_ps(v_Q[j]);
+    }
+    st.carr_sin = _mm512_cvtss_f32(v_sin);
+    st.carr_cos = _mm512_cvtss_f32(v_cos);
+  }
+
+  corr_run_generic(&st, c, s, n_vec, c->num_samples - n_vec);
+  corr_state_finish(&st, c);
+}
+
+#endif /* CORR_X86_DISPATCH */
+
+/** Initialise a channel of the multi-channel correlator.
+ *
+ * The code and carrier NCO state (`code_phase`, `code_step`, `carr_phase`,
+ * `carr_step`) and the sample window (`first_sample`, `num_samples`) are
+ * zeroed and should be set by the caller before each call to
+ * track_correlate_multi(). No upsampled `replica` is set.
+ *
+ * \param c           Channel state to initialise.
+ * \param code        Code replica, one chip (+/-1) per element. Unlike
+ *                    track_correlate() no padding chips are required, the
+ *                    replica wraps around at `code_length`.
+ * \param code_length Number of chips in the code period.
+ * \param n_taps      Number of correlator taps, at most #CORR_MAX_TAPS.
+ * \param tap_spacing Spacing between adjacent taps in chips. No tap may be
+ *                    more than #CORR_MAX_TAP_OFFSET chips from the prompt.
+ */
+void corr_channel_init(corr_channel_t *c, const s8 *code, u32 code_length,
+                       u8 n_taps, float tap_spacing)
+{
+  assert(n_taps > 0 && n_taps <= CORR_MAX_TAPS);
+  assert((n_taps - 1) / 2.0f * tap_spacing <= CORR_MAX_TAP_OFFSET);
+  assert(code_length > 2 * CORR_MAX_TAP_OFFSET);
+
+  c->code = code;
+  c->replica = NULL;
+  c->code_length = code_length;
+  c->code_phase = c->code_step = 0;
+  c->carr_phase = c->carr_step = 0;
+  c->first_sample = c->num_samples = 0;
+  c->n_taps = n_taps;
+  c->tap_spacing = tap_spacing;
+  for (u8 j = 0; j < CORR_MAX_TAPS; j++)
+    c->corr[j].I = c->corr[j].Q = 0;
+}
+
+/** Check whether a correlator kernel can run on the host CPU.
+ *
+ * \param impl Kernel implementation.
+ * \return true if `impl` may be passed to track_correlate_multi().
+ */
+bool corr_impl_supported(corr_impl_t impl)
+{
+  switch (impl) {
+  case CORR_IMPL_AUTO:
+  case CORR_IMPL_GENERIC:
+    return true;
+#ifdef CORR_X86_DISPATCH
+  case CORR_IMPL_AVX2:
+    return __builtin_cpu_supports("avx2");
+  case CORR_IMPL_AVX512:
+    return __builtin_cpu_supports("avx512f");
+#endif
+  default:
+    return false;
+  }
+}
+
+/** Find the fastest correlator kernel supported by the host CPU.
+ *
+ * \return Kernel implementation selected by #CORR_IMPL_AUTO.
+ */
+corr_impl_t corr_impl_best(void)
+{
+  if (corr_impl_supported(CORR_IMPL_AVX512))
+    return CORR_IMPL_AVX512;
+  if (corr_impl_supported(CORR_IMPL_AVX2))
+    return CORR_IMPL_AVX2;
+  return CORR_IMPL_GENERIC;
+}
+
+/** Multi-channel, multi-tap correlator.
+ *
+ * Correlates a block of samples shared by several channels, each with its
+ * own code replica, code and carrier NCOs, sample window and set of taps.
+ * On return each channel's `corr` holds the integrated correlations for its
+ * window and its code and carrier phases have been advanced to the sample
+ * following the window.
+ *
+ * Each channel reads its chips either by looking them up from the code
+ * phase in its one-chip-per-element `code`, or from a sample-aligned
+ * upsampled `replica` (see code_replica_chips()), which avoids any per-sample
+ * index arithmetic.
+ *
+ * The arithmetic follows the SSSE3 version of track_correlate(), which
+ * remains the reference implementation, using single precision
+ * accumulators and a renormalised recursive carrier rotation.
+ * The vector kernels process 8 (AVX2) or 16 (AVX-512) samples per iteration
+ * and fall back to the generic kernel for channels looking up chips from
+ * `code` whose code rate exceeds roughly 0.7 chips per sample.
+ *
+ * \param impl       Kernel to use, must be supported by the host CPU, see
+ *                   corr_impl_supported(). #CORR_IMPL_AUTO selects the
+ *                   fastest available kernel.
+ * \param samples    Sample buffer shared by all channels.
+ * \param n_channels Number of channels.
+ * \param channels   Array of channel states.
+ */
+void track_correlate_multi(corr_impl_t impl, const s8 *samples,
+                           u8 n_channels, corr_channel_t *channels)
+{
+  if (impl == CORR_IMPL_AUTO)
+    impl = corr_impl_best();
+  assert(corr_impl_supported(impl));
+
+  for (u8 i = 0; i < n_channels; i++) {
+    switch (impl) {
+#ifdef CORR_X86_DISPATCH
+    case CORR_IMPL_AVX512:
+      corr_channel_avx512(samples, &channels[i]);
+      break;
+    case CORR_IMPL_AVX2:
+      corr_channel_avx2(samples, &channels[i]);
+      break;
+#endif
+    default:
+      corr_channel_generic(samples, &channels[i]);
+      break;
+    }
+  }
+}
+
 /** \} */
@@ -23,19 +23,63 @@
 #include <libswiftnav/filter_utils.h>
 #include <libswiftnav/ambiguity_test.h>
 
-nkf_t nkf;
-sats_management_t sats_management;
-ambiguity_test_t ambiguity_test;
-
-dgnss_settings_t dgnss_settings = {
-  .phase_var_test = DEFAULT_PHASE_VAR_TEST,
-  .code_var_test = DEFAULT_CODE_VAR_TEST,
-  .phase_var_kf = DEFAULT_PHASE_VAR_KF,
-  .code_var_kf = DEFAULT_CODE_VAR_KF,
-  .amb_drift_var = DEFAULT_AMB_DRIFT_VAR,
-  .amb_init_var = DEFAULT_AMB_INIT_VAR,
-  .new_int_var = DEFAULT_NEW_INT_VAR,
-};
+#define DEFAULT_DGNSS_SETTINGS {                  \
+    .phase_var_test = DEFAULT_PHASE_VAR_TEST,    \
+    .code_var_test = DEFAULT_CODE_VAR_TEST,      \
+    .phase_var_kf = DEFAULT_PHASE_VAR_KF,        \
+    .code_var_kf = DEFAULT_CODE_VAR_KF,          \
+    .amb_drift_var = DEFAULT_AMB_DRIFT_VAR,      \
+    .amb_init_var = DEFAULT_AMB_INIT_VAR,        \
+    .new_int_var = DEFAULT_NEW_INT_VAR,          \
+  }
+
+dgnss_settings_t dgnss_settings = DEFAULT_DGNSS_SETTINGS;
+
+/* State behind the dgnss_*() functions without a context argument. */
+static dgnss_ctx_t dgnss_global;
+
+/* Returns the context used by the global functions, bringing its settings
+ * up to date with `dgnss_settings`. */
+static dgnss_ctx_t *global_ctx(void)
+{
+  if (dgnss_global.ambiguity_test.pool == NULL) {
+    create_empty_ambiguity_test(&dgnss_global.ambiguity_test);
+  }
+  dgnss_global.settings = dgnss_settings;
+  return &dgnss_global;
+}
+
+/** \defgroup dgnss_management DGNSS Management
+ * Float ambiguity filter and integer ambiguity resolution for a single
+ * baseline.
+ *
+ * All the state of a baseline is held in a ::dgnss_ctx_t owned by the
+ * caller and passed to the `dgnss_ctx_*()` functions, so any number of
+ * baselines can be processed concurrently from different threads, one
+ * context per thread at a time.
+ *
+ * The remaining `dgnss_*()` functions are wrappers which operate on a single
+ * internal context using the settings in `dgnss_settings`, and are not
+ * re-entrant.
+ * \{ */
+
+/** Initialise a DGNSS context.
+ * The context is set up with the default settings, which may be changed
+ * through `ctx->settings` at any time, and with no satellites. Integer
+ * ambiguity hypotheses are stored in `hyp_buff`, see ambiguity_test_init().
+ *
+ * \param ctx       The context to initialise.
+ * \param max_hyps  Maximum number of IAR hypotheses.
+ * \param hyp_buff  Buffer of #AMBIGUITY_TEST_BUFF_SIZE(`max_hyps`) bytes,
+ *                  which must remain valid while the context is in use.
+ * \return          `0` on success, `<0` on failure.
+ */
+s8 dgnss_ctx_init(dgnss_ctx_t *ctx, u32 max_hyps, void *hyp_buff)
+{
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->settings = (dgnss_settings_t) DEFAULT_DGNSS_SETTINGS;
+  return ambiguity_test_init(&ctx->ambiguity_test, max_hyps, hyp_buff);
+}
 
 void dgnss_set_settings(double phase_var_test, double code_var_test,
                         double phase_var_kf, double code_var_kf,
@@ -65,10 +109,11 @@ void make_measurements(u8 num_double_diffs, const sdiff_t *sdiffs, double *raw_m
   DEBUG_EXIT();
 }
 
-static bool sids_match(const gnss_signal_t *old_non_ref_sids, u16 num_non_ref_sdiffs,
+static bool sids_match(const dgnss_ctx_t *ctx,
+                       const gnss_signal_t *old_non_ref_sids, u16 num_non_ref_sdiffs,
                        const sdiff_t *non_ref_sdiffs)
 {
-  if (sats_management.num_sats-1 != num_non_ref_sdiffs) {
+  if (ctx->sats_management.num_sats-1 != num_non_ref_sdiffs) {
     /* lengths don't match */
     return false;
   }
@@ -83,36 +128,38 @@ static bool sids_match(const gnss_signal_t *old_non_ref_sids, u16 num_non_ref_sd
 
 /** Finds the prns of the intersection between old prns and new measurements.
  * It returns the length of the intersection
+ *
+ * Both inputs are sorted, so the index of a signal in either array is its
+ * rank in the corresponding signal set.
  */
 static u8 dgnss_intersect_sats(u8 num_old_sids, const gnss_signal_t *old_sids,
                                u8 num_sdiffs, const sdiff_t *sdiffs,
                                u8 *ndx_of_intersection_in_old,
                                u8 *ndx_of_intersection_in_new)
 {
-  u8 i, j, n = 0;
-  /* Loop over old_sids and sdiffs and check if a PRN is present in both. */
-  for (i=0, j=0; i<num_old_sids && j<num_sdiffs; i++, j++) {
-    if (sid_compare(old_sids[i], sdiffs[j].sid) < 0)
-      j--;
-    else if (sid_compare(old_sids[i], sdiffs[j].sid) > 0)
-      i--;
-    else {
-      ndx_of_intersection_in_old[n] = i;
-      ndx_of_intersection_in_new[n] = j;
-      n++;
-    }
+  sid_set_t old_set, new_set, common;
+  sid_set_from_sids(&old_set, num_old_sids, old_sids);
+  sdiffs_to_sid_set(num_sdiffs, sdiffs, &new_set);
+  sid_set_and(&common, &old_set, &new_set);
+
+  u8 n = 0;
+  for (u32 i = sid_set_next(&common, 0); i < NUM_SATS;
+       i = sid_set_next(&common, i + 1), n++) {
+    ndx_of_intersection_in_old[n] = sid_set_rank(&old_set, i);
+    ndx_of_intersection_in_new[n] = sid_set_rank(&new_set, i);
   }
   return n;
 }
 
-void dgnss_init(u8 num_sats, sdiff_t *sdiffs, double receiver_ecef[3])
+void dgnss_ctx_start(dgnss_ctx_t *ctx, u8 num_sats, sdiff_t *sdiffs,
+                     double receiver_ecef[3])
 {
   DEBUG_ENTRY();
 
   sdiff_t corrected_sdiffs[num_sats];
-  init_sats_management(&sats_management, num_sats, sdiffs, corrected_sdiffs);
+  init_sats_management(&ctx->sats_management, num_sats, sdiffs, corrected_sdiffs);
 
-  create_ambiguity_test(&ambiguity_test);
+  reset_ambiguity_test(&ctx->ambiguity_test);
 
   if (num_sats <= 1) {
     DEBUG_EXIT();
@@ -123,25 +170,27 @@ void dgnss_init(u8 num_sats, sdiff_t *sdiffs, double receiver_ecef[3])
   make_measurements(num_sats-1, corrected_sdiffs, dd_measurements);
 
   set_nkf(
-    &nkf,
-    dgnss_settings.amb_drift_var,
-    dgnss_settings.phase_var_kf, dgnss_settings.code_var_kf,
-    dgnss_settings.amb_init_var,
+    &ctx->nkf,
+    ctx->settings.amb_drift_var,
+    ctx->settings.phase_var_kf, ctx->settings.code_var_kf,
+    ctx->settings.amb_init_var,
     num_sats, corrected_sdiffs, dd_measurements, receiver_ecef
   );
 
   DEBUG_EXIT();
 }
 
-void dgnss_rebase_ref(u8 num_sdiffs, sdiff_t *sdiffs, double receiver_ecef[3], gnss_signal_t old_sids[MAX_CHANNELS], sdiff_t *corrected_sdiffs)
+void dgnss_ctx_rebase_ref(dgnss_ctx_t *ctx, u8 num_sdiffs, sdiff_t *sdiffs,
+                          double receiver_ecef[3],
+                          gnss_signal_t old_sids[MAX_CHANNELS],
+                          sdiff_t *corrected_sdiffs)
 {
-  (void)receiver_ecef;
   /* all the ref sat stuff */
-  s8 sats_management_code = rebase_sats_management(&sats_management, num_sdiffs, sdiffs, corrected_sdiffs);
+  s8 sats_management_code = rebase_sats_management(&ctx->sats_management, num_sdiffs, sdiffs, corrected_sdiffs);
   if (sats_management_code == NEW_REF_START_OVER) {
     log_info("Unable to rebase to new ref, resetting filters and starting over");
-    dgnss_init(num_sdiffs, sdiffs, receiver_ecef);
-    memcpy(old_sids, sats_management.sids, sats_management.num_sats * sizeof(gnss_signal_t));
+    dgnss_ctx_start(ctx, num_sdiffs, sdiffs, receiver_ecef);
+    memcpy(old_sids, ctx->sats_management.sids, ctx->sats_management.num_sats * sizeof(gnss_signal_t));
     if (num_sdiffs >= 1) {
       copy_sdiffs_put_ref_first(old_sids[0], num_sdiffs, sdiffs, corrected_sdiffs);
     }
@@ -150,7 +199,7 @@ void dgnss_rebase_ref(u8 num_sdiffs, sdiff_t *sdiffs, double receiver_ecef[3], g
   }
   else if (sats_management_code == NEW_REF) {
     /* do everything related to changing the reference sat here */
-    rebase_nkf(&nkf, sats_management.num_sats, &old_sids[0], &sats_management.sids[0]);
+    rebase_nkf(&ctx->nkf, ctx->sats_management.num_sats, &old_sids[0], &ctx->sats_management.sids[0]);
   }
 }
 
@@ -185,39 +234,31 @@ static void dgnss_simple_amb_meas(const u8 num_sdiffs,
   }
 }
 
-static void dgnss_update_sats(u8 num_sdiffs, double receiver_ecef[3],
-                              sdiff_t *sdiffs_with_ref_first,
-                              double *dd_measurements)
+static void dgnss_update_sats(dgnss_ctx_t *ctx, u8 num_sdiffs,
+                              sdiff_t *sdiffs_with_ref_first)
 {
   DEBUG_ENTRY();
 
-  (void)dd_measurements;
   gnss_signal_t new_sids[num_sdiffs];
   sdiffs_to_sids(num_sdiffs, sdiffs_with_ref_first, new_sids);
 
   gnss_signal_t old_sids[MAX_CHANNELS];
-  memcpy(old_sids, sats_management.sids, sats_management.num_sats * sizeof(gnss_signal_t));
+  memcpy(old_sids, ctx->sats_management.sids, ctx->sats_management.num_sats * sizeof(gnss_signal_t));
 
-  if (!sids_match(&old_sids[1], num_sdiffs-1, &sdiffs_with_ref_first[1])) {
-    u8 ndx_of_intersection_in_old[sats_management.num_sats];
-    u8 ndx_of_intersection_in_new[sats_management.num_sats];
+  if (!sids_match(ctx, &old_sids[1], num_sdiffs-1, &sdiffs_with_ref_first[1])) {
+    u8 ndx_of_intersection_in_old[ctx->sats_management.num_sats];
+    u8 ndx_of_intersection_in_new[ctx->sats_management.num_sats];
     ndx_of_intersection_in_old[0] = 0;
     ndx_of_intersection_in_new[0] = 0;
     u8 num_intersection_sats = dgnss_intersect_sats(
-        sats_management.num_sats-1, &old_sids[1],
+        ctx->sats_management.num_sats-1, &old_sids[1],
         num_sdiffs-1, &sdiffs_with_ref_first[1],
         &ndx_of_intersection_in_old[1],
         &ndx_of_intersection_in_new[1]) + 1;
 
-    set_nkf_matrices(
-      &nkf,
-      dgnss_settings.phase_var_kf, dgnss_settings.code_var_kf,
-      num_sdiffs, sdiffs_with_ref_first, receiver_ecef
-    );
-
-    if (num_intersection_sats < sats_management.num_sats) { /* we lost sats */
-      nkf_state_projection(&nkf,
-                           sats_management.num_sats-1,
+    if (num_intersection_sats < ctx->sats_management.num_sats) { /* we lost sats */
+      nkf_state_projection(&ctx->nkf,
+                           ctx->sats_management.num_sats-1,
                            num_intersection_sats-1,
                            &ndx_of_intersection_in_old[1]);
     }
@@ -225,29 +266,26 @@ static void dgnss_update_sats(u8 num_sdiffs, double receiver_ecef[3],
       double simple_estimates[num_sdiffs-1];
       dgnss_simple_amb_meas(num_sdiffs, sdiffs_with_ref_first,
                             simple_estimates);
-      nkf_state_inclusion(&nkf,
+      nkf_state_inclusion(&ctx->nkf,
                           num_intersection_sats-1,
                           num_sdiffs-1,
                           &ndx_of_intersection_in_new[1],
                           simple_estimates,
-                          dgnss_settings.new_int_var);
+                          ctx->settings.new_int_var);
     }
+    /* The projection and inclusion resize the state but leave its dimension
+     * to the caller, and the KF matrices aren't rebuilt until later. */
+    ctx->nkf.state_dim = num_sdiffs - 1;
 
-    update_sats_sats_management(&sats_management, num_sdiffs-1, &sdiffs_with_ref_first[1]);
-  }
-  else {
-    set_nkf_matrices(
-      &nkf,
-      dgnss_settings.phase_var_kf, dgnss_settings.code_var_kf,
-      num_sdiffs, sdiffs_with_ref_first, receiver_ecef
-    );
+    update_sats_sats_management(&ctx->sats_management, num_sdiffs-1, &sdiffs_with_ref_first[1]);
   }
 
   DEBUG_EXIT();
 }
 
-void dgnss_update(u8 num_sats, sdiff_t *sdiffs, double receiver_ecef[3],
-                  bool disable_raim, double raim_threshold)
+void dgnss_ctx_update(dgnss_ctx_t *ctx, u8 num_sats, sdiff_t *sdiffs,
+                      double receiver_ecef[3],
+                      bool disable_raim, double raim_threshold)
 {
   DEBUG_ENTRY();
   if (DEBUG) {
@@ -259,33 +297,33 @@ void dgnss_update(u8 num_sats, sdiff_t *sdiffs, double receiver_ecef[3],
   }
 
   if (num_sats <= 1) {
-    sats_management.num_sats = num_sats;
+    ctx->sats_management.num_sats = num_sats;
     if (num_sats == 1) {
-      sats_management.sids[0] = sdiffs[0].sid;
+      ctx->sats_management.sids[0] = sdiffs[0].sid;
     }
-    create_ambiguity_test(&ambiguity_test);
+    reset_ambiguity_test(&ctx->ambiguity_test);
     DEBUG_EXIT();
     return;
   }
 
-  if (sats_management.num_sats <= 1) {
-    dgnss_init(num_sats, sdiffs, receiver_ecef);
+  if (ctx->sats_management.num_sats <= 1) {
+    dgnss_ctx_start(ctx, num_sats, sdiffs, receiver_ecef);
   }
 
   sdiff_t sdiffs_with_ref_first[num_sats];
 
   gnss_signal_t old_sids[MAX_CHANNELS];
-  memcpy(old_sids, sats_management.sids, sats_management.num_sats * sizeof(gnss_signal_t));
+  memcpy(old_sids, ctx->sats_management.sids, ctx->sats_management.num_sats * sizeof(gnss_signal_t));
 
   /* rebase globals to a new reference sat
    * (permutes sdiffs_with_ref_first accordingly) */
-  dgnss_rebase_ref(num_sats, sdiffs, receiver_ecef, old_sids, sdiffs_with_ref_first);
+  dgnss_ctx_rebase_ref(ctx, num_sats, sdiffs, receiver_ecef, old_sids, sdiffs_with_ref_first);
 
   double dd_measurements[2*(num_sats-1)];
   make_measurements(num_sats-1, sdiffs_with_ref_first, dd_measurements);
 
   /* all the added/dropped sat stuff */
-  dgnss_update_sats(num_sats, receiver_ecef, sdiffs_with_ref_first, dd_measurements);
+  dgnss_update_sats(ctx, num_sats, sdiffs_with_ref_first);
 
   /* Unless the KF says otherwise, DONT TRUST THE MEASUREMENTS */
   u8 is_bad_measurement = true;
@@ -293,7 +331,7 @@ void dgnss_update(u8 num_sats, sdiff_t *sdiffs, double receiver_ecef[3],
   double ref_ecef[3];
   if (num_sats >= 5) {
     double b2[3];
-    s8 code = least_squares_solve_b_external_ambs(nkf.state_dim, nkf.state_mean,
+    s8 code = least_squares_solve_b_external_ambs(ctx->nkf.state_dim, ctx->nkf.state_mean,
         sdiffs_with_ref_first, dd_measurements, receiver_ecef, b2,
         disable_raim, raim_threshold);
 
@@ -303,57 +341,113 @@ void dgnss_update(u8 num_sats, sdiff_t *sdiffs, double receiver_ecef[3],
       memset(b2, 0, sizeof(b2));
     }
 
-    double ref_ecef[3];
-
     vector_add_sc(3, receiver_ecef, b2, 0.5, ref_ecef);
 
     /* TODO: make a common DE and use it instead. */
 
-    set_nkf_matrices(&nkf,
-                     dgnss_settings.phase_var_kf, dgnss_settings.code_var_kf,
-                     sats_management.num_sats, sdiffs_with_ref_first, ref_ecef);
+    set_nkf_matrices(&ctx->nkf,
+                     ctx->settings.phase_var_kf, ctx->settings.code_var_kf,
+                     ctx->sats_management.num_sats, sdiffs_with_ref_first, ref_ecef);
 
-    is_bad_measurement = nkf_update(&nkf, dd_measurements);
+    is_bad_measurement = nkf_update(&ctx->nkf, dd_measurements);
+  } else {
+    /* The KF matrices are only built once per epoch, at the baseline
+     * midpoint when we have one. */
+    set_nkf_matrices(&ctx->nkf,
+                     ctx->settings.phase_var_kf, ctx->settings.code_var_kf,
+                     num_sats, sdiffs_with_ref_first, receiver_ecef);
   }
 
-  u8 changed_sats = ambiguity_update_sats(&ambiguity_test, num_sats, sdiffs,
-                                          &sats_management, nkf.state_mean,
-                                          nkf.state_cov_U, nkf.state_cov_D,
+  u8 changed_sats = ambiguity_update_sats(&ctx->ambiguity_test, num_sats, sdiffs,
+                                          &ctx->sats_management, ctx->nkf.state_mean,
+                                          ctx->nkf.state_cov_U, ctx->nkf.state_cov_D,
                                           is_bad_measurement);
 
-  /* TODO: Refactor - looks like ref_ecef can be passed in uninitialized */
+  /* ref_ecef is set above whenever the KF accepted the measurements. */
   if (!is_bad_measurement) {
     update_ambiguity_test(ref_ecef,
-                          dgnss_settings.phase_var_test,
-                          dgnss_settings.code_var_test,
-                          &ambiguity_test, nkf.state_dim,
+                          ctx->settings.phase_var_test,
+                          ctx->settings.code_var_test,
+                          &ctx->ambiguity_test, ctx->nkf.state_dim,
                           sdiffs, changed_sats);
   }
 
-  update_unanimous_ambiguities(&ambiguity_test);
+  update_unanimous_ambiguities(&ctx->ambiguity_test);
 
   DEBUG_EXIT();
 }
 
-u32 dgnss_iar_num_hyps(void)
+/** Runs the float filter and ambiguity test over a batch of epochs.
+ * For post-processing logged data. Each epoch is processed as with
+ * dgnss_ctx_update() followed by dgnss_ctx_update_ambiguity_state() and
+ * dgnss_baseline(), and the baseline is written to `solutions`. A filter
+ * that has not been started is started on the first epoch of the batch.
+ * Successive calls continue from the state left by the previous one, so a
+ * long log can be streamed through in batches of any size.
+ *
+ * \param ctx            The DGNSS context to update.
+ * \param n_epochs       Number of epochs in the batch.
+ * \param epochs         Array of `n_epochs` epoch descriptions.
+ * \param sdiffs         The sdiffs of all the epochs, stored contiguously
+ *                       in epoch order, each epoch sorted by PRN.
+ * \param disable_raim   True disables raim check/repair.
+ * \param raim_threshold Threshold for raim checks.
+ * \param solutions      Output array of `n_epochs` baseline solutions.
+ * \return The number of epochs for which a baseline was found.
+ */
+u32 dgnss_ctx_process_epochs(dgnss_ctx_t *ctx, u32 n_epochs,
+                             const dgnss_epoch_t *epochs, sdiff_t *sdiffs,
+                             bool disable_raim, double raim_threshold,
+                             dgnss_solution_t *solutions)
+{
+  u32 n_solutions = 0;
+  ambiguity_state_t s;
+
+  for (u32 i = 0; i < n_epochs; i++) {
+    double receiver_ecef[3];
+    memcpy(receiver_ecef, epochs[i].receiver_ecef, sizeof(receiver_ecef));
+    u8 num_sats = epochs[i].num_sats;
+
+    if (ctx->sats_management.num_sats <= 1) {
+      dgnss_ctx_start(ctx, num_sats, sdiffs, receiver_ecef);
+    } else {
+      dgnss_ctx_update(ctx, num_sats, sdiffs, receiver_ecef,
+                       disable_raim, raim_threshold);
+    }
+
+    dgnss_ctx_update_ambiguity_state(ctx, &s);
+    solutions[i].num_used = 0;
+    solutions[i].ret = dgnss_baseline(num_sats, sdiffs, receiver_ecef, &s,
+                                      &solutions[i].num_used, solutions[i].b,
+                                      disable_raim, raim_threshold);
+    if (solutions[i].ret > 0) {
+      n_solutions++;
+    }
+    sdiffs += num_sats;
+  }
+
+  return n_solutions;
+}
+
+u32 dgnss_ctx_iar_num_hyps(dgnss_ctx_t *ctx)
 {
-  if (ambiguity_test.pool == NULL) {
+  if (ctx->ambiguity_test.pool == NULL) {
     return 0;
   } else {
-    return ambiguity_test_n_hypotheses(&ambiguity_test);
+    return ambiguity_test_n_hypotheses(&ctx->ambiguity_test);
   }
 }
 
-u32 dgnss_iar_num_sats(void)
+u32 dgnss_ctx_iar_num_sats(const dgnss_ctx_t *ctx)
 {
-  return ambiguity_test.sats.num_sats;
+  return ctx->ambiguity_test.sats.num_sats;
 }
 
-s8 dgnss_iar_get_single_hyp(double *dhyp)
+s8 dgnss_ctx_iar_get_single_hyp(dgnss_ctx_t *ctx, double *dhyp)
 {
-  u8 num_dds = ambiguity_test.sats.num_sats;
+  u8 num_dds = ctx->ambiguity_test.sats.num_sats;
   s32 hyp[num_dds];
-  s8 ret = get_single_hypothesis(&ambiguity_test, hyp);
+  s8 ret = get_single_hypothesis(&ctx->ambiguity_test, hyp);
   for (u8 i=0; i<num_dds; i++) {
     dhyp[i] = hyp[i];
   }
@@ -366,30 +460,30 @@ s8 dgnss_iar_get_single_hyp(double *dhyp)
  *
  * \param s Pointer to ambiguity state structure
  */
-void dgnss_update_ambiguity_state(ambiguity_state_t *s)
+void dgnss_ctx_update_ambiguity_state(dgnss_ctx_t *ctx, ambiguity_state_t *s)
 {
   /* Float filter */
-  /* NOTE: if sats_management.num_sats <= 1 the filter is not updated and
-   * nkf.state_dim may not match. */
-  if (sats_management.num_sats > 1) {
-    assert(sats_management.num_sats == nkf.state_dim+1);
-    s->float_ambs.n = nkf.state_dim;
-    memcpy(s->float_ambs.sids, sats_management.sids,
-           (nkf.state_dim+1) * sizeof(gnss_signal_t));
-    memcpy(s->float_ambs.ambs, nkf.state_mean,
-           nkf.state_dim * sizeof(double));
+  /* NOTE: if ctx->sats_management.num_sats <= 1 the filter is not updated and
+   * ctx->nkf.state_dim may not match. */
+  if (ctx->sats_management.num_sats > 1) {
+    assert(ctx->sats_management.num_sats == ctx->nkf.state_dim+1);
+    s->float_ambs.n = ctx->nkf.state_dim;
+    memcpy(s->float_ambs.sids, ctx->sats_management.sids,
+           (ctx->nkf.state_dim+1) * sizeof(gnss_signal_t));
+    memcpy(s->float_ambs.ambs, ctx->nkf.state_mean,
+           ctx->nkf.state_dim * sizeof(double));
   } else {
     s->float_ambs.n = 0;
   }
 
   /* Fixed filter */
-  if (ambiguity_iar_can_solve(&ambiguity_test)) {
-    s->fixed_ambs.n = ambiguity_test.amb_check.num_matching_ndxs;
-    s->fixed_ambs.sids[0] = ambiguity_test.sats.sids[0];
+  if (ambiguity_iar_can_solve(&ctx->ambiguity_test)) {
+    s->fixed_ambs.n = ctx->ambiguity_test.amb_check.num_matching_ndxs;
+    s->fixed_ambs.sids[0] = ctx->ambiguity_test.sats.sids[0];
     for (u8 i=0; i < s->fixed_ambs.n; i++) {
-      s->fixed_ambs.sids[i + 1] = ambiguity_test.sats.sids[1 +
-          ambiguity_test.amb_check.matching_ndxs[i]];
-      s->fixed_ambs.ambs[i] = ambiguity_test.amb_check.ambs[i];
+      s->fixed_ambs.sids[i + 1] = ctx->ambiguity_test.sats.sids[1 +
+          ctx->ambiguity_test.amb_check.matching_ndxs[i]];
+      s->fixed_ambs.ambs[i] = ctx->ambiguity_test.amb_check.ambs[i];
     }
   } else {
     s->fixed_ambs.n = 0;
@@ -445,24 +539,28 @@ s8 dgnss_baseline(u8 num_sdiffs, const sdiff_t *sdiffs,
   return ret;
 }
 
-void dgnss_reset_iar()
+void dgnss_ctx_reset_iar(dgnss_ctx_t *ctx)
 {
-  create_ambiguity_test(&ambiguity_test);
+  reset_ambiguity_test(&ctx->ambiguity_test);
 }
 
-void dgnss_init_known_baseline(u8 num_sats, sdiff_t *sdiffs,
-                               double receiver_ecef[3], double b[3])
+void dgnss_ctx_init_known_baseline(dgnss_ctx_t *ctx, u8 num_sats,
+                                   sdiff_t *sdiffs, double receiver_ecef[3],
+                                   double b[3])
 {
+  if (num_sats < 2)
+    return;
+
   double ref_ecef[3];
   vector_add_sc(3, receiver_ecef, b, 0.5, ref_ecef);
 
   sdiff_t corrected_sdiffs[num_sats];
 
   gnss_signal_t old_sids[MAX_CHANNELS];
-  memcpy(old_sids, sats_management.sids, sats_management.num_sats * sizeof(gnss_signal_t));
+  memcpy(old_sids, ctx->sats_management.sids, ctx->sats_management.num_sats * sizeof(gnss_signal_t));
   /* rebase globals to a new reference sat
    * (permutes corrected_sdiffs accordingly) */
-  dgnss_rebase_ref(num_sats, sdiffs, ref_ecef, old_sids, corrected_sdiffs);
+  dgnss_ctx_rebase_ref(ctx, num_sats, sdiffs, ref_ecef, old_sids, corrected_sdiffs);
 
   double dds[2*(num_sats-1)];
   make_measurements(num_sats-1, corrected_sdiffs, dds);
@@ -470,10 +568,10 @@ void dgnss_init_known_baseline(u8 num_sats, sdiff_t *sdiffs,
   double DE[(num_sats-1)*3];
   assign_de_mtx(num_sats, corrected_sdiffs, ref_ecef, DE);
 
-  dgnss_reset_iar();
+  dgnss_ctx_reset_iar(ctx);
 
-  memcpy(&ambiguity_test.sats, &sats_management, sizeof(sats_management));
-  hypothesis_t *hyp = (hypothesis_t *)memory_pool_add(ambiguity_test.pool);
+  memcpy(&ctx->ambiguity_test.sats, &ctx->sats_management, sizeof(ctx->sats_management));
+  hypothesis_t *hyp = (hypothesis_t *)memory_pool_add(ctx->ambiguity_test.pool);
   hyp->ll = 0;
   amb_from_baseline(num_sats-1, DE, dds, b, hyp->N);
 
@@ -485,17 +583,17 @@ void dgnss_init_known_baseline(u8 num_sats, sdiff_t *sdiffs,
       u8 i_ = i+num_dds;
       u8 j_ = j+num_dds;
       if (i==j) {
-        obs_cov[i*2*num_dds + j] = dgnss_settings.phase_var_test * 2;
-        obs_cov[i_*2*num_dds + j_] = dgnss_settings.code_var_test * 2;
+        obs_cov[i*2*num_dds + j] = ctx->settings.phase_var_test * 2;
+        obs_cov[i_*2*num_dds + j_] = ctx->settings.code_var_test * 2;
       }
       else {
-        obs_cov[i*2*num_dds + j] = dgnss_settings.phase_var_test;
-        obs_cov[i_*2*num_dds + j_] = dgnss_settings.code_var_test;
+        obs_cov[i*2*num_dds + j] = ctx->settings.phase_var_test;
+        obs_cov[i_*2*num_dds + j_] = ctx->settings.code_var_test;
       }
     }
   }
 
-  init_residual_matrices(&ambiguity_test.res_mtxs, num_sats-1, DE, obs_cov);
+  init_residual_matrices(&ctx->ambiguity_test.res_mtxs, num_sats-1, DE, obs_cov);
 }
 
 static void measure_b(u8 state_dim, const double *state_mean,
@@ -524,15 +622,18 @@ static void measure_b(u8 state_dim, const double *state_mean,
 }
 
 
-void measure_b_with_external_ambs(u8 state_dim, const double *state_mean,
-                                  u8 num_sdiffs, sdiff_t *sdiffs,
-                                  const double receiver_ecef[3], double *b)
+void dgnss_ctx_measure_b_with_external_ambs(const dgnss_ctx_t *ctx,
+                                            u8 state_dim,
+                                            const double *state_mean,
+                                            u8 num_sdiffs, sdiff_t *sdiffs,
+                                            const double receiver_ecef[3],
+                                            double *b)
 {
   DEBUG_ENTRY();
 
   sdiff_t sdiffs_with_ref_first[num_sdiffs];
   /* We require the sats updating has already been done with these sdiffs */
-  gnss_signal_t ref_sid = sats_management.sids[0];
+  gnss_signal_t ref_sid = ctx->sats_management.sids[0];
   copy_sdiffs_put_ref_first(ref_sid, num_sdiffs, sdiffs, sdiffs_with_ref_first);
 
   measure_b(state_dim, state_mean, num_sdiffs, sdiffs_with_ref_first, receiver_ecef, b);
@@ -540,39 +641,42 @@ void measure_b_with_external_ambs(u8 state_dim, const double *state_mean,
   DEBUG_EXIT();
 }
 
-void measure_amb_kf_b(u8 num_sdiffs, sdiff_t *sdiffs,
-                      const double receiver_ecef[3], double *b)
+void dgnss_ctx_measure_amb_kf_b(const dgnss_ctx_t *ctx,
+                                u8 num_sdiffs, sdiff_t *sdiffs,
+                                const double receiver_ecef[3], double *b)
 {
   DEBUG_ENTRY();
 
   sdiff_t sdiffs_with_ref_first[num_sdiffs];
   /* We require the sats updating has already been done with these sdiffs */
-  gnss_signal_t ref_sid = sats_management.sids[0];
+  gnss_signal_t ref_sid = ctx->sats_management.sids[0];
   copy_sdiffs_put_ref_first(ref_sid, num_sdiffs, sdiffs, sdiffs_with_ref_first);
 
-  measure_b( nkf.state_dim, nkf.state_mean,
+  measure_b( ctx->nkf.state_dim, ctx->nkf.state_mean,
       num_sdiffs, sdiffs_with_ref_first, receiver_ecef, b);
 
   DEBUG_EXIT();
 }
 
-void measure_iar_b_with_external_ambs(double *state_mean,
-                                      u8 num_sdiffs, sdiff_t *sdiffs,
-                                      double receiver_ecef[3],
-                                      double *b)
+void dgnss_ctx_measure_iar_b_with_external_ambs(dgnss_ctx_t *ctx,
+                                                double *state_mean,
+                                                u8 num_sdiffs,
+                                                sdiff_t *sdiffs,
+                                                double receiver_ecef[3],
+                                                double *b)
 {
   DEBUG_ENTRY();
 
   sdiff_t sdiffs_with_ref_first[num_sdiffs];
-  match_sdiffs_to_sats_man(&ambiguity_test.sats, num_sdiffs, sdiffs, sdiffs_with_ref_first);
+  match_sdiffs_to_sats_man(&ctx->ambiguity_test.sats, num_sdiffs, sdiffs, sdiffs_with_ref_first);
 
-  measure_b(CLAMP_DIFF(ambiguity_test.sats.num_sats, 1), state_mean,
+  measure_b(CLAMP_DIFF(ctx->ambiguity_test.sats.num_sats, 1), state_mean,
       num_sdiffs, sdiffs_with_ref_first, receiver_ecef, b);
 
   DEBUG_EXIT();
 }
 
-static u8 get_de_and_phase(sats_management_t *sats_man,
+static u8 get_de_and_phase(const sats_management_t *sats_man,
                            u8 num_sdiffs, sdiff_t *sdiffs,
                            double ref_ecef[3],
                            double *de, double *phase)
@@ -621,89 +725,232 @@ static u8 get_de_and_phase(sats_management_t *sats_man,
   return num_sats;
 }
 
-u8 get_amb_kf_de_and_phase(u8 num_sdiffs, sdiff_t *sdiffs,
-                           double ref_ecef[3],
-                           double *de, double *phase)
+u8 dgnss_ctx_get_amb_kf_de_and_phase(const dgnss_ctx_t *ctx,
+                                     u8 num_sdiffs, sdiff_t *sdiffs,
+                                     double ref_ecef[3],
+                                     double *de, double *phase)
 {
-  return get_de_and_phase(&sats_management,
+  return get_de_and_phase(&ctx->sats_management,
                           num_sdiffs, sdiffs,
                           ref_ecef,
                           de, phase);
 }
 
-u8 get_iar_de_and_phase(u8 num_sdiffs, sdiff_t *sdiffs,
-                        double ref_ecef[3],
-                        double *de, double *phase)
+u8 dgnss_ctx_get_iar_de_and_phase(const dgnss_ctx_t *ctx,
+                                  u8 num_sdiffs, sdiff_t *sdiffs,
+                                  double ref_ecef[3],
+                                  double *de, double *phase)
 {
-  return get_de_and_phase(&ambiguity_test.sats,
+  return get_de_and_phase(&ctx->ambiguity_test.sats,
                           num_sdiffs, sdiffs,
                           ref_ecef,
                           de, phase);
 }
 
-u8 get_amb_kf_mean(double *ambs)
+u8 dgnss_ctx_get_amb_kf_mean(const dgnss_ctx_t *ctx, double *ambs)
 {
-  u8 num_dds = CLAMP_DIFF(sats_management.num_sats, 1);
-  memcpy(ambs, nkf.state_mean, num_dds * sizeof(double));
+  u8 num_dds = CLAMP_DIFF(ctx->sats_management.num_sats, 1);
+  memcpy(ambs, ctx->nkf.state_mean, num_dds * sizeof(double));
   return num_dds;
 }
 
-u8 get_amb_kf_cov(double *cov)
+u8 dgnss_ctx_get_amb_kf_cov(const dgnss_ctx_t *ctx, double *cov)
 {
-  u8 num_dds = CLAMP_DIFF(sats_management.num_sats, 1);
-  matrix_reconstruct_udu(num_dds, nkf.state_cov_U, nkf.state_cov_D, cov);
+  u8 num_dds = CLAMP_DIFF(ctx->sats_management.num_sats, 1);
+  matrix_reconstruct_udu(num_dds, ctx->nkf.state_cov_U, ctx->nkf.state_cov_D, cov);
   return num_dds;
 }
 
+u8 dgnss_ctx_get_amb_kf_sids(const dgnss_ctx_t *ctx, gnss_signal_t *sids)
+{
+  memcpy(sids, ctx->sats_management.sids, ctx->sats_management.num_sats * sizeof(gnss_signal_t));
+  return ctx->sats_management.num_sats;
+}
+
+u8 dgnss_ctx_get_amb_test_sids(const dgnss_ctx_t *ctx, gnss_signal_t *sids)
+{
+  memcpy(sids, ctx->ambiguity_test.sats.sids, ctx->ambiguity_test.sats.num_sats * sizeof(gnss_signal_t));
+  return ctx->ambiguity_test.sats.num_sats;
+}
+
+s8 dgnss_ctx_iar_resolved(dgnss_ctx_t *ctx)
+{
+  return ambiguity_iar_can_solve(&ctx->ambiguity_test);
+}
+
+u8 dgnss_ctx_iar_pool_contains(dgnss_ctx_t *ctx, double *ambs)
+{
+  return ambiguity_test_pool_contains(&ctx->ambiguity_test, ambs);
+}
+
+double dgnss_ctx_iar_pool_ll(dgnss_ctx_t *ctx, u8 num_ambs, double *ambs)
+{
+  return ambiguity_test_pool_ll(&ctx->ambiguity_test, num_ambs, ambs);
+}
+
+double dgnss_ctx_iar_pool_prob(dgnss_ctx_t *ctx, u8 num_ambs, double *ambs)
+{
+  return ambiguity_test_pool_prob(&ctx->ambiguity_test, num_ambs, ambs);
+}
+
+u8 dgnss_ctx_iar_MLE_ambs(dgnss_ctx_t *ctx, s32 *ambs)
+{
+  ambiguity_test_MLE_ambs(&ctx->ambiguity_test, ambs);
+  return CLAMP_DIFF(ctx->ambiguity_test.sats.num_sats, 1);
+}
+
+
+/** \} */
+
+void dgnss_init(u8 num_sats, sdiff_t *sdiffs, double receiver_ecef[3])
+{
+  dgnss_ctx_start(global_ctx(), num_sats, sdiffs, receiver_ecef);
+}
+
+void dgnss_rebase_ref(u8 num_sdiffs, sdiff_t *sdiffs, double receiver_ecef[3],
+                      gnss_signal_t old_sids[MAX_CHANNELS],
+                      sdiff_t *corrected_sdiffs)
+{
+  dgnss_ctx_rebase_ref(global_ctx(), num_sdiffs, sdiffs, receiver_ecef,
+                       old_sids, corrected_sdiffs);
+}
+
+void dgnss_update(u8 num_sats, sdiff_t *sdiffs, double receiver_ecef[3],
+                  bool disable_raim, double raim_threshold)
+{
+  dgnss_ctx_update(global_ctx(), num_sats, sdiffs, receiver_ecef,
+                   disable_raim, raim_threshold);
+}
+
+u32 dgnss_iar_num_hyps(void)
+{
+  return dgnss_ctx_iar_num_hyps(global_ctx());
+}
+
+u32 dgnss_iar_num_sats(void)
+{
+  return dgnss_ctx_iar_num_sats(global_ctx());
+}
+
+s8 dgnss_iar_get_single_hyp(double *dhyp)
+{
+  return dgnss_ctx_iar_get_single_hyp(global_ctx(), dhyp);
+}
+
+void dgnss_update_ambiguity_state(ambiguity_state_t *s)
+{
+  dgnss_ctx_update_ambiguity_state(global_ctx(), s);
+}
+
+void dgnss_reset_iar(void)
+{
+  dgnss_ctx_reset_iar(global_ctx());
+}
+
+void dgnss_init_known_baseline(u8 num_sats, sdiff_t *sdiffs,
+                               double receiver_ecef[3], double b[3])
+{
+  dgnss_ctx_init_known_baseline(global_ctx(), num_sats, sdiffs,
+                                receiver_ecef, b);
+}
+
+void measure_b_with_external_ambs(u8 state_dim, const double *state_mean,
+                                  u8 num_sdiffs, sdiff_t *sdiffs,
+                                  const double receiver_ecef[3], double *b)
+{
+  dgnss_ctx_measure_b_with_external_ambs(global_ctx(), state_dim, state_mean,
+                                         num_sdiffs, sdiffs, receiver_ecef, b);
+}
+
+void measure_amb_kf_b(u8 num_sdiffs, sdiff_t *sdiffs,
+                      const double receiver_ecef[3], double *b)
+{
+  dgnss_ctx_measure_amb_kf_b(global_ctx(), num_sdiffs, sdiffs,
+                             receiver_ecef, b);
+}
+
+void measure_iar_b_with_external_ambs(double *state_mean,
+                                      u8 num_sdiffs, sdiff_t *sdiffs,
+                                      double receiver_ecef[3],
+                                      double *b)
+{
+  dgnss_ctx_measure_iar_b_with_external_ambs(global_ctx(), state_mean,
+                                             num_sdiffs, sdiffs,
+                                             receiver_ecef, b);
+}
+
+u8 get_amb_kf_de_and_phase(u8 num_sdiffs, sdiff_t *sdiffs,
+                           double ref_ecef[3],
+                           double *de, double *phase)
+{
+  return dgnss_ctx_get_amb_kf_de_and_phase(global_ctx(), num_sdiffs, sdiffs,
+                                           ref_ecef, de, phase);
+}
+
+u8 get_iar_de_and_phase(u8 num_sdiffs, sdiff_t *sdiffs,
+                        double ref_ecef[3],
+                        double *de, double *phase)
+{
+  return dgnss_ctx_get_iar_de_and_phase(global_ctx(), num_sdiffs, sdiffs,
+                                        ref_ecef, de, phase);
+}
+
+u8 get_amb_kf_mean(double *ambs)
+{
+  return dgnss_ctx_get_amb_kf_mean(global_ctx(), ambs);
+}
+
+u8 get_amb_kf_cov(double *cov)
+{
+  return dgnss_ctx_get_amb_kf_cov(global_ctx(), cov);
+}
+
 u8 get_amb_kf_sids(gnss_signal_t *sids)
 {
-  memcpy(sids, sats_management.sids, sats_management.num_sats * sizeof(gnss_signal_t));
-  return sats_management.num_sats;
+  return dgnss_ctx_get_amb_kf_sids(global_ctx(), sids);
 }
 
 u8 get_amb_test_sids(gnss_signal_t *sids)
 {
-  memcpy(sids, ambiguity_test.sats.sids, ambiguity_test.sats.num_sats * sizeof(gnss_signal_t));
-  return ambiguity_test.sats.num_sats;
+  return dgnss_ctx_get_amb_test_sids(global_ctx(), sids);
 }
 
-s8 dgnss_iar_resolved()
+s8 dgnss_iar_resolved(void)
 {
-  return ambiguity_iar_can_solve(&ambiguity_test);
+  return dgnss_ctx_iar_resolved(global_ctx());
 }
 
 u8 dgnss_iar_pool_contains(double *ambs)
 {
-  return ambiguity_test_pool_contains(&ambiguity_test, ambs);
+  return dgnss_ctx_iar_pool_contains(global_ctx(), ambs);
 }
 
 double dgnss_iar_pool_ll(u8 num_ambs, double *ambs)
 {
-  return ambiguity_test_pool_ll(&ambiguity_test, num_ambs, ambs);
+  return dgnss_ctx_iar_pool_ll(global_ctx(), num_ambs, ambs);
 }
 
 double dgnss_iar_pool_prob(u8 num_ambs, double *ambs)
 {
-  return ambiguity_test_pool_prob(&ambiguity_test, num_ambs, ambs);
+  return dgnss_ctx_iar_pool_prob(global_ctx(), num_ambs, ambs);
 }
 
 u8 dgnss_iar_MLE_ambs(s32 *ambs)
 {
-  ambiguity_test_MLE_ambs(&ambiguity_test, ambs);
-  return CLAMP_DIFF(ambiguity_test.sats.num_sats, 1);
+  return dgnss_ctx_iar_MLE_ambs(global_ctx(), ambs);
 }
 
 nkf_t* get_dgnss_nkf(void)
 {
-  return &nkf;
+  return &global_ctx()->nkf;
 }
 
 sats_management_t* get_sats_management(void)
 {
-  return &sats_management;
+  return &global_ctx()->sats_management;
 }
 
 ambiguity_test_t* get_ambiguity_test(void)
 {
-  return &ambiguity_test;
+  return &global_ctx()->ambiguity_test;
 }
@@ -55,6 +55,249 @@ static const u32 crc24qtab[256] = {
   0x42FA2F, 0xC4B6D4, 0xC82F22, 0x4E63D9, 0xD11CCE, 0x575035, 0x5BC9C3, 0xDD8538
 };
 
+/* crc24qtab_slice[k-1][v] is the CRC of byte v followed by k zero bytes, so
+ * that eight bytes can be folded into the CRC with one lookup each. */
+static const u32 crc24qtab_slice[7][256] = {
+  {
+    0x000000, 0x668F48, 0xCD1E90, 0xAB91D8, 0x1C71DB, 0x7AFE93, 0xD16F4B, 0xB7E003,
+    0x38E3B6, 0x5E6CFE, 0xF5FD26, 0x93726E, 0x24926D, 0x421D25, 0xE98CFD, 0x8F03B5,
+    0x71C76C, 0x174824, 0xBCD9FC, 0xDA56B4, 0x6DB6B7, 0x0B39FF, 0xA0A827, 0xC6276F,
+    0x4924DA, 0x2FAB92, 0x843A4A, 0xE2B502, 0x555501, 0x33DA49, 0x984B91, 0xFEC4D9,
+    0xE38ED8, 0x850190, 0x2E9048, 0x481F00, 0xFFFF03, 0x99704B, 0x32E193, 0x546EDB,
+    0xDB6D6E, 0xBDE226, 0x1673FE, 0x70FCB6, 0xC71CB5, 0xA193FD, 0x0A0225, 0x6C8D6D,
+    0x9249B4, 0xF4C6FC, 0x5F5724, 0x39D86C, 0x8E386F, 0xE8B727, 0x4326FF, 0x25A9B7,
+    0xAAAA02, 0xCC254A, 0x67B492, 0x013BDA, 0xB6DBD9, 0xD05491, 0x7BC549, 0x1D4A01,
+    0x41514B, 0x27DE03, 0x8C4FDB, 0xEAC093, 0x5D2090, 0x3BAFD8, 0x903E00, 0xF6B148,
+    0x79B2FD, 0x1F3DB5, 0xB4AC6D, 0xD22325, 0x65C326, 0x034C6E, 0xA8DDB6, 0xCE52FE,
+    0x309627, 0x56196F, 0xFD88B7, 0x9B07FF, 0x2CE7FC, 0x4A68B4, 0xE1F96C, 0x877624,
+    0x087591, 0x6EFAD9, 0xC56B01, 0xA3E449, 0x14044A, 0x728B02, 0xD91ADA, 0xBF9592,
+    0xA2DF93, 0xC450DB, 0x6FC103, 0x094E4B, 0xBEAE48, 0xD82100, 0x73B0D8, 0x153F90,
+    0x9A3C25, 0xFCB36D, 0x5722B5, 0x31ADFD, 0x864DFE, 0xE0C2B6, 0x4B536E, 0x2DDC26,
+    0xD318FF, 0xB597B7, 0x1E066F, 0x788927, 0xCF6924, 0xA9E66C, 0x0277B4, 0x64F8FC,
+    0xEBFB49, 0x8D7401, 0x26E5D9, 0x406A91, 0xF78A92, 0x9105DA, 0x3A9402, 0x5C1B4A,
+    0x82A296, 0xE42DDE, 0x4FBC06, 0x29334E, 0x9ED34D, 0xF85C05, 0x53CDDD, 0x354295,
+    0xBA4120, 0xDCCE68, 0x775FB0, 0x11D0F8, 0xA630FB, 0xC0BFB3, 0x6B2E6B, 0x0DA123,
+    0xF365FA, 0x95EAB2, 0x3E7B6A, 0x58F422, 0xEF1421, 0x899B69, 0x220AB1, 0x4485F9,
+    0xCB864C, 0xAD0904, 0x0698DC, 0x601794, 0xD7F797, 0xB178DF, 0x1AE907, 0x7C664F,
+    0x612C4E, 0x07A306, 0xAC32DE, 0xCABD96, 0x7D5D95, 0x1BD2DD, 0xB04305, 0xD6CC4D,
+    0x59CFF8, 0x3F40B0, 0x94D168, 0xF25E20, 0x45BE23, 0x23316B, 0x88A0B3, 0xEE2FFB,
+    0x10EB22, 0x76646A, 0xDDF5B2, 0xBB7AFA, 0x0C9AF9, 0x6A15B1, 0xC18469, 0xA70B21,
+    0x280894, 0x4E87DC, 0xE51604, 0x83994C, 0x34794F, 0x52F607, 0xF967DF, 0x9FE897,
+    0xC3F3DD, 0xA57C95, 0x0EED4D, 0x686205, 0xDF8206, 0xB90D4E, 0x129C96, 0x7413DE,
+    0xFB106B, 0x9D9F23, 0x360EFB, 0x5081B3, 0xE761B0, 0x81EEF8, 0x2A7F20, 0x4CF068,
+    0xB234B1, 0xD4BBF9, 0x7F2A21, 0x19A569, 0xAE456A, 0xC8CA22, 0x635BFA, 0x05D4B2,
+    0x8AD707, 0xEC584F, 0x47C997, 0x2146DF, 0x96A6DC, 0xF02994, 0x5BB84C, 0x3D3704,
+    0x207D05, 0x46F24D, 0xED6395, 0x8BECDD, 0x3C0CDE, 0x5A8396, 0xF1124E, 0x979D06,
+    0x189EB3, 0x7E11FB, 0xD58023, 0xB30F6B, 0x04EF68, 0x626020, 0xC9F1F8, 0xAF7EB0,
+    0x51BA69, 0x373521, 0x9CA4F9, 0xFA2BB1, 0x4DCBB2, 0x2B44FA, 0x80D522, 0xE65A6A,
+    0x6959DF, 0x0FD697, 0xA4474F, 0xC2C807, 0x752804, 0x13A74C, 0xB83694, 0xDEB9DC
+  },
+  {
+    0x000000, 0x8309D7, 0x805F55, 0x035682, 0x86F251, 0x05FB86, 0x06AD04, 0x85A4D3,
+    0x8BA859, 0x08A18E, 0x0BF70C, 0x88FEDB, 0x0D5A08, 0x8E53DF, 0x8D055D, 0x0E0C8A,
+    0x911C49, 0x12159E, 0x11431C, 0x924ACB, 0x17EE18, 0x94E7CF, 0x97B14D, 0x14B89A,
+    0x1AB410, 0x99BDC7, 0x9AEB45, 0x19E292, 0x9C4641, 0x1F4F96, 0x1C1914, 0x9F10C3,
+    0xA47469, 0x277DBE, 0x242B3C, 0xA722EB, 0x228638, 0xA18FEF, 0xA2D96D, 0x21D0BA,
+    0x2FDC30, 0xACD5E7, 0xAF8365, 0x2C8AB2, 0xA92E61, 0x2A27B6, 0x297134, 0xAA78E3,
+    0x356820, 0xB661F7, 0xB53775, 0x363EA2, 0xB39A71, 0x3093A6, 0x33C524, 0xB0CCF3,
+    0xBEC079, 0x3DC9AE, 0x3E9F2C, 0xBD96FB, 0x383228, 0xBB3BFF, 0xB86D7D, 0x3B64AA,
+    0xCEA429, 0x4DADFE, 0x4EFB7C, 0xCDF2AB, 0x485678, 0xCB5FAF, 0xC8092D, 0x4B00FA,
+    0x450C70, 0xC605A7, 0xC55325, 0x465AF2, 0xC3FE21, 0x40F7F6, 0x43A174, 0xC0A8A3,
+    0x5FB860, 0xDCB1B7, 0xDFE735, 0x5CEEE2, 0xD94A31, 0x5A43E6, 0x591564, 0xDA1CB3,
+    0xD41039, 0x5719EE, 0x544F6C, 0xD746BB, 0x52E268, 0xD1EBBF, 0xD2BD3D, 0x51B4EA,
+    0x6AD040, 0xE9D997, 0xEA8F15, 0x6986C2, 0xEC2211, 0x6F2BC6, 0x6C7D44, 0xEF7493,
+    0xE17819, 0x6271CE, 0x61274C, 0xE22E9B, 0x678A48, 0xE4839F, 0xE7D51D, 0x64DCCA,
+    0xFBCC09, 0x78C5DE, 0x7B935C, 0xF89A8B, 0x7D3E58, 0xFE378F, 0xFD610D, 0x7E68DA,
+    0x706450, 0xF36D87, 0xF03B05, 0x7332D2, 0xF69601, 0x759FD6, 0x76C954, 0xF5C083,
+    0x1B04A9, 0x980D7E, 0x9B5BFC, 0x18522B, 0x9DF6F8, 0x1EFF2F, 0x1DA9AD, 0x9EA07A,
+    0x90ACF0, 0x13A527, 0x10F3A5, 0x93FA72, 0x165EA1, 0x955776, 0x9601F4, 0x150823,
+    0x8A18E0, 0x091137, 0x0A47B5, 0x894E62, 0x0CEAB1, 0x8FE366, 0x8CB5E4, 0x0FBC33,
+    0x01B0B9, 0x82B96E, 0x81EFEC, 0x02E63B, 0x8742E8, 0x044B3F, 0x071DBD, 0x84146A,
+    0xBF70C0, 0x3C7917, 0x3F2F95, 0xBC2642, 0x398291, 0xBA8B46, 0xB9DDC4, 0x3AD413,
+    0x34D899, 0xB7D14E, 0xB487CC, 0x378E1B, 0xB22AC8, 0x31231F, 0x32759D, 0xB17C4A,
+    0x2E6C89, 0xAD655E, 0xAE33DC, 0x2D3A0B, 0xA89ED8, 0x2B970F, 0x28C18D, 0xABC85A,
+    0xA5C4D0, 0x26CD07, 0x259B85, 0xA69252, 0x233681, 0xA03F56, 0xA369D4, 0x206003,
+    0xD5A080, 0x56A957, 0x55FFD5, 0xD6F602, 0x5352D1, 0xD05B06, 0xD30D84, 0x500453,
+    0x5E08D9, 0xDD010E, 0xDE578C, 0x5D5E5B, 0xD8FA88, 0x5BF35F, 0x58A5DD, 0xDBAC0A,
+    0x44BCC9, 0xC7B51E, 0xC4E39C, 0x47EA4B, 0xC24E98, 0x41474F, 0x4211CD, 0xC1181A,
+    0xCF1490, 0x4C1D47, 0x4F4BC5, 0xCC4212, 0x49E6C1, 0xCAEF16, 0xC9B994, 0x4AB043,
+    0x71D4E9, 0xF2DD3E, 0xF18BBC, 0x72826B, 0xF726B8, 0x742F6F, 0x7779ED, 0xF4703A,
+    0xFA7CB0, 0x797567, 0x7A23E5, 0xF92A32, 0x7C8EE1, 0xFF8736, 0xFCD1B4, 0x7FD863,
+    0xE0C8A0, 0x63C177, 0x6097F5, 0xE39E22, 0x663AF1, 0xE53326, 0xE665A4, 0x656C73,
+    0x6B60F9, 0xE8692E, 0xEB3FAC, 0x68367B, 0xED92A8, 0x6E9B7F, 0x6DCDFD, 0xEEC42A
+  },
+  {
+    0x000000, 0x360952, 0x6C12A4, 0x5A1BF6, 0xD82548, 0xEE2C1A, 0xB437EC, 0x823EBE,
+    0x36066B, 0x000F39, 0x5A14CF, 0x6C1D9D, 0xEE2323, 0xD82A71, 0x823187, 0xB438D5,
+    0x6C0CD6, 0x5A0584, 0x001E72, 0x361720, 0xB4299E, 0x8220CC, 0xD83B3A, 0xEE3268,
+    0x5A0ABD, 0x6C03EF, 0x361819, 0x00114B, 0x822FF5, 0xB426A7, 0xEE3D51, 0xD83403,
+    0xD819AC, 0xEE10FE, 0xB40B08, 0x82025A, 0x003CE4, 0x3635B6, 0x6C2E40, 0x5A2712,
+    0xEE1FC7, 0xD81695, 0x820D63, 0xB40431, 0x363A8F, 0x0033DD, 0x5A282B, 0x6C2179,
+    0xB4157A, 0x821C28, 0xD807DE, 0xEE0E8C, 0x6C3032, 0x5A3960, 0x002296, 0x362BC4,
+    0x821311, 0xB41A43, 0xEE01B5, 0xD808E7, 0x5A3659, 0x6C3F0B, 0x3624FD, 0x002DAF,
+    0x367FA3, 0x0076F1, 0x5A6D07, 0x6C6455, 0xEE5AEB, 0xD853B9, 0x82484F, 0xB4411D,
+    0x0079C8, 0x36709A, 0x6C6B6C, 0x5A623E, 0xD85C80, 0xEE55D2, 0xB44E24, 0x824776,
+    0x5A7375, 0x6C7A27, 0x3661D1, 0x006883, 0x82563D, 0xB45F6F, 0xEE4499, 0xD84DCB,
+    0x6C751E, 0x5A7C4C, 0x0067BA, 0x366EE8, 0xB45056, 0x825904, 0xD842F2, 0xEE4BA0,
+    0xEE660F, 0xD86F5D, 0x8274AB, 0xB47DF9, 0x364347, 0x004A15, 0x5A51E3, 0x6C58B1,
+    0xD86064, 0xEE6936, 0xB472C0, 0x827B92, 0x00452C, 0x364C7E, 0x6C5788, 0x5A5EDA,
+    0x826AD9, 0xB4638B, 0xEE787D, 0xD8712F, 0x5A4F91, 0x6C46C3, 0x365D35, 0x005467,
+    0xB46CB2, 0x8265E0, 0xD87E16, 0xEE7744, 0x6C49FA, 0x5A40A8, 0x005B5E, 0x36520C,
+    0x6CFF46, 0x5AF614, 0x00EDE2, 0x36E4B0, 0xB4DA0E, 0x82D35C, 0xD8C8AA, 0xEEC1F8,
+    0x5AF92D, 0x6CF07F, 0x36EB89, 0x00E2DB, 0x82DC65, 0xB4D537, 0xEECEC1, 0xD8C793,
+    0x00F390, 0x36FAC2, 0x6CE134, 0x5AE866, 0xD8D6D8, 0xEEDF8A, 0xB4C47C, 0x82CD2E,
+    0x36F5FB, 0x00FCA9, 0x5AE75F, 0x6CEE0D, 0xEED0B3, 0xD8D9E1, 0x82C217, 0xB4CB45,
+    0xB4E6EA, 0x82EFB8, 0xD8F44E, 0xEEFD1C, 0x6CC3A2, 0x5ACAF0, 0x00D106, 0x36D854,
+    0x82E081, 0xB4E9D3, 0xEEF225, 0xD8FB77, 0x5AC5C9, 0x6CCC9B, 0x36D76D, 0x00DE3F,
+    0xD8EA3C, 0xEEE36E, 0xB4F898, 0x82F1CA, 0x00CF74, 0x36C626, 0x6CDDD0, 0x5AD482,
+    0xEEEC57, 0xD8E505, 0x82FEF3, 0xB4F7A1, 0x36C91F, 0x00C04D, 0x5ADBBB, 0x6CD2E9,
+    0x5A80E5, 0x6C89B7, 0x369241, 0x009B13, 0x82A5AD, 0xB4ACFF, 0xEEB709, 0xD8BE5B,
+    0x6C868E, 0x5A8FDC, 0x00942A, 0x369D78, 0xB4A3C6, 0x82AA94, 0xD8B162, 0xEEB830,
+    0x368C33, 0x008561, 0x5A9E97, 0x6C97C5, 0xEEA97B, 0xD8A029, 0x82BBDF, 0xB4B28D,
+    0x008A58, 0x36830A, 0x6C98FC, 0x5A91AE, 0xD8AF10, 0xEEA642, 0xB4BDB4, 0x82B4E6,
+    0x829949, 0xB4901B, 0xEE8BED, 0xD882BF, 0x5ABC01, 0x6CB553, 0x36AEA5, 0x00A7F7,
+    0xB49F22, 0x829670, 0xD88D86, 0xEE84D4, 0x6CBA6A, 0x5AB338, 0x00A8CE, 0x36A19C,
+    0xEE959F, 0xD89CCD, 0x82873B, 0xB48E69, 0x36B0D7, 0x00B985, 0x5AA273, 0x6CAB21,
+    0xD893F4, 0xEE9AA6, 0xB48150, 0x828802, 0x00B6BC, 0x36BFEE, 0x6CA418, 0x5AAD4A
+  },
+  {
+    0x000000, 0xD9FE8C, 0x35B1E3, 0xEC4F6F, 0x6B63C6, 0xB29D4A, 0x5ED225, 0x872CA9,
+    0xD6C78C, 0x0F3900, 0xE3766F, 0x3A88E3, 0xBDA44A, 0x645AC6, 0x8815A9, 0x51EB25,
+    0x2BC3E3, 0xF23D6F, 0x1E7200, 0xC78C8C, 0x40A025, 0x995EA9, 0x7511C6, 0xACEF4A,
+    0xFD046F, 0x24FAE3, 0xC8B58C, 0x114B00, 0x9667A9, 0x4F9925, 0xA3D64A, 0x7A28C6,
+    0x5787C6, 0x8E794A, 0x623625, 0xBBC8A9, 0x3CE400, 0xE51A8C, 0x0955E3, 0xD0AB6F,
+    0x81404A, 0x58BEC6, 0xB4F1A9, 0x6D0F25, 0xEA238C, 0x33DD00, 0xDF926F, 0x066CE3,
+    0x7C4425, 0xA5BAA9, 0x49F5C6, 0x900B4A, 0x1727E3, 0xCED96F, 0x229600, 0xFB688C,
+    0xAA83A9, 0x737D25, 0x9F324A, 0x46CCC6, 0xC1E06F, 0x181EE3, 0xF4518C, 0x2DAF00,
+    0xAF0F8C, 0x76F100, 0x9ABE6F, 0x4340E3, 0xC46C4A, 0x1D92C6, 0xF1DDA9, 0x282325,
+    0x79C800, 0xA0368C, 0x4C79E3, 0x95876F, 0x12ABC6, 0xCB554A, 0x271A25, 0xFEE4A9,
+    0x84CC6F, 0x5D32E3, 0xB17D8C, 0x688300, 0xEFAFA9, 0x365125, 0xDA1E4A, 0x03E0C6,
+    0x520BE3, 0x8BF56F, 0x67BA00, 0xBE448C, 0x396825, 0xE096A9, 0x0CD9C6, 0xD5274A,
+    0xF8884A, 0x2176C6, 0xCD39A9, 0x14C725, 0x93EB8C, 0x4A1500, 0xA65A6F, 0x7FA4E3,
+    0x2E4FC6, 0xF7B14A, 0x1BFE25, 0xC200A9, 0x452C00, 0x9CD28C, 0x709DE3, 0xA9636F,
+    0xD34BA9, 0x0AB525, 0xE6FA4A, 0x3F04C6, 0xB8286F, 0x61D6E3, 0x8D998C, 0x546700,
+    0x058C25, 0xDC72A9, 0x303DC6, 0xE9C34A, 0x6EEFE3, 0xB7116F, 0x5B5E00, 0x82A08C,
+    0xD853E3, 0x01AD6F, 0xEDE200, 0x341C8C, 0xB33025, 0x6ACEA9, 0x8681C6, 0x5F7F4A,
+    0x0E946F, 0xD76AE3, 0x3B258C, 0xE2DB00, 0x65F7A9, 0xBC0925, 0x50464A, 0x89B8C6,
+    0xF39000, 0x2A6E8C, 0xC621E3, 0x1FDF6F, 0x98F3C6, 0x410D4A, 0xAD4225, 0x74BCA9,
+    0x25578C, 0xFCA900, 0x10E66F, 0xC918E3, 0x4E344A, 0x97CAC6, 0x7B85A9, 0xA27B25,
+    0x8FD425, 0x562AA9, 0xBA65C6, 0x639B4A, 0xE4B7E3, 0x3D496F, 0xD10600, 0x08F88C,
+    0x5913A9, 0x80ED25, 0x6CA24A, 0xB55CC6, 0x32706F, 0xEB8EE3, 0x07C18C, 0xDE3F00,
+    0xA417C6, 0x7DE94A, 0x91A625, 0x4858A9, 0xCF7400, 0x168A8C, 0xFAC5E3, 0x233B6F,
+    0x72D04A, 0xAB2EC6, 0x4761A9, 0x9E9F25, 0x19B38C, 0xC04D00, 0x2C026F, 0xF5FCE3,
+    0x775C6F, 0xAEA2E3, 0x42ED8C, 0x9B1300, 0x1C3FA9, 0xC5C125, 0x298E4A, 0xF070C6,
+    0xA19BE3, 0x78656F, 0x942A00, 0x4DD48C, 0xCAF825, 0x1306A9, 0xFF49C6, 0x26B74A,
+    0x5C9F8C, 0x856100, 0x692E6F, 0xB0D0E3, 0x37FC4A, 0xEE02C6, 0x024DA9, 0xDBB325,
+    0x8A5800, 0x53A68C, 0xBFE9E3, 0x66176F, 0xE13BC6, 0x38C54A, 0xD48A25, 0x0D74A9,
+    0x20DBA9, 0xF92525, 0x156A4A, 0xCC94C6, 0x4BB86F, 0x9246E3, 0x7E098C, 0xA7F700,
+    0xF61C25, 0x2FE2A9, 0xC3ADC6, 0x1A534A, 0x9D7FE3, 0x44816F, 0xA8CE00, 0x71308C,
+    0x0B184A, 0xD2E6C6, 0x3EA9A9, 0xE75725, 0x607B8C, 0xB98500, 0x55CA6F, 0x8C34E3,
+    0xDDDFC6, 0x04214A, 0xE86E25, 0x3190A9, 0xB6BC00, 0x6F428C, 0x830DE3, 0x5AF36F
+  },
+  {
+    0x000000, 0x36EB3D, 0x6DD67A, 0x5B3D47, 0xDBACF4, 0xED47C9, 0xB67A8E, 0x8091B3,
+    0x311513, 0x07FE2E, 0x5CC369, 0x6A2854, 0xEAB9E7, 0xDC52DA, 0x876F9D, 0xB184A0,
+    0x622A26, 0x54C11B, 0x0FFC5C, 0x391761, 0xB986D2, 0x8F6DEF, 0xD450A8, 0xE2BB95,
+    0x533F35, 0x65D408, 0x3EE94F, 0x080272, 0x8893C1, 0xBE78FC, 0xE545BB, 0xD3AE86,
+    0xC4544C, 0xF2BF71, 0xA98236, 0x9F690B, 0x1FF8B8, 0x291385, 0x722EC2, 0x44C5FF,
+    0xF5415F, 0xC3AA62, 0x989725, 0xAE7C18, 0x2EEDAB, 0x180696, 0x433BD1, 0x75D0EC,
+    0xA67E6A, 0x909557, 0xCBA810, 0xFD432D, 0x7DD29E, 0x4B39A3, 0x1004E4, 0x26EFD9,
+    0x976B79, 0xA18044, 0xFABD03, 0xCC563E, 0x4CC78D, 0x7A2CB0, 0x2111F7, 0x17FACA,
+    0x0EE463, 0x380F5E, 0x633219, 0x55D924, 0xD54897, 0xE3A3AA, 0xB89EED, 0x8E75D0,
+    0x3FF170, 0x091A4D, 0x52270A, 0x64CC37, 0xE45D84, 0xD2B6B9, 0x898BFE, 0xBF60C3,
+    0x6CCE45, 0x5A2578, 0x01183F, 0x37F302, 0xB762B1, 0x81898C, 0xDAB4CB, 0xEC5FF6,
+    0x5DDB56, 0x6B306B, 0x300D2C, 0x06E611, 0x8677A2, 0xB09C9F, 0xEBA1D8, 0xDD4AE5,
+    0xCAB02F, 0xFC5B12, 0xA76655, 0x918D68, 0x111CDB, 0x27F7E6, 0x7CCAA1, 0x4A219C,
+    0xFBA53C, 0xCD4E01, 0x967346, 0xA0987B, 0x2009C8, 0x16E2F5, 0x4DDFB2, 0x7B348F,
+    0xA89A09, 0x9E7134, 0xC54C73, 0xF3A74E, 0x7336FD, 0x45DDC0, 0x1EE087, 0x280BBA,
+    0x998F1A, 0xAF6427, 0xF45960, 0xC2B25D, 0x4223EE, 0x74C8D3, 0x2FF594, 0x191EA9,
+    0x1DC8C6, 0x2B23FB, 0x701EBC, 0x46F581, 0xC66432, 0xF08F0F, 0xABB248, 0x9D5975,
+    0x2CDDD5, 0x1A36E8, 0x410BAF, 0x77E092, 0xF77121, 0xC19A1C, 0x9AA75B, 0xAC4C66,
+    0x7FE2E0, 0x4909DD, 0x12349A, 0x24DFA7, 0xA44E14, 0x92A529, 0xC9986E, 0xFF7353,
+    0x4EF7F3, 0x781CCE, 0x232189, 0x15CAB4, 0x955B07, 0xA3B03A, 0xF88D7D, 0xCE6640,
+    0xD99C8A, 0xEF77B7, 0xB44AF0, 0x82A1CD, 0x02307E, 0x34DB43, 0x6FE604, 0x590D39,
+    0xE88999, 0xDE62A4, 0x855FE3, 0xB3B4DE, 0x33256D, 0x05CE50, 0x5EF317, 0x68182A,
+    0xBBB6AC, 0x8D5D91, 0xD660D6, 0xE08BEB, 0x601A58, 0x56F165, 0x0DCC22, 0x3B271F,
+    0x8AA3BF, 0xBC4882, 0xE775C5, 0xD19EF8, 0x510F4B, 0x67E476, 0x3CD931, 0x0A320C,
+    0x132CA5, 0x25C798, 0x7EFADF, 0x4811E2, 0xC88051, 0xFE6B6C, 0xA5562B, 0x93BD16,
+    0x2239B6, 0x14D28B, 0x4FEFCC, 0x7904F1, 0xF99542, 0xCF7E7F, 0x944338, 0xA2A805,
+    0x710683, 0x47EDBE, 0x1CD0F9, 0x2A3BC4, 0xAAAA77, 0x9C414A, 0xC77C0D, 0xF19730,
+    0x401390, 0x76F8AD, 0x2DC5EA, 0x1B2ED7, 0x9BBF64, 0xAD5459, 0xF6691E, 0xC08223,
+    0xD778E9, 0xE193D4, 0xBAAE93, 0x8C45AE, 0x0CD41D, 0x3A3F20, 0x610267, 0x57E95A,
+    0xE66DFA, 0xD086C7, 0x8BBB80, 0xBD50BD, 0x3DC10E, 0x0B2A33, 0x501774, 0x66FC49,
+    0xB552CF, 0x83B9F2, 0xD884B5, 0xEE6F88, 0x6EFE3B, 0x581506, 0x032841, 0x35C37C,
+    0x8447DC, 0xB2ACE1, 0xE991A6, 0xDF7A9B, 0x5FEB28, 0x690015, 0x323D52, 0x04D66F
+  },
+  {
+    0x000000, 0x3B918C, 0x772318, 0x4CB294, 0xEE4630, 0xD5D7BC, 0x996528, 0xA2F4A4,
+    0x5AC09B, 0x615117, 0x2DE383, 0x16720F, 0xB486AB, 0x8F1727, 0xC3A5B3, 0xF8343F,
+    0xB58136, 0x8E10BA, 0xC2A22E, 0xF933A2, 0x5BC706, 0x60568A, 0x2CE41E, 0x177592,
+    0xEF41AD, 0xD4D021, 0x9862B5, 0xA3F339, 0x01079D, 0x3A9611, 0x762485, 0x4DB509,
+    0xED4E97, 0xD6DF1B, 0x9A6D8F, 0xA1FC03, 0x0308A7, 0x38992B, 0x742BBF, 0x4FBA33,
+    0xB78E0C, 0x8C1F80, 0xC0AD14, 0xFB3C98, 0x59C83C, 0x6259B0, 0x2EEB24, 0x157AA8,
+    0x58CFA1, 0x635E2D, 0x2FECB9, 0x147D35, 0xB68991, 0x8D181D, 0xC1AA89, 0xFA3B05,
+    0x020F3A, 0x399EB6, 0x752C22, 0x4EBDAE, 0xEC490A, 0xD7D886, 0x9B6A12, 0xA0FB9E,
+    0x5CD1D5, 0x674059, 0x2BF2CD, 0x106341, 0xB297E5, 0x890669, 0xC5B4FD, 0xFE2571,
+    0x06114E, 0x3D80C2, 0x713256, 0x4AA3DA, 0xE8577E, 0xD3C6F2, 0x9F7466, 0xA4E5EA,
+    0xE950E3, 0xD2C16F, 0x9E73FB, 0xA5E277, 0x0716D3, 0x3C875F, 0x7035CB, 0x4BA447,
+    0xB39078, 0x8801F4, 0xC4B360, 0xFF22EC, 0x5DD648, 0x6647C4, 0x2AF550, 0x1164DC,
+    0xB19F42, 0x8A0ECE, 0xC6BC5A, 0xFD2DD6, 0x5FD972, 0x6448FE, 0x28FA6A, 0x136BE6,
+    0xEB5FD9, 0xD0CE55, 0x9C7CC1, 0xA7ED4D, 0x0519E9, 0x3E8865, 0x723AF1, 0x49AB7D,
+    0x041E74, 0x3F8FF8, 0x733D6C, 0x48ACE0, 0xEA5844, 0xD1C9C8, 0x9D7B5C, 0xA6EAD0,
+    0x5EDEEF, 0x654F63, 0x29FDF7, 0x126C7B, 0xB098DF, 0x8B0953, 0xC7BBC7, 0xFC2A4B,
+    0xB9A3AA, 0x823226, 0xCE80B2, 0xF5113E, 0x57E59A, 0x6C7416, 0x20C682, 0x1B570E,
+    0xE36331, 0xD8F2BD, 0x944029, 0xAFD1A5, 0x0D2501, 0x36B48D, 0x7A0619, 0x419795,
+    0x0C229C, 0x37B310, 0x7B0184, 0x409008, 0xE264AC, 0xD9F520, 0x9547B4, 0xAED638,
+    0x56E207, 0x6D738B, 0x21C11F, 0x1A5093, 0xB8A437, 0x8335BB, 0xCF872F, 0xF416A3,
+    0x54ED3D, 0x6F7CB1, 0x23CE25, 0x185FA9, 0xBAAB0D, 0x813A81, 0xCD8815, 0xF61999,
+    0x0E2DA6, 0x35BC2A, 0x790EBE, 0x429F32, 0xE06B96, 0xDBFA1A, 0x97488E, 0xACD902,
+    0xE16C0B, 0xDAFD87, 0x964F13, 0xADDE9F, 0x0F2A3B, 0x34BBB7, 0x780923, 0x4398AF,
+    0xBBAC90, 0x803D1C, 0xCC8F88, 0xF71E04, 0x55EAA0, 0x6E7B2C, 0x22C9B8, 0x195834,
+    0xE5727F, 0xDEE3F3, 0x925167, 0xA9C0EB, 0x0B344F, 0x30A5C3, 0x7C1757, 0x4786DB,
+    0xBFB2E4, 0x842368, 0xC891FC, 0xF30070, 0x51F4D4, 0x6A6558, 0x26D7CC, 0x1D4640,
+    0x50F349, 0x6B62C5, 0x27D051, 0x1C41DD, 0xBEB579, 0x8524F5, 0xC99661, 0xF207ED,
+    0x0A33D2, 0x31A25E, 0x7D10CA, 0x468146, 0xE475E2, 0xDFE46E, 0x9356FA, 0xA8C776,
+    0x083CE8, 0x33AD64, 0x7F1FF0, 0x448E7C, 0xE67AD8, 0xDDEB54, 0x9159C0, 0xAAC84C,
+    0x52FC73, 0x696DFF, 0x25DF6B, 0x1E4EE7, 0xBCBA43, 0x872BCF, 0xCB995B, 0xF008D7,
+    0xBDBDDE, 0x862C52, 0xCA9EC6, 0xF10F4A, 0x53FBEE, 0x686A62, 0x24D8F6, 0x1F497A,
+    0xE77D45, 0xDCECC9, 0x905E5D, 0xABCFD1, 0x093B75, 0x32AAF9, 0x7E186D, 0x4589E1
+  },
+  {
+    0x000000, 0xF50BAF, 0x6C5BA5, 0x99500A, 0xD8B74A, 0x2DBCE5, 0xB4ECEF, 0x41E740,
+    0x37226F, 0xC229C0, 0x5B79CA, 0xAE7265, 0xEF9525, 0x1A9E8A, 0x83CE80, 0x76C52F,
+    0x6E44DE, 0x9B4F71, 0x021F7B, 0xF714D4, 0xB6F394, 0x43F83B, 0xDAA831, 0x2FA39E,
+    0x5966B1, 0xAC6D1E, 0x353D14, 0xC036BB, 0x81D1FB, 0x74DA54, 0xED8A5E, 0x1881F1,
+    0xDC89BC, 0x298213, 0xB0D219, 0x45D9B6, 0x043EF6, 0xF13559, 0x686553, 0x9D6EFC,
+    0xEBABD3, 0x1EA07C, 0x87F076, 0x72FBD9, 0x331C99, 0xC61736, 0x5F473C, 0xAA4C93,
+    0xB2CD62, 0x47C6CD, 0xDE96C7, 0x2B9D68, 0x6A7A28, 0x9F7187, 0x06218D, 0xF32A22,
+    0x85EF0D, 0x70E4A2, 0xE9B4A8, 0x1CBF07, 0x5D5847, 0xA853E8, 0x3103E2, 0xC4084D,
+    0x3F5F83, 0xCA542C, 0x530426, 0xA60F89, 0xE7E8C9, 0x12E366, 0x8BB36C, 0x7EB8C3,
+    0x087DEC, 0xFD7643, 0x642649, 0x912DE6, 0xD0CAA6, 0x25C109, 0xBC9103, 0x499AAC,
+    0x511B5D, 0xA410F2, 0x3D40F8, 0xC84B57, 0x89AC17, 0x7CA7B8, 0xE5F7B2, 0x10FC1D,
+    0x663932, 0x93329D, 0x0A6297, 0xFF6938, 0xBE8E78, 0x4B85D7, 0xD2D5DD, 0x27DE72,
+    0xE3D63F, 0x16DD90, 0x8F8D9A, 0x7A8635, 0x3B6175, 0xCE6ADA, 0x573AD0, 0xA2317F,
+    0xD4F450, 0x21FFFF, 0xB8AFF5, 0x4DA45A, 0x0C431A, 0xF948B5, 0x6018BF, 0x951310,
+    0x8D92E1, 0x78994E, 0xE1C944, 0x14C2EB, 0x5525AB, 0xA02E04, 0x397E0E, 0xCC75A1,
+    0xBAB08E, 0x4FBB21, 0xD6EB2B, 0x23E084, 0x6207C4, 0x970C6B, 0x0E5C61, 0xFB57CE,
+    0x7EBF06, 0x8BB4A9, 0x12E4A3, 0xE7EF0C, 0xA6084C, 0x5303E3, 0xCA53E9, 0x3F5846,
+    0x499D69, 0xBC96C6, 0x25C6CC, 0xD0CD63, 0x912A23, 0x64218C, 0xFD7186, 0x087A29,
+    0x10FBD8, 0xE5F077, 0x7CA07D, 0x89ABD2, 0xC84C92, 0x3D473D, 0xA41737, 0x511C98,
+    0x27D9B7, 0xD2D218, 0x4B8212, 0xBE89BD, 0xFF6EFD, 0x0A6552, 0x933558, 0x663EF7,
+    0xA236BA, 0x573D15, 0xCE6D1F, 0x3B66B0, 0x7A81F0, 0x8F8A5F, 0x16DA55, 0xE3D1FA,
+    0x9514D5, 0x601F7A, 0xF94F70, 0x0C44DF, 0x4DA39F, 0xB8A830, 0x21F83A, 0xD4F395,
+    0xCC7264, 0x3979CB, 0xA029C1, 0x55226E, 0x14C52E, 0xE1CE81, 0x789E8B, 0x8D9524,
+    0xFB500B, 0x0E5BA4, 0x970BAE, 0x620001, 0x23E741, 0xD6ECEE, 0x4FBCE4, 0xBAB74B,
+    0x41E085, 0xB4EB2A, 0x2DBB20, 0xD8B08F, 0x9957CF, 0x6C5C60, 0xF50C6A, 0x0007C5,
+    0x76C2EA, 0x83C945, 0x1A994F, 0xEF92E0, 0xAE75A0, 0x5B7E0F, 0xC22E05, 0x3725AA,
+    0x2FA45B, 0xDAAFF4, 0x43FFFE, 0xB6F451, 0xF71311, 0x0218BE, 0x9B48B4, 0x6E431B,
+    0x188634, 0xED8D9B, 0x74DD91, 0x81D63E, 0xC0317E, 0x353AD1, 0xAC6ADB, 0x596174,
+    0x9D6939, 0x686296, 0xF1329C, 0x043933, 0x45DE73, 0xB0D5DC, 0x2985D6, 0xDC8E79,
+    0xAA4B56, 0x5F40F9, 0xC610F3, 0x331B5C, 0x72FC1C, 0x87F7B3, 0x1EA7B9, 0xEBAC16,
+    0xF32DE7, 0x062648, 0x9F7642, 0x6A7DED, 0x2B9AAD, 0xDE9102, 0x47C108, 0xB2CAA7,
+    0xC40F88, 0x310427, 0xA8542D, 0x5D5F82, 0x1CB8C2, 0xE9B36D, 0x70E367, 0x85E8C8
+  }
+};
+
 /** Calculate Qualcomm 24-bit Cyclical Redundancy Check (CRC-24Q).
  *
  * The CRC polynomial used is:
@@ -64,6 +307,10 @@ static const u32 crc24qtab[256] = {
  * \f]
  * Mask 0x1864CFB, not reversed, not XOR'd
  *
+ * Eight bytes are processed at a time using the slicing-by-8 method: the CRC
+ * register is folded into the first three bytes of each block and the
+ * contributions of all eight bytes are looked up independently.
+ *
  * \param buf Array of data to calculate CRC for
  * \param len Length of data array
  * \param crc Initial CRC value
@@ -72,6 +319,16 @@ static const u32 crc24qtab[256] = {
  */
 u32 crc24q(const u8 *buf, u32 len, u32 crc)
 {
+  for (; len >= 8; len -= 8, buf += 8) {
+    crc = crc24qtab_slice[6][buf[0] ^ ((crc >> 16) & 0xff)] ^
+          crc24qtab_slice[5][buf[1] ^ ((crc >> 8) & 0xff)] ^
+          crc24qtab_slice[4][buf[2] ^ (crc & 0xff)] ^
+          crc24qtab_slice[3][buf[3]] ^
+          crc24qtab_slice[2][buf[4]] ^
+          crc24qtab_slice[1][buf[5]] ^
+          crc24qtab_slice[0][buf[6]] ^
+          crc24qtab[buf[7]];
+  }
   for (u32 i = 0; i < len; i++)
     crc = ((crc << 8) & 0xFFFFFF) ^ crc24qtab[((crc >> 16) ^ buf[i]) & 0xff];
   return crc;
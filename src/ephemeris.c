@@ -25,6 +25,14 @@
  * Functions and calculations related to the GPS ephemeris.
  * \{ */
 
+/** Newton iterations used to solve Kepler's equation. */
+#define KEPLER_ITERATIONS 2
+/** Largest eccentricity for which Kepler's equation is solved with the fixed
+ * #KEPLER_ITERATIONS, see kepler_ea(). The GPS ICD bounds it at 0.03. */
+#define KEPLER_ECC_MAX 0.03
+/** Bound on the iterations of the fallback solve for larger eccentricities. */
+#define KEPLER_MAX_ITERATIONS 20
+
 /** Calculate satellite position, velocity from xyz ephemeris.
  *
  * References:
@@ -77,6 +85,75 @@ static s8 calc_sat_state_xyz(const ephemeris_t *e, const gps_time_t *t,
   return 0;
 }
 
+/** Rotates the angle whose sine and cosine are `s` and `c` by the small
+ * angle `d`, using Taylor series accurate to double precision for
+ * \f$ |d| < 0.05 \f$.
+ */
+static inline void rotate_small(double d, double *s, double *c)
+{
+  double d2 = d * d;
+  double sin_d = d * (1 - d2 / 6 * (1 - d2 / 20 * (1 - d2 / 42)));
+  double cos_d = 1 - d2 / 2 * (1 - d2 / 12 * (1 - d2 / 30 * (1 - d2 / 56)));
+  double s_next = *s * cos_d + *c * sin_d;
+  *c = *c * cos_d - *s * sin_d;
+  *s = s_next;
+}
+
+/** Solves Kepler's equation \f$ M = E - e \sin E \f$ for the eccentric
+ * anomaly.
+ *
+ * The second order series \f$ E = M + e \sin M + \frac{e^2}{2} \sin 2M \f$
+ * is within \f$ e^3 \f$ of the solution and each Newton step squares the
+ * error, so a fixed number of steps reaches double precision for the
+ * near-circular GPS orbits without a data dependent loop exit. The sine and
+ * cosine of the iterate are carried along by rotating through each step, so
+ * only those of the mean anomaly need a library call.
+ *
+ * The steps are only within the range of rotate_small() for eccentricities up
+ * to #KEPLER_ECC_MAX, above which the equation is iterated to convergence
+ * instead.
+ *
+ * \param ma Mean anomaly [rad]
+ * \param ecc Eccentricity
+ * \param ea Eccentric anomaly [rad]
+ * \param sin_ea Sine of the eccentric anomaly
+ * \param cos_ea Cosine of the eccentric anomaly
+ */
+static void kepler_ea(double ma, double ecc,
+                      double *ea, double *sin_ea, double *cos_ea)
+{
+  if (fabs(ecc) > KEPLER_ECC_MAX) {
+    double e = ma;
+    for (u8 i = 0; i < KEPLER_MAX_ITERATIONS; i++) {
+      double d = (ma - e + ecc * sin(e)) / (1.0 - ecc * cos(e));
+      e += d;
+      if (fabs(d) <= 1.0E-14)
+        break;
+    }
+    *ea = e;
+    *sin_ea = sin(e);
+    *cos_ea = cos(e);
+    return;
+  }
+
+  double s = sin(ma);
+  double c = cos(ma);
+
+  double d = ecc * s * (1.0 + ecc * c);
+  double e = ma + d;
+  rotate_small(d, &s, &c);
+
+  for (u8 i = 0; i < KEPLER_ITERATIONS; i++) {
+    d = (ma - e + ecc * s) / (1.0 - ecc * c);
+    e += d;
+    rotate_small(d, &s, &c);
+  }
+
+  *ea = e;
+  *sin_ea = s;
+  *cos_ea = c;
+}
+
 /** Calculate satellite position, velocity and clock offset from ephemeris.
  *
  * References:
@@ -126,78 +203,77 @@ static s8 calc_sat_state_kepler(const ephemeris_t *e,
   /* Corrected mean anomaly in radians. */
   double ma = k->m0 + ma_dot * dt;
 
-  /* Iteratively solve for the Eccentric Anomaly
-   * (from Keith Alter and David Johnston) */
-  double ea = ma; /* Starting value for E. */
-  double ea_old;
-  double temp;
+  /* Solve Kepler's equation for the Eccentric Anomaly. */
   double ecc = k->ecc;
-  u8 count = 0;
-
-  /* TODO: Implement convergence test using integer difference of doubles,
-   * http://www.cygnus-software.com/papers/comparingfloats/comparingfloats.htm */
-  /* TODO: Bound number of iterations. */
-  do {
-    ea_old = ea;
-    temp = 1.0 - ecc * cos(ea_old);
-    ea = ea + (ma - ea_old + ecc * sin(ea_old)) / temp;
-    count++;
-    if (count > 5)
-      break;
-  } while (fabs(ea - ea_old) > 1.0E-14);
+  double ea, sin_ea, cos_ea;
+  kepler_ea(ma, ecc, &ea, &sin_ea, &cos_ea);
+  double temp = 1.0 - ecc * cos_ea;
 
   double ea_dot = ma_dot / temp;
 
   /* Relativistic correction term. */
-  double einstein = GPS_F * ecc * k->sqrta * sin(ea);
+  double einstein = GPS_F * ecc * k->sqrta * sin_ea;
   *clock_err += einstein;
 
   /* Begin calc for True Anomaly and Argument of Latitude */
   double temp2 = sqrt(1.0 - ecc * ecc);
+  double sin_ta = temp2 * sin_ea / temp;
+  double cos_ta = (cos_ea - ecc) / temp;
   /* Argument of Latitude = True Anomaly + Argument of Perigee. */
-  double al = atan2(temp2 * sin(ea), cos(ea) - ecc) + k->w;
+  double sin_w = sin(k->w);
+  double cos_w = cos(k->w);
+  double sin_al = sin_ta * cos_w + cos_ta * sin_w;
+  double cos_al = cos_ta * cos_w - sin_ta * sin_w;
   double al_dot = temp2 * ea_dot / temp;
+  double sin_2al = 2.0 * sin_al * cos_al;
+  double cos_2al = (cos_al - sin_al) * (cos_al + sin_al);
 
   /* Calculate corrected argument of latitude based on position. */
-  double cal = al + k->cus * sin(2.0 * al) + k->cuc * cos(2.0 * al);
-  double cal_dot = al_dot * (1.0 + 2.0 * (k->cus * cos(2.0 * al)
-                                          - k->cuc * sin(2.0 * al)));
+  double sin_cal = sin_al;
+  double cos_cal = cos_al;
+  rotate_small(k->cus * sin_2al + k->cuc * cos_2al, &sin_cal, &cos_cal);
+  double cal_dot = al_dot * (1.0 + 2.0 * (k->cus * cos_2al
+                                          - k->cuc * sin_2al));
 
   /* Calculate corrected radius based on argument of latitude. */
-  double r = a * temp + k->crc * cos(2.0 * al) + k->crs * sin(2.0 * al);
-  double r_dot = a * ecc * sin(ea) * ea_dot
-                 + 2.0 * al_dot * (k->crs * cos(2.0 * al)
-                                   - k->crc * sin(2.0 * al));
+  double r = a * temp + k->crc * cos_2al + k->crs * sin_2al;
+  double r_dot = a * ecc * sin_ea * ea_dot
+                 + 2.0 * al_dot * (k->crs * cos_2al
+                                   - k->crc * sin_2al);
 
   /* Calculate inclination based on argument of latitude. */
-  double inc = k->inc + k->inc_dot * dt + k->cic * cos(2.0 * al)
-               + k->cis * sin(2.0 * al);
+  double inc = k->inc + k->inc_dot * dt + k->cic * cos_2al
+               + k->cis * sin_2al;
   double inc_dot = k->inc_dot
-                   + 2.0 * al_dot * (k->cis * cos(2.0 * al)
-                                     - k->cic * sin(2.0 * al));
+                   + 2.0 * al_dot * (k->cis * cos_2al
+                                     - k->cic * sin_2al);
+  double sin_inc = sin(inc);
+  double cos_inc = cos(inc);
 
   /* Calculate position and velocity in orbital plane. */
-  double x = r * cos(cal);
-  double y = r * sin(cal);
-  double x_dot = r_dot * cos(cal) - y * cal_dot;
-  double y_dot = r_dot * sin(cal) + x * cal_dot;
+  double x = r * cos_cal;
+  double y = r * sin_cal;
+  double x_dot = r_dot * cos_cal - y * cal_dot;
+  double y_dot = r_dot * sin_cal + x * cal_dot;
 
   /* Corrected longitude of ascenting node. */
   double om_dot = k->omegadot - GPS_OMEGAE_DOT;
   double om = k->omega0 + dt * om_dot - GPS_OMEGAE_DOT * e->toe.tow;
+  double sin_om = sin(om);
+  double cos_om = cos(om);
 
   /* Compute the satellite's position in Earth-Centered Earth-Fixed
    * coordiates. */
-  pos[0] = x * cos(om) - y * cos(inc) * sin(om);
-  pos[1] = x * sin(om) + y * cos(inc) * cos(om);
-  pos[2] = y * sin(inc);
+  pos[0] = x * cos_om - y * cos_inc * sin_om;
+  pos[1] = x * sin_om + y * cos_inc * cos_om;
+  pos[2] = y * sin_inc;
 
   /* Compute the satellite's velocity in Earth-Centered Earth-Fixed
    * coordiates. */
-  temp = y_dot * cos(inc) - y * sin(inc) * inc_dot;
-  vel[0] = -om_dot * pos[1] + x_dot * cos(om) - temp * sin(om);
-  vel[1] = om_dot * pos[0] + x_dot * sin(om) + temp * cos(om);
-  vel[2] = y * cos(inc) * inc_dot + y_dot * sin(inc);
+  temp = y_dot * cos_inc - y * sin_inc * inc_dot;
+  vel[0] = -om_dot * pos[1] + x_dot * cos_om - temp * sin_om;
+  vel[1] = om_dot * pos[0] + x_dot * sin_om + temp * cos_om;
+  vel[2] = y * cos_inc * inc_dot + y_dot * sin_inc;
 
   return 0;
 }
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <math.h>
+
+#include <libswiftnav/fft.h>
+
+/** \defgroup fft FFT
+ * Mixed radix complex FFT.
+ *
+ * A decimation in time, mixed radix FFT for any transform length whose prime
+ * factors are at most #FFT_MAX_RADIX, in the style of KISS FFT. Radix 2, 3
+ * and 4 stages have dedicated butterflies, other factors use a generic
+ * O(p^2) butterfly so lengths with large prime factors are supported but
+ * slower. The transforms are not scaled.
+ *
+ * The plan does not allocate memory, the caller provides storage for the
+ * twiddle factors.
+ * \{ */
+
+static inline fft_cpx_t cmul(fft_cpx_t a, fft_cpx_t b)
+{
+  fft_cpx_t r = {a.re*b.re - a.im*b.im, a.re*b.im + a.im*b.re};
+  return r;
+}
+
+static inline fft_cpx_t cadd(fft_cpx_t a, fft_cpx_t b)
+{
+  fft_cpx_t r = {a.re + b.re, a.im + b.im};
+  return r;
+}
+
+static inline fft_cpx_t csub(fft_cpx_t a, fft_cpx_t b)
+{
+  fft_cpx_t r = {a.re - b.re, a.im - b.im};
+  return r;
+}
+
+/** Initialise an FFT plan.
+ *
+ * \param p        Plan to initialise.
+ * \param n        Transform length.
+ * \param twiddles Storage for `n` twiddle factors, owned by the plan.
+ * \return `0` on success, `<0` if `n` has a prime factor larger than
+ *         #FFT_MAX_RADIX or too many factors.
+ */
+s8 fft_plan_init(fft_plan_t *p, u32 n, fft_cpx_t *twiddles)
+{
+  if (n == 0 || !twiddles)
+    return -1;
+
+  p->n = n;
+  p->twiddles = twiddles;
+  for (u32 i = 0; i < n; i++) {
+    double phase = -2 * M_PI * i / n;
+    twiddles[i].re = cos(phase);
+    twiddles[i].im = sin(phase);
+  }
+
+  /* Factor out 4s first, then 2s, then odd factors. */
+  u32 radix = 4;
+  u32 m = n;
+  u32 n_factors = 0;
+  while (m > 1) {
+    while (m % radix) {
+      switch (radix) {
+      case 4: radix = 2; break;
+      case 2: radix = 3; break;
+      default: radix += 2; break;
+      }
+      if (radix > FFT_MAX_RADIX || radix * radix > m)
+        radix = m;
+    }
+    if (radix > FFT_MAX_RADIX || n_factors >= FFT_MAX_FACTORS)
+      return -2;
+    m /= radix;
+    p->factors[2*n_factors] = radix;
+    p->factors[2*n_factors + 1] = m;
+    n_factors++;
+  }
+  if (n == 1) {
+    p->factors[0] = 1;
+    p->factors[1] = 1;
+  }
+  return 0;
+}
+
+static void bfly2(fft_cpx_t *out, u32 fstride, const fft_plan_t *p, u32 m)
+{
+  const fft_cpx_t *tw = p->twiddles;
+  for (u32 k = 0; k < m; k++) {
+    fft_cpx_t t = cmul(out[m + k], tw[k*fstride]);
+    out[m + k] = csub(out[k], t);
+    out[k] = cadd(out[k], t);
+  }
+}
+
+static void bfly3(fft_cpx_t *out, u32 fstride, const fft_plan_t *p, u32 m)
+{
+  const fft_cpx_t *tw = p->twiddles;
+  float epi3 = tw[fstride*m].im;
+  for (u32 k = 0; k < m; k++) {
+    fft_cpx_t s1 = cmul(out[m + k], tw[k*fstride]);
+    fft_cpx_t s2 = cmul(out[2*m + k], tw[2*k*fstride]);
+    fft_cpx_t s3 = cadd(s1, s2);
+    fft_cpx_t s0 = csub(s1, s2);
+    out[m + k].re = out[k].re - 0.5f*s3.re;
+    out[m + k].im = out[k].im - 0.5f*s3.im;
+    s0.re *= epi3;
+    s0.im *= epi3;
+    out[k] = cadd(out[k], s3);
+    out[2*m + k].re = out[m + k].re + s0.im;
+    out[2*m + k].im = out[m + k].im - s0.re;
+    out[m + k].re -= s0.im;
+    out[m + k].im += s0.re;
+  }
+}
+
+static void bfly4(fft_cpx_t *out, u32 fstride, const fft_plan_t *p, u32 m)
+{
+  const fft_cpx_t *tw = p->twiddles;
+  for (u32 k = 0; k < m; k++) {
+    fft_cpx_t s0 = cmul(out[m + k], tw[k*fstride]);
+    fft_cpx_t s1 = cmul(out[2*m + k], tw[2*k*fstride]);
+    fft_cpx_t s2 = cmul(out[3*m + k], tw[3*k*fstride]);
+    fft_cpx_t s5 = csub(out[k], s1);
+    out[k] = cadd(out[k], s1);
+    fft_cpx_t s3 = cadd(s0, s2);
+    fft_cpx_t s4 = csub(s0, s2);
+    out[2*m + k] = csub(out[k], s3);
+    out[k] = cadd(out[k], s3);
+    out[m + k].re = s5.re + s4.im;
+    out[m + k].im = s5.im - s4.re;
+    out[3*m + k].re = s5.re - s4.im;
+    out[3*m + k].im = s5.im + s4.re;
+  }
+}
+
+static void bfly_generic(fft_cpx_t *out, u32 fstride, const fft_plan_t *p,
+                         u32 m, u32 radix)
+{
+  const fft_cpx_t *tw = p->twiddles;
+  fft_cpx_t scratch[FFT_MAX_RADIX];
+
+  for (u32 u = 0; u < m; u++) {
+    for (u32 q = 0, k = u; q < radix; q++, k += m)
+      scratch[q] = out[k];
+
+    for (u32 q1 = 0, k = u; q1 < radix; q1++, k += m) {
+      u32 twstep = (u64)fstride * k % p->n;
+      u32 twidx = 0;
+      out[k] = scratch[0];
+      for (u32 q = 1; q < radix; q++) {
+        twidx += twstep;
+        if (twidx >= p->n)
+          twidx -= p->n;
+        out[k] = cadd(out[k], cmul(scratch[q], tw[twidx]));
+      }
+    }
+  }
+}
+
+static void fft_work(const fft_plan_t *p, fft_cpx_t *out, const fft_cpx_t *in,
+                     u32 fstride, const u32 *factors)
+{
+  u32 radix = factors[0];
+  u32 m = factors[1];
+  fft_cpx_t *out_end = out + radix*m;
+
+  if (m == 1) {
+    for (fft_cpx_t *o = out; o != out_end; o++, in += fstride)
+      *o = *in;
+  } else {
+    for (fft_cpx_t *o = out; o != out_end; o += m, in += fstride)
+      fft_work(p, o, in, fstride*radix, factors + 2);
+  }
+
+  switch (radix) {
+  case 1: break;
+  case 2: bfly2(out, fstride, p, m); break;
+  case 3: bfly3(out, fstride, p, m); break;
+  case 4: bfly4(out, fstride, p, m); break;
+  default: bfly_generic(out, fstride, p, m, radix); break;
+  }
+}
+
+/** Forward FFT.
+ * \f[
+ *   X_k = \sum_{n=0}^{N-1} x_n e^{-2 \pi i k n / N}
+ * \f]
+ *
+ * \param p   Plan from fft_plan_init().
+ * \param in  Input, `p->n` elements.
+ * \param out Output, `p->n` elements, must not overlap `in`.
+ */
+void fft_forward(const fft_plan_t *p, const fft_cpx_t *in, fft_cpx_t *out)
+{
+  fft_work(p, out, in, 1, p->factors);
+}
+
+/** Inverse FFT, without the \f$1/N\f$ scaling.
+ * Computed as the conjugate of the forward transform of the conjugate.
+ *
+ * \param p   Plan from fft_plan_init().
+ * \param in  Input, `p->n` elements, conjugated in place.
+ * \param out Output, `p->n` elements, must not overlap `in`.
+ */
+void fft_inverse(const fft_plan_t *p, fft_cpx_t *in, fft_cpx_t *out)
+{
+  for (u32 i = 0; i < p->n; i++)
+    in[i].im = -in[i].im;
+  fft_work(p, out, in, 1, p->factors);
+  for (u32 i = 0; i < p->n; i++)
+    out[i].im = -out[i].im;
+}
+
+/** \} */
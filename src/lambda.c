@@ -16,8 +16,6 @@
 
 #include <string.h>
 #include <math.h>
-#include <cblas.h>
-#include <clapack.h>
 
 #include <libswiftnav/linear_algebra.h>
 #include <libswiftnav/amb_kf.h>
@@ -27,6 +25,8 @@
 /* constants/macros ----------------------------------------------------------*/
 
 #define LOOPMAX     10000           /* maximum count of search loop */
+#define POLLNODES   64              /* search loops between budget polls */
+#define NMAX        LAMBDA_MAX_DIM  /* maximum number of float parameters */
 
 #define SGN(x)      ((x)<=0.0?-1.0:1.0)
 #define ROUND(x)    (floor((x)+0.5))
@@ -37,7 +37,7 @@ static int LD(int n, const double *Q, double *L, double *D)
 {
     int i,j,k,info=0;
     double a;
-    double A[n*n];
+    double A[NMAX*NMAX];
     memset(L, 0, sizeof(double)*n*n);
     memset(D, 0, sizeof(double)*n);
 
@@ -52,24 +52,27 @@ static int LD(int n, const double *Q, double *L, double *D)
     if (info) {
         log_error("%s : LD factorization error, trying UD from Gibbs "
                   "(col major UD = LD)", __FILE__);
-        double Qcopy[n * n];
-        memcpy(Qcopy, Q, n * n * sizeof(double));
-        matrix_udu(n, Qcopy, L, D);
+        memcpy(A, Q, n * n * sizeof(double));
+        matrix_udu(n, A, L, D);
     }
     return info;
 }
-/* integer gauss transformation ----------------------------------------------*/
-static void gauss(int n, double *L, double *Z, int i, int j)
+/* integer gauss transformation (Zi=inv(Z)), returns 1 if L changed --------*/
+static int gauss(int n, double *L, double *Z, double *Zi, int i, int j)
 {
     int k,mu;
 
     if ((mu=(int)ROUND(L[i+j*n]))!=0) {
         for (k=i;k<n;k++) L[k+n*j]-=(double)mu*L[k+i*n];
         for (k=0;k<n;k++) Z[k+n*j]-=(double)mu*Z[k+i*n];
+        for (k=0;k<n;k++) Zi[i+n*k]+=(double)mu*Zi[j+n*k];
+        return 1;
     }
+    return 0;
 }
 /* permutations --------------------------------------------------------------*/
-static void perm(int n, double *L, double *D, int j, double del, double *Z)
+static void perm(int n, double *L, double *D, int j, double del, double *Z,
+                 double *Zi)
 {
     int k;
     double eta,lam,a0,a1;
@@ -85,48 +88,69 @@ static void perm(int n, double *L, double *D, int j, double del, double *Z)
     L[j+1+j*n]=lam;
     for (k=j+2;k<n;k++) SWAP(L[k+j*n],L[k+(j+1)*n]);
     for (k=0;k<n;k++) SWAP(Z[k+j*n],Z[k+(j+1)*n]);
+    for (k=0;k<n;k++) SWAP(Zi[j+k*n],Zi[j+1+k*n]);
 }
-/* lambda reduction (z=Z'*a, Qz=Z'*Q*Z=L'*diag(D)*L) (ref.[1]) ---------------*/
-static void reduction(int n, double *L, double *D, double *Z)
+/* lambda reduction (z=Z'*a, Qz=Z'*Q*Z=L'*diag(D)*L) (ref.[1]) ---------------
+* return : number of gauss transformations and permutations applied
+*-----------------------------------------------------------------------------*/
+static unsigned int reduction(int n, double *L, double *D, double *Z,
+                              double *Zi)
 {
     int i,j,k;
+    unsigned int steps=0;
     double del;
 
     j=n-2; k=n-2;
     while (j>=0) {
-        if (j<=k) for (i=j+1;i<n;i++) gauss(n,L,Z,i,j);
+        if (j<=k) for (i=j+1;i<n;i++) steps+=gauss(n,L,Z,Zi,i,j);
         del=D[j]+L[j+1+j*n]*L[j+1+j*n]*D[j+1];
         if (del+1E-6<D[j+1]) { /* compared considering numerical error */
-            perm(n,L,D,j,del,Z);
+            perm(n,L,D,j,del,Z,Zi);
+            steps++;
             k=j; j=n-2;
         }
         else j--;
     }
+    return steps;
+}
+/* check search budget -------------------------------------------------------*/
+static int expired(const lambda_budget_t *budget, unsigned int nodes)
+{
+    if (nodes>=budget->max_nodes) return 1;
+    if (budget->expired&&nodes%POLLNODES==0) return budget->expired(budget->ctx);
+    return 0;
 }
-/* modified lambda (mlambda) search (ref. [2]) -------------------------------*/
-static int search(int n, int m, const double *L, const double *D,
-                  const double *zs, double *zn, double *s)
+/* modified lambda (mlambda) search (ref. [2]) -------------------------------
+* L is stored with leading dimension ld, so that the search can run on the
+* trailing block of a larger factorization. The best candidates found so far
+* are kept in zn and s, m of them once the search has found that many.
+* return : 0:search complete, 1:stopped by budget
+*-----------------------------------------------------------------------------*/
+static int search(int n, int ld, int m, const double *L, const double *D,
+                  const double *zs, double *zn, double *s,
+                  lambda_budget_t *budget, int *nfound)
 {
-    int i,j,k,c,nn=0,imax=0;
+    int i,j,k,nn=0,imax=0,ret=0;
     double newdist,maxdist=1E99,y;
-    double S[n*n];
-    double dist[n];
-    double zb[n];
-    double z[n];
-    double step[n];
-    memset(S, 0, sizeof(double)*n*n);
+    double S[NMAX*NMAX];
+    double dist[NMAX];
+    double zb[NMAX];
+    double z[NMAX];
+    double step[NMAX];
+    memset(S, 0, sizeof(S));
 
     k=n-1; dist[k]=0.0;
     zb[k]=zs[k];
     z[k]=ROUND(zb[k]); y=zb[k]-z[k]; step[k]=SGN(y);
-    for (c=0;c<LOOPMAX;c++) {
+    for (;;budget->nodes++) {
+        if (expired(budget,budget->nodes)) {ret=1; break;}
         newdist=dist[k]+y*y/D[k];
         if (newdist<maxdist) {
             if (k!=0) {
                 dist[--k]=newdist;
                 for (i=0;i<=k;i++)
-                    S[k+i*n]=S[k+1+i*n]+(z[k+1]-zb[k+1])*L[k+1+i*n];
-                zb[k]=zs[k]+S[k+k*n];
+                    S[k+i*NMAX]=S[k+1+i*NMAX]+(z[k+1]-zb[k+1])*L[k+1+i*ld];
+                zb[k]=zs[k]+S[k+k*NMAX];
                 z[k]=ROUND(zb[k]); y=zb[k]-z[k]; step[k]=SGN(y);
             }
             else {
@@ -134,6 +158,7 @@ static int search(int n, int m, const double *L, const double *D,
                     if (nn==0||newdist>s[imax]) imax=nn;
                     for (i=0;i<n;i++) zn[i+nn*n]=z[i];
                     s[nn++]=newdist;
+                    if (nn==m) maxdist=s[imax];
                 }
                 else {
                     if (newdist<s[imax]) {
@@ -154,17 +179,76 @@ static int search(int n, int m, const double *L, const double *D,
             }
         }
     }
-    for (i=0;i<m-1;i++) { /* sort by s */
-        for (j=i+1;j<m;j++) {
+    for (i=0;i<nn-1;i++) { /* sort by s */
+        for (j=i+1;j<nn;j++) {
             if (s[i]<s[j]) continue;
             SWAP(s[i],s[j]);
             for (k=0;k<n;k++) SWAP(zn[k+i*n],zn[k+j*n]);
         }
     }
+    *nfound=nn;
+    return ret;
+}
 
-    if (c>=LOOPMAX) {
-        log_error("LAMBDA search loop count overflow");
-        return -1;
+/* initialize lambda reduction state -----------------------------------------
+* forget any previous reduction, so that the next update starts cold. call
+* when the parameters change, e.g. when the satellite set changes.
+* args   : lambda_reduction_t *r O reduction state
+*-----------------------------------------------------------------------------*/
+void lambda_reduction_init(lambda_reduction_t *r)
+{
+    r->n=0;
+    r->steps=r->cold_steps=r->steps_saved=0;
+}
+
+/* warm started lambda reduction -----------------------------------------------
+* LD factorization and lambda reduction of Q. if the previous reduction in r
+* has the same dimension, its transformation Z is applied to Q first and the
+* reduction resumes from Z'*Q*Z, which for a slowly changing Q needs few or no
+* further steps. otherwise, or if the factorization of Z'*Q*Z fails, the
+* reduction starts from the identity.
+* args   : lambda_reduction_t *r IO reduction state
+*          int    n      I  number of float parameters (n <= LAMBDA_MAX_DIM)
+*          double *Q     I  covariance matrix of float parameters (n x n)
+* return : status (0:ok,other:error)
+* notes  : matrix stored by column-major order (fortran convension)
+*-----------------------------------------------------------------------------*/
+int lambda_reduction_update(lambda_reduction_t *r, int n, const double *Q)
+{
+    int i,j,k,info,cold=r->n!=n;
+    double A[NMAX*NMAX],B[NMAX*NMAX];
+
+    if (n<=0||n>NMAX) return -1;
+
+    if (!cold) {
+        for (i=0;i<n;i++) for (j=0;j<n;j++) { /* B=Q*Z */
+            B[i+j*n]=0.0;
+            for (k=0;k<n;k++) B[i+j*n]+=Q[i+k*n]*r->Z[k+j*n];
+        }
+        for (i=0;i<n;i++) for (j=0;j<=i;j++) { /* A=Z'*B */
+            A[i+j*n]=0.0;
+            for (k=0;k<n;k++) A[i+j*n]+=r->Z[k+i*n]*B[k+j*n];
+            A[j+i*n]=A[i+j*n];
+        }
+        cold=LD(n,A,r->L,r->D)!=0;
+    }
+    if (cold) {
+        memset(r->Z,0,sizeof(double)*n*n);
+        memset(r->Zi,0,sizeof(double)*n*n);
+        for (i=0;i<n;i++) r->Z[i+n*i]=r->Zi[i+n*i]=1;
+        if ((info=LD(n,Q,r->L,r->D))) {
+            r->n=0;
+            return info;
+        }
+    }
+    r->n=n;
+    r->steps=reduction(n,r->L,r->D,r->Z,r->Zi);
+    if (cold) {
+        r->cold_steps=r->steps;
+        r->steps_saved=0;
+    }
+    else {
+        r->steps_saved=r->cold_steps>r->steps?r->cold_steps-r->steps:0;
     }
     return 0;
 }
@@ -172,7 +256,7 @@ static int search(int n, int m, const double *L, const double *D,
 /* lambda reduction transformation ------------------------------
 * integer least-square estimation. reduction is performed by lambda (ref.[1]),
 * and search by mlambda (ref.[2]).
-* args   : int    n      I  number of float parameters
+* args   : int    n      I  number of float parameters (n <= LAMBDA_MAX_DIM)
 *          double *a     I  float parameters (n x 1)
 *          double *Q     I  covariance matrix of float parameters (n x n)
 * return : status (0:ok,other:error)
@@ -181,78 +265,100 @@ static int search(int n, int m, const double *L, const double *D,
 int lambda_reduction(int n, const double *Q, double *Z)
 {
     int info;
+    lambda_reduction_t r;
 
-    if (n<=0) return -1;
-
-    double L[n*n];
-    double D[n];
-
-    /* L = zeros(n,n) */
-    memset(L, 0, sizeof(double)*n*n);
+    lambda_reduction_init(&r);
+    info=lambda_reduction_update(&r,n,Q);
+    if (n>0&&n<=NMAX) memcpy(Z,r.Z,sizeof(double)*n*n); /* eye(n) on error */
+    return info;
+}
 
-    /* Z = eye(n) */
-    memset(Z, 0, sizeof(double)*n*n);
-    for (int i=0; i<n; i++)
-      Z[i+n*i] = 1;
+/* decorrelated float parameters z=Z'*a ---------------------------------------*/
+static void decorrelate(const lambda_reduction_t *r, const double *a,
+                        double *z)
+{
+    int i,j,n=r->n;
 
-    /* LD factorization */
-    if (!(info=LD(n,Q,L,D))) {
-        /* lambda reduction */
-        reduction(n,L,D,Z);
+    for (i=0;i<n;i++) {
+        z[i]=0.0;
+        for (j=0;j<n;j++) z[i]+=r->Z[j+i*n]*a[j];
     }
-
-    return info;
 }
 
-/* multiply matrix (wrapper of blas dgemm) -------------------------------------
-* multiply matrix by matrix (C=alpha*A*B+beta*C)
-* args   : char   *tr       I  transpose flags ("N":normal,"T":transpose)
-*          int    n,k,m     I  size of (transposed) matrix A,B
-*          double alpha     I  alpha
-*          double *A,*B     I  (transposed) matrix A (n x m), B (m x k)
-*          double beta      I  beta
-*          double *C        IO matrix C (n x k)
-* return : none
+/* lambda/mlambda search on a reduction ---------------------------------------
+* integer least-square estimation with the float parameter covariance already
+* reduced by lambda_reduction_update(), with the search limited by a budget of
+* search loops and optionally a caller's clock. if the budget runs out, the
+* best candidates found so far are returned, which may be fewer than m.
+* args : lambda_reduction_t *r I reduction of the covariance of a
+* int m I number of fixed solutions
+* double *a I float parameters (n x 1)
+* lambda_budget_t *budget IO search budget, nodes set to the loops used
+* double *F O fixed solutions (n x m)
+* double *s O sum of squared residulas of fixed solutions (1 x m)
+* int *nfound O number of fixed solutions found
+* return : status (0:ok,1:budget exhausted,other:error)
+* notes : matrix stored by column-major order (fortran convension)
 *-----------------------------------------------------------------------------*/
-static void matmul(const char *tr, integer n, integer k, integer m, double alpha,
-                   const double *A, const double *B, double beta, double *C)
+int lambda_solution_reduced(const lambda_reduction_t *r, int m,
+                            const double *a, lambda_budget_t *budget,
+                            double *F, double *s, int *nfound)
 {
-    integer lda=tr[0]=='T'?m:n,ldb=tr[1]=='T'?k:m;
+    int i,j,k,info,n=r->n;
+    double z[NMAX],f[NMAX];
+
+    budget->nodes=0;
+    *nfound=0;
+    if (n<=0||m<=0) return -1;
+
+    decorrelate(r,a,z);
+
+    /* mlambda search, candidates stored in F */
+    info=search(n,n,m,r->L,r->D,z,F,s,budget,nfound);
 
-    dgemm_((char *)tr,(char *)tr+1,&n,&k,&m,&alpha,(double *)A,&lda,(double *)B,
-           &ldb,&beta,C,&n);
+    for (k=0;k<*nfound;k++) { /* F=Z'\E=Zi'*E */
+        for (i=0;i<n;i++) {
+            f[i]=0.0;
+            for (j=0;j<n;j++) f[i]+=r->Zi[j+i*n]*F[j+k*n];
+        }
+        memcpy(F+k*n,f,sizeof(double)*n);
+    }
+    return info;
 }
 
-/* solve linear equation -------------------------------------------------------
-* solve linear equation (X=A\Y or X=A'\Y)
-* args   : char   *tr       I   transpose flag ("N":normal,"T":transpose)
-*          double *A        I   input matrix A (n x n)
-*          double *Y        I   input matrix Y (n x m)
-*          int    n,m       I   size of matrix A,Y
-*          double *X        O   X=A\Y or X=A'\Y (n x m)
-* return : status (0:ok,0>:error)
-* notes  : matirix stored by column-major order (fortran convention)
-*          X can be same as Y
+/* bounded lambda/mlambda integer least-square estimation ----------------------
+* as lambda_solution(), with the search limited by a budget as for
+* lambda_solution_reduced().
+* args : int n I number of float parameters (n <= LAMBDA_MAX_DIM)
+* int m I number of fixed solutions
+* double *a I float parameters (n x 1)
+* double *Q I covariance matrix of float parameters (n x n)
+* lambda_budget_t *budget IO search budget, nodes set to the loops used
+* double *F O fixed solutions (n x m)
+* double *s O sum of squared residulas of fixed solutions (1 x m)
+* int *nfound O number of fixed solutions found
+* return : status (0:ok,1:budget exhausted,other:error)
+* notes : matrix stored by column-major order (fortran convension)
 *-----------------------------------------------------------------------------*/
-static int solve(const char *tr, const double *A, const double *Y, integer n,
-                 integer m, double *X)
+int lambda_solution_bounded(int n, int m, const double *a, const double *Q,
+                            lambda_budget_t *budget, double *F, double *s,
+                            int *nfound)
 {
-    double B[n*n];
-    integer info;
-    integer ipiv[n];
-
-    memcpy(B, A, sizeof(double)*n*n);
-    memcpy(X, Y, sizeof(double)*n*m);
-    dgetrf_(&n,&n,B,&n,ipiv,&info);
-    if (!info) dgetrs_((char *)tr,&n,&m,B,&n,ipiv,X,&n,&info);
-    return info;
+    int info;
+    lambda_reduction_t r;
+
+    budget->nodes=0;
+    *nfound=0;
+    lambda_reduction_init(&r);
+    if (m<=0) return -1;
+    if ((info=lambda_reduction_update(&r,n,Q))) return info;
+    return lambda_solution_reduced(&r,m,a,budget,F,s,nfound);
 }
 
-
 /* lambda/mlambda integer least-square estimation ------------------------------
 * integer least-square estimation. reduction is performed by lambda (ref.[1]),
 * and search by mlambda (ref.[2]).
-* args : int n I number of float parameters
+* args : int n I number of float parameters (n <= LAMBDA_MAX_DIM)
 * int m I number of fixed solutions
 * double *a I float parameters (n x 1)
 * double *Q I covariance matrix of float parameters (n x n)
@@ -264,35 +370,107 @@ static int solve(const char *tr, const double *A, const double *Y, integer n,
 int lambda_solution(int n, int m, const double *a, const double *Q, double *F,
                   double *s)
 {
-    int info;
-
-    if (n<=0||m<=0) return -1;
-    double L[n*n];
-    double D[n];
-    double Z[n*n];
-    double z[n];
-    double E[n*m];
+    int info,nfound;
+    lambda_budget_t budget={LOOPMAX,NULL,NULL,0};
 
-    /* L = zeros(n,n) */
-    memset(L, 0, sizeof(double)*n*n);
+    info=lambda_solution_bounded(n,m,a,Q,&budget,F,s,&nfound);
+    if (info==1) {
+        log_error("LAMBDA search loop count overflow");
+        return -1;
+    }
+    return info;
+}
 
-    /* Z = eye(n) */
-    memset(Z, 0, sizeof(double)*n*n);
-    for (int i=0; i<n; i++)
-      Z[i+n*i] = 1;
+/* partial lambda ambiguity resolution on a reduction -------------------------
+* fix the largest subset of the decorrelated ambiguities that can be fixed
+* reliably. after reduction the decorrelated ambiguities are searched from the
+* most precise, so the candidate subsets are the trailing ones of z. the
+* largest subset whose bootstrapped success rate reaches p0 is searched first,
+* then smaller ones until the best candidate passes the ratio test against the
+* second best. a search stopped by the budget is not trusted and ends the
+* attempt. the float parameters are then conditioned on the fixed subset.
+* args : lambda_reduction_t *r I reduction of Q
+* double *a I float parameters (n x 1)
+* double *Q I covariance matrix of float parameters (n x n)
+* double p0 I minimum bootstrapped success rate of the fixed subset
+* double ratio I minimum ratio of the second best to best residuals
+* lambda_budget_t *budget IO search budget shared by all subsets tried
+* double *b O float parameters conditioned on the fixed subset (n x 1),
+*             equal to the integer solution if all are fixed
+* int *nfixed O number of decorrelated ambiguities fixed, 0 if none
+* return : status (0:ok,other:error)
+*-----------------------------------------------------------------------------*/
+int lambda_partial_reduced(const lambda_reduction_t *r, const double *a,
+                           const double *Q, double p0, double ratio,
+                           lambda_budget_t *budget, double *b, int *nfixed)
+{
+    int i,j,k,nf=0,nfound,n=r->n;
+    const double *L=r->L,*D=r->D,*Z=r->Z;
+    double z[NMAX],E[NMAX*2],s[2],x[NMAX],w[NMAX],ps=1.0;
 
-    /* LD factorization */
-    if (!(info=LD(n,Q,L,D))) {
+    budget->nodes=0;
+    *nfixed=0;
+    if (n<=0) return -1;
+    memcpy(b,a,sizeof(double)*n);
 
-        /* lambda reduction */
-        reduction(n,L,D,Z);
-        matmul("TN",n,1,n,1.0,Z,a,0.0,z); /* z=Z'*a */
+    decorrelate(r,a,z);
 
-        /* mlambda search */
-        if (!(info=search(n,m,L,D,z,E,s))) {
+    /* largest trailing subset with enough bootstrapped success rate */
+    for (k=n;k>0;k--) {
+        ps*=erf(1.0/(2.0*sqrt(2.0*D[k-1])));
+        if (ps<p0) break;
+    }
+    for (;k<n;k++) {
+        nf=n-k;
+        if (search(nf,n,2,L+k+k*n,D+k,z+k,E,s,budget,&nfound)) return 0;
+        if (nfound==2&&s[1]>=ratio*s[0]) break;
+    }
+    if (k==n) return 0;
 
-            info=solve("T",Z,E,n,m,F); /* F=Z'\E */
-        }
+    /* x=Qzf\(zf-E), Qzf=Lf'*diag(Df)*Lf */
+    for (i=nf-1;i>=0;i--) {
+        x[i]=z[k+i]-E[i];
+        for (j=i+1;j<nf;j++) x[i]-=L[k+j+(k+i)*n]*x[j];
     }
-    return info;
+    for (i=0;i<nf;i++) x[i]/=D[k+i];
+    for (i=0;i<nf;i++) {
+        for (j=0;j<i;j++) x[i]-=L[k+i+(k+j)*n]*x[j];
+    }
+    /* b=a-Q*Zf*x */
+    for (i=0;i<n;i++) {
+        w[i]=0.0;
+        for (j=0;j<nf;j++) w[i]+=Z[i+(k+j)*n]*x[j];
+    }
+    for (i=0;i<n;i++) {
+        for (j=0;j<n;j++) b[i]-=Q[i+j*n]*w[j];
+    }
+    *nfixed=nf;
+    return 0;
+}
+
+/* partial lambda ambiguity resolution -----------------------------------------
+* as lambda_partial_reduced(), reducing Q first.
+* args : int n I number of float parameters (n <= LAMBDA_MAX_DIM)
+* double *a I float parameters (n x 1)
+* double *Q I covariance matrix of float parameters (n x n)
+* double p0 I minimum bootstrapped success rate of the fixed subset
+* double ratio I minimum ratio of the second best to best residuals
+* lambda_budget_t *budget IO search budget shared by all subsets tried
+* double *b O float parameters conditioned on the fixed subset (n x 1),
+*             equal to the integer solution if all are fixed
+* int *nfixed O number of decorrelated ambiguities fixed, 0 if none
+* return : status (0:ok,other:error)
+*-----------------------------------------------------------------------------*/
+int lambda_partial(int n, const double *a, const double *Q, double p0,
+                   double ratio, lambda_budget_t *budget, double *b,
+                   int *nfixed)
+{
+    int info;
+    lambda_reduction_t r;
+
+    budget->nodes=0;
+    *nfixed=0;
+    lambda_reduction_init(&r);
+    if ((info=lambda_reduction_update(&r,n,Q))) return info;
+    return lambda_partial_reduced(&r,a,Q,p0,ratio,budget,b,nfixed);
 }
@@ -26,6 +26,45 @@ inline static node_t *get_node_n(memory_pool_t *pool, node_t *head, u32 n)
   return (node_t *)((u8 *)head + calc_node_size(pool->element_size) * n);
 }
 
+/* In compact mode the elements are stored contiguously, in collection order,
+ * at the start of the pool buffer. The space the node headers would occupy
+ * is used as scratch space for two u16 index arrays when sorting. */
+inline static element_t *get_elem_n(memory_pool_t *pool, u32 n)
+{
+  return (element_t *)pool->pool + pool->element_size * n;
+}
+
+inline static u8 *get_scratch(memory_pool_t *pool)
+{
+  return (u8 *)pool->pool + pool->element_size * pool->n_elements;
+}
+
+/* Scratch indices may be unaligned, access them with memcpy. */
+inline static u16 get_index(const u8 *idx, u32 n)
+{
+  u16 i;
+  memcpy(&i, idx + n * sizeof(u16), sizeof(u16));
+  return i;
+}
+
+inline static void set_index(u8 *idx, u32 n, u16 i)
+{
+  memcpy(idx + n * sizeof(u16), &i, sizeof(u16));
+}
+
+/* Reverse the order of the first `n` elements of a compact pool. */
+static void compact_reverse(memory_pool_t *pool, u32 n)
+{
+  u8 tmp[pool->element_size];
+  for (u32 i = 0; i < n / 2; i++) {
+    element_t *a = get_elem_n(pool, i);
+    element_t *b = get_elem_n(pool, n - 1 - i);
+    memcpy(tmp, a, pool->element_size);
+    memcpy(a, b, pool->element_size);
+    memcpy(b, tmp, pool->element_size);
+  }
+}
+
 /** \defgroup memory_pool Functional Memory Pool
  * Simple fixed size memory pool collection supporting functional operations.
  *
@@ -39,8 +78,53 @@ inline static node_t *get_node_n(memory_pool_t *pool, node_t *head, u32 n)
  * Allocation and deallocation from the pool are guaranteed constant time and
  * map and fold are O(N).
  *
+ * A pool can alternatively be initialised in compact mode with
+ * memory_pool_init_compact(). A compact pool supports exactly the same
+ * operations, with the same results and element ordering, but keeps the
+ * allocated elements packed contiguously at the start of its buffer instead
+ * of in a linked list. Iterating over a compact pool is then a linear scan
+ * through memory, filter compacts the elements in a single pass, and the
+ * elements can be accessed directly as a plain array with
+ * memory_pool_elements(). The price is that memory_pool_add() on a compact
+ * pool is O(N), as the new element is inserted at the head of the
+ * collection.
+ *
+ * Pools allocated on the heap with memory_pool_new() aren't available when
+ * building with `LIBSWIFTNAV_EMBEDDED`, buffers must then be given to
+ * memory_pool_init().
+ *
  * \{ */
 
+#ifndef LIBSWIFTNAV_EMBEDDED
+
+static memory_pool_t *pool_new(u32 n_elements, size_t element_size,
+                               bool compact)
+{
+  memory_pool_t *new_pool = malloc(sizeof(memory_pool_t));
+  if (!new_pool) {
+    return NULL;
+  }
+
+  /* Allocate memory pool */
+  size_t node_size = calc_node_size(element_size);
+  node_t *buff = (node_t *)malloc(node_size * n_elements);
+  if (!buff) {
+    free(new_pool);
+    return NULL;
+  }
+
+  s8 ret = compact ?
+    memory_pool_init_compact(new_pool, n_elements, element_size, buff) :
+    memory_pool_init(new_pool, n_elements, element_size, buff);
+  if (ret < 0) {
+    free(buff);
+    free(new_pool);
+    return NULL;
+  }
+
+  return new_pool;
+}
+
 /** Create a new memory pool.
  * Creates a new memory pool containing a maximum of `n_elements` elements of
  * size `element_size`. This function calles malloc() to reserve space for a
@@ -62,24 +146,25 @@ inline static node_t *get_node_n(memory_pool_t *pool, node_t *head, u32 n)
  */
 memory_pool_t *memory_pool_new(u32 n_elements, size_t element_size)
 {
-  memory_pool_t *new_pool = malloc(sizeof(memory_pool_t));
-  if (!new_pool) {
-    return NULL;
-  }
-
-  /* Allocate memory pool */
-  size_t node_size = calc_node_size(element_size);
-  node_t *buff = (node_t *)malloc(node_size * n_elements);
-  if (!buff) {
-    free(new_pool);
-    return NULL;
-  }
-
-  memory_pool_init(new_pool, n_elements, element_size, buff);
+  return pool_new(n_elements, element_size, false);
+}
 
-  return new_pool;
+/** Create a new compact memory pool.
+ * As memory_pool_new() but the pool is initialised in compact mode, see
+ * memory_pool_init_compact().
+ *
+ * \param n_elements Number of elements that the pool can hold
+ * \param element_size Size in bytes of the user payload elements
+ * \returns Pointer to a new ::memory_pool_t or NULL upon a malloc() failure
+ *          or if `n_elements` is too large for a compact pool
+ */
+memory_pool_t *memory_pool_new_compact(u32 n_elements, size_t element_size)
+{
+  return pool_new(n_elements, element_size, true);
 }
 
+#endif /* LIBSWIFTNAV_EMBEDDED */
+
 /** Initialise a new memory pool.
  * Initialises a new memory pool containing a maximum of `n_elements` elements
  * of size `element_size`. This function does not allocate memory and must be
@@ -110,6 +195,8 @@ s8 memory_pool_init(memory_pool_t *new_pool, u32 n_elements,
 
   new_pool->n_elements = n_elements;
   new_pool->element_size = element_size;
+  new_pool->compact = false;
+  new_pool->n_allocated = 0;
 
   /* Setup memory pool buffer area */
   new_pool->pool = (node_t *)buff;
@@ -136,6 +223,86 @@ s8 memory_pool_init(memory_pool_t *new_pool, u32 n_elements,
   return 0;
 }
 
+/** Initialise a new compact memory pool.
+ * Initialises a new memory pool containing a maximum of `n_elements` elements
+ * of size `element_size` in compact mode, where the allocated elements are
+ * kept contiguous and in collection order at the start of `buff`. The buffer
+ * required is the same size as for memory_pool_init():
+ *
+ * ~~~
+ * n_elements * (element_size + sizeof(void *))
+ * ~~~
+ *
+ * The space beyond the elements themselves is used as working area by
+ * memory_pool_sort() and memory_pool_group_by(). A compact pool can hold at
+ * most #MEMORY_POOL_COMPACT_MAX_ELEMENTS elements.
+ *
+ * \param new_pool Pointer to a memory pool to initialise
+ * \param n_elements Number of elements that the pool can hold
+ * \param element_size Size in bytes of the user payload elements
+ * \param buff Pointer to a buffer to use as the memory pool working area
+ * \returns `0` on success, `<0` on failure.
+ */
+s8 memory_pool_init_compact(memory_pool_t *new_pool, u32 n_elements,
+                            size_t element_size, void *buff)
+{
+  if (!new_pool) {
+    return -1;
+  }
+
+  if (!buff) {
+    return -2;
+  }
+
+  if (n_elements > MEMORY_POOL_COMPACT_MAX_ELEMENTS) {
+    return -3;
+  }
+
+  new_pool->n_elements = n_elements;
+  new_pool->element_size = element_size;
+  new_pool->pool = (node_t *)buff;
+  new_pool->free_nodes_head = NULL;
+  new_pool->allocated_nodes_head = NULL;
+  new_pool->compact = true;
+  new_pool->n_allocated = 0;
+
+  return 0;
+}
+
+/** Move a compact memory pool to a new buffer.
+ * Re-homes a compact pool in `buff`, which may hold a different number of
+ * elements than the current buffer, keeping the allocated elements and their
+ * order. The buffer must be sized for `n_elements` as for
+ * memory_pool_init_compact() and may overlap the current one. The pool no
+ * longer refers to the old buffer afterwards.
+ *
+ * \param pool Pointer to a compact memory pool
+ * \param n_elements Number of elements that the pool can hold
+ * \param buff Pointer to a buffer to use as the memory pool working area
+ * \returns `0` on success, `<0` on failure. Fails if the pool is not compact,
+ *          or if `n_elements` is fewer than the allocated elements or more
+ *          than #MEMORY_POOL_COMPACT_MAX_ELEMENTS.
+ */
+s8 memory_pool_resize_compact(memory_pool_t *pool, u32 n_elements, void *buff)
+{
+  if (!pool->compact || !buff) {
+    return -1;
+  }
+
+  if (n_elements < pool->n_allocated ||
+      n_elements > MEMORY_POOL_COMPACT_MAX_ELEMENTS) {
+    return -2;
+  }
+
+  memmove(buff, pool->pool, pool->element_size * pool->n_allocated);
+  pool->pool = (node_t *)buff;
+  pool->n_elements = n_elements;
+
+  return 0;
+}
+
+#ifndef LIBSWIFTNAV_EMBEDDED
+
 /** Destroy a memory pool.
  * Cleans up and frees the memory associated with the pool. This must only be
  * called on memory pools allocated with memory_pool_new().
@@ -148,15 +315,21 @@ void memory_pool_destroy(memory_pool_t *pool)
   free(pool);
 }
 
+#endif /* LIBSWIFTNAV_EMBEDDED */
+
 /** Calculates the number of free (unallocated) elements remaining in the
  * collection.
- * This operation is O(N) in the number of free elements.
+ * This operation is O(N) in the number of free elements, or O(1) for a
+ * compact pool.
  *
  * \param pool Pointer to a memory pool
  * \returns Number of free elements or `< 0` on an error.
  */
 s32 memory_pool_n_free(memory_pool_t *pool)
 {
+  if (pool->compact)
+    return pool->n_elements - pool->n_allocated;
+
   u32 count = 0;
 
   node_t *p = pool->free_nodes_head;
@@ -174,13 +347,17 @@ s32 memory_pool_n_free(memory_pool_t *pool)
 }
 
 /** Calculates the number of elements already allocated in the collection.
- * This operation is O(N) in the number of allocated elements.
+ * This operation is O(N) in the number of allocated elements, or O(1) for a
+ * compact pool.
  *
  * \param pool Pointer to a memory pool
  * \returns Number of allocated elements or `< 0` on an error.
  */
 s32 memory_pool_n_allocated(memory_pool_t *pool)
 {
+  if (pool->compact)
+    return pool->n_allocated;
+
   u32 count = 0;
 
   node_t *p = pool->allocated_nodes_head;
@@ -205,6 +382,9 @@ s32 memory_pool_n_allocated(memory_pool_t *pool)
  */
 u8 memory_pool_empty(memory_pool_t *pool)
 {
+  if (pool->compact)
+    return (pool->n_allocated == 0);
+
   return (pool->allocated_nodes_head == NULL);
 }
 
@@ -228,6 +408,11 @@ u32 memory_pool_n_elements(memory_pool_t *pool)
  */
 s32 memory_pool_to_array(memory_pool_t *pool, void *array)
 {
+  if (pool->compact) {
+    memcpy(array, get_elem_n(pool, 0), pool->n_allocated * pool->element_size);
+    return pool->n_allocated;
+  }
+
   u32 count = 0;
 
   node_t *p = pool->allocated_nodes_head;
@@ -245,15 +430,46 @@ s32 memory_pool_to_array(memory_pool_t *pool, void *array)
   return count;
 }
 
+/** Direct access to the elements of a compact pool.
+ * The elements of a compact pool are stored contiguously, in the same order
+ * in which memory_pool_map() and memory_pool_fold() visit them, and may be
+ * read and updated in-place as a plain array of memory_pool_n_allocated()
+ * elements. The pointer is invalidated by any operation that adds or removes
+ * elements.
+ *
+ * \param pool Pointer to a memory pool
+ * \return Pointer to the first element, or NULL if the pool is not compact.
+ */
+element_t *memory_pool_elements(memory_pool_t *pool)
+{
+  if (!pool->compact)
+    return NULL;
+
+  return get_elem_n(pool, 0);
+}
+
 /** Adds an element to a collection.
  * Allocates and element from the pool and adds it to the collection of
  * elements, then returns a pointer to the new element.
  *
+ * The new element becomes the head of the collection. For a compact pool the
+ * existing elements are moved along to make room, making this O(N).
+ *
  * \param pool Pointer to a memory pool
  * \return A pointer to the new element or NULL if the pool is full.
  */
 element_t *memory_pool_add(memory_pool_t *pool)
 {
+  if (pool->compact) {
+    if (pool->n_allocated == pool->n_elements) {
+      return NULL;
+    }
+    memmove(get_elem_n(pool, 1), get_elem_n(pool, 0),
+            pool->n_allocated * pool->element_size);
+    pool->n_allocated++;
+    return get_elem_n(pool, 0);
+  }
+
   /* Take the head of the list of free nodes, insert it as the head of the
    * allocated nodes and return a pointer to the node's element. */
 
@@ -280,6 +496,12 @@ element_t *memory_pool_add(memory_pool_t *pool)
  */
 s32 memory_pool_map(memory_pool_t *pool, void *arg, void (*f)(void *arg, element_t *elem))
 {
+  if (pool->compact) {
+    for (u32 i = 0; i < pool->n_allocated; i++)
+      (*f)(arg, get_elem_n(pool, i));
+    return pool->n_allocated;
+  }
+
   u32 count = 0;
 
   node_t *p = pool->allocated_nodes_head;
@@ -310,6 +532,12 @@ s32 memory_pool_map(memory_pool_t *pool, void *arg, void (*f)(void *arg, element
 s32 memory_pool_fold(memory_pool_t *pool, void *x0,
                      void (*f)(void *x, element_t *elem))
 {
+  if (pool->compact) {
+    for (u32 i = 0; i < pool->n_allocated; i++)
+      (*f)(x0, get_elem_n(pool, i));
+    return pool->n_allocated;
+  }
+
   u32 count = 0;
 
   node_t *p = pool->allocated_nodes_head;
@@ -343,6 +571,12 @@ double memory_pool_dfold(memory_pool_t *pool, double x0,
   u32 count = 0;
   double x = x0;
 
+  if (pool->compact) {
+    for (u32 i = 0; i < pool->n_allocated; i++)
+      x = (*f)(x, get_elem_n(pool, i));
+    return x;
+  }
+
   node_t *p = pool->allocated_nodes_head;
   while (p && count <= pool->n_elements) {
     x = (*f)(x, p->elem);
@@ -369,6 +603,12 @@ float memory_pool_ffold(memory_pool_t *pool, float x0,
   u32 count = 0;
   float x = x0;
 
+  if (pool->compact) {
+    for (u32 i = 0; i < pool->n_allocated; i++)
+      x = (*f)(x, get_elem_n(pool, i));
+    return x;
+  }
+
   node_t *p = pool->allocated_nodes_head;
   while (p && count <= pool->n_elements) {
     x = (*f)(x, p->elem);
@@ -395,6 +635,12 @@ s32 memory_pool_ifold(memory_pool_t *pool, s32 x0,
   u32 count = 0;
   s32 x = x0;
 
+  if (pool->compact) {
+    for (u32 i = 0; i < pool->n_allocated; i++)
+      x = (*f)(x, get_elem_n(pool, i));
+    return x;
+  }
+
   node_t *p = pool->allocated_nodes_head;
   while (p && count <= pool->n_elements) {
     x = (*f)(x, p->elem);
@@ -416,6 +662,21 @@ s32 memory_pool_ifold(memory_pool_t *pool, s32 x0,
  */
 s32 memory_pool_filter(memory_pool_t *pool, void *arg, s8 (*f)(void *arg, element_t *elem))
 {
+  if (pool->compact) {
+    /* Move each kept element down over the discarded ones. */
+    u32 n_kept = 0;
+    for (u32 i = 0; i < pool->n_allocated; i++) {
+      element_t *elem = get_elem_n(pool, i);
+      if ((*f)(arg, elem)) {
+        if (n_kept != i)
+          memcpy(get_elem_n(pool, n_kept), elem, pool->element_size);
+        n_kept++;
+      }
+    }
+    pool->n_allocated = n_kept;
+    return n_kept;
+  }
+
   u32 count = 0;
 
   /* Construct a fake 'previous' node for the head of the list, this eliminates
@@ -456,6 +717,59 @@ s32 memory_pool_filter(memory_pool_t *pool, void *arg, s8 (*f)(void *arg, elemen
   return count;
 }
 
+/** Filter elements in the collection using a precomputed mask.
+ * Equivalent to memory_pool_filter() with a filter function that returns
+ * `keep[i]` for the `i`th element, in the order visited by memory_pool_map().
+ * This allows the filter decisions to be made in bulk, for example over the
+ * array returned by memory_pool_elements(), and then applied in one pass.
+ *
+ * \param pool Pointer to a memory pool
+ * \param keep Array of memory_pool_n_allocated() flags, `0` to discard the
+ *             corresponding element or `!=0` to keep it.
+ * \return Number of elements in the filtered collection or `< 0` on an error.
+ */
+s32 memory_pool_filter_mask(memory_pool_t *pool, const u8 *keep)
+{
+  if (pool->compact) {
+    u32 n_kept = 0;
+    for (u32 i = 0; i < pool->n_allocated; i++) {
+      if (keep[i]) {
+        if (n_kept != i)
+          memcpy(get_elem_n(pool, n_kept), get_elem_n(pool, i),
+                 pool->element_size);
+        n_kept++;
+      }
+    }
+    pool->n_allocated = n_kept;
+    return n_kept;
+  }
+
+  u32 i = 0;
+  u32 count = 0;
+  node_t **link = &pool->allocated_nodes_head;
+  node_t *p = *link;
+
+  while (p && i <= pool->n_elements) {
+    if (keep[i++]) {
+      link = &p->hdr.next;
+      count++;
+    } else {
+      /* Drop this element from the list and return its node to the pool. */
+      *link = p->hdr.next;
+      p->hdr.next = pool->free_nodes_head;
+      pool->free_nodes_head = p;
+    }
+    p = *link;
+  }
+
+  if (p)
+    /* The list of elements is larger than the pool,
+     * something has gone horribly wrong. */
+    return -1;
+
+  return count;
+}
+
 /** Remove all elements from the collection and return them all back to the pool.
  * This function is O(n) in the number of currently allocated nodes.
  *
@@ -463,6 +777,11 @@ s32 memory_pool_filter(memory_pool_t *pool, void *arg, s8 (*f)(void *arg, elemen
  */
 s32 memory_pool_clear(memory_pool_t *pool)
 {
+  if (pool->compact) {
+    pool->n_allocated = 0;
+    return 0;
+  }
+
   u32 count = 0;
   node_t *p = pool->allocated_nodes_head;
 
@@ -490,6 +809,62 @@ s32 memory_pool_clear(memory_pool_t *pool)
   return 0;
 }
 
+/* Stable bottom-up merge sort of a compact pool. The sort is done on two u16
+ * index arrays in the scratch area and the resulting permutation is then
+ * applied to the elements in-place, following each cycle with one temporary
+ * element. */
+static void compact_sort(memory_pool_t *pool, void *arg,
+                         s32 (*cmp)(void *arg, element_t *a, element_t *b))
+{
+  u32 n = pool->n_allocated;
+  u8 *idx = get_scratch(pool);
+  u8 *tmp = idx + pool->n_elements * sizeof(u16);
+
+  for (u32 i = 0; i < n; i++)
+    set_index(idx, i, i);
+
+  for (u32 width = 1; width < n; width *= 2) {
+    for (u32 lo = 0; lo < n; lo += 2*width) {
+      u32 mid = MIN(lo + width, n);
+      u32 hi = MIN(lo + 2*width, n);
+      u32 a = lo, b = mid, k = lo;
+      while (a < mid && b < hi) {
+        u16 ia = get_index(idx, a);
+        u16 ib = get_index(idx, b);
+        if (cmp(arg, get_elem_n(pool, ia), get_elem_n(pool, ib)) <= 0) {
+          set_index(tmp, k++, ia); a++;
+        } else {
+          set_index(tmp, k++, ib); b++;
+        }
+      }
+      while (a < mid)
+        set_index(tmp, k++, get_index(idx, a++));
+      while (b < hi)
+        set_index(tmp, k++, get_index(idx, b++));
+    }
+    u8 *t = idx; idx = tmp; tmp = t;
+  }
+
+  /* Position k of the sorted collection takes the element now at idx[k]. */
+  u8 e[pool->element_size];
+  for (u32 k = 0; k < n; k++) {
+    if (get_index(idx, k) == k)
+      continue;
+    memcpy(e, get_elem_n(pool, k), pool->element_size);
+    u32 j = k;
+    while (1) {
+      u32 src = get_index(idx, j);
+      set_index(idx, j, j);
+      if (src == k) {
+        memcpy(get_elem_n(pool, j), e, pool->element_size);
+        break;
+      }
+      memcpy(get_elem_n(pool, j), get_elem_n(pool, src), pool->element_size);
+      j = src;
+    }
+  }
+}
+
 /** Sort the elements in a collection.
  * This is implemented as a merge sort on a linked list and has O(N log N) time
  * complexity and O(1) space complexity. The implementation is stable and has
@@ -504,6 +879,10 @@ s32 memory_pool_clear(memory_pool_t *pool)
  * through from memory_pool_sort(), this can be used to pass a key or index to
  * sort on to a general comparison function, for example.
  *
+ * For a compact pool the same stable merge sort is performed on an array of
+ * indices, using the pool's working area, and the elements are then moved
+ * into place.
+ *
  * This implementation is based on the excellent implementation by Simon Tatham:
  *
  * http://www.chiark.greenend.org.uk/~sgtatham/algorithms/listsort.html
@@ -538,6 +917,11 @@ s32 memory_pool_clear(memory_pool_t *pool)
 void memory_pool_sort(memory_pool_t *pool, void *arg,
                       s32 (*cmp)(void *arg, element_t *a, element_t *b))
 {
+  if (pool->compact) {
+    compact_sort(pool, arg, cmp);
+    return;
+  }
+
   /* If collection is empty, return immediately. */
   if (!pool->allocated_nodes_head)
     return;
@@ -609,6 +993,48 @@ void memory_pool_sort(memory_pool_t *pool, void *arg,
   }
 }
 
+static void compact_group_by(memory_pool_t *pool, void *arg,
+                             s32 (*cmp)(void *arg, element_t *a, element_t *b),
+                             void *x0, size_t x_size,
+                             void (*agg)(element_t *new, void *x, u32 n, element_t *elem))
+{
+  compact_sort(pool, arg, cmp);
+
+  u8 x_work[x_size];
+  u64 new_elem[(pool->element_size + sizeof(u64) - 1) / sizeof(u64)];
+
+  u32 n = pool->n_allocated;
+  u32 n_groups = 0;
+  u32 i = 0;
+
+  while (i < n) {
+    u32 group_count = 0;
+    u32 group_head = i;
+
+    if (x_size)
+      memcpy(x_work, x0, x_size);
+
+    memcpy(new_elem, get_elem_n(pool, i), pool->element_size);
+
+    do {
+      agg((element_t *)new_elem, (void *)x_work, group_count,
+          get_elem_n(pool, i));
+      group_count++;
+      i++;
+    } while (i < n &&
+             cmp(arg, get_elem_n(pool, group_head), get_elem_n(pool, i)) == 0);
+
+    /* Aggregates are written over the start of the sorted elements, always
+     * behind the group being read. */
+    memcpy(get_elem_n(pool, n_groups), new_elem, pool->element_size);
+    n_groups++;
+  }
+
+  /* memory_pool_add() places each aggregate at the head of the list. */
+  compact_reverse(pool, n_groups);
+  pool->n_allocated = n_groups;
+}
+
 /** Perform a groupby type reduction on a collection.
  * A groupby reduction consists of two steps:
  *
@@ -649,6 +1075,11 @@ void memory_pool_group_by(memory_pool_t *pool, void *arg,
                           void *x0, size_t x_size,
                           void (*agg)(element_t *new, void *x, u32 n, element_t *elem))
 {
+  if (pool->compact) {
+    compact_group_by(pool, arg, cmp, x0, x_size, agg);
+    return;
+  }
+
   /* If collection is empty, return immediately. */
   if (!pool->allocated_nodes_head)
     return;
@@ -703,6 +1134,90 @@ void memory_pool_group_by(memory_pool_t *pool, void *arg,
   }
 }
 
+/* The product operations on a compact pool first move the old elements to
+ * the end of the buffer. New elements are then written from the start, and
+ * each old element's slot becomes available once it has been processed, so
+ * the pool fills up at exactly the same point as when nodes are returned to
+ * the free list. Finally the new elements are reversed to match the order
+ * given by memory_pool_add(). Returns the index of the first old element. */
+static u32 compact_product_start(memory_pool_t *pool)
+{
+  u32 n_old = pool->n_allocated;
+  u32 old_start = pool->n_elements - n_old;
+  memmove(get_elem_n(pool, old_start), get_elem_n(pool, 0),
+          n_old * pool->element_size);
+  return old_start;
+}
+
+static s32 compact_product_finish(memory_pool_t *pool, u32 count, s32 ret)
+{
+  compact_reverse(pool, count);
+  pool->n_allocated = count;
+  return ret < 0 ? ret : (s32)count;
+}
+
+static s32 compact_product(memory_pool_t *pool, void *xs, u32 n_xs, size_t x_size,
+                           void (*prod)(element_t *new, void *x, u32 n_xs, u32 n, element_t *elem))
+{
+  u32 n_old = pool->n_allocated;
+  u32 old_start = compact_product_start(pool);
+  u32 count = 0;
+
+  for (u32 i = 0; i < n_old; i++) {
+    element_t *elem = get_elem_n(pool, old_start + i);
+    for (u32 j = 0; j < n_xs; j++) {
+      if (count == old_start + i) {
+        /* Pool is full. */
+        return compact_product_finish(pool, count, -2);
+      }
+      element_t *new = get_elem_n(pool, count);
+      memcpy(new, elem, pool->element_size);
+      prod(new, ((u8 *)xs + j*x_size), n_xs, j, elem);
+      count++;
+    }
+  }
+
+  return compact_product_finish(pool, count, 0);
+}
+
+static s32 compact_product_generator(memory_pool_t *pool, void *x0, u32 max_xs, size_t x_size,
+                                     s8 (*init)(void *x, element_t *elem),
+                                     s8 (*next)(void *x, u32 n),
+                                     void (*prod)(element_t *new, void *x, u32 n, element_t *elem))
+{
+  u32 n_old = pool->n_allocated;
+  u32 old_start = compact_product_start(pool);
+  u32 count = 0;
+
+  for (u32 i = 0; i < n_old; i++) {
+    element_t *elem = get_elem_n(pool, old_start + i);
+    u8 x_work[x_size];
+    memcpy(x_work, x0, x_size);
+
+    if (!init(x_work, elem))
+      continue;
+
+    u32 x_count = 0;
+    do {
+      if (x_count > max_xs) {
+        /* Exceded maximum number of generator iterations. */
+        return compact_product_finish(pool, count, -3);
+      }
+      if (count == old_start + i) {
+        /* Pool is full. */
+        return compact_product_finish(pool, count, -2);
+      }
+      element_t *new = get_elem_n(pool, count);
+      memcpy(new, elem, pool->element_size);
+      prod(new, x_work, x_count, elem);
+      x_count++;
+      count++;
+    } while (next(x_work, x_count));
+  }
+
+  return compact_product_finish(pool, count, 0);
+}
+
 /** Cartesian product of a memory pool collection with an array.
  * For each pair of an element in the original collection and an item in the
  * array `xs`, a new element is created in the updated collection formed by the
@@ -724,6 +1239,9 @@ void memory_pool_group_by(memory_pool_t *pool, void *arg,
 s32 memory_pool_product(memory_pool_t *pool, void *xs, u32 n_xs, size_t x_size,
                         void (*prod)(element_t *new, void *x, u32 n_xs, u32 n, element_t *elem))
 {
+  if (pool->compact)
+    return compact_product(pool, xs, n_xs, x_size, prod);
+
   /* Save the head of the original list and reset the pool head where the
    * product data will be added. */
   node_t *old_head = pool->allocated_nodes_head;
@@ -770,6 +1288,9 @@ s32 memory_pool_product_generator(memory_pool_t *pool, void *x0, u32 max_xs, siz
                                   s8 (*next)(void *x, u32 n),
                                   void (*prod)(element_t *new, void *x, u32 n, element_t *elem))
 {
+  if (pool->compact)
+    return compact_product_generator(pool, x0, max_xs, x_size, init, next, prod);
+
   /* Save the head of the original list and reset the pool head where the
    * product data will be added. */
   node_t *old_head = pool->allocated_nodes_head;
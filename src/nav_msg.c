@@ -29,6 +29,10 @@ void nav_msg_init(nav_msg_t *n)
   n->bit_polarity = BIT_POLARITY_UNKNOWN;
 }
 
+/* Preamble candidates are checked 360 nav bits back, i.e. at the start of the
+ * circular subframe_bits buffer, then confirmed 60 nav bits back. */
+#define SUBFRAME_START_BUFFER_OFFSET (NAV_MSG_SUBFRAME_BITS_LEN*32 - 360)
+
 static u32 extract_word(nav_msg_t *n, u16 bit_index, u8 n_bits, u8 invert)
 {
   /* Extract a word of n_bits length (n_bits <= 32) at position bit_index into
@@ -48,7 +52,7 @@ static u32 extract_word(nav_msg_t *n, u16 bit_index, u8 n_bits, u8 invert)
   }
 
   /* Wrap if necessary. */
-  if (bit_index > NAV_MSG_SUBFRAME_BITS_LEN*32)
+  if (bit_index >= NAV_MSG_SUBFRAME_BITS_LEN*32)
     bit_index -= NAV_MSG_SUBFRAME_BITS_LEN*32;
 
   u8 bix_hi = bit_index >> 5;
@@ -68,6 +72,49 @@ static u32 extract_word(nav_msg_t *n, u16 bit_index, u8 n_bits, u8 invert)
   return word >> (32 - n_bits);
 }
 
+/* Confirms a preamble candidate at n->subframe_start_index by looking for a
+ * second preamble and a consecutive TOW one subframe later. Clears
+ * subframe_start_index if the candidate is rejected.
+ *
+ * \return The GPS time of week in milliseconds of the current code phase
+ *         rollover, or `TOW_INVALID` (-1) if the candidate is rejected
+ */
+static s32 confirm_preamble(nav_msg_t *n)
+{
+  s32 TOW_ms = TOW_INVALID;
+
+  // Looks like we found a preamble, but let's confirm.
+  if (extract_word(n, 300, 8, 0) == 0x8B) {
+    // There's another preamble in the following subframe.  Looks good so far.
+    // Extract the TOW:
+    unsigned int TOW_trunc = extract_word(n,30,17,extract_word(n,29,1,0));
+    /* (bit 29 is D30* for the second word, where the TOW resides) */
+    if (TOW_trunc < 7*24*60*10) {
+      /* TOW in valid range */
+      TOW_trunc++;  // Increment it, to see what we expect at the start of the next subframe
+      if (TOW_trunc == 7*24*60*10)  // Handle end of week rollover
+        TOW_trunc = 0;
+
+      if (TOW_trunc == extract_word(n,330,17,extract_word(n,329,1,0))) {
+        // We got two appropriately spaced preambles, and two matching TOW counts.  Pretty certain now.
+        /* TODO: should still check parity? */
+        // The TOW in the message is for the start of the NEXT subframe.
+        // That is, 240 nav bits' time from now, since we are 60 nav bits into the second subframe that we recorded.
+        if (TOW_trunc == 0)
+          /* end-of-week special case */
+          TOW_ms = 7*24*60*60*1000 - (300-60)*20;
+        else
+          TOW_ms = TOW_trunc * 6000 - (300-60)*20;
+      }
+    }
+  }
+  /* If we didn't find a matching pair of preambles + TOWs, this offset can't be right. Move on. */
+  if (TOW_ms < 0)
+    n->subframe_start_index = 0;
+
+  return TOW_ms;
+}
+
 /** Navigation message decoding update.
  * Called once per nav bit interval. Performs the necessary steps to
  * store the nav bits and decode them.
@@ -123,8 +170,6 @@ s32 nav_msg_update(nav_msg_t *n, bool bit_val)
   if (!n->subframe_start_index) {
     /* We're going to look for the preamble at a time 360 nav bits ago,
      * then again 60 nav bits ago. */
-    #define SUBFRAME_START_BUFFER_OFFSET (NAV_MSG_SUBFRAME_BITS_LEN*32 - 360)
-
     /* Check whether there's a preamble at the start of the circular
      * subframe_bits buffer. */
     u8 preamble_candidate = extract_word(n, n->subframe_bit_index + SUBFRAME_START_BUFFER_OFFSET, 8, 0);
@@ -136,39 +181,79 @@ s32 nav_msg_update(nav_msg_t *n, bool bit_val)
        n->subframe_start_index = -(n->subframe_bit_index + SUBFRAME_START_BUFFER_OFFSET + 1);
     }
 
+    if (n->subframe_start_index)
+      TOW_ms = confirm_preamble(n);
+  }
+
+  return TOW_ms;
+}
+
+/** Navigation message decoding update for a block of nav bits.
+ * Equivalent to calling nav_msg_update() for each bit in turn, but the bits
+ * are stored up to a word at a time and the preamble search slides over the
+ * stored word instead of re-extracting it for every bit.
+ *
+ * Decoding stops after the bit on which a subframe becomes ready, so that
+ * process_subframe() can be called before the remaining bits are passed in a
+ * further call. If a subframe is already waiting, bits are stored until the
+ * buffer would overrun.
+ *
+ * \param n      Nav message decode state struct
+ * \param bits   Nav bits, packed MSB first
+ * \param n_bits Number of bits in `bits`
+ * \param TOW_ms Set to the GPS time of week in milliseconds of the code
+ *               phase rollover after the last consumed bit if a subframe
+ *               became ready on it, otherwise `TOW_INVALID` (-1)
+ *
+ * \return Number of bits consumed
+ */
+u32 nav_msg_update_bits(nav_msg_t *n, const u8 *bits, u32 n_bits,
+                        s32 *TOW_ms)
+{
+  *TOW_ms = TOW_INVALID;
+
+  u32 i = 0;
+  while (i < n_bits) {
     if (n->subframe_start_index) {
-      // Looks like we found a preamble, but let's confirm.
-      if (extract_word(n, 300, 8, 0) == 0x8B) {
-        // There's another preamble in the following subframe.  Looks good so far.
-        // Extract the TOW:
-        unsigned int TOW_trunc = extract_word(n,30,17,extract_word(n,29,1,0));
-        /* (bit 29 is D30* for the second word, where the TOW resides) */
-        if (TOW_trunc < 7*24*60*10) {
-          /* TOW in valid range */
-          TOW_trunc++;  // Increment it, to see what we expect at the start of the next subframe
-          if (TOW_trunc == 7*24*60*10)  // Handle end of week rollover
-            TOW_trunc = 0;
-
-          if (TOW_trunc == extract_word(n,330,17,extract_word(n,329,1,0))) {
-            // We got two appropriately spaced preambles, and two matching TOW counts.  Pretty certain now.
-            /* TODO: should still check parity? */
-            // The TOW in the message is for the start of the NEXT subframe.
-            // That is, 240 nav bits' time from now, since we are 60 nav bits into the second subframe that we recorded.
-            if (TOW_trunc == 0)
-              /* end-of-week special case */
-              TOW_ms = 7*24*60*60*1000 - (300-60)*20;
-            else
-              TOW_ms = TOW_trunc * 6000 - (300-60)*20;
-          }
-        }
-      }
-      /* If we didn't find a matching pair of preambles + TOWs, this offset can't be right. Move on. */
-      if (TOW_ms < 0)
-        n->subframe_start_index = 0;
+      /* Subframe waiting to be processed, store bits one at a time until the
+       * buffer is full. */
+      if (nav_msg_update(n, getbitu(bits, i, 1)) == -2)
+        break;
+      i++;
+      continue;
     }
+
+    /* Store up to 24 bits without crossing a buffer word, so that the
+     * preamble candidates ending on them fit in one extracted word and the
+     * bits written ahead of each candidate are never read by
+     * confirm_preamble(). */
+    u16 idx = n->subframe_bit_index;
+    u8 k = MIN(MIN(n_bits - i, 24u), 32u - (idx & 0x1F));
+    u32 shift = 32 - (idx & 0x1F) - k;
+    u32 mask = ((1u << k) - 1) << shift;
+    u32 *w = &n->subframe_bits[idx >> 5];
+    *w = (*w & ~mask) | (getbitu(bits, i, k) << shift);
+
+    u32 candidates = extract_word(n, idx + 1 + SUBFRAME_START_BUFFER_OFFSET,
+                                  k + 7, 0);
+    for (u8 j = 0; j < k; j++) {
+      u8 preamble_candidate = (candidates >> (k - 1 - j)) & 0xFF;
+      if (preamble_candidate != 0x8B && preamble_candidate != 0x74)
+        continue;
+
+      n->subframe_bit_index = (idx + j + 1) % (NAV_MSG_SUBFRAME_BITS_LEN*32);
+      s16 start = n->subframe_bit_index + SUBFRAME_START_BUFFER_OFFSET + 1;
+      n->subframe_start_index = (preamble_candidate == 0x8B) ? start : -start;
+      *TOW_ms = confirm_preamble(n);
+      if (*TOW_ms >= 0)
+        return i + j + 1;
+    }
+
+    n->subframe_bit_index = (idx + k) % (NAV_MSG_SUBFRAME_BITS_LEN*32);
+    i += k;
   }
 
-  return TOW_ms;
+  return i;
 }
 
 /* Tests the parity of a L1 C/A NAV message word.
@@ -43,8 +43,8 @@ int cmp_sdiff_sid(const void *a_, const void *b_)
 }
 
 /** Create a single difference from two observations.
- * Used by single_diff() to map two `navigation_measurement_t`s
- * into an `sdiff_t`.
+ * Used by make_propagated_sdiffs_wip() to map two
+ * `navigation_measurement_t`s into an `sdiff_t`.
  *
  * SNR in the output is the lesser of the SNRs of inputs a and b.
  *
@@ -71,6 +71,141 @@ static void single_diff_(void *context, u32 n, const void *a, const void *b)
   memcpy(&(sds[n].sat_vel), &(m_b->sat_vel), 3*sizeof(double));
 }
 
+/** Initialise an observation store, leaving it empty.
+ *
+ * \param s Observation store to initialise.
+ */
+void obs_store_init(obs_store_t *s)
+{
+  memset(s, 0, sizeof(*s));
+}
+
+/** Add navigation measurements to an observation store.
+ * A measurement replaces any already stored for the same signal.
+ *
+ * \param s Observation store.
+ * \param n Number of measurements in `m`.
+ * \param m Measurements, in any order.
+ */
+void obs_store_add_nav_meas(obs_store_t *s, u8 n,
+                            const navigation_measurement_t *m)
+{
+  for (u8 k = 0; k < n; k++) {
+    u32 i = sid_to_index(m[k].sid);
+    sid_set_add_index(&s->sats, i);
+    s->pseudorange[i] = m[k].raw_pseudorange;
+    s->carrier_phase[i] = m[k].carrier_phase;
+    s->doppler[i] = m[k].raw_doppler;
+    s->snr[i] = m[k].snr;
+    s->lock_counter[i] = m[k].lock_counter;
+    memcpy(s->sat_pos[i], m[k].sat_pos, sizeof(s->sat_pos[i]));
+    memcpy(s->sat_vel[i], m[k].sat_vel, sizeof(s->sat_vel[i]));
+  }
+}
+
+/** Calculate single differences between two observation stores.
+ * The signals present in `sd` are those present in both `a` and `b`.
+ * Follows the same conventions as single_diff(): SNR is the lesser of the
+ * two SNRs, lock counters are summed and `sat_pos` and `sat_vel` are taken
+ * from `b`.
+ *
+ * The differences are taken over the whole arrays rather than signal by
+ * signal, so that they vectorise, and `sd` may be the same store as `a` or
+ * `b`.
+ *
+ * \param a First observation store.
+ * \param b Second observation store.
+ * \param sd Single differences `a - b`.
+ * \return The number of signals present in `sd`.
+ */
+u8 obs_store_single_diff(const obs_store_t *a, const obs_store_t *b,
+                         obs_store_t *sd)
+{
+  for (u32 i = 0; i < NUM_SATS; i++) {
+    sd->pseudorange[i] = a->pseudorange[i] - b->pseudorange[i];
+    sd->carrier_phase[i] = a->carrier_phase[i] - b->carrier_phase[i];
+    sd->doppler[i] = a->doppler[i] - b->doppler[i];
+    sd->snr[i] = MIN(a->snr[i], b->snr[i]);
+    sd->lock_counter[i] = a->lock_counter[i] + b->lock_counter[i];
+  }
+  if (sd != b) {
+    memcpy(sd->sat_pos, b->sat_pos, sizeof(sd->sat_pos));
+    memcpy(sd->sat_vel, b->sat_vel, sizeof(sd->sat_vel));
+  }
+  sid_set_and(&sd->sats, &a->sats, &b->sats);
+  return sid_set_count(&sd->sats);
+}
+
+/** Copy the single differences in an observation store to an array.
+ *
+ * \param sd Single differences, e.g. from obs_store_single_diff().
+ * \param sds Array to write to, sorted by signal.
+ * \return The number of single differences written to `sds`.
+ */
+u8 obs_store_get_sdiffs(const obs_store_t *sd, sdiff_t *sds)
+{
+  u8 n = 0;
+  for (u32 i = sid_set_next(&sd->sats, 0); i < NUM_SATS;
+       i = sid_set_next(&sd->sats, i + 1), n++) {
+    sds[n].sid = sid_from_index(i);
+    sds[n].pseudorange = sd->pseudorange[i];
+    sds[n].carrier_phase = sd->carrier_phase[i];
+    sds[n].doppler = sd->doppler[i];
+    sds[n].snr = sd->snr[i];
+    sds[n].lock_counter = sd->lock_counter[i];
+    memcpy(sds[n].sat_pos, sd->sat_pos[i], sizeof(sds[n].sat_pos));
+    memcpy(sds[n].sat_vel, sd->sat_vel[i], sizeof(sds[n].sat_vel));
+  }
+  return n;
+}
+
+/** Make the set of signals of an array of single differences.
+ *
+ * \param n Number of single differences in `sdiffs`.
+ * \param sdiffs Single differences, in any order.
+ * \param s Set of their signals.
+ */
+void sdiffs_to_sid_set(u8 n, const sdiff_t *sdiffs, sid_set_t *s)
+{
+  sid_set_init(s);
+  for (u8 k = 0; k < n; k++)
+    sid_set_add(s, sdiffs[k].sid);
+}
+
+/* Find the measurements of signals present in both `m_a` and `m_b`. Rather
+ * than merging the two arrays, each is indexed by sid_to_index() and the
+ * intersection is a bitset AND. Writes the indices into `m_a` and `m_b` of
+ * the common signals, in signal order, and returns how many there are. */
+static u8 match_nav_meas(u8 n_a, const navigation_measurement_t *m_a,
+                         u8 n_b, const navigation_measurement_t *m_b,
+                         u8 *idx_a, u8 *idx_b)
+{
+  u8 pos_a[NUM_SATS], pos_b[NUM_SATS];
+  sid_set_t set_a, set_b, common;
+  sid_set_init(&set_a);
+  sid_set_init(&set_b);
+
+  for (u8 k = 0; k < n_a; k++) {
+    u32 i = sid_to_index(m_a[k].sid);
+    pos_a[i] = k;
+    sid_set_add_index(&set_a, i);
+  }
+  for (u8 k = 0; k < n_b; k++) {
+    u32 i = sid_to_index(m_b[k].sid);
+    pos_b[i] = k;
+    sid_set_add_index(&set_b, i);
+  }
+
+  sid_set_and(&common, &set_a, &set_b);
+  u8 n = 0;
+  for (u32 i = sid_set_next(&common, 0); i < NUM_SATS;
+       i = sid_set_next(&common, i + 1), n++) {
+    idx_a[n] = pos_a[i];
+    idx_b[n] = pos_b[i];
+  }
+  return n;
+}
+
 /** Calculate single differences from two sets of observations.
  * Undifferenced input observations are assumed to be both taken at the
  * same time, `t`.
@@ -79,23 +214,26 @@ static void single_diff_(void *context, u32 n, const void *a, const void *b)
  *
  * `sat_pos` and `sat_vel` are taken from input b.
  *
+ * Callers that keep their observations in an obs_store_t can use
+ * obs_store_single_diff() instead.
+ *
  * \param n_a Number of measurements in set `m_a`
  * \param m_a Array of undifferenced observations, as a set sorted by PRN
  * \param n_b Number of measurements in set `m_b`
  * \param m_b Array of undifferenced observations, as a set sorted by PRN
- * \param sds Single difference observations
+ * \param sds Single difference observations, sorted by PRN
  *
- * \return The number of observations written to `sds` on success,
- *         -1 if `m_a` is not a valid set,
- *         -2 if `m_b` is not a valid set
+ * \return The number of observations written to `sds`
  */
 u8 single_diff(u8 n_a, navigation_measurement_t *m_a,
                u8 n_b, navigation_measurement_t *m_b,
                sdiff_t *sds)
 {
-  return intersection_map(n_a, sizeof(navigation_measurement_t), m_a,
-                          n_b, sizeof(navigation_measurement_t), m_b,
-                          nav_meas_cmp, sds, single_diff_);
+  u8 idx_a[NUM_SATS], idx_b[NUM_SATS];
+  u8 n = match_nav_meas(n_a, m_a, n_b, m_b, idx_a, idx_b);
+  for (u8 k = 0; k < n; k++)
+    single_diff_(sds, k, &m_a[idx_a[k]], &m_b[idx_b[k]]);
+  return n;
 }
 
 typedef struct {
@@ -180,54 +318,50 @@ u8 make_propagated_sdiffs(u8 n_local, navigation_measurement_t *m_local,
                           const ephemeris_t *e[], const gps_time_t *t,
                           sdiff_t *sds)
 {
-  u8 i, j, n = 0;
-
-  /* Loop over m_a and m_b and check if a PRN is present in both. */
-  for (i=0, j=0; i<n_local && j<n_remote; i++, j++) {
-    if (sid_compare(m_local[i].sid, m_remote[j].sid) < 0)
-      j--;
-    else if (sid_compare(m_local[i].sid, m_remote[j].sid) > 0)
-      i--;
-    else {
-      double clock_err;
-      double clock_rate_err;
-      double local_sat_pos[3];
-      double local_sat_vel[3];
-      calc_sat_state(e[i], t, local_sat_pos, local_sat_vel,
-                     &clock_err, &clock_rate_err);
-      sds[n].sid = m_local[i].sid;
-      double dx = local_sat_pos[0] - remote_pos_ecef[0];
-      double dy = local_sat_pos[1] - remote_pos_ecef[1];
-      double dz = local_sat_pos[2] - remote_pos_ecef[2];
-      double new_dist = sqrt( dx * dx + dy * dy + dz * dz);
-      double dist_diff = new_dist - remote_dists[j];
-      /* Explanation:
-       * pseudorange = dist + c
-       * To update a pseudorange in time:
-       *  new_pseudorange = new_dist + c
-       *                  = old_dist + c + (new_dist - old_dist)
-       *                  = old_pseudorange + (new_dist - old_dist)
-       *
-       * So to get the single differenced pseudorange:
-       *  local_pseudorange - new_remote_pseudorange
-       *    = local_pseudorange - (old_remote_pseudorange + new_dist - old_dist)
-       *
-       * For carrier phase, it's the same thing, but the update has opposite sign. */
-      sds[n].pseudorange = m_local[i].raw_pseudorange
-                         - (m_remote[j].raw_pseudorange
-                            + dist_diff);
-      sds[n].carrier_phase = m_local[i].carrier_phase
-                           - (m_remote[j].carrier_phase
-                              - dist_diff / GPS_L1_LAMBDA);
-
-      /* Doppler is not propagated.
-       * sds[n].doppler = m_local[i].raw_doppler - m_remote[j].raw_doppler; */
-      sds[n].snr = MIN(m_local[i].snr, m_remote[j].snr);
-      memcpy(&(sds[n].sat_pos), &(local_sat_pos[0]), 3*sizeof(double));
-      memcpy(&(sds[n].sat_vel), &(local_sat_vel[0]), 3*sizeof(double));
-
-      n++;
-    }
+  u8 i, j;
+  u8 local_idx[NUM_SATS], remote_idx[NUM_SATS];
+  u8 n = match_nav_meas(n_local, m_local, n_remote, m_remote,
+                        local_idx, remote_idx);
+
+  for (u8 k=0; k<n; k++) {
+    i = local_idx[k];
+    j = remote_idx[k];
+    double clock_err;
+    double clock_rate_err;
+    double local_sat_pos[3];
+    double local_sat_vel[3];
+    calc_sat_state(e[i], t, local_sat_pos, local_sat_vel,
+                   &clock_err, &clock_rate_err);
+    sds[k].sid = m_local[i].sid;
+    double dx = local_sat_pos[0] - remote_pos_ecef[0];
+    double dy = local_sat_pos[1] - remote_pos_ecef[1];
+    double dz = local_sat_pos[2] - remote_pos_ecef[2];
+    double new_dist = sqrt( dx * dx + dy * dy + dz * dz);
+    double dist_diff = new_dist - remote_dists[j];
+    /* Explanation:
+     * pseudorange = dist + c
+     * To update a pseudorange in time:
+     *  new_pseudorange = new_dist + c
+     *                  = old_dist + c + (new_dist - old_dist)
+     *                  = old_pseudorange + (new_dist - old_dist)
+     *
+     * So to get the single differenced pseudorange:
+     *  local_pseudorange - new_remote_pseudorange
+     *    = local_pseudorange - (old_remote_pseudorange + new_dist - old_dist)
+     *
+     * For carrier phase, it's the same thing, but the update has opposite sign. */
+    sds[k].pseudorange = m_local[i].raw_pseudorange
+                       - (m_remote[j].raw_pseudorange
+                          + dist_diff);
+    sds[k].carrier_phase = m_local[i].carrier_phase
+                         - (m_remote[j].carrier_phase
+                            - dist_diff / GPS_L1_LAMBDA);
+
+    /* Doppler is not propagated.
+     * sds[k].doppler = m_local[i].raw_doppler - m_remote[j].raw_doppler; */
+    sds[k].snr = MIN(m_local[i].snr, m_remote[j].snr);
+    memcpy(&(sds[k].sat_pos), &(local_sat_pos[0]), 3*sizeof(double));
+    memcpy(&(sds[k].sat_vel), &(local_sat_vel[0]), 3*sizeof(double));
   }
 
   return n;
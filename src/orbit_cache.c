@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <libswiftnav/constants.h>
+#include <libswiftnav/orbit_cache.h>
+
+/** \defgroup orbit_cache Orbit Cache
+ * Polynomial interpolation of satellite states computed from ephemerides.
+ *
+ * Satellite states are often needed at many nearby times, for each
+ * transmit time iteration, for the base and rover measurements or for
+ * several baselines. Rather than evaluating the ephemeris model each time,
+ * the cache fits Chebyshev polynomials to the position, velocity and clock
+ * error of each satellite over fixed #ORBIT_CACHE_SPAN second intervals of
+ * GPS time, and answers later requests within the same interval by
+ * evaluating the polynomials.
+ *
+ * A fit is replaced when a request falls in a different interval or when
+ * the ephemeris differs from the one the fit was made from, as reported by
+ * ephemeris_equal(). Requests that can't be fitted, because the interval
+ * isn't entirely within the ephemeris fit interval or the ephemeris isn't a
+ * GPS Kepler ephemeris, are passed straight to calc_sat_state().
+ *
+ * With the default span and order the interpolated positions are within a
+ * millimetre of the ephemeris model. The cache does not allocate memory and
+ * is not thread safe.
+ * \{ */
+
+/** Initialise an orbit cache, discarding all fits.
+ *
+ * \param cache Cache to initialise.
+ */
+void orbit_cache_init(orbit_cache_t *cache)
+{
+  memset(cache, 0, sizeof(*cache));
+}
+
+/* Fit the satellite states of one interval at the Chebyshev nodes. */
+static s8 orbit_fit(orbit_fit_t *f, const ephemeris_t *e,
+                    const gps_time_t *t_mid)
+{
+  double s[ORBIT_CACHE_COEFFS][7];
+
+  for (u8 k = 0; k < ORBIT_CACHE_COEFFS; k++) {
+    gps_time_t t = *t_mid;
+    t.tow += 0.5 * ORBIT_CACHE_SPAN *
+             cos(M_PI * (k + 0.5) / ORBIT_CACHE_COEFFS);
+    double clock_rate_err;
+    if (calc_sat_state(e, &t, &s[k][0], &s[k][3], &s[k][6],
+                       &clock_rate_err) < 0)
+      return -1;
+  }
+
+  for (u8 j = 0; j < ORBIT_CACHE_COEFFS; j++) {
+    double c[7] = {0};
+    for (u8 k = 0; k < ORBIT_CACHE_COEFFS; k++) {
+      double w = cos(M_PI * j * (k + 0.5) / ORBIT_CACHE_COEFFS);
+      for (u8 i = 0; i < 7; i++)
+        c[i] += w * s[k][i];
+    }
+    /* The zeroth coefficient is halved here rather than on evaluation. */
+    double scale = (j == 0 ? 1.0 : 2.0) / ORBIT_CACHE_COEFFS;
+    for (u8 i = 0; i < 7; i++)
+      f->c[j][i] = scale * c[i];
+  }
+
+  f->eph = *e;
+  f->t_mid = *t_mid;
+  f->valid = 1;
+  return 0;
+}
+
+/* Evaluate a fit at normalised time x in [-1, 1] by Clenshaw's recurrence. */
+static void orbit_eval(const orbit_fit_t *f, double x,
+                       double pos[3], double vel[3], double *clock_err)
+{
+  double b1[7] = {0}, b2[7] = {0};
+
+  for (u8 j = ORBIT_CACHE_COEFFS - 1; j > 0; j--) {
+    for (u8 i = 0; i < 7; i++) {
+      double b0 = 2 * x * b1[i] - b2[i] + f->c[j][i];
+      b2[i] = b1[i];
+      b1[i] = b0;
+    }
+  }
+
+  for (u8 i = 0; i < 3; i++) {
+    pos[i] = x * b1[i] - b2[i] + f->c[0][i];
+    vel[i] = x * b1[3 + i] - b2[3 + i] + f->c[0][3 + i];
+  }
+  *clock_err = x * b1[6] - b2[6] + f->c[0][6];
+}
+
+/** Calculate satellite position, velocity and clock offset, using the
+ * cached fit of the satellite's orbit where possible.
+ *
+ * Has the same interface and return values as calc_sat_state().
+ *
+ * \param cache Orbit cache.
+ * \param e Ephemeris struct
+ * \param t GPS time at which to calculate the satellite state
+ * \param pos Array into which to write calculated satellite position [m]
+ * \param vel Array into which to write calculated satellite velocity [m/s]
+ * \param clock_err Pointer to where to store the calculated satellite clock
+ *                  error [s]
+ * \param clock_rate_err Pointer to where to store the calculated satellite
+ *                       clock error [s/s]
+ *
+ * \return  0 on success,
+ *         -1 if ephemeris is older (or newer) than the fit interval
+ */
+s8 orbit_cache_sat_state(orbit_cache_t *cache, const ephemeris_t *e,
+                         const gps_time_t *t, double pos[3], double vel[3],
+                         double *clock_err, double *clock_rate_err)
+{
+  if (e->sid.constellation != CONSTELLATION_GPS)
+    return calc_sat_state(e, t, pos, vel, clock_err, clock_rate_err);
+
+  /* Middle of the interval containing t. */
+  gps_time_t t_mid = {
+    .wn = t->wn,
+    .tow = (floor(t->tow / ORBIT_CACHE_SPAN) + 0.5) * ORBIT_CACHE_SPAN
+  };
+  double dt = gpsdifftime(t, &t_mid);
+
+  orbit_fit_t *f = &cache->fits[sid_to_index(e->sid)];
+  if (!f->valid || gpsdifftime(&f->t_mid, &t_mid) != 0 ||
+      !ephemeris_equal(&f->eph, e)) {
+    f->valid = 0;
+    if (!e->valid ||
+        fabs(gpsdifftime(&t_mid, &e->toe)) + ORBIT_CACHE_SPAN / 2 >=
+          ((u32)e->fit_interval)*60*60)
+      return calc_sat_state(e, t, pos, vel, clock_err, clock_rate_err);
+    if (orbit_fit(f, e, &t_mid) < 0)
+      return calc_sat_state(e, t, pos, vel, clock_err, clock_rate_err);
+    cache->misses++;
+  } else {
+    cache->hits++;
+  }
+
+  orbit_eval(f, dt / (0.5 * ORBIT_CACHE_SPAN), pos, vel, clock_err);
+
+  /* The clock rate isn't fitted, it is cheaper to compute directly. */
+  double dt_toc = gpsdifftime(t, &e->kepler.toc);
+  *clock_rate_err = e->kepler.af1 + 2.0 * dt_toc * e->kepler.af2;
+
+  return 0;
+}
+
+/** \} */
@@ -17,9 +17,17 @@
 #include <string.h>
 #include <stdio.h>
 
+/* The AVX2 batch kernel is compiled with a per-function target attribute and
+ * selected at runtime. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PVT_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
 #include <libswiftnav/constants.h>
 #include <libswiftnav/logging.h>
 #include <libswiftnav/linear_algebra.h>
+#include <libswiftnav/small_matrix.h>
 #include <libswiftnav/coord_system.h>
 #include <libswiftnav/track.h>
 #include <libswiftnav/pvt.h>
@@ -56,7 +64,7 @@ static double vel_solve(double rx_vel[],
    *
    *   rx_vel[j] = X[j] . tempvX[j]
    */
-  matrix_multiply(4, n_used, 1, (double *) X, (double *) tempvX, (double *) rx_vel);
+  smat_mul(4, n_used, 1, (double *) X, (double *) tempvX, (double *) rx_vel);
 
   /* Return just the receiver clock bias. */
   return rx_vel[3];
@@ -130,16 +138,16 @@ static double pvt_solve(double rx_state[],
                         const u8 n_used,
                         const navigation_measurement_t *nav_meas[n_used],
                         double omp[n_used],
+                        double G[n_used][4],
                         double H[4][4])
 {
   double p_pred[n_used];
 
   /* G is a geometry matrix tells us how our pseudoranges relate to
    * our state estimates -- it's the Jacobian of d(p_i)/d(x_j) where
-   * x_j are x, y, z, Δt. */
-  double G[n_used][4];
-  double Gtrans[4][n_used];
+   * x_j are x, y, z, Δt. It is returned for use by RAIM. */
   double GtG[4][4];
+  double L[4][4];
 
   /* H is the square of the Jacobian matrix; it tells us the shape of
      our error (or, if you prefer, the direction in which we need to
@@ -214,16 +222,20 @@ static double pvt_solve(double rx_state[],
    * in Wikipedia's article on GPS.
    */
 
-  /* Gt := G^{T} */
-  matrix_transpose(n_used, 4, (double *) G, (double *) Gtrans);
   /* GtG := G^{T} G */
-  matrix_multiply(4, n_used, 4, (double *) Gtrans, (double *) G, (double *) GtG);
-  /* H \elem \mathbb{R}^{4 \times 4} := GtG^{-1} */
-  matrix_inverse(4, (const double *) GtG, (double *) H);
+  smat_ata(n_used, 4, (double *) G, (double *) GtG);
+  /* H \elem \mathbb{R}^{4 \times 4} := GtG^{-1}, by Cholesky factorisation
+   * as GtG is symmetric positive definite unless the geometry is
+   * degenerate. */
+  if (smat_cholesky(4, (double *) GtG, (double *) L) == 0) {
+    smat_cholesky_inverse(4, (double *) L, (double *) H);
+  } else {
+    matrix_inverse(4, (const double *) GtG, (double *) H);
+  }
   /* X := H * G^{T} */
-  matrix_multiply(4, 4, n_used, (double *) H, (double *) Gtrans, (double *) X);
+  smat_mul_abt(4, 4, n_used, (double *) H, (double *) G, (double *) X);
   /* correction := X * E (= X * omp) */
-  matrix_multiply(4, n_used, 1, (double *) X, (double *) omp, (double *) correction);
+  smat_mul(4, n_used, 1, (double *) X, (double *) omp, (double *) correction);
 
   /* Increment ecef estimate by the new corrections */
   for (u8 i=0; i<3; i++) {
@@ -309,12 +321,13 @@ static bool residual_test(u8 n_used, double omp[n_used],
  *   - `0`: solution converged
  *   - `-1`: solution failed to converge
  *
- *  Results stored in rx_state, omp, H
+ *  Results stored in rx_state, omp, G, H
  */
 static s8 pvt_iter(double rx_state[],
                    const u8 n_used,
                    const navigation_measurement_t *nav_meas[n_used],
                    double omp[n_used],
+                   double G[n_used][4],
                    double H[4][4])
 {
   /* Reset state to zero */
@@ -325,7 +338,7 @@ static s8 pvt_iter(double rx_state[],
   u8 iters;
   /* Newton-Raphson iteration. */
   for (iters=0; iters<PVT_MAX_ITERATIONS; iters++) {
-    if (pvt_solve(rx_state, n_used, nav_meas, omp, H) > 0) {
+    if (pvt_solve(rx_state, n_used, nav_meas, omp, G, H) > 0) {
       break;
     }
   }
@@ -341,11 +354,44 @@ static s8 pvt_iter(double rx_state[],
   return 0;
 }
 
-/** See pvt_solve_raim() for parameter meanings.
+/** Hat matrix \f$ P = G (G^T G)^{-1} G^T \f$ element.
+ *
+ * \param G geometry matrix
+ * \param X \f$ (G^T G)^{-1} G^T \f$
+ * \param i row
+ * \param j column
+ */
+static double hat(u8 n_used, const double G[n_used][4],
+                  const double X[4][n_used], u8 i, u8 j)
+{
+  double p = 0;
+  for (u8 k = 0; k < 4; k++) {
+    p += G[i][k] * X[k][j];
+  }
+  return p;
+}
+
+/* Below this, removing the measurements leaves the position unobservable. */
+#define RAIM_MIN_REDUNDANCY 1e-9
+
+/** Fault exclusion from the full solution's least squares factorization.
+ *
+ * The residual sum of squares with measurement i removed follows from the
+ * full solution's residuals r and hat matrix P without re-solving:
+ * \f$ |r|^2 - r_i^2 / (1 - P_{ii}) \f$, and likewise with a pair removed
+ * using the 2x2 block of \f$ I - P \f$. Each single exclusion is tested
+ * against the residual threshold; if none passes and enough measurements
+ * remain, each pair is tested. Exactly one passing subset is required, which
+ * is then solved once more in full.
+ *
+ * See pvt_solve_raim() for parameter meanings.
+ *
+ * \param omp residuals of the full solution with the clock offset removed
+ * \param G geometry matrix of the full solution
  *
  * \return
- *   - `1`: repaired solution, using one fewer observation
- *          returns sid of removed measurement if removed_sid ptr is passed
+ *   - `1`: repaired solution, using one or two fewer observations
+ *          excluded sids are stored in raim
  *
  *   - `-1`: no reasonable solution possible
  */
@@ -353,59 +399,122 @@ static s8 pvt_repair(double rx_state[],
                      const u8 n_used,
                      const navigation_measurement_t nav_meas[n_used],
                      double omp[n_used],
+                     double G[n_used][4],
                      double H[4][4],
-                     gnss_signal_t *removed_sid)
+                     pvt_raim_t *raim)
 {
-  /* Try solving with n-1 navigation measurements. */
-  s8 one_less = n_used - 1;
-  s8 bad_sat = -1;
-  u8 num_passing = 0;
-
-  const navigation_measurement_t *nav_meas_subset[n_used];
-  for (s8 i = 0; i < n_used; i++) {
-    nav_meas_subset[i] = &nav_meas[i];
-  }
+  double X[4][n_used];
+  smat_mul_abt(4, 4, n_used, (double *) H, (double *) G, (double *) X);
 
-  /* Carefully ordered.
-   * Permutes nav measurements so that each one is excluded from one test.
-   */
-  for (s8 drop = one_less; drop >= 0; drop--) {
-    /* Swaps the last omitted value with the one at index `drop'.
-     * On first iteration, does nothing (omits last nav_meas) */
-    const navigation_measurement_t *temp;
-    temp = nav_meas_subset[drop];
-    nav_meas_subset[drop] = nav_meas_subset[one_less];
-    nav_meas_subset[one_less] = temp;
-
-    s8 flag = pvt_iter(rx_state, n_used - 1, nav_meas_subset, omp, H);
-
-    if (flag == -1) {
-      /* Didn't converge. */
-      /* TODO(dsk) this may be unnecessary; use continue instead. */
-      return -1;
+  double sse = vector_dot(n_used, omp, omp);
+  double threshold_sq = PVT_RESIDUAL_THRESHOLD * PVT_RESIDUAL_THRESHOLD;
+  double one_minus_p[n_used];
+  u8 num_passing = 0;
+  u8 bad_sats[PVT_RAIM_MAX_EXCLUDED] = {0};
+  u8 n_bad = 0;
+
+  /* Leave one out. */
+  for (u8 i = 0; i < n_used; i++) {
+    one_minus_p[i] = 1 - hat(n_used, (const double (*)[4]) G,
+                             (const double (*)[n_used]) X, i, i);
+    if (one_minus_p[i] < RAIM_MIN_REDUNDANCY) {
+      continue;
     }
-
-    if (residual_test(n_used-1, omp, rx_state, 0)) {
+    if (sse - omp[i] * omp[i] / one_minus_p[i] < threshold_sq) {
       num_passing++;
-      bad_sat = drop;
+      bad_sats[0] = i;
+      n_bad = 1;
     }
   }
 
-  if (num_passing == 1) {
-    /* Repair is possible by omitting bad_sat. Recalculate that solution. */
-    for (s8 i = 0; i < n_used; i++) {
-      nav_meas_subset[i] = &nav_meas[i];
+  /* Leave two out, keeping at least 5 measurements so the repaired
+   * solution can still be checked. */
+  if (num_passing == 0 && n_used >= 7) {
+    for (u8 i = 0; i < n_used; i++) {
+      for (u8 j = i + 1; j < n_used; j++) {
+        double p_ij = hat(n_used, (const double (*)[4]) G,
+                          (const double (*)[n_used]) X, i, j);
+        double det = one_minus_p[i] * one_minus_p[j] - p_ij * p_ij;
+        if (det < RAIM_MIN_REDUNDANCY) {
+          continue;
+        }
+        double explained = (omp[i] * omp[i] * one_minus_p[j] +
+                            2 * omp[i] * omp[j] * p_ij +
+                            omp[j] * omp[j] * one_minus_p[i]) / det;
+        if (sse - explained < threshold_sq) {
+          num_passing++;
+          bad_sats[0] = i;
+          bad_sats[1] = j;
+          n_bad = 2;
+        }
+      }
     }
-    nav_meas_subset[bad_sat] = nav_meas_subset[one_less];
-    s8 flag = pvt_iter(rx_state, n_used - 1, nav_meas_subset, omp, H);
-    assert(flag == 0);
-    if (removed_sid) {
-      *removed_sid = nav_meas[bad_sat].sid;
+  }
+
+  if (num_passing != 1) {
+    return -1;
+  }
+
+  /* Repair is possible by omitting bad_sats. Recalculate that solution. */
+  const navigation_measurement_t *nav_meas_subset[n_used];
+  u8 n_subset = 0;
+  for (u8 i = 0; i < n_used; i++) {
+    if (i != bad_sats[0] && (n_bad < 2 || i != bad_sats[1])) {
+      nav_meas_subset[n_subset++] = &nav_meas[i];
     }
-    return 1;
-  } else {
+  }
+  s8 flag = pvt_iter(rx_state, n_subset, nav_meas_subset, omp, G, H);
+  if (flag == -1 || !residual_test(n_subset, omp, rx_state, &raim->residual)) {
+    /* Linearisation about the faulty solution was too poor. */
     return -1;
   }
+
+  raim->n_excluded = n_bad;
+  for (u8 k = 0; k < n_bad; k++) {
+    raim->excluded_sid[k] = nav_meas[bad_sats[k]].sid;
+  }
+  return 1;
+}
+
+/** Horizontal and vertical protection levels of a solution.
+ *
+ * For each measurement, the slope between the position error and the
+ * residual norm caused by a bias on that measurement alone is
+ * \f$ |K_i| / \sqrt{1 - P_{ii}} \f$, where \f$ K = (G^T G)^{-1} G^T \f$
+ * rotated into NED. The protection level is the position error of the
+ * steepest measurement when its bias is just below the residual threshold,
+ * ignoring noise.
+ */
+static void protection_levels(const u8 n_used,
+                              const double G[n_used][4],
+                              const double H[4][4],
+                              const double pos_ecef[3],
+                              pvt_raim_t *raim)
+{
+  double X[4][n_used];
+  smat_mul_abt(4, 4, n_used, (double *) H, (double *) G, (double *) X);
+
+  double M[3][3];
+  ecef2ned_matrix(pos_ecef, M);
+
+  double max_hslope = 0, max_vslope = 0;
+  for (u8 i = 0; i < n_used; i++) {
+    double one_minus_p = 1 - hat(n_used, G, (const double (*)[n_used]) X, i, i);
+    if (one_minus_p < RAIM_MIN_REDUNDANCY) {
+      /* A bias on this measurement can't be detected at all. */
+      raim->hpl = raim->vpl = -1;
+      return;
+    }
+    double k_ecef[3] = {X[0][i], X[1][i], X[2][i]};
+    double k_ned[3];
+    matrix_multiply(3, 3, 1, (double *) M, k_ecef, k_ned);
+    double scale = 1 / sqrt(one_minus_p);
+    max_hslope = MAX(max_hslope, scale * sqrt(k_ned[0] * k_ned[0] +
+                                              k_ned[1] * k_ned[1]));
+    max_vslope = MAX(max_vslope, scale * fabs(k_ned[2]));
+  }
+  raim->hpl = max_hslope * PVT_RESIDUAL_THRESHOLD;
+  raim->vpl = max_vslope * PVT_RESIDUAL_THRESHOLD;
 }
 
 /** Calculate pvt solution, perform RAIM check, attempt to repair if needed.
@@ -416,8 +525,7 @@ static s8 pvt_repair(double rx_state[],
  * \param nav_meas array of measurements
  * \param disable_raim passing True will omit raim check/repair functionality
  * \param H see pvt_solve
- * \param removed_sid if not null and repair occurs, returns dropped sid
- * \param residual if not null, return double value of residual
+ * \param raim RAIM results, see pvt_raim_t
  *
  * \return Non-negative values indicate success; see below
  *         For negative values, refer to pvt_err_msg().
@@ -425,8 +533,8 @@ static s8 pvt_repair(double rx_state[],
  *    `2`: solution ok, but raim check was not used
  *        (exactly 4 measurements, or explicitly disabled)
  *
- *    `1`: repaired solution, using one fewer observation
- *        returns sid of removed measurement if removed_sid ptr is passed
+ *    `1`: repaired solution, using one or two fewer observations
+ *        excluded sids are stored in raim
  *
  *    `0`: initial solution ok
  *
@@ -441,41 +549,51 @@ static s8 pvt_solve_raim(double rx_state[],
                          const navigation_measurement_t nav_meas[n_used],
                          bool disable_raim,
                          double H[4][4],
-                         gnss_signal_t *removed_sid,
-                         double residual)
+                         pvt_raim_t *raim)
 {
   double omp[n_used];
+  double G[n_used][4];
 
   assert(n_used <= MAX_CHANNELS);
 
+  raim->n_excluded = 0;
+  raim->residual = 0;
+  raim->hpl = raim->vpl = -1;
+
   const navigation_measurement_t *nav_meas_ptrs[n_used];
   for (s8 i = 0; i < n_used; i++) {
     nav_meas_ptrs[i] = &nav_meas[i];
   }
 
-  s8 flag = pvt_iter(rx_state, n_used, nav_meas_ptrs, omp, H);
+  s8 flag = pvt_iter(rx_state, n_used, nav_meas_ptrs, omp, G, H);
 
   if (flag == -1) {
     /* Iteration didn't converge. Don't attempt to repair; too CPU intensive. */
     return -3;
   }
-  if (flag >= 0 && (disable_raim || residual_test(n_used, omp, rx_state, &residual))) {
+  if (disable_raim || residual_test(n_used, omp, rx_state, &raim->residual)) {
     /* Solution ok, or raim check disabled. */
     if (disable_raim || n_used == 4) {
       /* Residual test couldn't have detected an error. */
       return 2;
     }
+    protection_levels(n_used, (const double (*)[4]) G,
+                      (const double (*)[4]) H, rx_state, raim);
     return 0;
-  } else {
-    if (n_used < 6) {
-      /* Not enough measurements to repair.
-       * 6 are needed because a 4 dimensional system is exactly constrained,
-       * so the bad measurement can't be detected.
-       */
-      return -2;
-    }
-    return pvt_repair(rx_state, n_used, nav_meas, omp, H, removed_sid);
   }
+  if (n_used < 6) {
+    /* Not enough measurements to repair.
+     * 6 are needed because a 4 dimensional system is exactly constrained,
+     * so the bad measurement can't be detected.
+     */
+    return -2;
+  }
+  flag = pvt_repair(rx_state, n_used, nav_meas, omp, G, H, raim);
+  if (flag == 1) {
+    protection_levels(n_used - raim->n_excluded, (const double (*)[4]) G,
+                      (const double (*)[4]) H, rx_state, raim);
+  }
+  return flag;
 }
 
 /** Error strings for calc_PVT() negative (failure) return codes.
@@ -516,40 +634,30 @@ s8 calc_PVT(const u8 n_used,
             gnss_solution *soln,
             dops_t *dops)
 {
-  /* Initial state is the center of the Earth with zero velocity and zero
-   * clock error, if we have some a priori position estimate we could use
-   * that here to speed convergence a little on the first iteration.
-   *
-   *  rx_state format:
-   *    pos[3], clock error, vel[3], intermediate freq error
-   */
-  static double rx_state[8];
-
-  double H[4][4];
-
-  if (n_used < 4) {
-    return -7;
-  }
-
-  soln->valid = 0;
-  soln->n_used = n_used; // Keep track of number of working channels
-
-  gnss_signal_t removed_sid;
-  s8 raim_flag = pvt_solve_raim(rx_state, n_used, nav_meas, disable_raim,
-                                H, &removed_sid, 0);
-
-  if (raim_flag < 0) {
-    /* Didn't converge or least squares integrity check failed. */
-    return raim_flag - 3;
-  }
-
-  /* Initial solution failed, but repair was successful. */
-  if (raim_flag == 1) {
-    soln->n_used--;
-  }
+  pvt_raim_t raim;
+  return calc_PVT_raim(n_used, nav_meas, disable_raim, soln, dops, &raim);
+}
 
+/** Fills in the solution from a converged state.
+ *
+ * \param rx_state solver state, position elements are reset if the solution
+ *                 is filtered out
+ * \param H see pvt_solve
+ * \param nav_meas first measurement used, for the time of transmission
+ * \param soln output solution struct, n_used already set
+ * \param dops output doppler information
+ *
+ * \return `0` if the solution is valid, otherwise the negated
+ *         filter_solution() code
+ */
+static s8 pvt_finish(double rx_state[],
+                     const double H[4][4],
+                     const navigation_measurement_t *nav_meas,
+                     gnss_solution *soln,
+                     dops_t *dops)
+{
   /* Compute various dilution of precision metrics. */
-  compute_dops((const double(*)[4])H, rx_state, dops);
+  compute_dops(H, rx_state, dops);
   soln->err_cov[6] = dops->gdop;
 
   /* Populate error covariances according to layout in definition
@@ -578,8 +686,8 @@ s8 calc_PVT(const u8 n_used,
 
   /* Time at receiver is TOT plus time of flight. Time of flight is eqaul to
    * the pseudorange minus the clock bias. */
-  soln->time = nav_meas[0].tot;
-  soln->time.tow += nav_meas[0].pseudorange / GPS_C;
+  soln->time = nav_meas->tot;
+  soln->time.tow += nav_meas->pseudorange / GPS_C;
   /* Subtract clock offset. */
   soln->time.tow -= rx_state[3] / GPS_C;
   normalize_gps_time(&soln->time);
@@ -596,5 +704,393 @@ s8 calc_PVT(const u8 n_used,
 
   soln->valid = 1;
 
+  return 0;
+}
+
+/** Single point solution starting from a given solver state.
+ * See calc_PVT_raim() for parameter meanings and return values.
+ *
+ * \param rx_state solver state, see calc_PVT_raim()
+ */
+static s8 pvt_epoch(double rx_state[],
+                    const u8 n_used,
+                    const navigation_measurement_t nav_meas[n_used],
+                    bool disable_raim,
+                    gnss_solution *soln,
+                    dops_t *dops,
+                    pvt_raim_t *raim)
+{
+  double H[4][4];
+
+  if (n_used < 4) {
+    return -7;
+  }
+
+  soln->valid = 0;
+  soln->n_used = n_used; // Keep track of number of working channels
+
+  s8 raim_flag = pvt_solve_raim(rx_state, n_used, nav_meas, disable_raim,
+                                H, raim);
+
+  if (raim_flag < 0) {
+    /* Didn't converge or least squares integrity check failed. */
+    return raim_flag - 3;
+  }
+
+  /* Initial solution failed, but repair was successful. */
+  if (raim_flag == 1) {
+    soln->n_used -= raim->n_excluded;
+  }
+
+  s8 ret = pvt_finish(rx_state, (const double (*)[4]) H, &nav_meas[0],
+                      soln, dops);
+  if (ret < 0) {
+    return ret;
+  }
+
   return raim_flag;
 }
+
+/** Try to calculate a single point gps solution, reporting RAIM details.
+ *
+ * As calc_PVT(), with the residual, protection levels and any excluded
+ * measurements stored in `raim`. Up to two faulty measurements can be
+ * excluded; `soln->n_used` is reduced accordingly.
+ *
+ * \param n_used number of measurments
+ * \param nav_meas array of measurements
+ * \param disable_raim passing True will omit raim check/repair functionality
+ * \param soln output solution struct
+ * \param dops output doppler information
+ * \param raim output RAIM results
+ * \return See calc_PVT()
+ */
+s8 calc_PVT_raim(const u8 n_used,
+                 const navigation_measurement_t nav_meas[n_used],
+                 bool disable_raim,
+                 gnss_solution *soln,
+                 dops_t *dops,
+                 pvt_raim_t *raim)
+{
+  /* Initial state is the center of the Earth with zero velocity and zero
+   * clock error, if we have some a priori position estimate we could use
+   * that here to speed convergence a little on the first iteration.
+   *
+   *  rx_state format:
+   *    pos[3], clock error, vel[3], intermediate freq error
+   */
+  static double rx_state[8];
+
+  return pvt_epoch(rx_state, n_used, nav_meas, disable_raim, soln, dops, raim);
+}
+
+/* Measurement slots per epoch in the batch solver, MAX_CHANNELS rounded up
+ * to a whole number of AVX2 vectors. */
+#define PVT_BATCH_SLOTS ((MAX_CHANNELS + 3) & ~3)
+
+/** One epoch's measurements and the last Gauss-Newton iteration's geometry,
+ * one array per field. Unused slots have zero weight. */
+typedef struct {
+  double x[PVT_BATCH_SLOTS];   /**< Satellite position X [m]. */
+  double y[PVT_BATCH_SLOTS];   /**< Satellite position Y [m]. */
+  double z[PVT_BATCH_SLOTS];   /**< Satellite position Z [m]. */
+  double pr[PVT_BATCH_SLOTS];  /**< Pseudorange [m]. */
+  double w[PVT_BATCH_SLOTS];   /**< 1 for used slots, 0 for padding. */
+  double gx[PVT_BATCH_SLOTS];  /**< Geometry matrix column X. */
+  double gy[PVT_BATCH_SLOTS];  /**< Geometry matrix column Y. */
+  double gz[PVT_BATCH_SLOTS];  /**< Geometry matrix column Z. */
+  double omp[PVT_BATCH_SLOTS]; /**< Observed minus predicted range [m]. */
+} pvt_soa_t;
+
+/* Normal equations of one pvt_solve() step, G^T G and G^T omp, with the
+ * geometry and residuals left in m. Same arithmetic as pvt_solve(). */
+static void pvt_normal_generic(pvt_soa_t *m, const double rx[3],
+                               double GtG[4][4], double Gtomp[4])
+{
+  double s[14] = {0};
+
+  for (u8 j = 0; j < PVT_BATCH_SLOTS; j++) {
+    double dx = rx[0] - m->x[j];
+    double dy = rx[1] - m->y[j];
+    double dz = rx[2] - m->z[j];
+    double tau = sqrt(dx*dx + dy*dy + dz*dz) / GPS_C;
+    double wEtau = GPS_OMEGAE_DOT * tau;
+    double lx = m->x[j] + wEtau * m->y[j] - rx[0];
+    double ly = m->y[j] - wEtau * m->x[j] - rx[1];
+    double lz = m->z[j] - rx[2];
+    double range = sqrt(lx*lx + ly*ly + lz*lz);
+    double w = m->w[j];
+    double omp = (m->pr[j] - range) * w;
+    double gx = -lx / range * w;
+    double gy = -ly / range * w;
+    double gz = -lz / range * w;
+    m->gx[j] = gx;
+    m->gy[j] = gy;
+    m->gz[j] = gz;
+    m->omp[j] = omp;
+    s[0] += gx*gx; s[1] += gx*gy; s[2] += gx*gz; s[3] += gx;
+    s[4] += gy*gy; s[5] += gy*gz; s[6] += gy;
+    s[7] += gz*gz; s[8] += gz;
+    s[9] += w;
+    s[10] += gx*omp; s[11] += gy*omp; s[12] += gz*omp; s[13] += omp;
+  }
+
+  GtG[0][0] = s[0]; GtG[0][1] = s[1]; GtG[0][2] = s[2]; GtG[0][3] = s[3];
+  GtG[1][1] = s[4]; GtG[1][2] = s[5]; GtG[1][3] = s[6];
+  GtG[2][2] = s[7]; GtG[2][3] = s[8];
+  GtG[3][3] = s[9];
+  for (u8 i = 1; i < 4; i++)
+    for (u8 k = 0; k < i; k++)
+      GtG[i][k] = GtG[k][i];
+  for (u8 i = 0; i < 4; i++)
+    Gtomp[i] = s[10 + i];
+}
+
+#ifdef PVT_X86_DISPATCH
+
+__attribute__((target("avx2")))
+static double pvt_hsum_avx2(__m256d v)
+{
+  __m128d x = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x)));
+}
+
+/* pvt_normal_generic() four measurements at a time. */
+__attribute__((target("avx2")))
+static void pvt_normal_avx2(pvt_soa_t *m, const double rx[3],
+                            double GtG[4][4], double Gtomp[4])
+{
+  const __m256d rx0 = _mm256_set1_pd(rx[0]);
+  const __m256d rx1 = _mm256_set1_pd(rx[1]);
+  const __m256d rx2 = _mm256_set1_pd(rx[2]);
+  const __m256d c = _mm256_set1_pd(GPS_C);
+  const __m256d omega = _mm256_set1_pd(GPS_OMEGAE_DOT);
+  const __m256d zero = _mm256_setzero_pd();
+  __m256d s[14];
+  for (u8 k = 0; k < 14; k++)
+    s[k] = zero;
+
+  for (u8 j = 0; j < PVT_BATCH_SLOTS; j += 4) {
+    __m256d x = _mm256_loadu_pd(&m->x[j]);
+    __m256d y = _mm256_loadu_pd(&m->y[j]);
+    __m256d z = _mm256_loadu_pd(&m->z[j]);
+    __m256d w = _mm256_loadu_pd(&m->w[j]);
+    __m256d dx = _mm256_sub_pd(rx0, x);
+    __m256d dy = _mm256_sub_pd(rx1, y);
+    __m256d dz = _mm256_sub_pd(rx2, z);
+    __m256d d2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx),
+                                             _mm256_mul_pd(dy, dy)),
+                               _mm256_mul_pd(dz, dz));
+    __m256d wEtau = _mm256_mul_pd(omega,
+                                  _mm256_div_pd(_mm256_sqrt_pd(d2), c));
+    __m256d lx = _mm256_sub_pd(_mm256_add_pd(x, _mm256_mul_pd(wEtau, y)), rx0);
+    __m256d ly = _mm256_sub_pd(_mm256_sub_pd(y, _mm256_mul_pd(wEtau, x)), rx1);
+    __m256d lz = _mm256_sub_pd(z, rx2);
+    __m256d r2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(lx, lx),
+                                             _mm256_mul_pd(ly, ly)),
+                               _mm256_mul_pd(lz, lz));
+    __m256d range = _mm256_sqrt_pd(r2);
+    __m256d omp = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(&m->pr[j]),
+                                              range), w);
+    __m256d gx = _mm256_mul_pd(_mm256_div_pd(_mm256_sub_pd(zero, lx), range), w);
+    __m256d gy = _mm256_mul_pd(_mm256_div_pd(_mm256_sub_pd(zero, ly), range), w);
+    __m256d gz = _mm256_mul_pd(_mm256_div_pd(_mm256_sub_pd(zero, lz), range), w);
+    _mm256_storeu_pd(&m->gx[j], gx);
+    _mm256_storeu_pd(&m->gy[j], gy);
+    _mm256_storeu_pd(&m->gz[j], gz);
+    _mm256_storeu_pd(&m->omp[j], omp);
+    s[0] = _mm256_add_pd(s[0], _mm256_mul_pd(gx, gx));
+    s[1] = _mm256_add_pd(s[1], _mm256_mul_pd(gx, gy));
+    s[2] = _mm256_add_pd(s[2], _mm256_mul_pd(gx, gz));
+    s[3] = _mm256_add_pd(s[3], gx);
+    s[4] = _mm256_add_pd(s[4], _mm256_mul_pd(gy, gy));
+    s[5] = _mm256_add_pd(s[5], _mm256_mul_pd(gy, gz));
+    s[6] = _mm256_add_pd(s[6], gy);
+    s[7] = _mm256_add_pd(s[7], _mm256_mul_pd(gz, gz));
+    s[8] = _mm256_add_pd(s[8], gz);
+    s[9] = _mm256_add_pd(s[9], w);
+    s[10] = _mm256_add_pd(s[10], _mm256_mul_pd(gx, omp));
+    s[11] = _mm256_add_pd(s[11], _mm256_mul_pd(gy, omp));
+    s[12] = _mm256_add_pd(s[12], _mm256_mul_pd(gz, omp));
+    s[13] = _mm256_add_pd(s[13], omp);
+  }
+
+  GtG[0][0] = pvt_hsum_avx2(s[0]);
+  GtG[0][1] = GtG[1][0] = pvt_hsum_avx2(s[1]);
+  GtG[0][2] = GtG[2][0] = pvt_hsum_avx2(s[2]);
+  GtG[0][3] = GtG[3][0] = pvt_hsum_avx2(s[3]);
+  GtG[1][1] = pvt_hsum_avx2(s[4]);
+  GtG[1][2] = GtG[2][1] = pvt_hsum_avx2(s[5]);
+  GtG[1][3] = GtG[3][1] = pvt_hsum_avx2(s[6]);
+  GtG[2][2] = pvt_hsum_avx2(s[7]);
+  GtG[2][3] = GtG[3][2] = pvt_hsum_avx2(s[8]);
+  GtG[3][3] = pvt_hsum_avx2(s[9]);
+  for (u8 i = 0; i < 4; i++)
+    Gtomp[i] = pvt_hsum_avx2(s[10 + i]);
+}
+
+#endif /* PVT_X86_DISPATCH */
+
+/** Check whether a batch PVT kernel can run on the host CPU.
+ *
+ * \param impl Kernel implementation.
+ * \return true if `impl` may be passed to calc_PVT_batch().
+ */
+bool pvt_impl_supported(pvt_impl_t impl)
+{
+  switch (impl) {
+  case PVT_IMPL_AUTO:
+  case PVT_IMPL_GENERIC:
+    return true;
+#ifdef PVT_X86_DISPATCH
+  case PVT_IMPL_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+/** Solves one batch epoch with the vectorised Gauss-Newton iteration,
+ * falling back to pvt_epoch() if RAIM fails.
+ * See calc_PVT_raim() for parameter meanings and return values.
+ */
+static s8 pvt_batch_epoch(pvt_impl_t impl,
+                          const u8 n_used,
+                          const navigation_measurement_t nav_meas[n_used],
+                          bool disable_raim,
+                          gnss_solution *soln,
+                          dops_t *dops)
+{
+  double rx_state[8] = {0};
+
+  if (n_used < 4) {
+    return -7;
+  }
+
+  assert(n_used <= MAX_CHANNELS);
+
+  soln->valid = 0;
+  soln->n_used = n_used;
+
+  pvt_soa_t m;
+  for (u8 j = 0; j < PVT_BATCH_SLOTS; j++) {
+    const navigation_measurement_t *nm = &nav_meas[MIN(j, n_used - 1)];
+    m.x[j] = nm->sat_pos[0];
+    m.y[j] = nm->sat_pos[1];
+    m.z[j] = nm->sat_pos[2];
+    m.pr[j] = nm->pseudorange;
+    m.w[j] = j < n_used ? 1 : 0;
+  }
+
+  double GtG[4][4], L[4][4], H[4][4], Gtomp[4], correction[4];
+  u8 iters;
+  for (iters = 0; iters < PVT_MAX_ITERATIONS; iters++) {
+#ifdef PVT_X86_DISPATCH
+    if (impl == PVT_IMPL_AVX2)
+      pvt_normal_avx2(&m, rx_state, GtG, Gtomp);
+    else
+#endif
+      pvt_normal_generic(&m, rx_state, GtG, Gtomp);
+    if (smat_cholesky(4, (double *) GtG, (double *) L) < 0) {
+      /* Degenerate geometry. */
+      return PVT_UNCONVERGED;
+    }
+    memcpy(correction, Gtomp, sizeof(correction));
+    smat_cholesky_solve(4, (double *) L, 1, correction);
+    for (u8 i = 0; i < 3; i++) {
+      rx_state[i] += correction[i];
+    }
+    rx_state[3] = correction[3];
+    if (vector_norm(3, correction) <= 0.001) {
+      break;
+    }
+  }
+  if (iters >= PVT_MAX_ITERATIONS) {
+    return PVT_UNCONVERGED;
+  }
+
+  if (!disable_raim) {
+    double ssq = 0;
+    for (u8 j = 0; j < n_used; j++) {
+      double r = m.omp[j] - rx_state[3];
+      ssq += r * r;
+    }
+    if (sqrt(ssq) >= PVT_RESIDUAL_THRESHOLD) {
+      /* Faulty epochs are rare, repair them with the full solver. */
+      pvt_raim_t raim;
+      memset(rx_state, 0, sizeof(rx_state));
+      return pvt_epoch(rx_state, n_used, nav_meas, disable_raim, soln, dops,
+                       &raim);
+    }
+  }
+
+  /* Velocity, as vel_solve(). */
+  double Gtv[4] = {0};
+  for (u8 j = 0; j < n_used; j++) {
+    double g[3] = {m.gx[j], m.gy[j], m.gz[j]};
+    double pdot_pred = -vector_dot(3, g, nav_meas[j].sat_vel);
+    double v = -nav_meas[j].doppler * GPS_C / GPS_L1_HZ - pdot_pred;
+    for (u8 i = 0; i < 3; i++) {
+      Gtv[i] += g[i] * v;
+    }
+    Gtv[3] += v;
+  }
+  memcpy(&rx_state[4], Gtv, sizeof(Gtv));
+  smat_cholesky_solve(4, (double *) L, 1, &rx_state[4]);
+  smat_cholesky_inverse(4, (double *) L, (double *) H);
+
+  s8 ret = pvt_finish(rx_state, (const double (*)[4]) H, &nav_meas[0],
+                      soln, dops);
+  if (ret < 0) {
+    return ret;
+  }
+
+  return (disable_raim || n_used == 4) ? PVT_CONVERGED_NO_RAIM :
+                                         PVT_CONVERGED_RAIM_OK;
+}
+
+/** Calculate single point solutions for a batch of independent epochs.
+ *
+ * Each epoch is solved as by calc_PVT() from a cold start, so the results
+ * don't depend on the order of the epochs and disjoint ranges of epochs can
+ * be solved concurrently from different threads. The measurements are
+ * copied into a struct-of-arrays layout per epoch and the Gauss-Newton
+ * iterations run on whole vectors of measurements. Epochs failing the RAIM
+ * check are handed to the full single epoch solver for repair.
+ *
+ * \param impl      Kernel to use, must be supported by the host CPU, see
+ *                  pvt_impl_supported(). #PVT_IMPL_AUTO selects the fastest
+ *                  available kernel.
+ * \param n_epochs  Number of epochs
+ * \param n_used    Number of measurements of each epoch
+ * \param nav_meas  Measurements of all epochs, one epoch after the other
+ * \param disable_raim passing True will omit raim check/repair functionality
+ * \param ret       Output calc_PVT() return code of each epoch
+ * \param soln      Output solution of each epoch
+ * \param dops      Output doppler information of each epoch
+ * \return Number of epochs with a valid solution
+ */
+u32 calc_PVT_batch(pvt_impl_t impl,
+                   u32 n_epochs,
+                   const u8 n_used[],
+                   const navigation_measurement_t nav_meas[],
+                   bool disable_raim,
+                   s8 ret[],
+                   gnss_solution soln[],
+                   dops_t dops[])
+{
+  if (impl == PVT_IMPL_AUTO)
+    impl = pvt_impl_supported(PVT_IMPL_AVX2) ? PVT_IMPL_AVX2 : PVT_IMPL_GENERIC;
+  assert(pvt_impl_supported(impl));
+
+  u32 n_valid = 0;
+  for (u32 e = 0; e < n_epochs; e++) {
+    ret[e] = pvt_batch_epoch(impl, n_used[e], nav_meas, disable_raim,
+                             &soln[e], &dops[e]);
+    if (ret[e] >= 0)
+      n_valid++;
+    nav_meas += n_used[e];
+  }
+  return n_valid;
+}
@@ -11,17 +11,44 @@
  */
 
 #include <math.h>
+#include <string.h>
 
 #include <libswiftnav/bits.h>
+#include <libswiftnav/constants.h>
 #include <libswiftnav/edc.h>
 #include <libswiftnav/rtcm3.h>
 
 #define RTCM3_PREAMBLE 0xD3 /**< RTCM v3 Frame sync / preamble byte. */
 #define PRUNIT_GPS 299792.458 /**< RTCM v3 Unit of GPS Pseudorange (m) */
 
+#define PRUNIT_GLO 599584.916 /**< RTCM v3 Unit of GLONASS Pseudorange (m) */
+
 #define CLIGHT  299792458.0         /* speed of light (m/s) */
 #define FREQ1   1.57542e9           /* L1/E1  frequency (Hz) */
+#define FREQ2   1.22760e9           /* L2     frequency (Hz) */
 #define LAMBDA1 (CLIGHT / FREQ1)
+#define FREQ1_GLO  1.60200e9        /* GLONASS G1 base frequency (Hz) */
+#define DFREQ1_GLO 0.56250e6        /* GLONASS G1 bias frequency (Hz/n) */
+#define FREQ2_GLO  1.24600e9        /* GLONASS G2 base frequency (Hz) */
+#define DFREQ2_GLO 0.43750e6        /* GLONASS G2 bias frequency (Hz/n) */
+
+#define RANGE_MS (CLIGHT * 1e-3)    /* range of one light millisecond (m) */
+
+/* Invalid values of the observation data fields. */
+#define OBS_PPR_INVALID (-0x80000)          /* DF012, DF018, DF042, DF048 */
+#define OBS_DIFF_INVALID (-0x2000)          /* DF017, DF047 */
+#define MSM_ROUGH_RANGE_INVALID (0xFF << 10) /* DF397, DF398 */
+#define MSM_ROUGH_RATE_INVALID (-0x2000)    /* DF399 */
+#define MSM_FINE_RATE_INVALID (-0x4000)     /* DF404 */
+
+/* Ephemeris scale factors. */
+#define P2_5  0x1p5
+#define P2_19 0x1p19
+#define P2_29 0x1p29
+#define P2_31 0x1p31
+#define P2_33 0x1p33
+#define P2_43 0x1p43
+#define P2_55 0x1p55
 
 /** \addtogroup io Input / Output
  * \{ */
@@ -177,13 +204,15 @@ void rtcm3_write_header(u8 *buff, u16 type, u16 id, gps_time_t t,
 void rtcm3_read_header(u8 *buff, u16 *type, u16 *id, double *tow,
                        u8 *sync, u8 *n_sat, u8 *div_free, u8 *smooth)
 {
-  *type = getbitu(buff, 0, 12);
-  *id = getbitu(buff, 12, 12);
-  *tow = getbitu(buff, 24, 30) / 1e3;
-  *sync = getbitu(buff, 54, 1);
-  *n_sat = getbitu(buff, 55, 5);
-  *div_free = getbitu(buff, 60, 1);
-  *smooth = getbitu(buff, 61, 3);
+  bitstream_t s;
+  bitstream_init(&s, buff, 0);
+  *type = bitstream_getu(&s, 12);
+  *id = bitstream_getu(&s, 12);
+  *tow = bitstream_getu(&s, 30) / 1e3;
+  *sync = bitstream_getu(&s, 1);
+  *n_sat = bitstream_getu(&s, 5);
+  *div_free = bitstream_getu(&s, 1);
+  *smooth = bitstream_getu(&s, 3);
 }
 
 /** Convert a lock time in seconds into a RTCMv3 Lock Time Indicator value.
@@ -353,23 +382,24 @@ s8 rtcm3_decode_1002(u8 *buff, u16 *id, double *tow, u8 *n_sat,
      * n_sat so we are all done. */
     return 0;
 
-  u16 bit = 64;
+  bitstream_t s;
+  bitstream_init(&s, buff, 64);
   for (u8 i=0; i<*n_sat; i++) {
     /* TODO: Handle SBAS prns properly, numbered differently in RTCM? */
-    nm[i].sid.sat = getbitu(buff, bit, 6); bit += 6;
+    nm[i].sid.sat = bitstream_getu(&s, 6);
 
-    u8 code = getbitu(buff, bit, 1); bit += 1;
+    u8 code = bitstream_getu(&s, 1);
     /* TODO: When we start storing the signal/system etc. properly we can
      * store the code flag in the nav meas struct. */
     if (code == 1)
       /* P(Y) code not currently supported. */
       return -2;
 
-    u32 pr = getbitu(buff, bit,24); bit += 24;
-    s32 ppr = getbits(buff, bit,20); bit += 20;
-    u8 lock = getbitu(buff, bit, 7); bit += 7;
-    u8 amb = getbitu(buff, bit, 8); bit += 8;
-    u8 cnr = getbitu(buff, bit, 8); bit += 8;
+    u32 pr = bitstream_getu(&s, 24);
+    s32 ppr = bitstream_gets(&s, 20);
+    u8 lock = bitstream_getu(&s, 7);
+    u8 amb = bitstream_getu(&s, 8);
+    u8 cnr = bitstream_getu(&s, 8);
 
     nm[i].raw_pseudorange = 0.02*pr + PRUNIT_GPS*amb;
     nm[i].carrier_phase = (nm[i].raw_pseudorange + 0.0005*ppr) / (CLIGHT / FREQ1);
@@ -380,6 +410,859 @@ s8 rtcm3_decode_1002(u8 *buff, u16 *id, double *tow, u8 *n_sat,
   return 0;
 }
 
+/** Carrier frequency of a GLONASS FDMA signal.
+ *
+ * \param band 0 for L1, 1 for L2.
+ * \param fcn Frequency channel number, -7..13.
+ * \return Carrier frequency [Hz].
+ */
+static double glo_freq(u8 band, s8 fcn)
+{
+  return band == 0 ? FREQ1_GLO + fcn * DFREQ1_GLO
+                   : FREQ2_GLO + fcn * DFREQ2_GLO;
+}
+
+/** Encode the satellite fields of one 1004 or 1012 observation.
+ *
+ * If the phase has drifted too far from the pseudorange to fit the data
+ * field it is moved by a whole number of cycles and the lock time sent as
+ * zero, as is done for message 1002.
+ *
+ * \param buff A pointer to the RTCM data message buffer.
+ * \param bit Bit position of the satellite fields.
+ * \param obs Observation to encode.
+ * \param glo Set for message 1012, clear for message 1004.
+ * \return Bit position following the satellite fields.
+ */
+static u16 encode_obs(u8 *buff, u16 bit, const rtcm3_obs_t *obs, bool glo)
+{
+  double unit = glo ? PRUNIT_GLO : PRUNIT_GPS;
+  double lambda[2];
+  for (u8 b = 0; b < 2; b++)
+    lambda[b] = CLIGHT / (glo ? glo_freq(b, obs->fcn) : (b ? FREQ2 : FREQ1));
+
+  u32 amb = (u32)(obs->pseudorange[0] / unit);
+  u32 pr = (u32)lround((obs->pseudorange[0] - amb * unit) / 0.02);
+  /* Pseudorange as transmitted, which the other fields are relative to. */
+  double prc = pr * 0.02 + amb * unit;
+
+  s32 ppr[2], pr_diff = OBS_DIFF_INVALID;
+  u8 lock[2], cnr[2];
+  for (u8 b = 0; b < 2; b++) {
+    ppr[b] = OBS_PPR_INVALID;
+    lock[b] = to_lock_ind(obs->lock_time[b]);
+    cnr[b] = (u8)MIN(MAX(lround(obs->cnr[b] * 4.0), 0), 255);
+
+    if (b == 1 && (obs->flags[1] & RTCM3_OBS_PR)) {
+      double diff = (obs->pseudorange[1] - prc) / 0.02;
+      if (fabs(diff) < 8191)
+        pr_diff = lround(diff);
+    }
+
+    if (obs->flags[b] & RTCM3_OBS_CP) {
+      double cp_pr = obs->carrier_phase[b] - prc / lambda[b];
+      if (fabs(cp_pr) > 1000) {
+        lock[b] = 0;
+        cp_pr -= (s32)cp_pr;
+      }
+      ppr[b] = lround(cp_pr * lambda[b] / 0.0005);
+    }
+  }
+
+  setbitu(buff, bit, 6, obs->sat);          bit += 6;
+  setbitu(buff, bit, 1, obs->code[0]);      bit += 1;
+  if (glo) {
+    setbitu(buff, bit, 5, obs->fcn + 7);    bit += 5;
+    setbitu(buff, bit, 25, pr);             bit += 25;
+  } else {
+    setbitu(buff, bit, 24, pr);             bit += 24;
+  }
+  setbits(buff, bit, 20, ppr[0]);           bit += 20;
+  setbitu(buff, bit, 7, lock[0]);           bit += 7;
+  setbitu(buff, bit, glo ? 7 : 8, amb);     bit += glo ? 7 : 8;
+  setbitu(buff, bit, 8, cnr[0]);            bit += 8;
+  setbitu(buff, bit, 2, obs->code[1]);      bit += 2;
+  setbits(buff, bit, 14, pr_diff);          bit += 14;
+  setbits(buff, bit, 20, ppr[1]);           bit += 20;
+  setbitu(buff, bit, 7, lock[1]);           bit += 7;
+  setbitu(buff, bit, 8, cnr[1]);            bit += 8;
+
+  return bit;
+}
+
+/** Decode the satellite fields of one 1004 or 1012 observation.
+ *
+ * \param s Bit stream positioned at the satellite fields.
+ * \param obs Decoded observation.
+ * \param glo Set for message 1012, clear for message 1004.
+ */
+static void decode_obs(bitstream_t *s, rtcm3_obs_t *obs, bool glo)
+{
+  u32 pr, amb;
+  s32 ppr[2], pr_diff;
+  u8 lock[2], cnr[2];
+
+  obs->sat = bitstream_getu(s, 6);
+  obs->code[0] = bitstream_getu(s, 1);
+  if (glo) {
+    obs->fcn = (s8)bitstream_getu(s, 5) - 7;
+    pr = bitstream_getu(s, 25);
+  } else {
+    obs->fcn = 0;
+    pr = bitstream_getu(s, 24);
+  }
+  ppr[0] = bitstream_gets(s, 20);
+  lock[0] = bitstream_getu(s, 7);
+  amb = bitstream_getu(s, glo ? 7 : 8);
+  cnr[0] = bitstream_getu(s, 8);
+  obs->code[1] = bitstream_getu(s, 2);
+  pr_diff = bitstream_gets(s, 14);
+  ppr[1] = bitstream_gets(s, 20);
+  lock[1] = bitstream_getu(s, 7);
+  cnr[1] = bitstream_getu(s, 8);
+
+  double pr1 = pr * 0.02 + amb * (glo ? PRUNIT_GLO : PRUNIT_GPS);
+  for (u8 b = 0; b < 2; b++) {
+    double lambda = CLIGHT / (glo ? glo_freq(b, obs->fcn)
+                                  : (b ? FREQ2 : FREQ1));
+    obs->flags[b] = 0;
+    obs->pseudorange[b] = 0;
+    obs->carrier_phase[b] = 0;
+    if (b == 0) {
+      obs->pseudorange[0] = pr1;
+      obs->flags[0] |= RTCM3_OBS_PR;
+    } else if (pr_diff != OBS_DIFF_INVALID) {
+      obs->pseudorange[1] = pr1 + pr_diff * 0.02;
+      obs->flags[1] |= RTCM3_OBS_PR;
+    }
+    if (ppr[b] != OBS_PPR_INVALID) {
+      obs->carrier_phase[b] = (pr1 + ppr[b] * 0.0005) / lambda;
+      obs->flags[b] |= RTCM3_OBS_CP;
+    }
+    obs->lock_time[b] = from_lock_ind(lock[b]);
+    obs->cnr[b] = cnr[b] / 4.0;
+  }
+}
+
+/** Encode an RTCMv3 message type 1004 (Extended L1&L2 GPS RTK Observables)
+ * Message type 1004 has length `64 + n_sat*125` bits. Returned message length
+ * is rounded up to the nearest whole byte.
+ *
+ * \param buff A pointer to the RTCM data message buffer.
+ * \param msg Message to encode.
+ * \return The message length in bytes.
+ */
+u16 rtcm3_encode_1004(u8 *buff, const rtcm3_obs_msg_t *msg)
+{
+  setbitu(buff, 0, 12, 1004);
+  setbitu(buff, 12, 12, msg->id);
+  setbitu(buff, 24, 30, msg->tow_ms);
+  setbitu(buff, 54, 1, msg->sync);
+  setbitu(buff, 55, 5, msg->n_sat);
+  setbitu(buff, 60, 1, msg->div_free);
+  setbitu(buff, 61, 3, msg->smooth);
+
+  u16 bit = 64;
+  for (u8 i = 0; i < msg->n_sat; i++)
+    bit = encode_obs(buff, bit, &msg->obs[i], false);
+
+  return (bit + 7) / 8;
+}
+
+/** Decode an RTCMv3 message type 1004 (Extended L1&L2 GPS RTK Observables)
+ *
+ * \param buff A pointer to the RTCM data message buffer.
+ * \param msg Decoded message.
+ * \return If valid then return 0.
+ *         Returns a negative number if the message is invalid:
+ *          - `-1` : Message type mismatch
+ */
+s8 rtcm3_decode_1004(const u8 *buff, rtcm3_obs_msg_t *msg)
+{
+  bitstream_t s;
+  bitstream_init(&s, buff, 0);
+  if (bitstream_getu(&s, 12) != 1004)
+    return -1;
+
+  msg->id = bitstream_getu(&s, 12);
+  msg->tow_ms = bitstream_getu(&s, 30);
+  msg->sync = bitstream_getu(&s, 1);
+  msg->n_sat = bitstream_getu(&s, 5);
+  msg->div_free = bitstream_getu(&s, 1);
+  msg->smooth = bitstream_getu(&s, 3);
+
+  for (u8 i = 0; i < msg->n_sat; i++)
+    decode_obs(&s, &msg->obs[i], false);
+
+  return 0;
+}
+
+/** Encode an RTCMv3 message type 1012 (Extended L1&L2 GLONASS RTK
+ * Observables)
+ * Message type 1012 has length `61 + n_sat*130` bits. Returned message length
+ * is rounded up to the nearest whole byte.
+ *
+ * \param buff A pointer to the RTCM data message buffer.
+ * \param msg Message to encode, `tow_ms` holds the GLONASS time of day.
+ * \return The message length in bytes.
+ */
+u16 rtcm3_encode_1012(u8 *buff, const rtcm3_obs_msg_t *msg)
+{
+  setbitu(buff, 0, 12, 1012);
+  setbitu(buff, 12, 12, msg->id);
+  setbitu(buff, 24, 27, msg->tow_ms);
+  setbitu(buff, 51, 1, msg->sync);
+  setbitu(buff, 52, 5, msg->n_sat);
+  setbitu(buff, 57, 1, msg->div_free);
+  setbitu(buff, 58, 3, msg->smooth);
+
+  u16 bit = 61;
+  for (u8 i = 0; i < msg->n_sat; i++)
+    bit = encode_obs(buff, bit, &msg->obs[i], true);
+
+  /* Clear the padding bits. */
+  if (bit % 8)
+    setbitu(buff, bit, 8 - bit % 8, 0);
+
+  return (bit + 7) / 8;
+}
+
+/** Decode an RTCMv3 message type 1012 (Extended L1&L2 GLONASS RTK
+ * Observables)
+ *
+ * \param buff A pointer to the RTCM data message buffer.
+ * \param msg Decoded message, `tow_ms` holds the GLONASS time of day.
+ * \return If valid then return 0.
+ *         Returns a negative number if the message is invalid:
+ *          - `-1` : Message type mismatch
+ */
+s8 rtcm3_decode_1012(const u8 *buff, rtcm3_obs_msg_t *msg)
+{
+  bitstream_t s;
+  bitstream_init(&s, buff, 0);
+  if (bitstream_getu(&s, 12) != 1012)
+    return -1;
+
+  msg->id = bitstream_getu(&s, 12);
+  msg->tow_ms = bitstream_getu(&s, 27);
+  msg->sync = bitstream_getu(&s, 1);
+  msg->n_sat = bitstream_getu(&s, 5);
+  msg->div_free = bitstream_getu(&s, 1);
+  msg->smooth = bitstream_getu(&s, 3);
+
+  for (u8 i = 0; i < msg->n_sat; i++)
+    decode_obs(&s, &msg->obs[i], true);
 
+  return 0;
+}
+
+/** Convert an MSM lock time indicator into a minimum lock time.
+ * See RTCM 10403.2, Tables 3.5-74 (DF402) and 3.5-75 (DF407).
+ *
+ * \param ind Lock Time Indicator value.
+ * \param ext Set for the extended resolution indicator, DF407.
+ * \return Minimum lock time [ms].
+ */
+static u32 msm_lock_time(u16 ind, bool ext)
+{
+  if (!ext)
+    return ind == 0 ? 0 : 1u << (ind + 4);
+
+  if (ind < 64)
+    return ind;
+  if (ind >= 704)
+    return 67108864;
+  /* Each further run of 32 indicators doubles the step. */
+  u8 k = ind / 32 - 1;
+  return (32u << k) + ((ind % 32) << k);
+}
+
+/** Convert a minimum lock time into an MSM lock time indicator.
+ *
+ * \param ms Lock time [ms].
+ * \param ext Set for the extended resolution indicator, DF407.
+ * \return Largest Lock Time Indicator value not exceeding the lock time.
+ */
+static u16 msm_lock_ind(u32 ms, bool ext)
+{
+  if (ext && ms < 64)
+    return ms;
+
+  /* Find the doubling k with 32 * 2^k <= ms < 32 * 2^(k+1). */
+  u8 k = 0;
+  while (k < 21 && (32u << (k + 1)) <= ms)
+    k++;
+
+  if (!ext)
+    return ms < 32 ? 0 : MIN(k + 1, 15);
+  if (k >= 21)
+    return 704;
+  return 32 * (k + 1) + ((ms - (32u << k)) >> k);
+}
+
+/** Encode an RTCMv3 MSM4, MSM5 or MSM7 Multiple Signal Message.
+ *
+ * The satellite and signal masks are built from the satellite IDs and the
+ * signal IDs of the cells. The rough range and range rate of each
+ * satellite are taken from its first valid cell.
+ *
+ * \param buff A pointer to the RTCM data message buffer.
+ * \param msg Message to encode, `type` selects the constellation and MSM
+ *            type.
+ * \return The message length in bytes.
+ *         Returns a negative number if the message can't be encoded:
+ *          - `-1` : Message type is not MSM4, MSM5 or MSM7
+ *          - `-2` : Satellites or cells are not in order
+ *          - `-3` : More than #RTCM3_MSM_MAX_CELLS cells in the cell mask
+ */
+s16 rtcm3_encode_msm(u8 *buff, const rtcm3_msm_t *msg)
+{
+  u8 msm = msg->type % 10;
+  if (msg->type < 1071 || msg->type > 1137 ||
+      (msm != 4 && msm != 5 && msm != 7))
+    return -1;
+  bool ext = msm != 4;
+  bool hr = msm == 7;
+
+  /* Satellite and signal masks. */
+  u32 sat_mask[2] = {0, 0};
+  u32 sig_mask = 0;
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    if (msg->sats[i].id < 1 || msg->sats[i].id > RTCM3_MSM_MAX_SATS ||
+        (i > 0 && msg->sats[i].id <= msg->sats[i-1].id))
+      return -2;
+    u8 m = msg->sats[i].id - 1;
+    sat_mask[m / 32] |= 0x80000000u >> (m % 32);
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    const rtcm3_msm_cell_t *c = &msg->cells[j];
+    if (c->sat >= msg->n_sat || c->sig < 1 || c->sig > RTCM3_MSM_MAX_SIGS ||
+        (j > 0 && (c->sat < msg->cells[j-1].sat ||
+                   (c->sat == msg->cells[j-1].sat &&
+                    c->sig <= msg->cells[j-1].sig))))
+      return -2;
+    sig_mask |= 0x80000000u >> (c->sig - 1);
+  }
+
+  /* Signal ID to signal mask index. */
+  u8 sig_index[RTCM3_MSM_MAX_SIGS + 1];
+  u8 n_sig = 0;
+  for (u8 s = 1; s <= RTCM3_MSM_MAX_SIGS; s++)
+    if (sig_mask & (0x80000000u >> (s - 1)))
+      sig_index[s] = n_sig++;
+  if (msg->n_sat * n_sig > RTCM3_MSM_MAX_CELLS)
+    return -3;
+
+  setbitu(buff, 0, 12, msg->type);
+  setbitu(buff, 12, 12, msg->id);
+  setbitu(buff, 24, 30, msg->epoch);
+  setbitu(buff, 54, 1, msg->multiple);
+  setbitu(buff, 55, 3, msg->iods);
+  setbitu(buff, 58, 7, 0);
+  setbitu(buff, 65, 2, msg->clock_steering);
+  setbitu(buff, 67, 2, msg->ext_clock);
+  setbitu(buff, 69, 1, msg->div_free);
+  setbitu(buff, 70, 3, msg->smooth);
+  setbitu(buff, 73, 32, sat_mask[0]);
+  setbitu(buff, 105, 32, sat_mask[1]);
+  setbitu(buff, 137, 32, sig_mask);
+
+  u16 bit = 169;
+  u8 cell_mask[RTCM3_MSM_MAX_CELLS] = {0};
+  for (u8 j = 0; j < msg->n_cell; j++)
+    cell_mask[msg->cells[j].sat * n_sig + sig_index[msg->cells[j].sig]] = 1;
+  for (u16 k = 0; k < msg->n_sat * n_sig; k++)
+    setbitu(buff, bit++, 1, cell_mask[k]);
+
+  /* Rough range [2^-10 ms] and rate [m/s] of each satellite. */
+  s32 rough_range[RTCM3_MSM_MAX_SATS];
+  s32 rough_rate[RTCM3_MSM_MAX_SATS];
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    rough_range[i] = MSM_ROUGH_RANGE_INVALID;
+    rough_rate[i] = MSM_ROUGH_RATE_INVALID;
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    const rtcm3_msm_cell_t *c = &msg->cells[j];
+    if (rough_range[c->sat] == MSM_ROUGH_RANGE_INVALID &&
+        (c->flags & (RTCM3_OBS_PR | RTCM3_OBS_CP))) {
+      double r = (c->flags & RTCM3_OBS_PR) ? c->pseudorange : c->phase_range;
+      s32 rr = lround(r / RANGE_MS * 1024);
+      if (rr >= 0 && rr < MSM_ROUGH_RANGE_INVALID)
+        rough_range[c->sat] = rr;
+    }
+    if (rough_rate[c->sat] == MSM_ROUGH_RATE_INVALID &&
+        (c->flags & RTCM3_OBS_RATE) && fabs(c->phase_range_rate) < 8191)
+      rough_rate[c->sat] = lround(c->phase_range_rate);
+  }
+
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    setbitu(buff, bit, 8, rough_range[i] >> 10); bit += 8;
+  }
+  if (ext)
+    for (u8 i = 0; i < msg->n_sat; i++) {
+      setbitu(buff, bit, 4, msg->sats[i].ext_info); bit += 4;
+    }
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    setbitu(buff, bit, 10, rough_range[i] & 0x3FF); bit += 10;
+  }
+  if (ext)
+    for (u8 i = 0; i < msg->n_sat; i++) {
+      setbits(buff, bit, 14, rough_rate[i]); bit += 14;
+    }
+
+  /* Signal data, each field for all cells in turn. */
+  u8 pr_bits = hr ? 20 : 15, cp_bits = hr ? 24 : 22;
+  double pr_scale = hr ? 0x1p29 : 0x1p24, cp_scale = hr ? 0x1p31 : 0x1p29;
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    const rtcm3_msm_cell_t *c = &msg->cells[j];
+    s32 invalid = -(1 << (pr_bits - 1));
+    s32 fine = invalid;
+    if ((c->flags & RTCM3_OBS_PR) &&
+        rough_range[c->sat] != MSM_ROUGH_RANGE_INVALID) {
+      double d = (c->pseudorange / RANGE_MS - rough_range[c->sat] / 1024.0) *
+                 pr_scale;
+      if (fabs(d) < -invalid - 1)
+        fine = lround(d);
+    }
+    setbits(buff, bit, pr_bits, fine); bit += pr_bits;
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    const rtcm3_msm_cell_t *c = &msg->cells[j];
+    s32 invalid = -(1 << (cp_bits - 1));
+    s32 fine = invalid;
+    if ((c->flags & RTCM3_OBS_CP) &&
+        rough_range[c->sat] != MSM_ROUGH_RANGE_INVALID) {
+      double d = (c->phase_range / RANGE_MS - rough_range[c->sat] / 1024.0) *
+                 cp_scale;
+      if (fabs(d) < -invalid - 1)
+        fine = lround(d);
+    }
+    setbits(buff, bit, cp_bits, fine); bit += cp_bits;
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    u8 n = hr ? 10 : 4;
+    setbitu(buff, bit, n, msm_lock_ind(msg->cells[j].lock_time, hr));
+    bit += n;
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    setbitu(buff, bit, 1, msg->cells[j].half_cycle); bit += 1;
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    if (hr) {
+      setbitu(buff, bit, 10,
+              MIN(MAX(lround(msg->cells[j].cnr * 16), 0), 1023));
+      bit += 10;
+    } else {
+      setbitu(buff, bit, 6, MIN(MAX(lround(msg->cells[j].cnr), 0), 63));
+      bit += 6;
+    }
+  }
+  if (ext)
+    for (u8 j = 0; j < msg->n_cell; j++) {
+      const rtcm3_msm_cell_t *c = &msg->cells[j];
+      s32 fine = MSM_FINE_RATE_INVALID;
+      if ((c->flags & RTCM3_OBS_RATE) &&
+          rough_rate[c->sat] != MSM_ROUGH_RATE_INVALID) {
+        double d = (c->phase_range_rate - rough_rate[c->sat]) / 0.0001;
+        if (fabs(d) < -MSM_FINE_RATE_INVALID - 1)
+          fine = lround(d);
+      }
+      setbits(buff, bit, 15, fine); bit += 15;
+    }
+
+  if (bit % 8)
+    setbitu(buff, bit, 8 - bit % 8, 0);
+
+  return (bit + 7) / 8;
+}
+
+/** Decode an RTCMv3 MSM4, MSM5 or MSM7 Multiple Signal Message.
+ *
+ * \param buff A pointer to the RTCM data message buffer.
+ * \param msg Decoded message.
+ * \return If valid then return 0.
+ *         Returns a negative number if the message is invalid:
+ *          - `-1` : Message type is not MSM4, MSM5 or MSM7
+ *          - `-3` : More than #RTCM3_MSM_MAX_CELLS cells in the cell mask
+ */
+s8 rtcm3_decode_msm(const u8 *buff, rtcm3_msm_t *msg)
+{
+  bitstream_t s;
+  bitstream_init(&s, buff, 0);
+  msg->type = bitstream_getu(&s, 12);
+  u8 msm = msg->type % 10;
+  if (msg->type < 1071 || msg->type > 1137 ||
+      (msm != 4 && msm != 5 && msm != 7))
+    return -1;
+  bool ext = msm != 4;
+  bool hr = msm == 7;
+
+  msg->id = bitstream_getu(&s, 12);
+  msg->epoch = bitstream_getu(&s, 30);
+  msg->multiple = bitstream_getu(&s, 1);
+  msg->iods = bitstream_getu(&s, 3);
+  bitstream_skip(&s, 7); /* Reserved */
+  msg->clock_steering = bitstream_getu(&s, 2);
+  msg->ext_clock = bitstream_getu(&s, 2);
+  msg->div_free = bitstream_getu(&s, 1);
+  msg->smooth = bitstream_getu(&s, 3);
+
+  /* Satellite and signal masks, MSB first. */
+  msg->n_sat = 0;
+  for (u8 w = 0; w < RTCM3_MSM_MAX_SATS / 32; w++) {
+    u32 mask = bitstream_getu(&s, 32);
+    for (u8 m = 0; m < 32; m++)
+      if (mask & (1u << (31 - m)))
+        msg->sats[msg->n_sat++].id = 32 * w + m + 1;
+  }
+  u8 sig_ids[RTCM3_MSM_MAX_SIGS];
+  u8 n_sig = 0;
+  u32 sig_mask = bitstream_getu(&s, RTCM3_MSM_MAX_SIGS);
+  for (u8 k = 0; k < RTCM3_MSM_MAX_SIGS; k++)
+    if (sig_mask & (1u << (RTCM3_MSM_MAX_SIGS - 1 - k)))
+      sig_ids[n_sig++] = k + 1;
+  if (msg->n_sat * n_sig > RTCM3_MSM_MAX_CELLS)
+    return -3;
+
+  msg->n_cell = 0;
+  for (u8 i = 0; i < msg->n_sat; i++)
+    for (u8 k = 0; k < n_sig; k++)
+      if (bitstream_getu(&s, 1)) {
+        msg->cells[msg->n_cell].sat = i;
+        msg->cells[msg->n_cell].sig = sig_ids[k];
+        msg->n_cell++;
+      }
+
+  s32 rough_range[RTCM3_MSM_MAX_SATS];
+  s32 rough_rate[RTCM3_MSM_MAX_SATS];
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    rough_range[i] = bitstream_getu(&s, 8) << 10;
+  }
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    msg->sats[i].ext_info = ext ? bitstream_getu(&s, 4) : 0;
+  }
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    rough_range[i] |= bitstream_getu(&s, 10);
+  }
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    rough_rate[i] = ext ? bitstream_gets(&s, 14) : MSM_ROUGH_RATE_INVALID;
+  }
+
+  u8 pr_bits = hr ? 20 : 15, cp_bits = hr ? 24 : 22;
+  double pr_scale = hr ? 0x1p-29 : 0x1p-24, cp_scale = hr ? 0x1p-31 : 0x1p-29;
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    rtcm3_msm_cell_t *c = &msg->cells[j];
+    bool rough_valid = (rough_range[c->sat] >> 10) != 0xFF;
+    double rough = rough_range[c->sat] / 1024.0;
+    c->flags = 0;
+    c->pseudorange = 0;
+    c->phase_range = 0;
+    c->phase_range_rate = 0;
+    s32 fine = bitstream_gets(&s, pr_bits);
+    if (rough_valid && fine != -(1 << (pr_bits - 1))) {
+      c->pseudorange = (rough + fine * pr_scale) * RANGE_MS;
+      c->flags |= RTCM3_OBS_PR;
+    }
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    rtcm3_msm_cell_t *c = &msg->cells[j];
+    bool rough_valid = (rough_range[c->sat] >> 10) != 0xFF;
+    s32 fine = bitstream_gets(&s, cp_bits);
+    if (rough_valid && fine != -(1 << (cp_bits - 1))) {
+      c->phase_range = (rough_range[c->sat] / 1024.0 + fine * cp_scale) *
+                       RANGE_MS;
+      c->flags |= RTCM3_OBS_CP;
+    }
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    u8 n = hr ? 10 : 4;
+    msg->cells[j].lock_time = msm_lock_time(bitstream_getu(&s, n), hr);
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    msg->cells[j].half_cycle = bitstream_getu(&s, 1);
+  }
+  for (u8 j = 0; j < msg->n_cell; j++) {
+    if (hr) {
+      msg->cells[j].cnr = bitstream_getu(&s, 10) / 16.0;
+    } else {
+      msg->cells[j].cnr = bitstream_getu(&s, 6);
+    }
+  }
+  if (ext)
+    for (u8 j = 0; j < msg->n_cell; j++) {
+      rtcm3_msm_cell_t *c = &msg->cells[j];
+      s32 fine = bitstream_gets(&s, 15);
+      if (rough_rate[c->sat] != MSM_ROUGH_RATE_INVALID &&
+          fine != MSM_FINE_RATE_INVALID) {
+        c->phase_range_rate = rough_rate[c->sat] + fine * 0.0001;
+        c->flags |= RTCM3_OBS_RATE;
+      }
+    }
+
+  return 0;
+}
+
+/** Encode an RTCMv3 message type 1019 (GPS Ephemerides)
+ * Message type 1019 has length 488 bits, 61 bytes.
+ *
+ * \param buff A pointer to the RTCM data message buffer.
+ * \param e GPS ephemeris to encode.
+ * \return The message length in bytes.
+ */
+u16 rtcm3_encode_1019(u8 *buff, const ephemeris_t *e)
+{
+  const ephemeris_kepler_t *k = &e->kepler;
+
+  u8 ura_index = 0;
+  while (ura_index < 15 && decode_ura_index(ura_index) < e->ura)
+    ura_index++;
+
+  u16 bit = 0;
+  setbitu(buff, bit, 12, 1019);                               bit += 12;
+  setbitu(buff, bit, 6, e->sid.sat);                          bit += 6;
+  setbitu(buff, bit, 10, e->toe.wn % 1024);                   bit += 10;
+  setbitu(buff, bit, 4, ura_index);                           bit += 4;
+  setbitu(buff, bit, 2, 0);                                   bit += 2;
+  setbits(buff, bit, 14, lround(k->inc_dot / GPS_PI * P2_43)); bit += 14;
+  setbitu(buff, bit, 8, k->iode);                             bit += 8;
+  setbitu(buff, bit, 16, lround(k->toc.tow / 16));            bit += 16;
+  setbits(buff, bit, 8, lround(k->af2 * P2_55));              bit += 8;
+  setbits(buff, bit, 16, lround(k->af1 * P2_43));             bit += 16;
+  setbits(buff, bit, 22, lround(k->af0 * P2_31));             bit += 22;
+  setbitu(buff, bit, 10, k->iodc);                            bit += 10;
+  setbits(buff, bit, 16, lround(k->crs * P2_5));              bit += 16;
+  setbits(buff, bit, 16, lround(k->dn / GPS_PI * P2_43));     bit += 16;
+  setbits(buff, bit, 32, (s32)round(k->m0 / GPS_PI * P2_31)); bit += 32;
+  setbits(buff, bit, 16, lround(k->cuc * P2_29));             bit += 16;
+  setbitu(buff, bit, 32, (u32)round(k->ecc * P2_33));         bit += 32;
+  setbits(buff, bit, 16, lround(k->cus * P2_29));             bit += 16;
+  setbitu(buff, bit, 32, (u32)round(k->sqrta * P2_19));       bit += 32;
+  setbitu(buff, bit, 16, lround(e->toe.tow / 16));            bit += 16;
+  setbits(buff, bit, 16, lround(k->cic * P2_29));             bit += 16;
+  setbits(buff, bit, 32, (s32)round(k->omega0 / GPS_PI * P2_31)); bit += 32;
+  setbits(buff, bit, 16, lround(k->cis * P2_29));             bit += 16;
+  setbits(buff, bit, 32, (s32)round(k->inc / GPS_PI * P2_31)); bit += 32;
+  setbits(buff, bit, 16, lround(k->crc * P2_5));              bit += 16;
+  setbits(buff, bit, 32, (s32)round(k->w / GPS_PI * P2_31));  bit += 32;
+  setbits(buff, bit, 24, lround(k->omegadot / GPS_PI * P2_43)); bit += 24;
+  setbits(buff, bit, 8, lround(k->tgd * P2_31));              bit += 8;
+  setbitu(buff, bit, 6, e->healthy ? 0 : 0x3F);               bit += 6;
+  setbitu(buff, bit, 1, 0);                                   bit += 1;
+  setbitu(buff, bit, 1, e->fit_interval > 4);                 bit += 1;
+
+  return bit / 8;
+}
+
+/** Decode an RTCMv3 message type 1019 (GPS Ephemerides)
+ *
+ * \param buff A pointer to the RTCM data message buffer.
+ * \param e Decoded GPS ephemeris.
+ * \return If valid then return 0.
+ *         Returns a negative number if the message is invalid:
+ *          - `-1` : Message type mismatch
+ */
+s8 rtcm3_decode_1019(const u8 *buff, ephemeris_t *e)
+{
+  bitstream_t s;
+  bitstream_init(&s, buff, 0);
+  if (bitstream_getu(&s, 12) != 1019)
+    return -1;
+
+  ephemeris_kepler_t *k = &e->kepler;
+
+  e->sid.sat = bitstream_getu(&s, 6);
+  e->sid.band = BAND_L1;
+  e->sid.constellation = CONSTELLATION_GPS;
+  u16 wn_raw = bitstream_getu(&s, 10);
+  e->toe.wn = gps_adjust_week_cycle(wn_raw, GPS_WEEK_REFERENCE);
+  k->toc.wn = e->toe.wn;
+  u8 ura_index = bitstream_getu(&s, 4);
+  e->ura = decode_ura_index(ura_index);
+  bitstream_skip(&s, 2); /* Code on L2 */
+  k->inc_dot = bitstream_gets(&s, 14) / P2_43 * GPS_PI;
+  k->iode = bitstream_getu(&s, 8);
+  k->toc.tow = bitstream_getu(&s, 16) * 16.0;
+  k->af2 = bitstream_gets(&s, 8) / P2_55;
+  k->af1 = bitstream_gets(&s, 16) / P2_43;
+  k->af0 = bitstream_gets(&s, 22) / P2_31;
+  k->iodc = bitstream_getu(&s, 10);
+  k->crs = bitstream_gets(&s, 16) / P2_5;
+  k->dn = bitstream_gets(&s, 16) / P2_43 * GPS_PI;
+  k->m0 = bitstream_gets(&s, 32) / P2_31 * GPS_PI;
+  k->cuc = bitstream_gets(&s, 16) / P2_29;
+  k->ecc = bitstream_getu(&s, 32) / P2_33;
+  k->cus = bitstream_gets(&s, 16) / P2_29;
+  k->sqrta = bitstream_getu(&s, 32) / P2_19;
+  e->toe.tow = bitstream_getu(&s, 16) * 16.0;
+  k->cic = bitstream_gets(&s, 16) / P2_29;
+  k->omega0 = bitstream_gets(&s, 32) / P2_31 * GPS_PI;
+  k->cis = bitstream_gets(&s, 16) / P2_29;
+  k->inc = bitstream_gets(&s, 32) / P2_31 * GPS_PI;
+  k->crc = bitstream_gets(&s, 16) / P2_5;
+  k->w = bitstream_gets(&s, 32) / P2_31 * GPS_PI;
+  k->omegadot = bitstream_gets(&s, 24) / P2_43 * GPS_PI;
+  k->tgd = bitstream_gets(&s, 8) / P2_31;
+  u8 health_bits = bitstream_getu(&s, 6);
+  bitstream_skip(&s, 1); /* L2 P data flag */
+  u8 fit_interval_flag = bitstream_getu(&s, 1);
+
+  e->fit_interval = decode_fit_interval(fit_interval_flag, k->iodc);
+  e->healthy = (health_bits == 0x00) && (ura_index < 15);
+  e->valid = 1;
+
+  return 0;
+}
+
+/** Initialise an RTCM v3 frame parser.
+ *
+ * \param p Parser to initialise.
+ */
+void rtcm3_parser_init(rtcm3_parser_t *p)
+{
+  memset(p, 0, sizeof(*p));
+}
+
+/** Register a handler for messages found by an RTCM v3 parser.
+ *
+ * Handlers are called in the order they were registered.
+ *
+ * \param p Parser.
+ * \param type Message type to handle, or 0 to handle all messages.
+ * \param cb Handler function.
+ * \param context Passed to the handler with each message.
+ * \return `0` on success, `-1` if #RTCM3_PARSER_MAX_HANDLERS handlers are
+ *         already registered.
+ */
+s8 rtcm3_parser_register(rtcm3_parser_t *p, u16 type,
+                         rtcm3_msg_handler_t cb, void *context)
+{
+  if (p->n_handlers >= RTCM3_PARSER_MAX_HANDLERS)
+    return -1;
+
+  p->handlers[p->n_handlers].type = type;
+  p->handlers[p->n_handlers].cb = cb;
+  p->handlers[p->n_handlers].context = context;
+  p->n_handlers++;
+  return 0;
+}
+
+/* Length of the frame starting with a preamble, or 0 if the reserved bits
+ * of the header are set. */
+static u16 frame_len(const u8 *frame)
+{
+  if (frame[1] & 0xFC)
+    return 0;
+  return 6 + (((frame[1] & 0x3) << 8) | frame[2]);
+}
+
+/* Check the CRC of a frame and pass its data message to the handlers. */
+static bool frame_dispatch(rtcm3_parser_t *p, const u8 *frame, u16 len)
+{
+  u32 crc = ((u32)frame[len-3] << 16) | (frame[len-2] << 8) | frame[len-1];
+  if (crc24q(frame, len - 3, 0) != crc) {
+    p->n_crc_errors++;
+    return false;
+  }
+
+  p->n_frames++;
+  u16 msg_len = len - 6;
+  if (msg_len < 2)
+    return true;
+
+  u16 type = (frame[3] << 4) | (frame[4] >> 4);
+  for (u8 i = 0; i < p->n_handlers; i++)
+    if (p->handlers[i].type == 0 || p->handlers[i].type == type)
+      p->handlers[i].cb(type, &frame[3], msg_len, p->handlers[i].context);
+  return true;
+}
+
+/* Drop the first byte of the buffered frame and anything up to the next
+ * preamble. */
+static void parser_resync(rtcm3_parser_t *p)
+{
+  u16 i = 1;
+  while (i < p->n_buff && p->buff[i] != RTCM3_PREAMBLE)
+    i++;
+  p->n_skipped += i;
+  p->n_buff -= i;
+  memmove(p->buff, &p->buff[i], p->n_buff);
+}
+
+/** Feed data into an RTCM v3 frame parser.
+ *
+ * The data may be split into chunks arbitrarily. Each valid frame found is
+ * passed to the handlers registered for its message type. Frames contained
+ * in one chunk are passed straight from the chunk, only frames split across
+ * chunks are copied into the parser. On a bad header or CRC the parser
+ * skips to the next preamble byte after the start of the bad frame.
+ *
+ * \param p Parser.
+ * \param data Next chunk of the RTCM stream.
+ * \param len Length of the chunk in bytes.
+ * \return Number of valid frames found in this call.
+ */
+u32 rtcm3_parser_process(rtcm3_parser_t *p, const u8 *data, u32 len)
+{
+  u32 n_frames = p->n_frames;
+  u32 i = 0;
+
+  while (true) {
+    if (p->n_buff > 0) {
+      /* Complete the frame held in the buffer. */
+      u16 need = p->n_buff < 3 ? 3 : frame_len(p->buff);
+      if (need == 0) {
+        parser_resync(p);
+        continue;
+      }
+      if (p->n_buff < need) {
+        u32 n = MIN((u32)(need - p->n_buff), len - i);
+        memcpy(&p->buff[p->n_buff], &data[i], n);
+        p->n_buff += n;
+        i += n;
+        if (p->n_buff < need)
+          break;
+      }
+      if (need == 3)
+        continue;
+      if (frame_dispatch(p, p->buff, need)) {
+        p->n_buff -= need;
+        memmove(p->buff, &p->buff[need], p->n_buff);
+      } else {
+        parser_resync(p);
+      }
+      continue;
+    }
+
+    if (i == len)
+      break;
+
+    /* Find frames in place in the chunk. */
+    const u8 *frame = memchr(&data[i], RTCM3_PREAMBLE, len - i);
+    if (!frame) {
+      p->n_skipped += len - i;
+      break;
+    }
+    p->n_skipped += frame - &data[i];
+    i = frame - data;
+
+    u32 remaining = len - i;
+    u16 flen = remaining < 3 ? 0xFFFF : frame_len(frame);
+    if (flen == 0) {
+      p->n_skipped++;
+      i++;
+    } else if (remaining < flen) {
+      memcpy(p->buff, frame, remaining);
+      p->n_buff = remaining;
+      i = len;
+    } else if (frame_dispatch(p, frame, flen)) {
+      i += flen;
+    } else {
+      p->n_skipped++;
+      i++;
+    }
+  }
+
+  return p->n_frames - n_frames;
+}
 /** \} */
 /** \} */
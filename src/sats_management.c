@@ -297,22 +297,31 @@ void update_sats_sats_management(sats_management_t *sats_management, u8 num_non_
 
 
 
+/* The sdiffs are sorted, so the position of a signal's sdiff is its rank in
+ * the set of sdiff signals. A non-reference satellite without an sdiff is
+ * only an error if an sdiff for a later signal follows it. */
 s8 match_sdiffs_to_sats_man(sats_management_t *sats, u8 num_sdiffs,
                             sdiff_t *sdiffs, sdiff_t *sdiffs_with_ref_first)
 {
-  u8 j = 1;
-  gnss_signal_t ref_sid = sats->sids[0];
-  for (u8 i=0; i<num_sdiffs && j<sats->num_sats; i++) {
-    if (sid_is_equal(sdiffs[i].sid, ref_sid)) {
-      memcpy(sdiffs_with_ref_first, &sdiffs[i], sizeof(sdiff_t));
-    }
-    else if (sid_is_equal(sdiffs[i].sid, sats->sids[j])) {
-      memcpy(&sdiffs_with_ref_first[j], &sdiffs[i], sizeof(sdiff_t));
-      j++;
-    }
-    else if (sid_compare(sdiffs[i].sid, sats->sids[j]) > 0) {
-      return -1;
-    }
+  if (sats->num_sats == 0)
+    return 0;
+
+  sid_set_t sdiff_set, non_ref_set;
+  sdiffs_to_sid_set(num_sdiffs, sdiffs, &sdiff_set);
+  non_ref_set = sdiff_set;
+  sid_set_remove(&non_ref_set, sats->sids[0]);
+
+  u32 ref = sid_to_index(sats->sids[0]);
+  if (sid_set_contains_index(&sdiff_set, ref))
+    memcpy(sdiffs_with_ref_first, &sdiffs[sid_set_rank(&sdiff_set, ref)],
+           sizeof(sdiff_t));
+
+  for (u8 j=1; j<sats->num_sats; j++) {
+    u32 idx = sid_to_index(sats->sids[j]);
+    if (!sid_set_contains_index(&sdiff_set, idx))
+      return sid_set_next(&non_ref_set, idx) < NUM_SATS ? -1 : 0;
+    memcpy(&sdiffs_with_ref_first[j], &sdiffs[sid_set_rank(&sdiff_set, idx)],
+           sizeof(sdiff_t));
   }
   return 0;
 }
@@ -245,4 +245,44 @@ u32 insert_element(u32 na, size_t sa, const void *as, void *a_out,
   return index;
 }
 
+/** Make a signal set from an array of signals.
+ *
+ * \param s    Signal set to fill, any previous members are removed
+ * \param n    Number of signals in `sids`
+ * \param sids Array of signals, in any order
+ */
+void sid_set_from_sids(sid_set_t *s, u32 n, const gnss_signal_t *sids)
+{
+  sid_set_init(s);
+  for (u32 i = 0; i < n; i++)
+    sid_set_add(s, sids[i]);
+}
+
+/** Find the member of a signal set with a given rank.
+ * The inverse of sid_set_rank() for members of the set.
+ *
+ * \param s Signal set
+ * \param k Rank of the member, i.e. its position in the equivalent sorted
+ *          array
+ *
+ * \return Index of the member, or `NUM_SATS` if the set has no more than `k`
+ *         members
+ */
+u32 sid_set_select(const sid_set_t *s, u32 k)
+{
+  for (u32 w = 0; w < SID_SET_WORDS; w++) {
+    u64 word = s->words[w];
+    u32 n = __builtin_popcountll(word);
+    if (k >= n) {
+      k -= n;
+      continue;
+    }
+    while (k--)
+      word &= word - 1;
+    u32 i = 64 * w + __builtin_ctzll(word);
+    return i < NUM_SATS ? i : NUM_SATS;
+  }
+  return NUM_SATS;
+}
+
 /** \} */
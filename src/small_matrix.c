@@ -0,0 +1,723 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+/* The AVX2 kernels are compiled with per-function target attributes and
+ * selected at runtime. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SMAT_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include <libswiftnav/small_matrix.h>
+
+/** \defgroup small_matrix Small Matrices
+ * Linear algebra kernels for the small dense matrices of the navigation
+ * solvers and filters.
+ *
+ * Matrices are row major. Each kernel is written once as an inline function
+ * of its dimensions and instantiated with constant dimensions for the sizes
+ * used most, 3 for baselines and 4 for single point solutions, which the
+ * compiler fully unrolls. Other sizes run the same code with variable loop
+ * bounds. Products at least 4 columns wide have an AVX2 path, selected at
+ * runtime, see smat_set_impl().
+ *
+ * Symmetric positive definite systems are solved by Cholesky or
+ * \f$ LDL^T \f$ factorisation rather than by forming inverses, and products
+ * with symmetric results only compute one triangle. Kernels needing
+ * workspace take dimensions up to #SMAT_MAX_DIM and keep it on the stack,
+ * nothing is allocated.
+ * \{ */
+
+#define SMAT_INLINE static inline __attribute__((always_inline))
+
+/* Pivots below this fraction of the diagonal element of the input are taken
+ * to mean the matrix is singular. */
+#define SMAT_PIVOT_TOL 1e-12
+
+static smat_impl_t smat_impl = SMAT_IMPL_AUTO;
+
+/** Check whether a kernel implementation can run on the host CPU.
+ *
+ * \param impl Kernel implementation.
+ * \return true if `impl` may be passed to smat_set_impl().
+ */
+bool smat_impl_supported(smat_impl_t impl)
+{
+  switch (impl) {
+  case SMAT_IMPL_AUTO:
+  case SMAT_IMPL_GENERIC:
+    return true;
+#ifdef SMAT_X86_DISPATCH
+  case SMAT_IMPL_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+/** Select the kernels used by all later calls, for testing and
+ * benchmarking. Not thread safe.
+ *
+ * \param impl Kernel implementation, must be supported by the host CPU.
+ *             #SMAT_IMPL_AUTO, the default, selects the fastest.
+ */
+void smat_set_impl(smat_impl_t impl)
+{
+  assert(smat_impl_supported(impl));
+  smat_impl = impl;
+}
+
+SMAT_INLINE void mul_kernel(u32 n, u32 m, u32 p, const double *restrict a,
+                            const double *restrict b, double *restrict c)
+{
+  for (u32 i = 0; i < n; i++) {
+    double *ci = &c[i*p];
+    for (u32 j = 0; j < p; j++)
+      ci[j] = 0;
+    for (u32 k = 0; k < m; k++) {
+      double aik = a[i*m + k];
+      const double *bk = &b[k*p];
+      for (u32 j = 0; j < p; j++)
+        ci[j] += aik * bk[j];
+    }
+  }
+}
+
+/* Matrix vector form of mul_kernel(), accumulating each element in a
+ * register. Four rows are done at once so the sums don't wait on each
+ * other. */
+SMAT_INLINE void mv_kernel(u32 n, u32 m, const double *restrict a,
+                           const double *restrict b, double *restrict c)
+{
+  u32 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const double *a0 = &a[i*m];
+    double x0 = 0, x1 = 0, x2 = 0, x3 = 0;
+    for (u32 k = 0; k < m; k++) {
+      x0 += a0[k] * b[k];
+      x1 += a0[m + k] * b[k];
+      x2 += a0[2*m + k] * b[k];
+      x3 += a0[3*m + k] * b[k];
+    }
+    c[i] = x0;
+    c[i + 1] = x1;
+    c[i + 2] = x2;
+    c[i + 3] = x3;
+  }
+  for (; i < n; i++) {
+    double x = 0;
+    for (u32 k = 0; k < m; k++)
+      x += a[i*m + k] * b[k];
+    c[i] = x;
+  }
+}
+
+#ifdef SMAT_X86_DISPATCH
+/* Whether to use the AVX2 kernel for a product `cols` columns wide. */
+static bool use_avx2(u32 cols)
+{
+  if (cols < 4)
+    return false;
+  smat_impl_t impl = smat_impl;
+  if (impl == SMAT_IMPL_AUTO)
+    impl = smat_impl_supported(SMAT_IMPL_AVX2) ? SMAT_IMPL_AVX2
+                                               : SMAT_IMPL_GENERIC;
+  return impl == SMAT_IMPL_AVX2;
+}
+
+__attribute__((target("avx2")))
+static void mul_avx2(u32 n, u32 m, u32 p, const double *restrict a,
+                     const double *restrict b, double *restrict c)
+{
+  u32 p_vec = p - p % 4;
+  for (u32 i = 0; i < n; i++) {
+    const double *ai = &a[i*m];
+    double *ci = &c[i*p];
+    for (u32 j = 0; j < p_vec; j += 4) {
+      __m256d acc = _mm256_setzero_pd();
+      for (u32 k = 0; k < m; k++)
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_set1_pd(ai[k]),
+                                               _mm256_loadu_pd(&b[k*p + j])));
+      _mm256_storeu_pd(&ci[j], acc);
+    }
+    for (u32 j = p_vec; j < p; j++) {
+      double s = 0;
+      for (u32 k = 0; k < m; k++)
+        s += ai[k] * b[k*p + j];
+      ci[j] = s;
+    }
+  }
+}
+#endif /* SMAT_X86_DISPATCH */
+
+/** Matrix product \f$ C = A B \f$.
+ *
+ * \param n Number of rows of `a` and `c`.
+ * \param m Number of columns of `a` and rows of `b`.
+ * \param p Number of columns of `b` and `c`.
+ * \param a Matrix `n` by `m`.
+ * \param b Matrix `m` by `p`.
+ * \param c Output matrix `n` by `p`, must not overlap `a` or `b`.
+ */
+void smat_mul(u32 n, u32 m, u32 p, const double *a, const double *b,
+              double *c)
+{
+  if (n == 3 && m == 3 && p == 1)
+    mv_kernel(3, 3, a, b, c);
+  else if (n == 4 && m == 4 && p == 1)
+    mv_kernel(4, 4, a, b, c);
+  else if (p == 1)
+    mv_kernel(n, m, a, b, c);
+  else if (n == 3 && m == 3 && p == 3)
+    mul_kernel(3, 3, 3, a, b, c);
+  else if (n == 4 && m == 4 && p == 4)
+    mul_kernel(4, 4, 4, a, b, c);
+#ifdef SMAT_X86_DISPATCH
+  else if (use_avx2(p))
+    mul_avx2(n, m, p, a, b, c);
+#endif
+  else
+    mul_kernel(n, m, p, a, b, c);
+}
+
+SMAT_INLINE void mul_abt_kernel(u32 n, u32 m, u32 p, const double *restrict a,
+                                const double *restrict b, double *restrict c)
+{
+  for (u32 i = 0; i < n; i++) {
+    for (u32 j = 0; j < p; j++) {
+      double s = 0;
+      for (u32 k = 0; k < m; k++)
+        s += a[i*m + k] * b[j*m + k];
+      c[i*p + j] = s;
+    }
+  }
+}
+
+/** Matrix product with a transpose, \f$ C = A B^T \f$.
+ *
+ * \param n Number of rows of `a` and `c`.
+ * \param m Number of columns of `a` and `b`.
+ * \param p Number of rows of `b` and columns of `c`.
+ * \param a Matrix `n` by `m`.
+ * \param b Matrix `p` by `m`.
+ * \param c Output matrix `n` by `p`, must not overlap `a` or `b`.
+ */
+void smat_mul_abt(u32 n, u32 m, u32 p, const double *a, const double *b,
+                  double *c)
+{
+  if (m == 3)
+    mul_abt_kernel(n, 3, p, a, b, c);
+  else if (m == 4)
+    mul_abt_kernel(n, 4, p, a, b, c);
+  else
+    mul_abt_kernel(n, m, p, a, b, c);
+}
+
+SMAT_INLINE void ata_kernel(u32 n, u32 m, const double *restrict a,
+                            double *restrict c)
+{
+  for (u32 i = 0; i < m; i++)
+    for (u32 j = i; j < m; j++)
+      c[i*m + j] = 0;
+  for (u32 k = 0; k < n; k++) {
+    const double *ak = &a[k*m];
+    for (u32 i = 0; i < m; i++)
+      for (u32 j = i; j < m; j++)
+        c[i*m + j] += ak[i] * ak[j];
+  }
+  for (u32 i = 0; i < m; i++)
+    for (u32 j = 0; j < i; j++)
+      c[i*m + j] = c[j*m + i];
+}
+
+/** Symmetric product \f$ C = A^T A \f$, for instance the normal matrix of a
+ * least squares problem. Only one triangle is computed.
+ *
+ * \param n Number of rows of `a`.
+ * \param m Number of columns of `a`, the dimension of `c`.
+ * \param a Matrix `n` by `m`.
+ * \param c Output matrix `m` by `m`, must not overlap `a`.
+ */
+void smat_ata(u32 n, u32 m, const double *a, double *c)
+{
+  if (m == 3)
+    ata_kernel(n, 3, a, c);
+  else if (m == 4)
+    ata_kernel(n, 4, a, c);
+  else
+    ata_kernel(n, m, a, c);
+}
+
+/** Symmetric product \f$ C = A S A^T \f$ of a symmetric matrix, for instance
+ * to transform a covariance. Only the upper triangle of `s` is read and only
+ * one triangle of the result is computed.
+ *
+ * \param n Number of rows of `a`, the dimension of `c`. At most
+ *          #SMAT_MAX_DIM.
+ * \param m Number of columns of `a`, the dimension of `s`. At most
+ *          #SMAT_MAX_DIM.
+ * \param a Matrix `n` by `m`.
+ * \param s Symmetric matrix `m` by `m`.
+ * \param c Output matrix `n` by `n`, may be `s` but must not overlap `a`
+ *          otherwise.
+ */
+void smat_asat(u32 n, u32 m, const double *a, const double *s, double *c)
+{
+  assert(n <= SMAT_MAX_DIM && m <= SMAT_MAX_DIM);
+  double S[SMAT_MAX_DIM * SMAT_MAX_DIM];
+  double AS[SMAT_MAX_DIM * SMAT_MAX_DIM];
+
+  for (u32 i = 0; i < m; i++)
+    for (u32 j = i; j < m; j++)
+      S[i*m + j] = S[j*m + i] = s[i*m + j];
+  smat_mul(n, m, m, a, S, AS);
+
+  for (u32 i = 0; i < n; i++) {
+    for (u32 j = i; j < n; j++) {
+      double x = 0;
+      for (u32 k = 0; k < m; k++)
+        x += AS[i*m + k] * a[j*m + k];
+      c[i*n + j] = c[j*n + i] = x;
+    }
+  }
+}
+
+SMAT_INLINE s8 cholesky_kernel(u32 n, const double *a, double *l)
+{
+  for (u32 j = 0; j < n; j++) {
+    double d = a[j*n + j];
+    double tol = SMAT_PIVOT_TOL * d;
+    for (u32 k = 0; k < j; k++)
+      d -= l[j*n + k] * l[j*n + k];
+    if (!(d > tol))
+      return -1;
+    double ljj = sqrt(d);
+    double ljj_inv = 1 / ljj;
+    for (u32 i = j + 1; i < n; i++) {
+      double x = a[i*n + j];
+      for (u32 k = 0; k < j; k++)
+        x -= l[i*n + k] * l[j*n + k];
+      l[i*n + j] = x * ljj_inv;
+    }
+    l[j*n + j] = ljj;
+    for (u32 i = 0; i < j; i++)
+      l[i*n + j] = 0;
+  }
+  return 0;
+}
+
+/** Cholesky factorisation \f$ A = L L^T \f$ of a symmetric positive
+ * definite matrix. Only the lower triangle of `a` is read.
+ *
+ * \param n Dimension of `a`.
+ * \param a Symmetric positive definite matrix `n` by `n`.
+ * \param l Output lower triangular factor `n` by `n`, may be `a`.
+ * \return  0 on success,
+ *         -1 if `a` isn't numerically positive definite, `l` is then
+ *            undefined
+ */
+s8 smat_cholesky(u32 n, const double *a, double *l)
+{
+  if (n == 3)
+    return cholesky_kernel(3, a, l);
+  if (n == 4)
+    return cholesky_kernel(4, a, l);
+  return cholesky_kernel(n, a, l);
+}
+
+SMAT_INLINE void cholesky_solve_kernel(u32 n, const double *restrict l, u32 p,
+                                       double *restrict b)
+{
+  /* L y = b */
+  for (u32 i = 0; i < n; i++) {
+    double *bi = &b[i*p];
+    for (u32 k = 0; k < i; k++)
+      for (u32 j = 0; j < p; j++)
+        bi[j] -= l[i*n + k] * b[k*p + j];
+    for (u32 j = 0; j < p; j++)
+      bi[j] /= l[i*n + i];
+  }
+  /* L' x = y */
+  for (u32 i = n; i-- > 0;) {
+    double *bi = &b[i*p];
+    for (u32 k = i + 1; k < n; k++)
+      for (u32 j = 0; j < p; j++)
+        bi[j] -= l[k*n + i] * b[k*p + j];
+    for (u32 j = 0; j < p; j++)
+      bi[j] /= l[i*n + i];
+  }
+}
+
+/** Solve \f$ A X = B \f$ in place given the Cholesky factor of `A`.
+ *
+ * \param n Dimension of `l`.
+ * \param l Cholesky factor from smat_cholesky(), `n` by `n`.
+ * \param p Number of columns of `b`.
+ * \param b Right hand sides `n` by `p`, overwritten with the solution.
+ */
+void smat_cholesky_solve(u32 n, const double *l, u32 p, double *b)
+{
+  if (n == 3 && p == 1)
+    cholesky_solve_kernel(3, l, 1, b);
+  else if (n == 4 && p == 1)
+    cholesky_solve_kernel(4, l, 1, b);
+  else
+    cholesky_solve_kernel(n, l, p, b);
+}
+
+SMAT_INLINE void cholesky_inverse_kernel(u32 n, const double *restrict l,
+                                         double *restrict b)
+{
+  /* W = L^-1, lower triangular. */
+  double w[SMAT_MAX_DIM * SMAT_MAX_DIM];
+  for (u32 j = 0; j < n; j++) {
+    w[j*n + j] = 1 / l[j*n + j];
+    for (u32 i = j + 1; i < n; i++) {
+      double x = 0;
+      for (u32 k = j; k < i; k++)
+        x -= l[i*n + k] * w[k*n + j];
+      w[i*n + j] = x / l[i*n + i];
+    }
+  }
+  /* A^-1 = W' W */
+  for (u32 i = 0; i < n; i++) {
+    for (u32 j = i; j < n; j++) {
+      double x = 0;
+      for (u32 k = j; k < n; k++)
+        x += w[k*n + i] * w[k*n + j];
+      b[i*n + j] = b[j*n + i] = x;
+    }
+  }
+}
+
+/** Inverse of a symmetric positive definite matrix given its Cholesky
+ * factor, for when the inverse itself is needed, e.g. as a covariance. The
+ * result is exactly symmetric.
+ *
+ * \param n Dimension of `l`, at most #SMAT_MAX_DIM.
+ * \param l Cholesky factor from smat_cholesky(), `n` by `n`.
+ * \param b Output inverse `n` by `n`, must not overlap `l`.
+ */
+void smat_cholesky_inverse(u32 n, const double *l, double *b)
+{
+  assert(n <= SMAT_MAX_DIM);
+  if (n == 3)
+    cholesky_inverse_kernel(3, l, b);
+  else if (n == 4)
+    cholesky_inverse_kernel(4, l, b);
+  else
+    cholesky_inverse_kernel(n, l, b);
+}
+
+/** \f$ L D L^T \f$ factorisation of a symmetric positive definite matrix,
+ * with `L` unit lower triangular and `D` diagonal. Unlike smat_cholesky()
+ * no square roots are taken. Only the lower triangle of `a` is read.
+ *
+ * \param n Dimension of `a`.
+ * \param a Symmetric positive definite matrix `n` by `n`.
+ * \param l Output unit lower triangular factor `n` by `n`, may be `a`.
+ * \param d Output diagonal of `D`, length `n`.
+ * \return  0 on success,
+ *         -1 if `a` isn't numerically positive definite, `l` and `d` are
+ *            then undefined
+ */
+s8 smat_ldl(u32 n, const double *a, double *l, double *d)
+{
+  for (u32 j = 0; j < n; j++) {
+    double dj = a[j*n + j];
+    double tol = SMAT_PIVOT_TOL * dj;
+    for (u32 k = 0; k < j; k++)
+      dj -= l[j*n + k] * l[j*n + k] * d[k];
+    if (!(dj > tol))
+      return -1;
+    for (u32 i = j + 1; i < n; i++) {
+      double x = a[i*n + j];
+      for (u32 k = 0; k < j; k++)
+        x -= l[i*n + k] * l[j*n + k] * d[k];
+      l[i*n + j] = x / dj;
+    }
+    d[j] = dj;
+    l[j*n + j] = 1;
+    for (u32 i = 0; i < j; i++)
+      l[i*n + j] = 0;
+  }
+  return 0;
+}
+
+/** Solve \f$ A X = B \f$ in place given the \f$ L D L^T \f$ factors of `A`.
+ *
+ * \param n Dimension of `l`.
+ * \param l Unit lower triangular factor from smat_ldl(), `n` by `n`.
+ * \param d Diagonal factor from smat_ldl(), length `n`.
+ * \param p Number of columns of `b`.
+ * \param b Right hand sides `n` by `p`, overwritten with the solution.
+ */
+void smat_ldl_solve(u32 n, const double *l, const double *d, u32 p,
+                    double *b)
+{
+  for (u32 i = 0; i < n; i++)
+    for (u32 k = 0; k < i; k++)
+      for (u32 j = 0; j < p; j++)
+        b[i*p + j] -= l[i*n + k] * b[k*p + j];
+  for (u32 i = 0; i < n; i++)
+    for (u32 j = 0; j < p; j++)
+      b[i*p + j] /= d[i];
+  for (u32 i = n; i-- > 0;)
+    for (u32 k = i + 1; k < n; k++)
+      for (u32 j = 0; j < p; j++)
+        b[i*p + j] -= l[k*n + i] * b[k*p + j];
+}
+
+SMAT_INLINE void unit_upper_mul_kernel(u32 n, u32 p, const double *u,
+                                       double *b)
+{
+  for (u32 i = 0; i < n; i++) {
+    for (u32 j = 0; j < p; j++) {
+      double x = b[i*p + j];
+      for (u32 k = i + 1; k < n; k++)
+        x += u[i*n + k] * b[k*p + j];
+      b[i*p + j] = x;
+    }
+  }
+}
+
+/** In place product \f$ B := U B \f$ with a unit upper triangular matrix.
+ * Only the strictly upper triangle of `u` is read.
+ *
+ * \param n Dimension of `u`, number of rows of `b`.
+ * \param p Number of columns of `b`.
+ * \param u Unit upper triangular matrix `n` by `n`.
+ * \param b Matrix `n` by `p`, overwritten with the product.
+ */
+void smat_unit_upper_mul(u32 n, u32 p, const double *u, double *b)
+{
+  if (p == 1)
+    unit_upper_mul_kernel(n, 1, u, b);
+  else
+    unit_upper_mul_kernel(n, p, u, b);
+}
+
+SMAT_INLINE void unit_upper_tmul_kernel(u32 n, u32 p, const double *u,
+                                        double *b)
+{
+  /* Row k of U adds to the later rows of B, before row k of B is itself
+   * updated by the earlier rows of U. */
+  for (u32 k = n; k-- > 0;)
+    for (u32 i = k + 1; i < n; i++)
+      for (u32 j = 0; j < p; j++)
+        b[i*p + j] += u[k*n + i] * b[k*p + j];
+}
+
+/** In place product \f$ B := U^T B \f$ with a unit upper triangular matrix.
+ * Only the strictly upper triangle of `u` is read.
+ *
+ * \param n Dimension of `u`, number of rows of `b`.
+ * \param p Number of columns of `b`.
+ * \param u Unit upper triangular matrix `n` by `n`.
+ * \param b Matrix `n` by `p`, overwritten with the product.
+ */
+void smat_unit_upper_tmul(u32 n, u32 p, const double *u, double *b)
+{
+  if (p == 1)
+    unit_upper_tmul_kernel(n, 1, u, b);
+  else
+    unit_upper_tmul_kernel(n, p, u, b);
+}
+
+/** Product \f$ C = A U \f$ with a unit upper triangular matrix, as for the
+ * \f$ U D U^T \f$ factors of a covariance. Only the strictly upper triangle
+ * of `u` is read.
+ *
+ * \param n Number of rows of `a` and `c`.
+ * \param m Number of columns of `a`, dimension of `u`.
+ * \param a Matrix `n` by `m`.
+ * \param u Unit upper triangular matrix `m` by `m`.
+ * \param c Output matrix `n` by `m`, may be `a`.
+ */
+void smat_mul_unit_upper(u32 n, u32 m, const double *a, const double *u,
+                         double *c)
+{
+  for (u32 i = 0; i < n; i++) {
+    const double *ai = &a[i*m];
+    double *ci = &c[i*m];
+    for (u32 j = m; j-- > 0;) {
+      double x = ai[j];
+      for (u32 k = 0; k < j; k++)
+        x += ai[k] * u[k*m + j];
+      ci[j] = x;
+    }
+  }
+}
+
+/* Euclidean norm of elements `j` to `n - 1` of `x`, accumulated with
+ * scaling as by the reference BLAS `DNRM2`. */
+static double column_norm(u32 n, u32 j, const double *x)
+{
+  double scale = 0, ssq = 1;
+  for (u32 i = j; i < n; i++) {
+    if (x[i] == 0)
+      continue;
+    double ax = fabs(x[i]);
+    if (scale < ax) {
+      double r = scale / ax;
+      ssq = ssq * (r * r) + 1;
+      scale = ax;
+    } else {
+      double r = ax / scale;
+      ssq += r * r;
+    }
+  }
+  return scale * sqrt(ssq);
+}
+
+/* sqrt(a^2 + b^2) as LAPACK's `DLAPY2`. */
+static double pythag(double a, double b)
+{
+  double w = MAX(fabs(a), fabs(b));
+  double z = MIN(fabs(a), fabs(b));
+  if (z == 0)
+    return w;
+  return w * sqrt(1 + (z / w) * (z / w));
+}
+
+/* Householder reflection taking elements `j` to `n - 1` of `x` to a
+ * non-negative multiple of e_j, as LAPACK's `DLARFP`. `x` is overwritten
+ * with the vector of householder_apply() and the returned factor tau. */
+static double householder_make(u32 n, u32 j, double *x)
+{
+  double s = column_norm(n, j + 1, x);
+  double alpha = x[j];
+  if (s == 0) {
+    if (alpha >= 0)
+      return 0;
+    for (u32 i = j + 1; i < n; i++)
+      x[i] = 0;
+    x[j] = -alpha;
+    return 2;
+  }
+  double beta = copysign(pythag(alpha, s), alpha);
+  double tau;
+  alpha += beta;
+  if (beta < 0) {
+    beta = -beta;
+    tau = -alpha / beta;
+  } else {
+    alpha = s * (s / alpha);
+    tau = alpha / beta;
+    alpha = -alpha;
+  }
+  double scale = 1 / alpha;
+  for (u32 i = j + 1; i < n; i++)
+    x[i] *= scale;
+  x[j] = beta;
+  return tau;
+}
+
+/* Apply the Householder reflection \f$ I - \tau v v^T \f$ to `y`, where
+ * \f$ v = (0, \ldots, 0, 1, x_{j+1}, \ldots, x_{n-1}) \f$. */
+SMAT_INLINE void householder_apply(u32 n, u32 j, const double *x, double tau,
+                                   double *y)
+{
+  double d = y[j];
+  for (u32 i = j + 1; i < n; i++)
+    d += x[i] * y[i];
+  d *= tau;
+  y[j] -= d;
+  for (u32 i = j + 1; i < n; i++)
+    y[i] -= d * x[i];
+}
+
+/** Orthonormal basis of the left null space of a matrix of full column
+ * rank, the rows `q` with \f$ q A = 0 \f$, for instance the combinations
+ * of double differences insensitive to the baseline.
+ *
+ * The basis is the last `n - m` columns of `Q` in the Householder QR
+ * factorisation with column pivoting \f$ A P = Q R \f$. The pivoting
+ * and reflections follow the bundled LAPACK's `DGEQP3`, so the basis is
+ * that given by `DGEQP3` and `DORGQR`.
+ *
+ * \param n Number of rows of `a`, at most #SMAT_MAX_DIM.
+ * \param m Number of columns of `a`, at most `n`.
+ * \param a Matrix `n` by `m`.
+ * \param q Output basis `n - m` by `n`.
+ */
+void smat_left_null_basis(u32 n, u32 m, const double *a, double *q)
+{
+  assert(m <= n && n <= SMAT_MAX_DIM);
+
+  /* Columns of A, overwritten with the Householder vectors. */
+  double w[SMAT_MAX_DIM * SMAT_MAX_DIM];
+  double tau[SMAT_MAX_DIM];
+  /* Norms of the remaining parts of the columns, downdated as each
+   * reflection is applied, and their last exact values. */
+  double vn1[SMAT_MAX_DIM], vn2[SMAT_MAX_DIM];
+  /* Square root of the unit roundoff, below which the downdated norms are
+   * recomputed. */
+  const double tol = sqrt(DBL_EPSILON / 2);
+
+  for (u32 j = 0; j < m; j++) {
+    for (u32 i = 0; i < n; i++)
+      w[j*n + i] = a[i*m + j];
+    vn1[j] = vn2[j] = column_norm(n, 0, &w[j*n]);
+  }
+
+  for (u32 j = 0; j < m; j++) {
+    u32 p = j;
+    for (u32 k = j + 1; k < m; k++)
+      if (vn1[k] > vn1[p])
+        p = k;
+    if (p != j) {
+      double t[SMAT_MAX_DIM];
+      memcpy(t, &w[p*n], n * sizeof(double));
+      memcpy(&w[p*n], &w[j*n], n * sizeof(double));
+      memcpy(&w[j*n], t, n * sizeof(double));
+      vn1[p] = vn1[j];
+      vn2[p] = vn2[j];
+    }
+
+    double *x = &w[j*n];
+    tau[j] = householder_make(n, j, x);
+
+    for (u32 k = j + 1; k < m; k++) {
+      double *y = &w[k*n];
+      if (tau[j] != 0)
+        householder_apply(n, j, x, tau[j], y);
+      if (vn1[k] == 0)
+        continue;
+      double r = fabs(y[j]) / vn1[k];
+      double t = MAX(0, 1 - r * r);
+      double t2 = t * (vn1[k] / vn2[k]) * (vn1[k] / vn2[k]);
+      if (t2 <= tol) {
+        vn1[k] = vn2[k] = column_norm(n, j + 1, y);
+      } else {
+        vn1[k] *= sqrt(t);
+      }
+    }
+  }
+
+  /* Q e_k = H_0 H_1 ... H_{m-1} e_k */
+  for (u32 r = 0; r < n - m; r++) {
+    double *y = &q[r*n];
+    memset(y, 0, n * sizeof(double));
+    y[m + r] = 1;
+    for (u32 j = m; j-- > 0;)
+      if (tau[j] != 0)
+        householder_apply(n, j, &w[j*n], tau[j], y);
+  }
+}
+
+/** \} */
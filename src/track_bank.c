@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2016 Swift Navigation Inc.
+ *
+ * This source is subject to the license found in the file 'LICENSE' which must
+ * be be distributed together with this source. All other rights reserved.
+ *
+ * THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF ANY KIND,
+ * EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <libswiftnav/track_bank.h>
+
+/** \defgroup track_bank Tracking Loop Bank
+ * Tracking loops of many channels updated together.
+ *
+ * The bank holds the same state as a set of aided_tl_state_t,
+ * simple_tl_state_t or comp_tl_state_t structs together with their
+ * lock_detect_t and cn0_est_state_t, but with each field stored as an array
+ * across channels. track_bank_update() then runs each stage of the loop
+ * update over all channels in turn, with the per-channel branches of the
+ * scalar functions replaced by selects so that the compiler can vectorize the
+ * filter, lock detector and \f$ C / N_0 \f$ arithmetic.
+ *
+ * The operations, and their order, are exactly those of aided_tl_update(),
+ * simple_tl_update(), comp_tl_update(), lock_detect_update() and cn0_est(),
+ * so a channel updated in a bank follows the same trajectory, bit for bit,
+ * as it would when updated on its own.
+ * \{ */
+
+/* Branch-free selects, `a` if `c` else `b`. Written with integer masks
+ * rather than `?:` so the compiler doesn't turn them back into conditional
+ * stores, which would stop the update loops being vectorized. */
+static inline u32 select_u32(bool c, u32 a, u32 b)
+{
+  u32 m = -(u32)c;
+  return (a & m) | (b & ~m);
+}
+
+static inline float select_f(bool c, float a, float b)
+{
+  u32 ua, ub;
+  memcpy(&ua, &a, sizeof(ua));
+  memcpy(&ub, &b, sizeof(ub));
+  ua = select_u32(c, ua, ub);
+  memcpy(&a, &ua, sizeof(a));
+  return a;
+}
+
+static void set_lock_detect(track_bank_t *b, u32 i, const lock_detect_t *ld)
+{
+  b->ld_k1[i] = ld->lpfi.k1;
+  b->ld_k2[i] = ld->k2;
+  b->ld_yi[i] = ld->lpfi.y;
+  b->ld_yq[i] = ld->lpfq.y;
+  b->ld_lo[i] = ld->lo;
+  b->ld_lp[i] = ld->lp;
+  b->ld_pcount1[i] = ld->pcount1;
+  b->ld_pcount2[i] = ld->pcount2;
+  b->outo[i] = ld->outo;
+  b->outp[i] = ld->outp;
+}
+
+static void get_lock_detect(const track_bank_t *b, u32 i, lock_detect_t *ld)
+{
+  ld->lpfi.k1 = b->ld_k1[i];
+  ld->lpfq.k1 = b->ld_k1[i];
+  ld->k2 = b->ld_k2[i];
+  ld->lpfi.y = b->ld_yi[i];
+  ld->lpfq.y = b->ld_yq[i];
+  ld->lo = b->ld_lo[i];
+  ld->lp = b->ld_lp[i];
+  ld->pcount1 = b->ld_pcount1[i];
+  ld->pcount2 = b->ld_pcount2[i];
+  ld->outo = b->outo[i];
+  ld->outp = b->outp[i];
+}
+
+static void set_cn0_est(track_bank_t *b, u32 i, const cn0_est_state_t *cn0)
+{
+  b->cn0_log_bw[i] = cn0->log_bw;
+  b->cn0_b[i] = cn0->b;
+  b->cn0_a[i] = cn0->a;
+  b->cn0_I_prev_abs[i] = cn0->I_prev_abs;
+  b->cn0_Q_prev_abs[i] = cn0->Q_prev_abs;
+  b->cn0_nsr[i] = cn0->nsr;
+  b->cn0_xn[i] = cn0->xn;
+  b->cn0[i] = cn0->log_bw - 10.f*log10f(cn0->nsr);
+}
+
+static void get_cn0_est(const track_bank_t *b, u32 i, cn0_est_state_t *cn0)
+{
+  cn0->log_bw = b->cn0_log_bw[i];
+  cn0->b = b->cn0_b[i];
+  cn0->a = b->cn0_a[i];
+  cn0->I_prev_abs = b->cn0_I_prev_abs[i];
+  cn0->Q_prev_abs = b->cn0_Q_prev_abs[i];
+  cn0->nsr = b->cn0_nsr[i];
+  cn0->xn = b->cn0_xn[i];
+}
+
+/** Initialise a tracking loop bank.
+ *
+ * All channels are initially zeroed simple loops, each channel should be
+ * loaded with one of the `track_bank_set_*` functions before the first
+ * update.
+ *
+ * \param b          The bank to initialise.
+ * \param n_channels Number of channels in the bank.
+ * \return 0 on success, -1 if `n_channels` exceeds TRACK_BANK_MAX_CHANNELS.
+ */
+s8 track_bank_init(track_bank_t *b, u32 n_channels)
+{
+  if (n_channels > TRACK_BANK_MAX_CHANNELS)
+    return -1;
+
+  memset(b, 0, sizeof(*b));
+  b->n_channels = n_channels;
+  for (u32 i = 0; i < TRACK_BANK_MAX_CHANNELS; i++)
+    b->loop_type[i] = TRACK_LOOP_SIMPLE;
+
+  return 0;
+}
+
+/** Load an aided tracking loop into a bank channel.
+ *
+ * \param b   The tracking loop bank.
+ * \param i   Channel index.
+ * \param tl  Tracking loop state, see aided_tl_init().
+ * \param ld  Lock detector state, see lock_detect_init().
+ * \param cn0 \f$ C / N_0 \f$ estimator state, see cn0_est_init().
+ */
+void track_bank_set_aided(track_bank_t *b, u32 i, const aided_tl_state_t *tl,
+                          const lock_detect_t *ld, const cn0_est_state_t *cn0)
+{
+  b->loop_type[i] = TRACK_LOOP_AIDED;
+  b->code_freq[i] = tl->code_freq;
+  b->carr_freq[i] = tl->carr_freq;
+  b->carr_b0[i] = tl->carr_filt.b0;
+  b->carr_b1[i] = tl->carr_filt.b1;
+  b->carr_igain[i] = tl->carr_filt.aiding_igain;
+  b->carr_prev[i] = tl->carr_filt.prev_error;
+  b->carr_y[i] = tl->carr_filt.y;
+  b->code_b0[i] = tl->code_filt.b0;
+  b->code_b1[i] = tl->code_filt.b1;
+  b->code_prev[i] = tl->code_filt.prev_error;
+  b->code_y[i] = tl->code_filt.y;
+  b->prev_I[i] = tl->prev_I;
+  b->prev_Q[i] = tl->prev_Q;
+  b->carr_to_code[i] = tl->carr_to_code;
+  b->A[i] = 0;
+  b->sched[i] = 0;
+  b->n[i] = 0;
+  set_lock_detect(b, i, ld);
+  set_cn0_est(b, i, cn0);
+}
+
+/** Load a simple tracking loop into a bank channel.
+ *
+ * \param b   The tracking loop bank.
+ * \param i   Channel index.
+ * \param tl  Tracking loop state, see simple_tl_init().
+ * \param ld  Lock detector state, see lock_detect_init().
+ * \param cn0 \f$ C / N_0 \f$ estimator state, see cn0_est_init().
+ */
+void track_bank_set_simple(track_bank_t *b, u32 i, const simple_tl_state_t *tl,
+                           const lock_detect_t *ld, const cn0_est_state_t *cn0)
+{
+  b->loop_type[i] = TRACK_LOOP_SIMPLE;
+  b->code_freq[i] = tl->code_freq;
+  b->carr_freq[i] = tl->carr_freq;
+  b->carr_b0[i] = tl->carr_filt.b0;
+  b->carr_b1[i] = tl->carr_filt.b1;
+  b->carr_igain[i] = 0;
+  b->carr_prev[i] = tl->carr_filt.prev_error;
+  b->carr_y[i] = tl->carr_filt.y;
+  b->code_b0[i] = tl->code_filt.b0;
+  b->code_b1[i] = tl->code_filt.b1;
+  b->code_prev[i] = tl->code_filt.prev_error;
+  b->code_y[i] = tl->code_filt.y;
+  b->prev_I[i] = 0;
+  b->prev_Q[i] = 0;
+  b->carr_to_code[i] = 0;
+  b->A[i] = 0;
+  b->sched[i] = 0;
+  b->n[i] = 0;
+  set_lock_detect(b, i, ld);
+  set_cn0_est(b, i, cn0);
+}
+
+/** Load a complementary filter tracking loop into a bank channel.
+ *
+ * \param b   The tracking loop bank.
+ * \param i   Channel index.
+ * \param tl  Tracking loop state, see comp_tl_init().
+ * \param ld  Lock detector state, see lock_detect_init().
+ * \param cn0 \f$ C / N_0 \f$ estimator state, see cn0_est_init().
+ */
+void track_bank_set_comp(track_bank_t *b, u32 i, const comp_tl_state_t *tl,
+                         const lock_detect_t *ld, const cn0_est_state_t *cn0)
+{
+  b->loop_type[i] = TRACK_LOOP_COMP;
+  b->code_freq[i] = tl->code_freq;
+  b->carr_freq[i] = tl->carr_freq;
+  b->carr_b0[i] = tl->carr_filt.b0;
+  b->carr_b1[i] = tl->carr_filt.b1;
+  b->carr_igain[i] = 0;
+  b->carr_prev[i] = tl->carr_filt.prev_error;
+  b->carr_y[i] = tl->carr_filt.y;
+  b->code_b0[i] = tl->code_filt.b0;
+  b->code_b1[i] = tl->code_filt.b1;
+  b->code_prev[i] = tl->code_filt.prev_error;
+  b->code_y[i] = tl->code_filt.y;
+  b->prev_I[i] = 0;
+  b->prev_Q[i] = 0;
+  b->carr_to_code[i] = tl->carr_to_code;
+  b->A[i] = tl->A;
+  b->sched[i] = tl->sched;
+  b->n[i] = tl->n;
+  set_lock_detect(b, i, ld);
+  set_cn0_est(b, i, cn0);
+}
+
+/** Read back the state of an aided tracking loop bank channel.
+ *
+ * \param b   The tracking loop bank.
+ * \param i   Channel index, loaded with track_bank_set_aided().
+ * \param tl  Output tracking loop state.
+ * \param ld  Output lock detector state, or NULL.
+ * \param cn0 Output \f$ C / N_0 \f$ estimator state, or NULL.
+ */
+void track_bank_get_aided(const track_bank_t *b, u32 i, aided_tl_state_t *tl,
+                          lock_detect_t *ld, cn0_est_state_t *cn0)
+{
+  tl->code_freq = b->code_freq[i];
+  tl->carr_freq = b->carr_freq[i];
+  tl->carr_filt.b0 = b->carr_b0[i];
+  tl->carr_filt.b1 = b->carr_b1[i];
+  tl->carr_filt.aiding_igain = b->carr_igain[i];
+  tl->carr_filt.prev_error = b->carr_prev[i];
+  tl->carr_filt.y = b->carr_y[i];
+  tl->code_filt.b0 = b->code_b0[i];
+  tl->code_filt.b1 = b->code_b1[i];
+  tl->code_filt.prev_error = b->code_prev[i];
+  tl->code_filt.y = b->code_y[i];
+  tl->prev_I = b->prev_I[i];
+  tl->prev_Q = b->prev_Q[i];
+  tl->carr_to_code = b->carr_to_code[i];
+  if (ld)
+    get_lock_detect(b, i, ld);
+  if (cn0)
+    get_cn0_est(b, i, cn0);
+}
+
+/** Read back the state of a simple tracking loop bank channel.
+ *
+ * \param b   The tracking loop bank.
+ * \param i   Channel index, loaded with track_bank_set_simple().
+ * \param tl  Output tracking loop state.
+ * \param ld  Output lock detector state, or NULL.
+ * \param cn0 Output \f$ C / N_0 \f$ estimator state, or NULL.
+ */
+void track_bank_get_simple(const track_bank_t *b, u32 i, simple_tl_state_t *tl,
+                           lock_detect_t *ld, cn0_est_state_t *cn0)
+{
+  tl->code_freq = b->code_freq[i];
+  tl->carr_freq = b->carr_freq[i];
+  tl->carr_filt.b0 = b->carr_b0[i];
+  tl->carr_filt.b1 = b->carr_b1[i];
+  tl->carr_filt.prev_error = b->carr_prev[i];
+  tl->carr_filt.y = b->carr_y[i];
+  tl->code_filt.b0 = b->code_b0[i];
+  tl->code_filt.b1 = b->code_b1[i];
+  tl->code_filt.prev_error = b->code_prev[i];
+  tl->code_filt.y = b->code_y[i];
+  if (ld)
+    get_lock_detect(b, i, ld);
+  if (cn0)
+    get_cn0_est(b, i, cn0);
+}
+
+/** Read back the state of a complementary filter tracking loop bank channel.
+ *
+ * \param b   The tracking loop bank.
+ * \param i   Channel index, loaded with track_bank_set_comp().
+ * \param tl  Output tracking loop state.
+ * \param ld  Output lock detector state, or NULL.
+ * \param cn0 Output \f$ C / N_0 \f$ estimator state, or NULL.
+ */
+void track_bank_get_comp(const track_bank_t *b, u32 i, comp_tl_state_t *tl,
+                         lock_detect_t *ld, cn0_est_state_t *cn0)
+{
+  tl->code_freq = b->code_freq[i];
+  tl->carr_freq = b->carr_freq[i];
+  tl->carr_filt.b0 = b->carr_b0[i];
+  tl->carr_filt.b1 = b->carr_b1[i];
+  tl->carr_filt.prev_error = b->carr_prev[i];
+  tl->carr_filt.y = b->carr_y[i];
+  tl->code_filt.b0 = b->code_b0[i];
+  tl->code_filt.b1 = b->code_b1[i];
+  tl->code_filt.prev_error = b->code_prev[i];
+  tl->code_filt.y = b->code_y[i];
+  tl->carr_to_code = b->carr_to_code[i];
+  tl->A = b->A[i];
+  tl->sched = b->sched[i];
+  tl->n = b->n[i];
+  if (ld)
+    get_lock_detect(b, i, ld);
+  if (cn0)
+    get_cn0_est(b, i, cn0);
+}
+
+/** Update all channels of a tracking loop bank.
+ *
+ * Equivalent to calling, for each channel `i`, the tracking loop update
+ * matching its type with `cs[i]`, then lock_detect_update() with the prompt
+ * correlation and `DT`, and finally cn0_est() with the prompt correlation,
+ * storing the result in `b->cn0[i]`.
+ *
+ * \param b  The tracking loop bank.
+ * \param cs Array of `n_channels` [E, P, L] correlations.
+ * \param DT Integration time, passed to the lock detector.
+ */
+void track_bank_update(track_bank_t *b, correlation_t cs[][3], float DT)
+{
+  u32 n = b->n_channels;
+
+  /* Discriminators. The transcendental functions are left as scalar library
+   * calls so that the results match the per-channel functions exactly. */
+  for (u32 i = 0; i < n; i++) {
+    float I = cs[i][1].I;
+    float Q = cs[i][1].Q;
+    b->prompt_I[i] = I;
+    b->prompt_Q[i] = Q;
+    /* costas_discriminator(), atanf(0) gives the same zero returned for
+     * I == 0. */
+    float ratio = (I != 0) ? Q / I : 0.f;
+    b->carr_err[i] = atanf(ratio) * (float)(1/(2*M_PI));
+    b->code_err[i] = dll_discriminator(cs[i]);
+  }
+
+  for (u32 i = 0; i < n; i++) {
+    b->freq_err[i] = 0;
+    if (b->loop_type[i] == TRACK_LOOP_AIDED && b->carr_igain[i] != 0) {
+      b->freq_err[i] = frequency_discriminator(b->prompt_I[i], b->prompt_Q[i],
+                                               b->prev_I[i], b->prev_Q[i]);
+      b->prev_I[i] = b->prompt_I[i];
+      b->prev_Q[i] = b->prompt_Q[i];
+    }
+  }
+
+  /* Loop filters. */
+  for (u32 i = 0; i < n; i++) {
+    bool aided = b->loop_type[i] == TRACK_LOOP_AIDED;
+    bool comp = b->loop_type[i] == TRACK_LOOP_COMP;
+
+    /* aided_lf_update() or simple_lf_update(). */
+    float carr_err = b->carr_err[i];
+    float carr_dy = (b->carr_b0[i] * carr_err) + (b->carr_b1[i] * b->carr_prev[i]);
+    carr_dy = select_f(aided, carr_dy + b->carr_igain[i] * b->freq_err[i],
+                       carr_dy);
+    float carr_freq = b->carr_y[i] + carr_dy;
+    b->carr_y[i] = carr_freq;
+    b->carr_prev[i] = carr_err;
+    b->carr_freq[i] = carr_freq;
+
+    /* simple_lf_update(), with the filter output reset first for the
+     * complementary filter loop. */
+    float code_err = -b->code_err[i];
+    float code_y = select_f(comp, 0.f, b->code_y[i]);
+    code_y += (b->code_b0[i] * code_err) + (b->code_b1[i] * b->code_prev[i]);
+    b->code_y[i] = code_y;
+    b->code_prev[i] = code_err;
+
+    /* Carrier aiding of the aided loop. */
+    float ctc = b->carr_to_code[i];
+    bool use_ctc = aided && ctc != 0;
+    float code_freq = select_f(use_ctc,
+                               code_y + carr_freq / select_f(use_ctc, ctc, 1.f),
+                               code_y);
+
+    /* Complementary filter. */
+    float A = b->A[i];
+    float prev_code_freq = b->code_freq[i];
+    float comp_freq = select_f(b->n[i] > b->sched[i],
+                               A * prev_code_freq + A * code_y +
+                               (1.f - A)*ctc*carr_freq,
+                               prev_code_freq + code_y);
+    b->code_freq[i] = select_f(comp, comp_freq, code_freq);
+    b->n[i] += comp;
+  }
+
+  /* Lock detectors, lock_detect_update(). */
+  for (u32 i = 0; i < n; i++) {
+    float k1 = b->ld_k1[i];
+    float yi = b->ld_yi[i];
+    float yq = b->ld_yq[i];
+    yi += k1 * ((float)(fabs(b->prompt_I[i]) / DT) - yi);
+    yq += k1 * ((float)(fabs(b->prompt_Q[i]) / DT) - yq);
+    b->ld_yi[i] = yi;
+    b->ld_yq[i] = yq;
+
+    bool locked = yi / b->ld_k2[i] > yq;
+    u32 pcount1 = b->ld_pcount1[i];
+    u32 pcount2 = b->ld_pcount2[i];
+    bool p1_over = pcount1 > b->ld_lp[i];
+    bool p2_over = pcount2 > b->ld_lo[i];
+
+    /* Locked: raise the optimistic indicator, count up to the pessimistic.
+     * Not locked: lower the pessimistic indicator, count down to the
+     * optimistic. */
+    b->outo[i] = select_u32(locked || !p2_over, locked | b->outo[i], 0);
+    b->outp[i] = select_u32(locked, p1_over | b->outp[i], 0);
+    b->ld_pcount1[i] = select_u32(locked, pcount1 + !p1_over, 0);
+    b->ld_pcount2[i] = select_u32(locked, 0, pcount2 + !p2_over);
+  }
+
+  /* C/N0 estimators, cn0_est(). The update is computed for every channel
+   * and discarded on the first iteration. */
+  for (u32 i = 0; i < n; i++) {
+    float I = b->prompt_I[i];
+    float Q = b->prompt_Q[i];
+    float I_prev_abs = b->cn0_I_prev_abs[i];
+    bool first = I_prev_abs < 0.f;
+
+    float P_n = fabsf(Q) - b->cn0_Q_prev_abs[i];
+    P_n = P_n*P_n;
+    float P_s = 0.5f*(I*I + I_prev_abs*I_prev_abs);
+    float tmp = b->cn0_b[i] * P_n / P_s;
+    float nsr = tmp + b->cn0_xn[i] - b->cn0_a[i] * b->cn0_nsr[i];
+
+    b->cn0_I_prev_abs[i] = fabsf(I);
+    b->cn0_Q_prev_abs[i] = fabsf(Q);
+    b->cn0_nsr[i] = select_f(first, b->cn0_nsr[i], nsr);
+    b->cn0_xn[i] = select_f(first, b->cn0_xn[i], tmp);
+  }
+
+  for (u32 i = 0; i < n; i++)
+    b->cn0[i] = b->cn0_log_bw[i] - 10.f*log10f(b->cn0_nsr[i]);
+}
+
+/** \} */
@@ -0,0 +1,88 @@
+#include <check.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <libswiftnav/acq.h>
+#include <libswiftnav/prns.h>
+
+/* Two samples per chip, 2046 = 2 * 3 * 11 * 31 exercises the mixed radix
+ * FFT. */
+#define SAMPLE_FREQ 2.046e6
+#define N 2046
+#define N_BLOCKS 4
+
+START_TEST(test_acq_search)
+{
+  static s8 samples[N_BLOCKS * N];
+  static u64 buff[800000 / sizeof(u64)];
+
+  const gnss_signal_t sid = {.constellation = CONSTELLATION_GPS,
+                             .band = BAND_L1, .sat = 5};
+  const gnss_signal_t absent = {.constellation = CONSTELLATION_GPS,
+                                .band = BAND_L1, .sat = 9};
+  const double cp0 = 300.25;
+  const double cf0 = 400e3 + 1234;
+  const u8 *code = ca_code(sid);
+
+  srand(4);
+  for (u32 i = 0; i < N_BLOCKS * N; i++) {
+    double cp = cp0 + i * 1.023e6 / SAMPLE_FREQ;
+    s8 chip = get_chip((u8 *)code, (u32)cp % 1023);
+    double s = 3 * chip * cos(2 * M_PI * cf0 * i / SAMPLE_FREQ);
+    samples[i] = (s8)lround(s + (rand() % 13) - 6);
+  }
+
+  size_t size = acq_buff_size(N, 2, 41);
+  fail_unless(size <= sizeof(buff), "Test buffer too small (%zu)", size);
+
+  acq_t a;
+  fail_unless(acq_init(&a, SAMPLE_FREQ, buff, size) == 0, "Init failed");
+
+  gnss_signal_t sids[2] = {absent, sid};
+  acq_result_t res[2];
+  fail_unless(acq_search(&a, samples, N_BLOCKS, 390e3, 410e3, 500, 2, sids,
+                         res) == 0, "Search failed");
+
+  fail_unless(sid_is_equal(res[1].sid, sid), "Result sid mismatch");
+  fail_unless(fabs(res[1].cf - cf0) <= 250,
+              "Carrier frequency %f, expected %f", res[1].cf, cf0);
+  fail_unless(fabs(res[1].cp - cp0) <= 0.5,
+              "Code phase %f, expected %f", res[1].cp, cp0);
+  fail_unless(res[1].snr > 3 * res[0].snr,
+              "SNR of present signal %f not well above absent signal %f",
+              res[1].snr, res[0].snr);
+
+  /* Searching again uses the cached code FFTs and no more storage. */
+  size_t used = a.buff_used;
+  fail_unless(acq_search(&a, samples, 1, 390e3, 410e3, 500, 1, &sid,
+                         res) == 0, "Second search failed");
+  fail_unless(a.buff_used == used, "Code FFT not cached");
+  fail_unless(fabs(res[0].cp - cp0) <= 0.5,
+              "Code phase %f, expected %f", res[0].cp, cp0);
+
+  /* Too many bins for the buffer. */
+  fail_unless(acq_search(&a, samples, 1, 300e3, 500e3, 100, 2, sids,
+                         res) < 0, "Search should fail, buffer too small");
+
+  /* Nothing to search for. */
+  fail_unless(acq_search(&a, samples, 1, 390e3, 410e3, 500, 0, sids,
+                         res) == 0, "Empty search failed");
+
+  /* Invalid frequency ranges are rejected. */
+  fail_unless(acq_search(&a, samples, 1, 410e3, 390e3, 500, 1, &sid,
+                         res) == -3, "Search should fail, inverted range");
+  fail_unless(acq_search(&a, samples, 1, 390e3, 410e3, 0, 1, &sid,
+                         res) == -3, "Search should fail, zero bin width");
+}
+END_TEST
+
+Suite* acq_suite(void)
+{
+  Suite *s = suite_create("Acquisition");
+
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_acq_search);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -1,4 +1,6 @@
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <check.h>
 
@@ -345,6 +347,75 @@ START_TEST(test_rebase_state)
 }
 END_TEST
 
+static void check_kf_matrices_dense(nkf_t *kf, u8 num_dds,
+                                    double phase_var, double code_var)
+{
+  u8 constraint_dim = CLAMP_DIFF(num_dds, 3);
+  u8 res_dim = num_dds + constraint_dim;
+  double Sig[res_dim * res_dim];
+  double U[res_dim * res_dim];
+  double D[res_dim];
+  double H_prime[res_dim * num_dds];
+
+  assign_residual_obs_cov(num_dds, phase_var, code_var, kf->null_basis_Q, Sig);
+  matrix_udu(res_dim, Sig, U, D);
+  assign_H_prime(res_dim, constraint_dim, num_dds, kf->null_basis_Q, U,
+                 H_prime);
+
+  for (u32 i = 0; i < res_dim * res_dim; i++) {
+    fail_unless(fabs(kf->decor_mtx[i] - U[i]) < 1e-9,
+                "decor_mtx[%u] %g, dense %g", i, kf->decor_mtx[i], U[i]);
+  }
+  for (u32 i = 0; i < res_dim; i++) {
+    fail_unless(fabs(kf->decor_obs_cov[i] - D[i]) < 1e-9 * D[i],
+                "decor_obs_cov[%u] %g, dense %g", i, kf->decor_obs_cov[i], D[i]);
+  }
+  for (u32 i = 0; i < res_dim * num_dds; i++) {
+    fail_unless(fabs(kf->decor_obs_mtx[i] - H_prime[i]) < 1e-9,
+                "decor_obs_mtx[%u] %g, dense %g",
+                i, kf->decor_obs_mtx[i], H_prime[i]);
+  }
+}
+
+/* The block-structured decorrelation matches decomposing the full residual
+ * covariance, including when the cached code block is reused. */
+START_TEST(test_kf_matrices)
+{
+  static nkf_t kf;
+  double ref_ecef[3] = {-2700000, -4300000, 3850000};
+  sdiff_t sdiffs[MAX_CHANNELS];
+  u8 num_sdiffs = MAX_CHANNELS;
+
+  memset(sdiffs, 0, sizeof(sdiffs));
+  for (u8 epoch = 0; epoch < 2; epoch++) {
+    for (u8 i = 0; i < num_sdiffs; i++) {
+      double az = 0.7 * i + 0.01 * epoch;
+      double el = 0.2 + 0.12 * i;
+      sdiffs[i].sid.sat = i + 1;
+      sdiffs[i].sat_pos[0] = ref_ecef[0] + 2e7 * cos(el) * cos(az);
+      sdiffs[i].sat_pos[1] = ref_ecef[1] + 2e7 * cos(el) * sin(az);
+      sdiffs[i].sat_pos[2] = ref_ecef[2] + 2e7 * sin(el);
+    }
+    set_nkf_matrices(&kf, 0.01, 100, num_sdiffs, sdiffs, ref_ecef);
+    fail_unless(kf.code_block_dim == num_sdiffs - 1);
+    check_kf_matrices_dense(&kf, num_sdiffs - 1, 0.01, 100);
+  }
+
+  /* A new code variance rebuilds the cached block. */
+  double old_var = kf.code_block_var;
+  set_nkf_matrices(&kf, 0.01, 400, num_sdiffs, sdiffs, ref_ecef);
+  fail_unless(kf.code_block_var != old_var);
+  check_kf_matrices_dense(&kf, num_sdiffs - 1, 0.01, 400);
+
+  /* Fewer sats, and the unconstrained case. */
+  set_nkf_matrices(&kf, 0.01, 400, 6, sdiffs, ref_ecef);
+  check_kf_matrices_dense(&kf, 5, 0.01, 400);
+  set_nkf_matrices(&kf, 0.01, 400, 4, sdiffs, ref_ecef);
+  fail_unless(kf.obs_dim == 3);
+  check_kf_matrices_dense(&kf, 3, 0.01, 400);
+}
+END_TEST
+
 Suite* amb_kf_test_suite(void)
 {
   Suite *s = suite_create("Ambiguity Kalman Filter");
@@ -358,6 +429,7 @@ Suite* amb_kf_test_suite(void)
   tcase_add_test(tc_core, test_kf_update_noop);
   tcase_add_test(tc_core, test_kf_update);
   tcase_add_test(tc_core, test_rebase_state);
+  tcase_add_test(tc_core, test_kf_matrices);
   suite_add_tcase(s, tc_core);
 
   return s;
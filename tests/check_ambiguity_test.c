@@ -1,6 +1,7 @@
 #include <check.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 
 #include <libswiftnav/linear_algebra.h>
 #include <libswiftnav/ambiguity_test.h>
@@ -82,7 +83,7 @@ START_TEST(test_bad_measurements)
   fail_unless(amb_test.sats.sids[3].sat == 5);
   /* And it should have dropped PRN's value from the hypothesis,
    * which should still be there and still be the only one. */
-  hyp = (hypothesis_t *) amb_test.pool->allocated_nodes_head->elem;
+  hyp = (hypothesis_t *) memory_pool_elements(amb_test.pool);
   fail_unless(ambiguity_test_n_hypotheses(&amb_test) == 1);
   fail_unless(hyp->N[0] == 1);
   fail_unless(hyp->N[1] == 2);
@@ -283,6 +284,105 @@ START_TEST(test_amb_sat_inclusion)
 }
 END_TEST
 
+/* Assure that the batched quadratic terms match the per-hypothesis ones. */
+START_TEST(test_quadratic_terms)
+{
+  seed_rng();
+  for (u8 num_dds = 1; num_dds < MAX_CHANNELS; num_dds++) {
+    double DE_mtx[num_dds * 3];
+    arr_frand(num_dds * 3, -1, 1, DE_mtx);
+    double obs_cov[4 * num_dds * num_dds];
+    memset(obs_cov, 0, sizeof(obs_cov));
+    for (u8 i = 0; i < num_dds; i++) {
+      for (u8 j = 0; j < num_dds; j++) {
+        double s = (i == j) ? 2 : 1;
+        obs_cov[i*2*num_dds + j] = s * 1e-4;
+        obs_cov[(i+num_dds)*2*num_dds + j+num_dds] = s * 4;
+      }
+    }
+    residual_mtxs_t res_mtxs;
+    init_residual_matrices(&res_mtxs, num_dds, DE_mtx, obs_cov);
+
+    double dd_meas[2 * num_dds];
+    arr_frand(2 * num_dds, -20, 20, dd_meas);
+    double r_vec[2*MAX_CHANNELS-5];
+    assign_r_vec(&res_mtxs, num_dds, dd_meas, r_vec);
+
+    u32 n_hyps = 37;
+    hypothesis_t hyps[n_hyps];
+    double q[n_hyps];
+    for (u32 k = 0; k < n_hyps; k++) {
+      for (u8 j = 0; j < num_dds; j++) {
+        hyps[k].N[j] = (s32)frand(-10, 10);
+      }
+    }
+    get_quadratic_terms(&res_mtxs, num_dds, n_hyps, hyps, r_vec, q);
+
+    for (u32 k = 0; k < n_hyps; k++) {
+      double N[num_dds];
+      for (u8 j = 0; j < num_dds; j++) {
+        N[j] = hyps[k].N[j];
+      }
+      double q_ref = get_quadratic_term(&res_mtxs, num_dds, N, r_vec);
+      fail_unless(fabs(q[k] - q_ref) <= 1e-9 * MAX(1, fabs(q_ref)),
+                  "Quadratic term mismatch (num_dds %u, hyp %u): %g vs %g",
+                  num_dds, k, q[k], q_ref);
+    }
+  }
+}
+END_TEST
+
+/* Assure that ambiguity tests with their own buffers are independent, and
+ * that resizing keeps the most likely hypotheses. */
+START_TEST(test_ambiguity_test_capacity)
+{
+  static u8 buff_a[AMBIGUITY_TEST_BUFF_SIZE(8)];
+  static u8 buff_b[AMBIGUITY_TEST_BUFF_SIZE(8)];
+  static u8 buff_c[AMBIGUITY_TEST_BUFF_SIZE(16)];
+  ambiguity_test_t a, b;
+
+  fail_unless(ambiguity_test_init(&a, 0, buff_a) < 0);
+  fail_unless(ambiguity_test_init(&a, 8, buff_a) == 0);
+  fail_unless(ambiguity_test_init(&b, 8, buff_b) == 0);
+  fail_unless(ambiguity_test_max_hypotheses(&a) == 8);
+
+  for (u8 i = 0; i < 8; i++) {
+    hypothesis_t *hyp = (hypothesis_t *)memory_pool_add(a.pool);
+    fail_unless(hyp != NULL);
+    hyp->N[0] = i;
+    hyp->ll = -(float)((i * 3) % 8);
+  }
+  fail_unless(memory_pool_add(a.pool) == NULL);
+  reset_ambiguity_test(&b);
+  fail_unless(ambiguity_test_n_hypotheses(&a) == 8);
+  fail_unless(ambiguity_test_n_hypotheses(&b) == 1);
+
+  /* Grow into a new buffer. */
+  fail_unless(ambiguity_test_resize(&a, 16, buff_c) == 0);
+  fail_unless(ambiguity_test_max_hypotheses(&a) == 16);
+  fail_unless(ambiguity_test_n_hypotheses(&a) == 8);
+  fail_unless(memory_pool_add(a.pool) != NULL);
+  memory_pool_filter_mask(a.pool, (const u8 []){0, 1, 1, 1, 1, 1, 1, 1, 1});
+
+  /* A failed resize leaves the hypotheses alone. */
+  fail_unless(ambiguity_test_resize(&a, 0, buff_c) < 0);
+  fail_unless(ambiguity_test_n_hypotheses(&a) == 8);
+
+  /* Shrink in place, keeping the three most likely hypotheses. */
+  fail_unless(ambiguity_test_resize(&a, 3, buff_c) == 0);
+  fail_unless(ambiguity_test_max_hypotheses(&a) == 3);
+  fail_unless(ambiguity_test_n_hypotheses(&a) == 3);
+  hypothesis_t *hyps = (hypothesis_t *)memory_pool_elements(a.pool);
+  for (u8 i = 0; i < 3; i++) {
+    fail_unless(hyps[i].ll == -(float)i,
+                "Hypothesis %u has ll %f", i, hyps[i].ll);
+    fail_unless((hyps[i].N[0] * 3) % 8 == i);
+  }
+
+  fail_unless(ambiguity_test_n_hypotheses(&b) == 1);
+}
+END_TEST
+
 Suite* ambiguity_test_suite(void)
 {
   Suite *s = suite_create("Ambiguity Test");
@@ -296,6 +396,8 @@ Suite* ambiguity_test_suite(void)
   //tcase_add_test(tc_core, test_update_sats_rebase);
   (void) test_update_sats_rebase;
   tcase_add_test(tc_core, test_amb_sat_inclusion);
+  tcase_add_test(tc_core, test_quadratic_terms);
+  tcase_add_test(tc_core, test_ambiguity_test_capacity);
   suite_add_tcase(s, tc_core);
 
   return s;
@@ -1,6 +1,7 @@
 #include <check.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <libswiftnav/linear_algebra.h>
 #include <libswiftnav/constants.h>
@@ -534,6 +535,134 @@ START_TEST(test_lesq_repair2)
 }
 END_TEST
 
+/* Double differences for a fixed sky and baseline, with small pseudo-noise
+ * and cycle slips on the listed dds. */
+static void make_raim_dds(u8 num_dds, u8 num_slips, const u8 *slips,
+                          double *DE, double *N, double *dd_obs)
+{
+  double b[3] = {12.3, -45.6, 7.8};
+  for (u8 i = 0; i < num_dds; i++) {
+    double az = 2 * M_PI * i / num_dds + 0.3;
+    double el = (15 + 60.0 * ((i * 7) % num_dds) / num_dds) * D2R;
+    DE[3*i + 0] = cos(el) * sin(az);
+    DE[3*i + 1] = cos(el) * cos(az);
+    DE[3*i + 2] = sin(el) - 1;
+    N[i] = (i * 37) % 23 - 11;
+  }
+  predict_carrier_obs(num_dds, N, DE, b, dd_obs);
+  for (u8 i = 0; i < num_dds; i++)
+    dd_obs[i] += ((s32)((i * 13) % 11) - 5) * 2e-3;
+  for (u8 k = 0; k < num_slips; k++)
+    dd_obs[slips[k]] += 5 + 3 * k;
+}
+
+/* Solve without the listed dds the direct way. */
+static void lesq_without(u8 num_dds, u8 num_dropped, const u8 *dropped,
+                         const double *DE, const double *N,
+                         const double *dd_obs, double b[3], double *resid)
+{
+  double DE_[num_dds * 3], N_[num_dds], dd_obs_[num_dds];
+  u8 n = 0;
+  for (u8 i = 0; i < num_dds; i++) {
+    bool drop = false;
+    for (u8 k = 0; k < num_dropped; k++)
+      drop |= dropped[k] == i;
+    if (drop)
+      continue;
+    memcpy(&DE_[3*n], &DE[3*i], 3 * sizeof(double));
+    N_[n] = N[i];
+    dd_obs_[n] = dd_obs[i];
+    n++;
+  }
+  fail_unless(lesq_solution_float(n, dd_obs_, N_, DE_, b, resid) == 0);
+}
+
+/* The closed form repair matches re-solving without the bad dd. */
+START_TEST(test_lesq_repair_closed_form)
+{
+  u8 num_dds = 9;
+  double DE[num_dds * 3], N[num_dds], dd_obs[num_dds];
+
+  for (u8 bad = 0; bad < num_dds; bad++) {
+    make_raim_dds(num_dds, 1, &bad, DE, N, dd_obs);
+
+    double b[3], resid[num_dds];
+    u8 n_used, removed;
+    s8 ret = lesq_solve_raim(num_dds, dd_obs, N, DE, b,
+      false, DEFAULT_RAIM_THRESHOLD, &n_used, resid, &removed);
+    fail_unless(ret == 1, "Expecting repaired solution, got %d", ret);
+    fail_unless(removed == bad, "Removed %u instead of %u", removed, bad);
+    fail_unless(n_used == num_dds - 1);
+
+    double b_ref[3], resid_ref[num_dds - 1];
+    lesq_without(num_dds, 1, &bad, DE, N, dd_obs, b_ref, resid_ref);
+    for (u8 i = 0; i < 3; i++)
+      fail_unless(fabs(b[i] - b_ref[i]) < 1e-9,
+                  "Baseline mismatch: %f vs %f", b[i], b_ref[i]);
+    for (u8 i = 0; i < num_dds - 1; i++)
+      fail_unless(fabs(resid[i] - resid_ref[i]) < 1e-9,
+                  "Residual mismatch: %f vs %f", resid[i], resid_ref[i]);
+  }
+}
+END_TEST
+
+START_TEST(test_lesq_raim_fde)
+{
+  u8 num_dds = 10;
+  double DE[num_dds * 3], N[num_dds], dd_obs[num_dds];
+  double b[3], resid[num_dds], scores[num_dds];
+  bool excluded[num_dds];
+  u8 n_used;
+  s8 ret;
+
+  /* No faults. */
+  make_raim_dds(num_dds, 0, 0, DE, N, dd_obs);
+  ret = lesq_solve_raim_fde(num_dds, dd_obs, N, DE, b,
+    DEFAULT_RAIM_THRESHOLD, 2, &n_used, resid, excluded, scores);
+  fail_unless(ret == 0, "Expecting 0 for a good solution, got %d", ret);
+  fail_unless(n_used == num_dds);
+  for (u8 i = 0; i < num_dds; i++)
+    fail_if(excluded[i], "Excluded good dd %u", i);
+
+  /* Two faults. */
+  u8 slips[] = {2, 6};
+  make_raim_dds(num_dds, 2, slips, DE, N, dd_obs);
+  ret = lesq_solve_raim_fde(num_dds, dd_obs, N, DE, b,
+    DEFAULT_RAIM_THRESHOLD, 2, &n_used, resid, excluded, scores);
+  fail_unless(ret == 1, "Expecting 1 for repaired solution, got %d", ret);
+  fail_unless(n_used == num_dds - 2);
+  for (u8 i = 0; i < num_dds; i++)
+    fail_unless(excluded[i] == (i == slips[0] || i == slips[1]),
+                "Wrong exclusion of dd %u", i);
+
+  u8 worst = 0;
+  for (u8 i = 1; i < num_dds; i++)
+    if (scores[i] > scores[worst])
+      worst = i;
+  fail_unless(worst == slips[0] || worst == slips[1],
+              "Highest fault score on good dd %u", worst);
+
+  double b_ref[3], resid_ref[num_dds - 2];
+  lesq_without(num_dds, 2, slips, DE, N, dd_obs, b_ref, resid_ref);
+  for (u8 i = 0; i < 3; i++)
+    fail_unless(fabs(b[i] - b_ref[i]) < 1e-9,
+                "Baseline mismatch: %f vs %f", b[i], b_ref[i]);
+  for (u8 i = 0, j = 0; i < num_dds; i++) {
+    if (excluded[i])
+      continue;
+    fail_unless(fabs(resid[i] - resid_ref[j]) < 1e-9,
+                "Residual mismatch: %f vs %f", resid[i], resid_ref[j]);
+    j++;
+  }
+
+  /* Not allowed to exclude enough. */
+  ret = lesq_solve_raim_fde(num_dds, dd_obs, N, DE, b,
+    DEFAULT_RAIM_THRESHOLD, 1, &n_used, 0, 0, 0);
+  fail_unless(ret == -3, "Expecting -3 for failed repair, got %d", ret);
+  fail_unless(n_used == 0);
+}
+END_TEST
+
 Suite* baseline_test_suite(void)
 {
   Suite *s = suite_create("Baseline Calculations");
@@ -551,6 +680,8 @@ Suite* baseline_test_suite(void)
   tcase_add_test(tc_core, test_lesq_repair2);
   tcase_add_test(tc_core, test_lesq_repair8);
   tcase_add_test(tc_core, test_lesq_repair_disabled);
+  tcase_add_test(tc_core, test_lesq_repair_closed_form);
+  tcase_add_test(tc_core, test_lesq_raim_fde);
 
   suite_add_tcase(s, tc_core);
 
@@ -4,6 +4,7 @@
 #include <libswiftnav/bits.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 
 START_TEST(test_parity)
 {
@@ -175,6 +176,45 @@ START_TEST(test_bitcopy)
 }
 END_TEST
 
+START_TEST(test_bitstream)
+{
+  u8 test_data[64];
+
+  srand(1);
+  for (u8 i = 0; i < sizeof(test_data); i++)
+    test_data[i] = rand();
+
+  /* Random field lengths, including zero length fields, from several
+   * unaligned start positions. */
+  for (u32 start = 0; start < 9; start++) {
+    bitstream_t s;
+    bitstream_init(&s, test_data, start);
+    u32 p = start;
+    /* Each pass reads two fields of up to 32 bits and skips up to 39. */
+    for (u32 n = 0; p < 8 * sizeof(test_data) - 104; n++) {
+      u8 len = rand() % 33;
+      fail_unless(bitstream_pos(&s) == p,
+          "Position %d, expected %d", bitstream_pos(&s), p);
+      u32 u = bitstream_getu(&s, len);
+      fail_unless(u == getbitu(test_data, p, len),
+          "Field %d (%d bits at %d) read as 0x%08X, expected 0x%08X",
+          n, len, p, u, getbitu(test_data, p, len));
+      p += len;
+      if (len > 0) {
+        s32 v = bitstream_gets(&s, len);
+        fail_unless(v == getbits(test_data, p, len),
+            "Signed field %d (%d bits at %d) read as %d, expected %d",
+            n, len, p, v, getbits(test_data, p, len));
+        p += len;
+      }
+      u8 skip = rand() % 40;
+      bitstream_skip(&s, skip);
+      p += skip;
+    }
+  }
+}
+END_TEST
+
 
 Suite* bits_suite(void)
 {
@@ -188,6 +228,7 @@ Suite* bits_suite(void)
   tcase_add_test(tc_core, test_setbits);
   tcase_add_test(tc_core, test_bitshl);
   tcase_add_test(tc_core, test_bitcopy);
+  tcase_add_test(tc_core, test_bitstream);
   suite_add_tcase(s, tc_core);
 
   return s;
@@ -453,6 +453,82 @@ START_TEST(test_cnav_decode_ok_nok_ok)
 END_TEST
 
 
+START_TEST(test_cnav_decode_block)
+{
+  /* Two good messages on either side of enough bad ones to lose the lock,
+   * started on an odd symbol. */
+  u8 prefix[4];
+  u8 suffix[SUFFIX_SIZE];
+  u8 bad_message[38];
+  memset(prefix, 0x55, sizeof(prefix));
+  memset(suffix, 0x55, sizeof(suffix));
+  memset(bad_message, 0x55, sizeof(bad_message));
+
+  u8 enc[((sizeof(prefix) + sizeof(suffix)) * CHAR_BIT +
+         GPS_CNAV_MSG_LENGTH * (GPS_CNAV_LOCK_MAX_CRC_FAILS + 5)) * 2 + 1];
+  size_t dst = 1;
+  u32 acc = 0;
+  enc[0] = 0x80;
+  dst += encode(&acc, prefix, sizeof(prefix), enc + dst);
+  dst += add_encoded_message(&acc, enc + dst);
+  dst += add_encoded_message(&acc, enc + dst);
+  for (size_t i = 0; i <= GPS_CNAV_LOCK_MAX_CRC_FAILS; ++i) {
+    dst += encode_bits(&acc, bad_message, GPS_CNAV_MSG_LENGTH, enc + dst);
+  }
+  dst += add_encoded_message(&acc, enc + dst);
+  dst += add_encoded_message(&acc, enc + dst);
+  dst += encode(&acc, suffix, sizeof(suffix), enc + dst);
+
+  /* Reference: one symbol at a time. Message times are kept as the index of
+   * the symbol the delay is counted back from, minus the delay. */
+  cnav_msg_decoder_t dec;
+  cnav_msg_t ref_msgs[8], msgs[8];
+  s32 ref_t[8];
+  u32 n_ref = 0;
+  cnav_msg_decoder_init(&dec);
+  for (size_t i = 0; i < dst; ++i) {
+    u32 delay;
+    if (cnav_msg_decoder_add_symbol(&dec, enc[i], &ref_msgs[n_ref], &delay)) {
+      ref_t[n_ref++] = (s32)i - (s32)delay;
+    }
+  }
+  fail_unless(n_ref == 4, "Expected 4 messages, decoded %" PRIu32, n_ref);
+
+  u32 seed = 1;
+  for (u32 trial = 0; trial < 20; trial++) {
+    u32 n_msgs = 0;
+    size_t i = 0;
+    cnav_msg_decoder_init(&dec);
+    while (i < dst) {
+      seed = seed * 1664525u + 1013904223u;
+      u32 n = MIN(1 + (seed >> 8) % (trial * 50 + 1), dst - i);
+      u32 max_msgs = MIN(1 + (seed >> 24) % 2, 8 - n_msgs);
+      u32 delays[2];
+      u32 n_used;
+      u32 n_new = cnav_msg_decoder_add_symbols(&dec, &enc[i], n, &msgs[n_msgs],
+                                               delays, max_msgs, &n_used);
+      fail_unless(n_used <= n && (n_used == n || n_new == max_msgs),
+                  "Block stopped early: %" PRIu32 " of %" PRIu32, n_used, n);
+      for (u32 k = 0; k < n_new; k++) {
+        s32 t = (s32)(i + n_used - 1) - (s32)delays[k];
+        fail_unless(n_msgs < n_ref && t == ref_t[n_msgs],
+                    "Message %" PRIu32 " time mismatch", n_msgs);
+        fail_unless(msgs[n_msgs].prn == ref_msgs[n_msgs].prn &&
+                    msgs[n_msgs].msg_id == ref_msgs[n_msgs].msg_id &&
+                    msgs[n_msgs].tow == ref_msgs[n_msgs].tow &&
+                    msgs[n_msgs].alert == ref_msgs[n_msgs].alert,
+                    "Message %" PRIu32 " mismatch", n_msgs);
+        n_msgs++;
+      }
+      i += n_used;
+    }
+    fail_unless(n_msgs == n_ref, "Decoded %" PRIu32 " of %" PRIu32 " messages",
+                n_msgs, n_ref);
+  }
+}
+END_TEST
+
+
 START_TEST(test_cnav_crc)
 {
   u32 crc0, crc1;
@@ -482,6 +558,7 @@ Suite* cnav_test_suite(void)
   tcase_add_test(tc_core, test_cnav_decode_false);
   tcase_add_test(tc_core, test_cnav_decode_unlock);
   tcase_add_test(tc_core, test_cnav_decode_ok_nok_ok);
+  tcase_add_test(tc_core, test_cnav_decode_block);
 
   suite_add_tcase(s, tc_core);
 
@@ -0,0 +1,141 @@
+#include <check.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <libswiftnav/code_cache.h>
+#include <libswiftnav/correlate.h>
+#include <libswiftnav/prns.h>
+
+#define CODE_STEP (1.023e6 / 16.368e6)
+#define CARR_STEP (2 * M_PI * 4.092e6 / 16.368e6)
+
+static u64 cache_buff[80000 / sizeof(u64)];
+
+static const gnss_signal_t sid1 = {.constellation = CONSTELLATION_GPS,
+                                   .band = BAND_L1, .sat = 3};
+static const gnss_signal_t sid2 = {.constellation = CONSTELLATION_SBAS,
+                                   .band = BAND_L1, .sat = 131};
+
+START_TEST(test_code_cache_get)
+{
+  code_cache_t cache;
+  size_t size = code_cache_replica_size(1023, CODE_STEP);
+  fail_unless(2 * size < sizeof(cache_buff) && 3 * size > sizeof(cache_buff),
+              "Test buffer should hold exactly two replicas");
+
+  fail_unless(code_cache_init(&cache, NULL, 0) < 0,
+              "Init should fail without a buffer");
+  fail_unless(code_cache_init(&cache, cache_buff, sizeof(cache_buff)) == 0,
+              "Init failed");
+
+  const code_replica_t *r1 = code_cache_get(&cache, sid1, CODE_STEP);
+  fail_unless(r1 != NULL, "Replica not generated");
+  fail_unless(code_cache_get(&cache, sid1, CODE_STEP * (1 + 1e-6)) == r1,
+              "Replica not shared for a slightly different code rate");
+  const code_replica_t *r2 = code_cache_get(&cache, sid2, CODE_STEP);
+  fail_unless(r2 != NULL && r2 != r1, "Replica not generated for sid2");
+  fail_unless(code_cache_get(&cache, sid1, 2 * CODE_STEP) == NULL,
+              "Cache should be full");
+
+  code_cache_clear(&cache);
+  fail_unless(code_cache_get(&cache, sid1, 2 * CODE_STEP) != NULL,
+              "Replica not generated after clear");
+}
+END_TEST
+
+START_TEST(test_code_replica_chips)
+{
+  code_cache_t cache;
+  code_cache_init(&cache, cache_buff, sizeof(cache_buff));
+  const code_replica_t *r = code_cache_get(&cache, sid1, CODE_STEP);
+  const u8 *ca = ca_code(sid1);
+
+  const double phases[] = {0.0, 1.5, 511.25, 1022.9375, 2046.0, -1.0};
+  for (u32 i = 0; i < sizeof(phases) / sizeof(phases[0]); i++) {
+    u32 n;
+    const s8 *chips = code_replica_chips(r, phases[i], &n);
+    fail_unless(n >= 1023 / CODE_STEP,
+                "Window shorter than one code period (%u)", n);
+
+    u64 packed[(2 * 16368 + 127) / 64];
+    u32 n_packed = code_replica_packed(r, phases[i], n, packed);
+    fail_unless(n_packed == n, "Packed window length %u != %u", n_packed, n);
+
+    /* The phases above all fall on the sample grid. */
+    for (s32 k = -(s32)(1 / CODE_STEP); k < (s32)n; k++) {
+      double p = phases[i] + k * CODE_STEP;
+      s32 idx = ((s32)floor(p) % 1023 + 1023) % 1023;
+      fail_unless(chips[k] == get_chip((u8 *)ca, idx),
+                  "Chip mismatch at phase %f sample %d", phases[i], k);
+      if (k >= 0) {
+        u8 bit = (packed[k / 64] >> (k % 64)) & 1;
+        fail_unless(bit == (chips[k] < 0),
+                    "Packed bit mismatch at phase %f sample %d", phases[i], k);
+      }
+    }
+  }
+}
+END_TEST
+
+START_TEST(test_code_replica_correlate)
+{
+  code_cache_t cache;
+  code_cache_init(&cache, cache_buff, sizeof(cache_buff));
+  const code_replica_t *r = code_cache_get(&cache, sid1, CODE_STEP);
+  const u8 *ca = ca_code(sid1);
+
+  static s8 code[1023];
+  static s8 samples[16368];
+  for (u32 i = 0; i < 1023; i++)
+    code[i] = get_chip((u8 *)ca, i);
+  srand(2);
+  for (u32 i = 0; i < 16368; i++)
+    samples[i] = (rand() % 15) - 7 + 5*code[(u32)(40 + i * CODE_STEP) % 1023];
+
+  corr_channel_t ref;
+  corr_channel_init(&ref, code, 1023, 5, 0.5);
+  ref.code_phase = 40.0;
+  ref.code_step = CODE_STEP;
+  ref.carr_step = CARR_STEP;
+  ref.num_samples = 16368;
+  track_correlate_multi(CORR_IMPL_GENERIC, samples, 1, &ref);
+
+  for (corr_impl_t impl = CORR_IMPL_GENERIC; impl <= CORR_IMPL_AVX512;
+       impl++) {
+    if (!corr_impl_supported(impl))
+      continue;
+
+    corr_channel_t c;
+    corr_channel_init(&c, code, 1023, 5, 0.5);
+    c.code_phase = 40.0;
+    c.code_step = CODE_STEP;
+    c.carr_step = CARR_STEP;
+    c.num_samples = 16368;
+    c.replica = code_replica_chips(r, c.code_phase, NULL);
+    track_correlate_multi(impl, samples, 1, &c);
+
+    for (u8 j = 0; j < 5; j++) {
+      fail_unless(fabs(c.corr[j].I - ref.corr[j].I) < 1.0 &&
+                  fabs(c.corr[j].Q - ref.corr[j].Q) < 1.0,
+                  "impl %d tap %d (%f, %f) != (%f, %f)", impl, j,
+                  c.corr[j].I, c.corr[j].Q, ref.corr[j].I, ref.corr[j].Q);
+    }
+    fail_unless(fabs(c.code_phase - ref.code_phase) < 1e-9,
+                "impl %d code phase %f != %f", impl, c.code_phase,
+                ref.code_phase);
+  }
+}
+END_TEST
+
+Suite* code_cache_suite(void)
+{
+  Suite *s = suite_create("Code cache");
+
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_code_cache_get);
+  tcase_add_test(tc_core, test_code_replica_chips);
+  tcase_add_test(tc_core, test_code_replica_correlate);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
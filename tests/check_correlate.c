@@ -0,0 +1,159 @@
+#include <check.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <libswiftnav/correlate.h>
+#include <libswiftnav/prns.h>
+
+#define NUM_SAMPLES 20000
+#define CODE_STEP (1.023e6 / 16.368e6 * (1 + 1e-6))
+#define CARR_STEP (2 * M_PI * (4.092e6 + 1234.5) / 16.368e6)
+
+static s8 samples[NUM_SAMPLES];
+static s8 code[1023];
+/* Replica in the padded layout expected by track_correlate(). */
+static s8 code_padded[1026];
+
+static void corr_setup(void)
+{
+  gnss_signal_t sid = {.constellation = CONSTELLATION_GPS,
+                       .band = BAND_L1, .sat = 7};
+  const u8 *ca = ca_code(sid);
+  for (u32 i = 0; i < 1023; i++)
+    code[i] = get_chip((u8 *)ca, i);
+  code_padded[0] = code[1022];
+  for (u32 i = 0; i < 1023; i++)
+    code_padded[i + 1] = code[i];
+  code_padded[1024] = code[0];
+  code_padded[1025] = code[1];
+
+  /* Signal with a slightly different code phase and carrier phase to the
+   * replica plus some noise. */
+  srand(1);
+  for (u32 i = 0; i < NUM_SAMPLES; i++) {
+    double cp = 100.2 + i * CODE_STEP;
+    double chip = code[(u32)cp % 1023];
+    double s = 12 * chip * sin(0.3 + i * CARR_STEP) + (rand() % 7) - 3;
+    samples[i] = (s8)lround(s);
+  }
+}
+
+static double sum_abs_samples(u32 first, u32 n)
+{
+  double sum = 0;
+  for (u32 i = first; i < first + n; i++)
+    sum += abs(samples[i]);
+  return sum;
+}
+
+START_TEST(test_correlate_multi_vs_reference)
+{
+  corr_setup();
+
+  double ref_code_phase = 100.0;
+  double ref_carr_phase = 0.1;
+  double I_E, Q_E, I_P, Q_P, I_L, Q_L;
+  u32 n;
+  track_correlate(samples, code_padded, &ref_code_phase, CODE_STEP,
+                  &ref_carr_phase, CARR_STEP,
+                  &I_E, &Q_E, &I_P, &Q_P, &I_L, &Q_L, &n);
+  double ref[6] = {I_E, Q_E, I_P, Q_P, I_L, Q_L};
+  double tol = 1e-3 * sum_abs_samples(0, n);
+
+  for (corr_impl_t impl = CORR_IMPL_GENERIC; impl <= CORR_IMPL_AVX512;
+       impl++) {
+    if (!corr_impl_supported(impl))
+      continue;
+
+    corr_channel_t c;
+    corr_channel_init(&c, code, 1023, 3, 0.5);
+    c.code_phase = 100.0;
+    c.code_step = CODE_STEP;
+    c.carr_phase = 0.1;
+    c.carr_step = CARR_STEP;
+    c.num_samples = n;
+    track_correlate_multi(impl, samples, 1, &c);
+
+    for (u8 j = 0; j < 3; j++) {
+      fail_unless(fabs(c.corr[j].I - ref[2*j]) < tol,
+                  "impl %d tap %d I %f != %f", impl, j, c.corr[j].I,
+                  ref[2*j]);
+      fail_unless(fabs(c.corr[j].Q - ref[2*j + 1]) < tol,
+                  "impl %d tap %d Q %f != %f", impl, j, c.corr[j].Q,
+                  ref[2*j + 1]);
+    }
+    fail_unless(fabs(c.code_phase - ref_code_phase) < 1e-6,
+                "impl %d code phase %f != %f", impl, c.code_phase,
+                ref_code_phase);
+    fail_unless(fabs(c.carr_phase - ref_carr_phase) < 1e-6,
+                "impl %d carrier phase %f != %f", impl, c.carr_phase,
+                ref_carr_phase);
+  }
+}
+END_TEST
+
+START_TEST(test_correlate_multi_channels)
+{
+  corr_setup();
+
+  /* Five taps, windows crossing the code rollover and a channel whose code
+   * rate is too high for the vector kernels. */
+  corr_channel_t ref[4], c[4];
+  const double code_phase[4] = {1000.3, 1022.95, 0.0, 512.5};
+  const double code_step[4] = {CODE_STEP, CODE_STEP, CODE_STEP, 0.95};
+  const u32 first[4] = {0, 17, 3000, 123};
+  for (u8 i = 0; i < 4; i++) {
+    corr_channel_init(&ref[i], code, 1023, i == 2 ? 3 : 5, 0.5);
+    ref[i].code_phase = code_phase[i];
+    ref[i].code_step = code_step[i];
+    ref[i].carr_phase = 0.5 * i;
+    ref[i].carr_step = CARR_STEP;
+    ref[i].first_sample = first[i];
+    ref[i].num_samples = 16000 + i;
+  }
+  track_correlate_multi(CORR_IMPL_GENERIC, samples, 4, ref);
+
+  for (corr_impl_t impl = CORR_IMPL_AVX2; impl <= CORR_IMPL_AVX512; impl++) {
+    if (!corr_impl_supported(impl))
+      continue;
+
+    for (u8 i = 0; i < 4; i++) {
+      corr_channel_init(&c[i], code, 1023, i == 2 ? 3 : 5, 0.5);
+      c[i].code_phase = code_phase[i];
+      c[i].code_step = code_step[i];
+      c[i].carr_phase = 0.5 * i;
+      c[i].carr_step = CARR_STEP;
+      c[i].first_sample = first[i];
+      c[i].num_samples = 16000 + i;
+    }
+    track_correlate_multi(impl, samples, 4, c);
+
+    for (u8 i = 0; i < 4; i++) {
+      double tol = 1e-3 * sum_abs_samples(first[i], c[i].num_samples);
+      for (u8 j = 0; j < c[i].n_taps; j++) {
+        fail_unless(fabs(c[i].corr[j].I - ref[i].corr[j].I) < tol,
+                    "impl %d channel %d tap %d I %f != %f", impl, i, j,
+                    c[i].corr[j].I, ref[i].corr[j].I);
+        fail_unless(fabs(c[i].corr[j].Q - ref[i].corr[j].Q) < tol,
+                    "impl %d channel %d tap %d Q %f != %f", impl, i, j,
+                    c[i].corr[j].Q, ref[i].corr[j].Q);
+      }
+      fail_unless(fabs(c[i].code_phase - ref[i].code_phase) < 1e-6,
+                  "impl %d channel %d code phase %f != %f", impl, i,
+                  c[i].code_phase, ref[i].code_phase);
+    }
+  }
+}
+END_TEST
+
+Suite* correlate_suite(void)
+{
+  Suite *s = suite_create("Correlate");
+
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_correlate_multi_vs_reference);
+  tcase_add_test(tc_core, test_correlate_multi_channels);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -1,6 +1,9 @@
 
 #include <check.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <libswiftnav/linear_algebra.h>
 #include <libswiftnav/dgnss_management.h>
 #include <libswiftnav/ambiguity_test.h>
@@ -9,43 +12,39 @@
 
 #include "check_utils.h"
 
-extern sats_management_t sats_management;
-extern nkf_t nkf;
-extern ambiguity_test_t ambiguity_test;
-
 START_TEST(test_dgnss_update_ambiguity_state_1)
 {
-  sats_management.num_sats = 5;
-  sats_management.sids[0].sat = 1;
-  sats_management.sids[1].sat = 2;
-  sats_management.sids[2].sat = 3;
-  sats_management.sids[3].sat = 4;
-  sats_management.sids[4].sat = 5;
-  nkf.state_dim = 4;
-  nkf.state_mean[0] = 1;
-  nkf.state_mean[1] = 2;
-  nkf.state_mean[2] = 3;
-  nkf.state_mean[3] = 4;
-
-
-  ambiguity_test.amb_check.initialized = 1;
-  ambiguity_test.amb_check.num_matching_ndxs = 4;
-  ambiguity_test.amb_check.matching_ndxs[0] = 0;
-  ambiguity_test.amb_check.matching_ndxs[1] = 2;
-  ambiguity_test.amb_check.matching_ndxs[2] = 3;
-  ambiguity_test.amb_check.matching_ndxs[3] = 5;
-  ambiguity_test.sats.num_sats = 7;
-  ambiguity_test.sats.sids[0].sat = 1;
-  ambiguity_test.sats.sids[1].sat = 2;
-  ambiguity_test.sats.sids[2].sat = 3;
-  ambiguity_test.sats.sids[3].sat = 4;
-  ambiguity_test.sats.sids[4].sat = 5;
-  ambiguity_test.sats.sids[5].sat = 6;
-  ambiguity_test.sats.sids[6].sat = 7;
-  ambiguity_test.amb_check.ambs[0] = 20;
-  ambiguity_test.amb_check.ambs[1] = 21;
-  ambiguity_test.amb_check.ambs[2] = 22;
-  ambiguity_test.amb_check.ambs[3] = 23;
+  get_sats_management()->num_sats = 5;
+  get_sats_management()->sids[0].sat = 1;
+  get_sats_management()->sids[1].sat = 2;
+  get_sats_management()->sids[2].sat = 3;
+  get_sats_management()->sids[3].sat = 4;
+  get_sats_management()->sids[4].sat = 5;
+  get_dgnss_nkf()->state_dim = 4;
+  get_dgnss_nkf()->state_mean[0] = 1;
+  get_dgnss_nkf()->state_mean[1] = 2;
+  get_dgnss_nkf()->state_mean[2] = 3;
+  get_dgnss_nkf()->state_mean[3] = 4;
+
+
+  get_ambiguity_test()->amb_check.initialized = 1;
+  get_ambiguity_test()->amb_check.num_matching_ndxs = 4;
+  get_ambiguity_test()->amb_check.matching_ndxs[0] = 0;
+  get_ambiguity_test()->amb_check.matching_ndxs[1] = 2;
+  get_ambiguity_test()->amb_check.matching_ndxs[2] = 3;
+  get_ambiguity_test()->amb_check.matching_ndxs[3] = 5;
+  get_ambiguity_test()->sats.num_sats = 7;
+  get_ambiguity_test()->sats.sids[0].sat = 1;
+  get_ambiguity_test()->sats.sids[1].sat = 2;
+  get_ambiguity_test()->sats.sids[2].sat = 3;
+  get_ambiguity_test()->sats.sids[3].sat = 4;
+  get_ambiguity_test()->sats.sids[4].sat = 5;
+  get_ambiguity_test()->sats.sids[5].sat = 6;
+  get_ambiguity_test()->sats.sids[6].sat = 7;
+  get_ambiguity_test()->amb_check.ambs[0] = 20;
+  get_ambiguity_test()->amb_check.ambs[1] = 21;
+  get_ambiguity_test()->amb_check.ambs[2] = 22;
+  get_ambiguity_test()->amb_check.ambs[3] = 23;
 
   ambiguity_state_t s = {
     .float_ambs = {
@@ -71,73 +70,73 @@ END_TEST
 
 START_TEST(test_dgnss_update_ambiguity_state_2)
 {
-  sats_management.num_sats = 5;
-  sats_management.sids[0].sat = 1;
-  sats_management.sids[1].sat = 2;
-  sats_management.sids[2].sat = 3;
-  sats_management.sids[3].sat = 4;
-  sats_management.sids[4].sat = 5;
-  nkf.state_dim = 4;
-  nkf.state_mean[0] = 1;
-  nkf.state_mean[1] = 2;
-  nkf.state_mean[2] = 3;
-  nkf.state_mean[3] = 4;
-
-
-  ambiguity_test.amb_check.initialized = 1;
-  ambiguity_test.amb_check.num_matching_ndxs = 4;
-  ambiguity_test.amb_check.matching_ndxs[0] = 0;
-  ambiguity_test.amb_check.matching_ndxs[1] = 2;
-  ambiguity_test.amb_check.matching_ndxs[2] = 3;
-  ambiguity_test.amb_check.matching_ndxs[3] = 5;
-  ambiguity_test.sats.num_sats = 7;
-  ambiguity_test.sats.sids[0].sat = 1;
-  ambiguity_test.sats.sids[1].sat = 2;
-  ambiguity_test.sats.sids[2].sat = 3;
-  ambiguity_test.sats.sids[3].sat = 4;
-  ambiguity_test.sats.sids[4].sat = 5;
-  ambiguity_test.sats.sids[5].sat = 6;
-  ambiguity_test.sats.sids[6].sat = 7;
-  ambiguity_test.amb_check.ambs[0] = 20;
-  ambiguity_test.amb_check.ambs[1] = 21;
-  ambiguity_test.amb_check.ambs[2] = 22;
-  ambiguity_test.amb_check.ambs[3] = 23;
+  get_sats_management()->num_sats = 5;
+  get_sats_management()->sids[0].sat = 1;
+  get_sats_management()->sids[1].sat = 2;
+  get_sats_management()->sids[2].sat = 3;
+  get_sats_management()->sids[3].sat = 4;
+  get_sats_management()->sids[4].sat = 5;
+  get_dgnss_nkf()->state_dim = 4;
+  get_dgnss_nkf()->state_mean[0] = 1;
+  get_dgnss_nkf()->state_mean[1] = 2;
+  get_dgnss_nkf()->state_mean[2] = 3;
+  get_dgnss_nkf()->state_mean[3] = 4;
+
+
+  get_ambiguity_test()->amb_check.initialized = 1;
+  get_ambiguity_test()->amb_check.num_matching_ndxs = 4;
+  get_ambiguity_test()->amb_check.matching_ndxs[0] = 0;
+  get_ambiguity_test()->amb_check.matching_ndxs[1] = 2;
+  get_ambiguity_test()->amb_check.matching_ndxs[2] = 3;
+  get_ambiguity_test()->amb_check.matching_ndxs[3] = 5;
+  get_ambiguity_test()->sats.num_sats = 7;
+  get_ambiguity_test()->sats.sids[0].sat = 1;
+  get_ambiguity_test()->sats.sids[1].sat = 2;
+  get_ambiguity_test()->sats.sids[2].sat = 3;
+  get_ambiguity_test()->sats.sids[3].sat = 4;
+  get_ambiguity_test()->sats.sids[4].sat = 5;
+  get_ambiguity_test()->sats.sids[5].sat = 6;
+  get_ambiguity_test()->sats.sids[6].sat = 7;
+  get_ambiguity_test()->amb_check.ambs[0] = 20;
+  get_ambiguity_test()->amb_check.ambs[1] = 21;
+  get_ambiguity_test()->amb_check.ambs[2] = 22;
+  get_ambiguity_test()->amb_check.ambs[3] = 23;
 
   ambiguity_state_t s_out;
 
   /* No fixed solution. */
 
   /* Uninitialized. */
-  ambiguity_test.amb_check.initialized = 0;
+  get_ambiguity_test()->amb_check.initialized = 0;
   dgnss_update_ambiguity_state(&s_out);
   fail_unless(s_out.fixed_ambs.n == 0);
 
   /* Too few sats. */
-  ambiguity_test.amb_check.initialized = 1;
-  ambiguity_test.amb_check.num_matching_ndxs = 0;
+  get_ambiguity_test()->amb_check.initialized = 1;
+  get_ambiguity_test()->amb_check.num_matching_ndxs = 0;
   dgnss_update_ambiguity_state(&s_out);
   fail_unless(s_out.fixed_ambs.n == 0);
 
-  ambiguity_test.amb_check.initialized = 1;
-  ambiguity_test.amb_check.num_matching_ndxs = 4;
+  get_ambiguity_test()->amb_check.initialized = 1;
+  get_ambiguity_test()->amb_check.num_matching_ndxs = 4;
 
   /* No float solution. */
 
   /* Too few sats. */
-  sats_management.num_sats = 0;
-  nkf.state_dim = 0;
+  get_sats_management()->num_sats = 0;
+  get_dgnss_nkf()->state_dim = 0;
   dgnss_update_ambiguity_state(&s_out);
   fail_unless(s_out.float_ambs.n == 0);
 
-  sats_management.num_sats = 1;
-  nkf.state_dim = 0;
+  get_sats_management()->num_sats = 1;
+  get_dgnss_nkf()->state_dim = 0;
   dgnss_update_ambiguity_state(&s_out);
   fail_unless(s_out.float_ambs.n == 0);
 
   /* Ensure we check num_sats first as state_dim may not be valid if num_sats
    * is too low. */
-  sats_management.num_sats = 1;
-  nkf.state_dim = 22;
+  get_sats_management()->num_sats = 1;
+  get_dgnss_nkf()->state_dim = 22;
   dgnss_update_ambiguity_state(&s_out);
   fail_unless(s_out.float_ambs.n == 0);
 }
@@ -242,6 +241,308 @@ START_TEST(test_dgnss_baseline_1)
 }
 END_TEST
 
+#define CTX_NUM_SATS 7
+#define CTX_NUM_EPOCHS 30
+
+/* Synthetic single differences for a static baseline `b` with integer
+ * ambiguities `N`, seen from a receiver on the equator. */
+static void make_ctx_sdiffs(const double b[3], const s32 N[CTX_NUM_SATS],
+                            u32 epoch, double receiver_ecef[3],
+                            sdiff_t sdiffs[CTX_NUM_SATS])
+{
+  receiver_ecef[0] = 6378137;
+  receiver_ecef[1] = 0;
+  receiver_ecef[2] = 0;
+  memset(sdiffs, 0, CTX_NUM_SATS * sizeof(sdiff_t));
+  for (u8 i = 0; i < CTX_NUM_SATS; i++) {
+    double az = 2 * M_PI * i / CTX_NUM_SATS + 1e-3 * epoch;
+    double el = (20 + 60.0 * i / CTX_NUM_SATS) * D2R;
+    double u[3] = {sin(el), cos(el) * sin(az), cos(el) * cos(az)};
+    double range = 0;
+    for (u8 j = 0; j < 3; j++) {
+      sdiffs[i].sat_pos[j] = receiver_ecef[j] + 20200e3 * u[j];
+      range += u[j] * b[j];
+    }
+    /* Deterministic pseudo-noise. */
+    double noise = ((s32)((epoch * 7 + i * 13) % 11) - 5) / 10.0;
+    sdiffs[i].sid.sat = i + 1;
+    sdiffs[i].pseudorange = -range + noise;
+    sdiffs[i].carrier_phase = range / GPS_L1_LAMBDA_NO_VAC + N[i] +
+                              noise * 1e-2;
+    sdiffs[i].snr = 40;
+  }
+}
+
+static void check_ctx_matches_global(dgnss_ctx_t *ctx)
+{
+  nkf_t *g = get_dgnss_nkf();
+  fail_unless(ctx->nkf.state_dim == g->state_dim);
+  fail_unless(memcmp(ctx->nkf.state_mean, g->state_mean,
+                     g->state_dim * sizeof(double)) == 0,
+              "Float ambiguities differ from the global filter");
+  fail_unless(memcmp(ctx->nkf.state_cov_D, g->state_cov_D,
+                     g->state_dim * sizeof(double)) == 0,
+              "Float covariance differs from the global filter");
+  fail_unless(dgnss_ctx_iar_num_hyps(ctx) == dgnss_iar_num_hyps());
+  fail_unless(dgnss_ctx_iar_num_sats(ctx) == dgnss_iar_num_sats());
+  s32 ambs_ctx[MAX_CHANNELS], ambs_g[MAX_CHANNELS];
+  u8 n = dgnss_ctx_iar_MLE_ambs(ctx, ambs_ctx);
+  fail_unless(n == dgnss_iar_MLE_ambs(ambs_g));
+  fail_unless(memcmp(ambs_ctx, ambs_g, n * sizeof(s32)) == 0,
+              "IAR MLE ambiguities differ from the global test");
+}
+
+/* Two interleaved contexts stay independent and each matches the global
+ * functions fed the same data. */
+START_TEST(test_dgnss_ctx)
+{
+  static u8 hyp_buff_a[AMBIGUITY_TEST_BUFF_SIZE(MAX_HYPOTHESES)];
+  static u8 hyp_buff_b[AMBIGUITY_TEST_BUFF_SIZE(MAX_HYPOTHESES)];
+  static dgnss_ctx_t ctx_a, ctx_b;
+  double b_a[3] = {1.5, -10.2, 3.3};
+  double b_b[3] = {-250.1, 40.7, 12.9};
+  s32 N_a[CTX_NUM_SATS] = {3, -7, 12, 0, 5, -2, 9};
+  s32 N_b[CTX_NUM_SATS] = {-20, 4, 1, 17, -3, 8, 0};
+  sdiff_t sdiffs_a[CTX_NUM_SATS], sdiffs_b[CTX_NUM_SATS];
+  double ecef[3];
+
+  fail_unless(dgnss_ctx_init(&ctx_a, MAX_HYPOTHESES, hyp_buff_a) == 0);
+  fail_unless(dgnss_ctx_init(&ctx_b, MAX_HYPOTHESES, hyp_buff_b) == 0);
+  fail_unless(dgnss_ctx_iar_num_hyps(&ctx_a) == 0);
+
+  /* Tight code variance so the float filter converges and IAR engages
+   * within the test; the global functions must be given the same. */
+  dgnss_settings_t saved_settings = dgnss_settings;
+  dgnss_settings.code_var_kf = 1;
+  ctx_a.settings.code_var_kf = 1;
+  ctx_b.settings.code_var_kf = 1;
+
+  for (u8 k = 0; k < 2; k++) {
+    const double *b = k ? b_b : b_a;
+    const s32 *N = k ? N_b : N_a;
+    dgnss_ctx_t *ctx = k ? &ctx_b : &ctx_a;
+    sdiff_t *sdiffs = k ? sdiffs_b : sdiffs_a;
+    make_ctx_sdiffs(b, N, 0, ecef, sdiffs);
+    dgnss_ctx_start(ctx, CTX_NUM_SATS, sdiffs, ecef);
+  }
+  make_ctx_sdiffs(b_a, N_a, 0, ecef, sdiffs_a);
+  dgnss_init(CTX_NUM_SATS, sdiffs_a, ecef);
+
+  for (u32 e = 1; e < CTX_NUM_EPOCHS; e++) {
+    make_ctx_sdiffs(b_a, N_a, e, ecef, sdiffs_a);
+    dgnss_ctx_update(&ctx_a, CTX_NUM_SATS, sdiffs_a, ecef,
+                     false, DEFAULT_RAIM_THRESHOLD);
+    make_ctx_sdiffs(b_b, N_b, e, ecef, sdiffs_b);
+    dgnss_ctx_update(&ctx_b, CTX_NUM_SATS, sdiffs_b, ecef,
+                     false, DEFAULT_RAIM_THRESHOLD);
+    make_ctx_sdiffs(b_a, N_a, e, ecef, sdiffs_a);
+    dgnss_update(CTX_NUM_SATS, sdiffs_a, ecef,
+                 false, DEFAULT_RAIM_THRESHOLD);
+    check_ctx_matches_global(&ctx_a);
+  }
+
+  fail_unless(dgnss_ctx_iar_num_sats(&ctx_a) == CTX_NUM_SATS);
+  fail_unless(dgnss_ctx_iar_num_sats(&ctx_b) == CTX_NUM_SATS);
+  fail_unless(memcmp(ctx_a.nkf.state_mean, ctx_b.nkf.state_mean,
+                     ctx_a.nkf.state_dim * sizeof(double)) != 0);
+
+  /* Replaying baseline B through the global functions reproduces ctx_b. */
+  for (u32 e = 0; e < CTX_NUM_EPOCHS; e++) {
+    make_ctx_sdiffs(b_b, N_b, e, ecef, sdiffs_b);
+    if (e == 0) {
+      dgnss_init(CTX_NUM_SATS, sdiffs_b, ecef);
+    } else {
+      dgnss_update(CTX_NUM_SATS, sdiffs_b, ecef,
+                   false, DEFAULT_RAIM_THRESHOLD);
+    }
+  }
+  check_ctx_matches_global(&ctx_b);
+
+  dgnss_settings = saved_settings;
+}
+END_TEST
+
+/* A batch split across calls gives the same solutions as the epochs fed
+ * one at a time. */
+START_TEST(test_dgnss_ctx_process_epochs)
+{
+  static u8 hyp_buff_a[AMBIGUITY_TEST_BUFF_SIZE(MAX_HYPOTHESES)];
+  static u8 hyp_buff_b[AMBIGUITY_TEST_BUFF_SIZE(MAX_HYPOTHESES)];
+  static dgnss_ctx_t ctx_a, ctx_b;
+  static sdiff_t sdiffs[CTX_NUM_EPOCHS * CTX_NUM_SATS];
+  dgnss_epoch_t epochs[CTX_NUM_EPOCHS];
+  dgnss_solution_t solutions[CTX_NUM_EPOCHS];
+  double b_true[3] = {-250.1, 40.7, 12.9};
+  s32 N[CTX_NUM_SATS] = {-20, 4, 1, 17, -3, 8, 0};
+
+  fail_unless(dgnss_ctx_init(&ctx_a, MAX_HYPOTHESES, hyp_buff_a) == 0);
+  fail_unless(dgnss_ctx_init(&ctx_b, MAX_HYPOTHESES, hyp_buff_b) == 0);
+  ctx_a.settings.code_var_kf = 1;
+  ctx_b.settings.code_var_kf = 1;
+
+  for (u32 e = 0; e < CTX_NUM_EPOCHS; e++) {
+    epochs[e].num_sats = CTX_NUM_SATS;
+    make_ctx_sdiffs(b_true, N, e, epochs[e].receiver_ecef,
+                    &sdiffs[e * CTX_NUM_SATS]);
+  }
+
+  u32 n_a = dgnss_ctx_process_epochs(&ctx_a, 7, epochs, sdiffs,
+                                     false, DEFAULT_RAIM_THRESHOLD, solutions);
+  n_a += dgnss_ctx_process_epochs(&ctx_a, CTX_NUM_EPOCHS - 7, &epochs[7],
+                                  &sdiffs[7 * CTX_NUM_SATS],
+                                  false, DEFAULT_RAIM_THRESHOLD, &solutions[7]);
+
+  u32 n_b = 0;
+  for (u32 e = 0; e < CTX_NUM_EPOCHS; e++) {
+    sdiff_t *sd = &sdiffs[e * CTX_NUM_SATS];
+    if (e == 0) {
+      dgnss_ctx_start(&ctx_b, CTX_NUM_SATS, sd, epochs[e].receiver_ecef);
+    } else {
+      dgnss_ctx_update(&ctx_b, CTX_NUM_SATS, sd, epochs[e].receiver_ecef,
+                       false, DEFAULT_RAIM_THRESHOLD);
+    }
+    ambiguity_state_t s;
+    dgnss_ctx_update_ambiguity_state(&ctx_b, &s);
+    u8 num_used;
+    double b[3];
+    s8 ret = dgnss_baseline(CTX_NUM_SATS, sd, epochs[e].receiver_ecef, &s,
+                            &num_used, b, false, DEFAULT_RAIM_THRESHOLD);
+    fail_unless(ret == solutions[e].ret,
+                "Epoch %u: return code %d, expected %d",
+                e, solutions[e].ret, ret);
+    if (ret > 0) {
+      n_b++;
+      fail_unless(num_used == solutions[e].num_used);
+      fail_unless(memcmp(b, solutions[e].b, sizeof(b)) == 0,
+                  "Epoch %u: batch baseline differs", e);
+    }
+  }
+  fail_unless(n_a == n_b);
+
+  dgnss_solution_t *last = &solutions[CTX_NUM_EPOCHS - 1];
+  fail_unless(last->ret > 0);
+  fail_unless(vector_distance(3, last->b, b_true) < 0.5,
+              "Baseline error %f m", vector_distance(3, last->b, b_true));
+}
+END_TEST
+
+/* Satellites dropping out and coming back between epochs resize the float
+ * filter to match. */
+START_TEST(test_dgnss_ctx_sats_change)
+{
+  static u8 hyp_buff[AMBIGUITY_TEST_BUFF_SIZE(MAX_HYPOTHESES)];
+  static dgnss_ctx_t ctx;
+  static sdiff_t sdiffs[CTX_NUM_EPOCHS * CTX_NUM_SATS];
+  dgnss_epoch_t epochs[CTX_NUM_EPOCHS];
+  dgnss_solution_t solutions[CTX_NUM_EPOCHS];
+  double b_true[3] = {1.5, -10.2, 3.3};
+  s32 N[CTX_NUM_SATS] = {3, -7, 12, 0, 5, -2, 9};
+
+  fail_unless(dgnss_ctx_init(&ctx, MAX_HYPOTHESES, hyp_buff) == 0);
+  ctx.settings.code_var_kf = 1;
+
+  /* All the sats, then one and then two fewer, then all of them again. */
+  sdiff_t *sd = sdiffs;
+  for (u32 e = 0; e < CTX_NUM_EPOCHS; e++) {
+    make_ctx_sdiffs(b_true, N, e, epochs[e].receiver_ecef, sd);
+    u8 num_sats = CTX_NUM_SATS;
+    if (e >= 8 && e < 16) {
+      memmove(&sd[4], &sd[5], (num_sats - 5) * sizeof(sdiff_t));
+      num_sats--;
+    }
+    if (e >= 12 && e < 16) {
+      memmove(&sd[2], &sd[3], (num_sats - 3) * sizeof(sdiff_t));
+      num_sats--;
+    }
+    epochs[e].num_sats = num_sats;
+    sd += num_sats;
+  }
+
+  sd = sdiffs;
+  for (u32 e = 0; e < CTX_NUM_EPOCHS; e++) {
+    dgnss_ctx_process_epochs(&ctx, 1, &epochs[e], sd,
+                             false, DEFAULT_RAIM_THRESHOLD, &solutions[e]);
+    fail_unless(ctx.nkf.state_dim == epochs[e].num_sats - 1,
+                "Epoch %u: float state has dimension %u with %u sats",
+                e, ctx.nkf.state_dim, epochs[e].num_sats);
+    fail_unless(ctx.sats_management.num_sats == epochs[e].num_sats);
+    sd += epochs[e].num_sats;
+  }
+
+  dgnss_solution_t *last = &solutions[CTX_NUM_EPOCHS - 1];
+  fail_unless(last->ret > 0);
+  fail_unless(last->num_used == CTX_NUM_SATS);
+  fail_unless(vector_distance(3, last->b, b_true) < 0.5,
+              "Baseline error %f m", vector_distance(3, last->b, b_true));
+}
+END_TEST
+
+#ifdef __GLIBC__
+/* Count the heap allocations made while `count_allocs` is set, by
+ * interposing the allocator over glibc's. */
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+static volatile bool count_allocs;
+static volatile u32 n_allocs;
+
+void *malloc(size_t size)
+{
+  if (count_allocs)
+    n_allocs++;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+  if (count_allocs)
+    n_allocs++;
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  if (count_allocs)
+    n_allocs++;
+  return __libc_realloc(ptr, size);
+}
+
+/* Once initialised, the float filter, the integer ambiguity search and the
+ * baseline solutions run without touching the heap. */
+START_TEST(test_dgnss_ctx_no_alloc)
+{
+  static u8 hyp_buff[AMBIGUITY_TEST_BUFF_SIZE(MAX_HYPOTHESES)];
+  static dgnss_ctx_t ctx;
+  static sdiff_t sdiffs[CTX_NUM_EPOCHS * CTX_NUM_SATS];
+  dgnss_epoch_t epochs[CTX_NUM_EPOCHS];
+  dgnss_solution_t solutions[CTX_NUM_EPOCHS];
+  double b_true[3] = {-250.1, 40.7, 12.9};
+  s32 N[CTX_NUM_SATS] = {-20, 4, 1, 17, -3, 8, 0};
+
+  fail_unless(dgnss_ctx_init(&ctx, MAX_HYPOTHESES, hyp_buff) == 0);
+  ctx.settings.code_var_kf = 1;
+  for (u32 e = 0; e < CTX_NUM_EPOCHS; e++) {
+    epochs[e].num_sats = CTX_NUM_SATS;
+    make_ctx_sdiffs(b_true, N, e, epochs[e].receiver_ecef,
+                    &sdiffs[e * CTX_NUM_SATS]);
+  }
+
+  n_allocs = 0;
+  count_allocs = true;
+  dgnss_ctx_process_epochs(&ctx, CTX_NUM_EPOCHS, epochs, sdiffs,
+                           false, DEFAULT_RAIM_THRESHOLD, solutions);
+  count_allocs = false;
+
+  fail_unless(n_allocs == 0, "%u allocations in %u epochs",
+              n_allocs, CTX_NUM_EPOCHS);
+  fail_unless(solutions[CTX_NUM_EPOCHS - 1].ret > 0);
+  fail_unless(dgnss_ctx_iar_num_sats(&ctx) == CTX_NUM_SATS,
+              "Integer ambiguity search not exercised");
+}
+END_TEST
+#endif /* __GLIBC__ */
+
 Suite* dgnss_management_test_suite(void)
 {
   Suite *s = suite_create("DGNSS Management");
@@ -257,5 +558,14 @@ Suite* dgnss_management_test_suite(void)
   tcase_add_test(tc_baseline, test_dgnss_baseline_1);
   suite_add_tcase(s, tc_baseline);
 
+  TCase *tc_ctx = tcase_create("Context");
+  tcase_add_test(tc_ctx, test_dgnss_ctx);
+  tcase_add_test(tc_ctx, test_dgnss_ctx_process_epochs);
+  tcase_add_test(tc_ctx, test_dgnss_ctx_sats_change);
+#ifdef __GLIBC__
+  tcase_add_test(tc_ctx, test_dgnss_ctx_no_alloc);
+#endif
+  suite_add_tcase(s, tc_ctx);
+
   return s;
 }
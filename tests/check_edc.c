@@ -25,12 +25,45 @@ START_TEST(test_crc24q)
 }
 END_TEST
 
+START_TEST(test_crc24q_long)
+{
+  u8 data[1029];
+
+  for (u32 i = 0; i < sizeof(data); i++)
+    data[i] = i * 151 + (i >> 3);
+
+  /* Compare the multi-byte path against the CRC accumulated a byte at a
+   * time, for every length and alignment of the tail. */
+  for (u32 len = 0; len < 40; len++) {
+    for (u32 off = 0; off < 8; off++) {
+      u32 crc_bytes = 0xB704CE;
+      for (u32 i = 0; i < len; i++)
+        crc_bytes = crc24q(&data[off + i], 1, crc_bytes);
+      u32 crc = crc24q(&data[off], len, 0xB704CE);
+      fail_unless(crc == crc_bytes,
+        "CRC of %d bytes at offset %d is 0x%06X, expected 0x%06X",
+        len, off, crc, crc_bytes);
+    }
+  }
+
+  /* A CRC over a message with its CRC appended is zero. */
+  u32 crc = crc24q(data, sizeof(data) - 3, 0);
+  data[sizeof(data) - 3] = crc >> 16;
+  data[sizeof(data) - 2] = crc >> 8;
+  data[sizeof(data) - 1] = crc;
+  crc = crc24q(data, sizeof(data), 0);
+  fail_unless(crc == 0,
+    "CRC of message with its CRC appended should be 0, not 0x%06X", crc);
+}
+END_TEST
+
 Suite* edc_suite(void)
 {
   Suite *s = suite_create("Error Detection and Correction");
 
   TCase *tc_crc = tcase_create("CRC");
   tcase_add_test(tc_crc, test_crc24q);
+  tcase_add_test(tc_crc, test_crc24q_long);
   suite_add_tcase(s, tc_crc);
 
   return s;
@@ -1,8 +1,12 @@
 
 #include <check.h>
+#include <math.h>
 
+#include  <libswiftnav/constants.h>
 #include  <libswiftnav/ephemeris.h>
 
+#define N_STATES 64
+
 START_TEST(test_ephemeris_equal)
 {
   ephemeris_t a;
@@ -276,12 +280,121 @@ START_TEST(test_ephemeris_equal)
 }
 END_TEST
 
+/* Reference satellite position, iterating Kepler's equation to convergence
+ * and evaluating every trig function directly. */
+static void reference_sat_pos(const ephemeris_t *e, const gps_time_t *t,
+                              double pos[3], double *clock_err)
+{
+  const ephemeris_kepler_t *k = &e->kepler;
+  double dt = gpsdifftime(t, &k->toc);
+  *clock_err = k->af0 + dt * (k->af1 + dt * k->af2) - k->tgd;
+  dt = gpsdifftime(t, &e->toe);
+
+  double a = k->sqrta * k->sqrta;
+  double ma_dot = sqrt(GPS_GM / (a * a * a)) + k->dn;
+  double ma = k->m0 + ma_dot * dt;
+  double ea = ma, ea_old;
+  do {
+    ea_old = ea;
+    ea = ea + (ma - ea + k->ecc * sin(ea)) / (1.0 - k->ecc * cos(ea));
+  } while (fabs(ea - ea_old) > 1e-15);
+  *clock_err += GPS_F * k->ecc * k->sqrta * sin(ea);
+
+  double al = atan2(sqrt(1.0 - k->ecc * k->ecc) * sin(ea),
+                    cos(ea) - k->ecc) + k->w;
+  double cal = al + k->cus * sin(2.0 * al) + k->cuc * cos(2.0 * al);
+  double r = a * (1.0 - k->ecc * cos(ea)) + k->crc * cos(2.0 * al)
+             + k->crs * sin(2.0 * al);
+  double inc = k->inc + k->inc_dot * dt + k->cic * cos(2.0 * al)
+               + k->cis * sin(2.0 * al);
+  double x = r * cos(cal);
+  double y = r * sin(cal);
+  double om = k->omega0 + dt * (k->omegadot - GPS_OMEGAE_DOT)
+              - GPS_OMEGAE_DOT * e->toe.tow;
+  pos[0] = x * cos(om) - y * cos(inc) * sin(om);
+  pos[1] = x * sin(om) + y * cos(inc) * cos(om);
+  pos[2] = y * sin(inc);
+}
+
+/* Satellite states agree with the converged reference for eccentricities
+ * either side of the fixed step Kepler solve's limit. */
+START_TEST(test_calc_sat_state)
+{
+  ephemeris_t eph[4];
+
+  memset(eph, 0, sizeof(eph));
+  for (u8 i = 0; i < 4; i++) {
+    ephemeris_t *e = &eph[i];
+    e->sid.sat = i + 1;
+    e->sid.constellation = CONSTELLATION_GPS;
+    e->toe.wn = 1866;
+    e->toe.tow = 7200;
+    e->fit_interval = 4;
+    e->valid = 1;
+    e->healthy = 1;
+    e->kepler.toc = e->toe;
+    e->kepler.sqrta = 5153.6 + 0.05 * i;
+    e->kepler.ecc = 0.002 + 0.014 * i;
+    e->kepler.m0 = -2.9 + 1.7 * i;
+    e->kepler.w = 0.4 - 0.8 * i;
+    e->kepler.omega0 = 1.1 * i - 2.0;
+    e->kepler.omegadot = -8.1e-9;
+    e->kepler.inc = 0.96 + 0.005 * i;
+    e->kepler.inc_dot = 1.8e-10;
+    e->kepler.dn = 4.7e-9;
+    e->kepler.cuc = -1.3e-6;
+    e->kepler.cus = 7.9e-6;
+    e->kepler.crc = 220.0;
+    e->kepler.crs = -25.0;
+    e->kepler.cic = 7.5e-8;
+    e->kepler.cis = -1.1e-7;
+    e->kepler.af0 = 1.2e-4;
+    e->kepler.af1 = -3.4e-12;
+    e->kepler.tgd = -1.1e-8;
+  }
+
+  for (u32 n = 0; n < N_STATES; n++) {
+    const ephemeris_t *e = &eph[n % 4];
+    gps_time_t t = e->toe;
+    t.tow += (n / 4) * 900.0 - 7000.0;
+    normalize_gps_time(&t);
+
+    double pos[3], vel[3], clock_err, clock_rate_err;
+    s8 ret = calc_sat_state(e, &t, pos, vel, &clock_err, &clock_rate_err);
+    fail_unless(ret == 0, "State %u returned %d", n, ret);
+
+    double ref_pos[3], ref_clock_err;
+    reference_sat_pos(e, &t, ref_pos, &ref_clock_err);
+    for (u8 k = 0; k < 3; k++)
+      fail_unless(fabs(pos[k] - ref_pos[k]) < 1e-6,
+                  "State %u pos[%u] differs from reference by %g m",
+                  n, k, pos[k] - ref_pos[k]);
+    fail_unless(fabs(clock_err - ref_clock_err) < 1e-15,
+                "State %u clock error differs from reference by %g s",
+                n, clock_err - ref_clock_err);
+
+    /* Velocity should match a central difference of the positions. */
+    double p0[3], p1[3], v[3], ce, cre;
+    gps_time_t t0 = t, t1 = t;
+    t0.tow -= 0.5;
+    t1.tow += 0.5;
+    calc_sat_state(e, &t0, p0, v, &ce, &cre);
+    calc_sat_state(e, &t1, p1, v, &ce, &cre);
+    for (u8 k = 0; k < 3; k++)
+      fail_unless(fabs(vel[k] - (p1[k] - p0[k])) < 1e-3,
+                  "State %u vel[%u] inconsistent with position by %g m/s",
+                  n, k, vel[k] - (p1[k] - p0[k]));
+  }
+}
+END_TEST
+
 Suite* ephemeris_suite(void)
 {
   Suite *s = suite_create("Ephemeris");
 
   TCase *tc_core = tcase_create("Core");
   tcase_add_test(tc_core, test_ephemeris_equal);
+  tcase_add_test(tc_core, test_calc_sat_state);
   suite_add_tcase(s, tc_core);
 
   return s;
@@ -0,0 +1,74 @@
+#include <check.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <libswiftnav/fft.h>
+
+#define MAX_N 2046
+
+START_TEST(test_fft_vs_dft)
+{
+  static fft_cpx_t twiddles[MAX_N], in[MAX_N], tmp[MAX_N], out[MAX_N];
+  const u32 lengths[] = {1, 2, 3, 4, 5, 8, 12, 30, 31, 62, 64, 1023, 2046};
+
+  srand(3);
+  for (u32 t = 0; t < sizeof(lengths) / sizeof(lengths[0]); t++) {
+    u32 n = lengths[t];
+    fft_plan_t p;
+    fail_unless(fft_plan_init(&p, n, twiddles) == 0,
+                "Plan init failed for n = %u", n);
+
+    for (u32 i = 0; i < n; i++) {
+      in[i].re = (rand() % 201 - 100) / 10.0;
+      in[i].im = (rand() % 201 - 100) / 10.0;
+    }
+    fft_forward(&p, in, out);
+
+    for (u32 k = 0; k < n; k++) {
+      double re = 0, im = 0;
+      for (u32 i = 0; i < n; i++) {
+        double phase = -2 * M_PI * (double)((u64)i * k % n) / n;
+        re += in[i].re * cos(phase) - in[i].im * sin(phase);
+        im += in[i].re * sin(phase) + in[i].im * cos(phase);
+      }
+      fail_unless(fabs(out[k].re - re) < 1e-3 * n &&
+                  fabs(out[k].im - im) < 1e-3 * n,
+                  "n = %u, X[%u] = (%f, %f) != (%f, %f)", n, k,
+                  out[k].re, out[k].im, re, im);
+    }
+
+    /* The unscaled inverse should give back n times the input. */
+    for (u32 i = 0; i < n; i++)
+      tmp[i] = out[i];
+    fft_inverse(&p, tmp, out);
+    for (u32 i = 0; i < n; i++) {
+      fail_unless(fabs(out[i].re / n - in[i].re) < 1e-3 &&
+                  fabs(out[i].im / n - in[i].im) < 1e-3,
+                  "n = %u, inverse x[%u] = (%f, %f) != (%f, %f)", n, i,
+                  out[i].re / n, out[i].im / n, in[i].re, in[i].im);
+    }
+  }
+}
+END_TEST
+
+START_TEST(test_fft_plan_init_bad_length)
+{
+  static fft_cpx_t twiddles[67 * 67];
+  fft_plan_t p;
+  fail_unless(fft_plan_init(&p, 0, twiddles) < 0, "n = 0 should fail");
+  fail_unless(fft_plan_init(&p, 67 * 67, twiddles) < 0,
+              "Prime factors above FFT_MAX_RADIX should fail");
+}
+END_TEST
+
+Suite* fft_suite(void)
+{
+  Suite *s = suite_create("FFT");
+
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_fft_vs_dft);
+  tcase_add_test(tc_core, test_fft_plan_init_bad_length);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
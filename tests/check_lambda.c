@@ -0,0 +1,267 @@
+#include <check.h>
+#include <math.h>
+#include <string.h>
+
+#include <libswiftnav/lambda.h>
+#include <libswiftnav/linear_algebra.h>
+
+#include "check_utils.h"
+
+#define N 8
+
+/* Float ambiguities near `truth` with a strongly correlated covariance, as
+ * from a float RTK solution. */
+static void make_float_ambs(double *a, double *Q, const double *truth,
+                            double noise)
+{
+  double B[N * 3];
+  arr_frand(N * 3, -2, 2, B);
+  for (u8 i = 0; i < N; i++) {
+    for (u8 j = 0; j < N; j++) {
+      double q = i == j ? 0.01 : 0;
+      for (u8 k = 0; k < 3; k++)
+        q += B[3*i + k] * B[3*j + k];
+      Q[i + j*N] = q;
+    }
+    a[i] = truth[i] + frand(-noise, noise);
+  }
+}
+
+/* (a - z)' Q^-1 (a - z) */
+static double ils_norm(const double *a, const double *Qinv, const double *z)
+{
+  double d[N], norm = 0;
+  for (u8 i = 0; i < N; i++)
+    d[i] = a[i] - z[i];
+  for (u8 i = 0; i < N; i++)
+    for (u8 j = 0; j < N; j++)
+      norm += d[i] * Qinv[i + j*N] * d[j];
+  return norm;
+}
+
+START_TEST(test_lambda_solution)
+{
+  seed_rng();
+  double truth[N], a[N], Q[N * N], Qinv[N * N], F[N * 2], s[2];
+
+  for (u8 t = 0; t < 20; t++) {
+    for (u8 i = 0; i < N; i++)
+      truth[i] = sizerand(100) - 50.0;
+    make_float_ambs(a, Q, truth, 0.3);
+    matrix_inverse(N, Q, Qinv);
+
+    fail_unless(lambda_solution(N, 2, a, Q, F, s) == 0);
+    fail_unless(s[0] <= s[1], "Candidates not sorted");
+    for (u8 k = 0; k < 2; k++) {
+      for (u8 i = 0; i < N; i++)
+        fail_unless(F[i + k*N] == round(F[i + k*N]), "Non-integer candidate");
+      fail_unless(fabs(s[k] - ils_norm(a, Qinv, &F[k*N])) < 1e-6 * (1 + s[k]),
+                  "Wrong residual %f", s[k]);
+    }
+
+    /* No neighbour of the best candidate is closer. */
+    for (u32 c = 0; c < 6561; c++) {
+      double z[N];
+      u32 d = c;
+      for (u8 i = 0; i < N; i++, d /= 3)
+        z[i] = F[i] + (s32)(d % 3) - 1;
+      fail_unless(ils_norm(a, Qinv, z) >= s[0] - 1e-6 * (1 + s[0]),
+                  "Search missed a better candidate");
+    }
+  }
+}
+END_TEST
+
+static u32 n_polls;
+
+static bool expire_on_second_poll(void *ctx)
+{
+  (void)ctx;
+  return ++n_polls >= 2;
+}
+
+START_TEST(test_lambda_bounded)
+{
+  seed_rng();
+  double truth[N] = {0}, a[N], Q[N * N];
+  double F[N * 2], s[2], F_ref[N * 2], s_ref[2];
+  int nfound;
+
+  make_float_ambs(a, Q, truth, 2);
+  fail_unless(lambda_solution(N, 2, a, Q, F_ref, s_ref) == 0);
+
+  /* A generous budget gives the complete search. */
+  lambda_budget_t budget = {.max_nodes = 100000};
+  fail_unless(lambda_solution_bounded(N, 2, a, Q, &budget, F, s,
+                                      &nfound) == 0);
+  fail_unless(nfound == 2);
+  fail_unless(budget.nodes < budget.max_nodes);
+  fail_unless(memcmp(F, F_ref, sizeof(F)) == 0);
+  fail_unless(memcmp(s, s_ref, sizeof(s)) == 0);
+  u32 nodes_complete = budget.nodes;
+
+  /* Too few nodes to reach a leaf. */
+  budget.max_nodes = N / 2;
+  fail_unless(lambda_solution_bounded(N, 2, a, Q, &budget, F, s,
+                                      &nfound) == 1);
+  fail_unless(nfound == 0);
+  fail_unless(budget.nodes == N / 2);
+
+  /* Stopping part way gives the best candidates found so far. */
+  budget.max_nodes = nodes_complete / 2;
+  fail_unless(lambda_solution_bounded(N, 2, a, Q, &budget, F, s,
+                                      &nfound) == 1);
+  fail_unless(nfound >= 1);
+  fail_unless(s[0] >= s_ref[0]);
+  if (nfound == 2)
+    fail_unless(s[0] <= s[1]);
+
+  /* The clock is polled and stops the search. */
+  n_polls = 0;
+  budget.max_nodes = 100000;
+  budget.expired = expire_on_second_poll;
+  int ret = lambda_solution_bounded(N, 2, a, Q, &budget, F, s, &nfound);
+  fail_unless(n_polls <= 2);
+  if (ret == 0)
+    fail_unless(budget.nodes == nodes_complete);
+  else
+    fail_unless(ret == 1 && budget.nodes <= nodes_complete);
+}
+END_TEST
+
+START_TEST(test_lambda_partial)
+{
+  seed_rng();
+  double truth[N], a[N], Q[N * N], b[N];
+  int nfixed;
+  lambda_budget_t budget = {.max_nodes = 100000};
+
+  /* The first half precise, the rest poorly determined and uncorrelated. */
+  memset(Q, 0, sizeof(Q));
+  for (u8 i = 0; i < N; i++) {
+    truth[i] = sizerand(100) - 50.0;
+    bool precise = i < N / 2;
+    Q[i + i*N] = precise ? 1e-3 : 4;
+    a[i] = truth[i] + (precise ? frand(-0.05, 0.05) : frand(-0.45, 0.45));
+  }
+  Q[1 + 0*N] = Q[0 + 1*N] = 5e-4;
+
+  fail_unless(lambda_partial(N, a, Q, 0.999, 3, &budget, b, &nfixed) == 0);
+  fail_unless(nfixed == N / 2, "Fixed %d ambiguities", nfixed);
+  for (u8 i = 0; i < N; i++) {
+    if (i < N / 2)
+      fail_unless(fabs(b[i] - truth[i]) < 1e-9,
+                  "Precise ambiguity %u not fixed: %f", i, b[i]);
+    else
+      fail_unless(fabs(b[i] - a[i]) < 1e-9,
+                  "Uncorrelated ambiguity %u changed: %f", i, b[i]);
+  }
+
+  /* All fixed. */
+  for (u8 i = N / 2; i < N; i++) {
+    Q[i + i*N] = 1e-3;
+    a[i] = truth[i] + frand(-0.05, 0.05);
+  }
+  fail_unless(lambda_partial(N, a, Q, 0.999, 3, &budget, b, &nfixed) == 0);
+  fail_unless(nfixed == N, "Fixed %d ambiguities", nfixed);
+  for (u8 i = 0; i < N; i++)
+    fail_unless(fabs(b[i] - truth[i]) < 1e-9);
+
+  /* Nothing fixed without a budget. */
+  budget.max_nodes = 0;
+  fail_unless(lambda_partial(N, a, Q, 0.999, 3, &budget, b, &nfixed) == 0);
+  fail_unless(nfixed == 0);
+  fail_unless(memcmp(a, b, sizeof(a)) == 0);
+}
+END_TEST
+
+/* Check r is a valid LAMBDA reduction of Q. */
+static void check_reduction(const lambda_reduction_t *r, const double *Q)
+{
+  for (u8 i = 0; i < N; i++) {
+    for (u8 j = 0; j < N; j++) {
+      /* Z is unimodular with inverse Zi. */
+      double zzi = 0;
+      for (u8 k = 0; k < N; k++)
+        zzi += r->Z[i + k*N] * r->Zi[k + j*N];
+      fail_unless(fabs(zzi - (i == j)) < 1e-9, "Zi isn't the inverse of Z");
+      fail_unless(r->Z[i + j*N] == round(r->Z[i + j*N]), "Non-integer Z");
+
+      /* Z'QZ = L'diag(D)L */
+      double zqz = 0, ldl = 0;
+      for (u8 k = 0; k < N; k++)
+        for (u8 l = 0; l < N; l++)
+          zqz += r->Z[k + i*N] * Q[k + l*N] * r->Z[l + j*N];
+      for (u8 k = 0; k < N; k++)
+        ldl += r->L[k + i*N] * r->D[k] * r->L[k + j*N];
+      fail_unless(fabs(zqz - ldl) < 1e-6 * (1 + fabs(zqz)),
+                  "Z'QZ != L'DL: %f vs %f", zqz, ldl);
+
+      /* Size reduced. */
+      if (i > j)
+        fail_unless(fabs(r->L[i + j*N]) <= 0.5 + 1e-9,
+                    "L not size reduced: %f", r->L[i + j*N]);
+    }
+  }
+}
+
+START_TEST(test_lambda_reduction_warm)
+{
+  seed_rng();
+  double truth[N] = {0}, a[N], Q[N * N], Q2[N * N];
+  double F[N * 2], s[2], F_ref[N * 2], s_ref[2];
+  int nfound;
+  lambda_reduction_t r;
+  lambda_budget_t budget = {.max_nodes = 100000};
+
+  make_float_ambs(a, Q, truth, 0.3);
+  lambda_reduction_init(&r);
+  fail_unless(lambda_reduction_update(&r, N, Q) == 0);
+  check_reduction(&r, Q);
+  fail_unless(r.steps > 0 && r.cold_steps == r.steps);
+  fail_unless(r.steps_saved == 0);
+
+  /* The same covariance needs no further steps. */
+  fail_unless(lambda_reduction_update(&r, N, Q) == 0);
+  check_reduction(&r, Q);
+  fail_unless(r.steps == 0, "Warm start took %u steps", r.steps);
+  fail_unless(r.steps_saved == r.cold_steps);
+
+  /* A slightly changed covariance is reduced from the last transform. */
+  for (u8 i = 0; i < N * N; i++)
+    Q2[i] = 0.98 * Q[i];
+  for (u8 i = 0; i < N; i++)
+    Q2[i + i*N] += 1e-3;
+  fail_unless(lambda_reduction_update(&r, N, Q2) == 0);
+  check_reduction(&r, Q2);
+  fail_unless(r.steps + r.steps_saved == r.cold_steps);
+
+  /* Searches on the warm started reduction find the same solution. */
+  fail_unless(lambda_solution_reduced(&r, 2, a, &budget, F, s, &nfound) == 0);
+  fail_unless(lambda_solution(N, 2, a, Q2, F_ref, s_ref) == 0);
+  fail_unless(nfound == 2);
+  fail_unless(memcmp(F, F_ref, N * sizeof(double)) == 0);
+  fail_unless(fabs(s[0] - s_ref[0]) < 1e-9 * (1 + s[0]));
+
+  /* A change of dimension starts cold. */
+  for (u8 i = 0; i < N - 1; i++)
+    for (u8 j = 0; j < N - 1; j++)
+      Q[i + j*(N - 1)] = Q2[i + j*N];
+  fail_unless(lambda_reduction_update(&r, N - 1, Q) == 0);
+  fail_unless(r.steps == r.cold_steps && r.steps_saved == 0);
+}
+END_TEST
+
+Suite* lambda_suite(void)
+{
+  Suite *s = suite_create("LAMBDA");
+
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_lambda_solution);
+  tcase_add_test(tc_core, test_lambda_bounded);
+  tcase_add_test(tc_core, test_lambda_partial);
+  tcase_add_test(tc_core, test_lambda_reduction_warm);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
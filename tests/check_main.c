@@ -33,6 +33,14 @@ int main(void)
   srunner_add_suite(sr, signal_test_suite());
   srunner_add_suite(sr, track_test_suite());
   srunner_add_suite(sr, cnav_test_suite());
+  srunner_add_suite(sr, nav_msg_suite());
+  srunner_add_suite(sr, correlate_suite());
+  srunner_add_suite(sr, code_cache_suite());
+  srunner_add_suite(sr, orbit_cache_suite());
+  srunner_add_suite(sr, fft_suite());
+  srunner_add_suite(sr, acq_suite());
+  srunner_add_suite(sr, lambda_suite());
+  srunner_add_suite(sr, small_matrix_suite());
 
   srunner_set_fork_status(sr, CK_NOFORK);
   srunner_run_all(sr, CK_NORMAL);
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 
 #include <libswiftnav/memory_pool.h>
 
@@ -12,13 +13,45 @@ memory_pool_t *test_pool_seq;
 memory_pool_t *test_pool_random;
 memory_pool_t *test_pool_empty;
 
+/* Run the tests against compact pools rather than linked list pools. */
+static bool compact_pools;
+
+static memory_pool_t *test_pool_new(u32 n_elements, size_t element_size)
+{
+#ifdef LIBSWIFTNAV_EMBEDDED
+  /* The embedded build has no heap allocated pools. */
+  memory_pool_t *pool = malloc(sizeof(memory_pool_t));
+  void *buff = malloc(n_elements *
+                      (element_size + sizeof(memory_pool_node_hdr_t)));
+  if (compact_pools)
+    memory_pool_init_compact(pool, n_elements, element_size, buff);
+  else
+    memory_pool_init(pool, n_elements, element_size, buff);
+  return pool;
+#else
+  if (compact_pools)
+    return memory_pool_new_compact(n_elements, element_size);
+  return memory_pool_new(n_elements, element_size);
+#endif
+}
+
+static void test_pool_destroy(memory_pool_t *pool)
+{
+#ifdef LIBSWIFTNAV_EMBEDDED
+  free(pool->pool);
+  free(pool);
+#else
+  memory_pool_destroy(pool);
+#endif
+}
+
 void setup()
 {
   /* Seed the random number generator with a specific seed for our test. */
   srandom(1);
 
   /* Create a new pool and fill it with a sequence of ints. */
-  test_pool_seq = memory_pool_new(50, sizeof(s32));
+  test_pool_seq = test_pool_new(50, sizeof(s32));
 
   s32 *x;
   for (u32 i=0; i<22; i++) {
@@ -27,7 +60,7 @@ void setup()
     *x = i;
   }
   /* Create a new pool and fill it entirely with random numbers. */
-  test_pool_random = memory_pool_new(20, sizeof(s32));
+  test_pool_random = test_pool_new(20, sizeof(s32));
 
   for (u32 i=0; i<20; i++) {
     x = (s32 *)memory_pool_add(test_pool_random);
@@ -36,7 +69,13 @@ void setup()
   }
 
   /* Create a new pool and leave it empty. */
-  test_pool_empty = memory_pool_new(50, sizeof(s32));
+  test_pool_empty = test_pool_new(50, sizeof(s32));
+}
+
+static void setup_compact(void)
+{
+  compact_pools = true;
+  setup();
 }
 
 void teardown()
@@ -57,9 +96,10 @@ void teardown()
               == 50,
               "Memory leak! test_pool_empty lost elements!");
 
-  memory_pool_destroy(test_pool_seq);
-  memory_pool_destroy(test_pool_random);
-  memory_pool_destroy(test_pool_empty);
+  test_pool_destroy(test_pool_seq);
+  test_pool_destroy(test_pool_random);
+  test_pool_destroy(test_pool_empty);
+  compact_pools = false;
 }
 
 void print_s32(element_t *elem)
@@ -340,6 +380,102 @@ s32 cmp_s32s(void *arg, element_t *a_, element_t *b_)
   return *a - *b;
 }
 
+START_TEST(test_filter_mask)
+{
+  s32 xs[22];
+  s32 test_xs_evens[11] = {
+    20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0
+  };
+  u8 keep[22];
+
+  /* Elements are visited 21 down to 0. */
+  for (u32 i=0; i<22; i++)
+    keep[i] = (21 - i) % 2 == 0;
+
+  fail_unless(memory_pool_filter_mask(test_pool_seq, keep) == 11,
+      "Filtered length does not match");
+  fail_unless(memory_pool_n_allocated(test_pool_seq) == 11,
+      "Filtered length does not match");
+
+  memory_pool_to_array(test_pool_seq, xs);
+  fail_unless(memcmp(xs, test_xs_evens, sizeof(test_xs_evens)) == 0,
+      "Output of filter operation does not match test data");
+
+  memset(keep, 0, sizeof(keep));
+  fail_unless(memory_pool_filter_mask(test_pool_seq, keep) == 0,
+      "Filtered length does not match");
+  fail_unless(memory_pool_empty(test_pool_seq),
+      "Pool should be empty after filtering out all elements");
+}
+END_TEST
+
+START_TEST(test_elements)
+{
+  s32 xs[22];
+  s32 *elems = (s32 *)memory_pool_elements(test_pool_seq);
+
+  if (!compact_pools) {
+    fail_unless(elems == NULL,
+        "memory_pool_elements should return NULL for a list pool");
+    return;
+  }
+
+  fail_unless(elems != NULL,
+      "memory_pool_elements returned NULL for a compact pool");
+
+  memory_pool_to_array(test_pool_seq, xs);
+  fail_unless(memcmp(elems, xs, sizeof(xs)) == 0,
+      "Elements array does not match collection order");
+
+  /* Updates through the array are seen by the pool. */
+  for (u32 i=0; i<22; i++)
+    elems[i] = 2*elems[i];
+  fail_unless(memory_pool_ifold(test_pool_seq, 0, &isum) == 462,
+      "Fold over updated elements failed");
+}
+END_TEST
+
+START_TEST(test_resize_compact)
+{
+  s32 xs[22], ys[22];
+  memory_pool_to_array(test_pool_seq, xs);
+
+  if (!compact_pools) {
+    u8 buff[10 * (sizeof(s32) + sizeof(void *))];
+    fail_unless(memory_pool_resize_compact(test_pool_seq, 10, buff) < 0,
+        "memory_pool_resize_compact should fail for a list pool");
+    return;
+  }
+
+  void *old_buff = memory_pool_elements(test_pool_seq);
+  fail_unless(memory_pool_resize_compact(test_pool_seq, 21, old_buff) < 0,
+      "Resize below the number of allocated elements should fail");
+
+  /* Shrink in place. */
+  fail_unless(memory_pool_resize_compact(test_pool_seq, 22, old_buff) == 0,
+      "Shrinking in place failed");
+  fail_unless(memory_pool_n_free(test_pool_seq) == 0,
+      "Pool should be full after shrinking to its contents");
+  fail_unless(memory_pool_add(test_pool_seq) == NULL,
+      "Add to a full pool should fail");
+
+  /* Grow back to the original capacity in a new buffer. */
+  void *new_buff = malloc(50 * (sizeof(s32) + sizeof(void *)));
+  fail_unless(memory_pool_resize_compact(test_pool_seq, 50, new_buff) == 0,
+      "Growing into a new buffer failed");
+  free(old_buff);
+  fail_unless(memory_pool_n_elements(test_pool_seq) == 50,
+      "Wrong capacity after resize");
+  fail_unless(memory_pool_n_allocated(test_pool_seq) == 22,
+      "Wrong number of elements after resize");
+  memory_pool_to_array(test_pool_seq, ys);
+  fail_unless(memcmp(xs, ys, sizeof(xs)) == 0,
+      "Elements changed by resize");
+  fail_unless(memory_pool_n_free(test_pool_seq) == 28,
+      "Wrong number of free elements after resize");
+}
+END_TEST
+
 START_TEST(test_clear)
 {
   memory_pool_clear(test_pool_seq);
@@ -499,7 +635,7 @@ void agg_sum_p(element_t *new_, void *x_, u32 n, element_t *elem_)
 START_TEST(test_groupby_2)
 {
   /* Create a new pool. */
-  memory_pool_t *test_pool_hyps = memory_pool_new(50, sizeof(hypothesis_t));
+  memory_pool_t *test_pool_hyps = test_pool_new(50, sizeof(hypothesis_t));
 
   for (u32 i=0; i<10; i++) {
     hypothesis_t *hyp = (hypothesis_t *)memory_pool_add(test_pool_hyps);
@@ -546,7 +682,7 @@ START_TEST(test_groupby_2)
               == 50,
               "Memory leak! test_pool_hyps lost elements!");
 
-  memory_pool_destroy(test_pool_hyps);
+  test_pool_destroy(test_pool_hyps);
 }
 END_TEST
 
@@ -565,7 +701,7 @@ void prod_N(element_t *new_, void *x_, u32 n_xs, u32 n, element_t *elem_)
 START_TEST(test_prod)
 {
   /* Create a new pool. */
-  memory_pool_t *test_pool_hyps = memory_pool_new(50, sizeof(hypothesis_t));
+  memory_pool_t *test_pool_hyps = test_pool_new(50, sizeof(hypothesis_t));
 
   for (u32 i=0; i<3; i++) {
     hypothesis_t *hyp = (hypothesis_t *)memory_pool_add(test_pool_hyps);
@@ -597,7 +733,7 @@ START_TEST(test_prod)
 
   /*memory_pool_map(test_pool_hyps, &print_hyp_elem); printf("\n");*/
 
-  memory_pool_destroy(test_pool_hyps);
+  test_pool_destroy(test_pool_hyps);
 }
 END_TEST
 
@@ -637,7 +773,7 @@ void prod_N_gen(element_t *new_, void *x_, u32 n, element_t *elem_)
 START_TEST(test_prod_generator)
 {
   /* Create a new pool. */
-  memory_pool_t *test_pool_hyps = memory_pool_new(50, sizeof(hypothesis_t));
+  memory_pool_t *test_pool_hyps = test_pool_new(50, sizeof(hypothesis_t));
 
   for (u32 i=0; i<3; i++) {
     hypothesis_t *hyp = (hypothesis_t *)memory_pool_add(test_pool_hyps);
@@ -669,7 +805,7 @@ START_TEST(test_prod_generator)
   fail_unless(memory_pool_n_allocated(test_pool_hyps) == 3,
       "Reduced length does not match33");
 
-  memory_pool_destroy(test_pool_hyps);
+  test_pool_destroy(test_pool_hyps);
 }
 END_TEST
 
@@ -697,7 +833,36 @@ Suite* memory_pool_suite(void)
   tcase_add_test(tc_core, test_groupby_2);
   tcase_add_test(tc_core, test_prod);
   tcase_add_test(tc_core, test_prod_generator);
+  tcase_add_test(tc_core, test_filter_mask);
+  tcase_add_test(tc_core, test_elements);
+  tcase_add_test(tc_core, test_resize_compact);
   suite_add_tcase(s, tc_core);
 
+  /* The same tests again, on compact pools. */
+  TCase *tc_compact = tcase_create("Compact");
+  tcase_add_checked_fixture (tc_compact, setup_compact, teardown);
+  tcase_add_test(tc_compact, test_simple_folds);
+  tcase_add_test(tc_compact, test_general_fold);
+  tcase_add_test(tc_compact, test_full);
+  tcase_add_test(tc_compact, test_n_free);
+  tcase_add_test(tc_compact, test_n_allocated);
+  tcase_add_test(tc_compact, test_empty);
+  tcase_add_test(tc_compact, test_pool_to_array);
+  tcase_add_test(tc_compact, test_map);
+  tcase_add_test(tc_compact, test_filter_1);
+  tcase_add_test(tc_compact, test_filter_2);
+  tcase_add_test(tc_compact, test_filter_3);
+  tcase_add_test(tc_compact, test_filter_4);
+  tcase_add_test(tc_compact, test_clear);
+  tcase_add_test(tc_compact, test_sort);
+  tcase_add_test(tc_compact, test_groupby_1);
+  tcase_add_test(tc_compact, test_groupby_2);
+  tcase_add_test(tc_compact, test_prod);
+  tcase_add_test(tc_compact, test_prod_generator);
+  tcase_add_test(tc_compact, test_filter_mask);
+  tcase_add_test(tc_compact, test_elements);
+  tcase_add_test(tc_compact, test_resize_compact);
+  suite_add_tcase(s, tc_compact);
+
   return s;
 }
@@ -0,0 +1,119 @@
+#include <check.h>
+
+#include <libswiftnav/bits.h>
+#include <libswiftnav/nav_msg.h>
+
+#include <string.h>
+
+#define N_SUBFRAMES 6
+#define LEAD_BITS 77
+#define N_BITS (LEAD_BITS + N_SUBFRAMES * 300)
+#define MAX_EVENTS 16
+
+/* LNAV-like bit stream: subframes with a preamble and consecutive TOWs but
+ * otherwise pseudo-random content, so that false preambles turn up too. */
+static void make_stream(u8 *bits)
+{
+  u32 seed = 7;
+  for (u32 i = 0; i < (N_BITS + 7) / 8; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    bits[i] = seed >> 24;
+  }
+  for (u32 s = 0; s < N_SUBFRAMES; s++) {
+    u32 start = LEAD_BITS + 300 * s;
+    setbitu(bits, start, 8, 0x8B);
+    setbitu(bits, start + 29, 1, 0);
+    setbitu(bits, start + 30, 17, 1000 + s);
+  }
+}
+
+START_TEST(test_nav_msg_update_bits)
+{
+  u8 bits[(N_BITS + 7) / 8];
+  make_stream(bits);
+
+  /* Reference: one bit at a time. Every subframe is marked as processed as
+   * soon as it is ready. */
+  nav_msg_t ref;
+  u32 ref_bit[MAX_EVENTS];
+  s32 ref_tow[MAX_EVENTS];
+  u32 n_ref = 0;
+  nav_msg_init(&ref);
+  for (u32 i = 0; i < N_BITS; i++) {
+    s32 TOW_ms = nav_msg_update(&ref, getbitu(bits, i, 1));
+    if (TOW_ms >= 0) {
+      ref_bit[n_ref] = i;
+      ref_tow[n_ref++] = TOW_ms;
+      ref.subframe_start_index = 0;
+    }
+  }
+  fail_unless(n_ref == N_SUBFRAMES - 1,
+              "Expected %d subframes, found %u", N_SUBFRAMES - 1, n_ref);
+
+  u32 seed = 1;
+  for (u32 trial = 0; trial < 20; trial++) {
+    nav_msg_t n;
+    nav_msg_init(&n);
+    u8 block[(N_BITS + 7) / 8];
+    u32 n_events = 0;
+    u32 i = 0;
+    while (i < N_BITS) {
+      seed = seed * 1664525u + 1013904223u;
+      u32 len = MIN(1 + (seed >> 8) % (trial * 20 + 1), N_BITS - i);
+      /* Pass each block starting at bit 0 of its own buffer. */
+      memset(block, 0, sizeof(block));
+      bitcopy(block, 0, bits, i, len);
+      s32 TOW_ms;
+      u32 n_used = nav_msg_update_bits(&n, block, len, &TOW_ms);
+      i += n_used;
+      if (TOW_ms >= 0) {
+        fail_unless(n_events < n_ref && ref_bit[n_events] == i - 1 &&
+                    ref_tow[n_events] == TOW_ms,
+                    "Subframe %u mismatch at bit %u", n_events, i - 1);
+        n_events++;
+        n.subframe_start_index = 0;
+      } else {
+        fail_unless(n_used == len, "Block stopped early at bit %u", i);
+      }
+    }
+    fail_unless(n_events == n_ref, "Found %u of %u subframes",
+                n_events, n_ref);
+    fail_unless(n.subframe_bit_index == ref.subframe_bit_index &&
+                0 == memcmp(n.subframe_bits, ref.subframe_bits,
+                            sizeof(n.subframe_bits)),
+                "Subframe buffer mismatch");
+  }
+}
+END_TEST
+
+START_TEST(test_nav_msg_update_bits_overrun)
+{
+  u8 bits[(N_BITS + 7) / 8];
+  make_stream(bits);
+
+  nav_msg_t n;
+  nav_msg_init(&n);
+  s32 TOW_ms;
+  u32 n_used = nav_msg_update_bits(&n, bits, N_BITS, &TOW_ms);
+  fail_unless(TOW_ms >= 0 && subframe_ready(&n), "No subframe found");
+
+  /* Without processing the subframe the buffer fills up. */
+  u32 n_more = nav_msg_update_bits(&n, &bits[n_used / 8], N_BITS - n_used,
+                                   &TOW_ms);
+  fail_unless(TOW_ms == TOW_INVALID, "Unexpected TOW");
+  fail_unless(n.overrun, "No overrun");
+  fail_unless(n_more < N_BITS - n_used, "Overrun bits consumed");
+}
+END_TEST
+
+Suite* nav_msg_suite(void)
+{
+  Suite *s = suite_create("Nav message");
+
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_nav_msg_update_bits);
+  tcase_add_test(tc_core, test_nav_msg_update_bits_overrun);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -1,5 +1,6 @@
 #include <check.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <libswiftnav/observation.h>
 
@@ -219,6 +220,77 @@ START_TEST(test_single_diff_3)
 }
 END_TEST
 
+START_TEST(test_obs_store_single_diff)
+{
+  navigation_measurement_t m_a[8], m_b[8];
+  sdiff_t sds[8], sds_store[8];
+  obs_store_t a, b, sd;
+
+  /* Overlapping sets of GPS and SBAS signals. */
+  static const u16 sats_a[] = {1, 3, 4, 9, 17, 32, 120, 138};
+  static const u16 sats_b[] = {2, 3, 9, 10, 17, 31, 120, 125};
+  memset(m_a, 0, sizeof(m_a));
+  memset(m_b, 0, sizeof(m_b));
+  /* Clear the padding so the outputs can be compared with memcmp(). */
+  memset(sds, 0, sizeof(sds));
+  memset(sds_store, 0, sizeof(sds_store));
+  for (u8 k = 0; k < 8; k++) {
+    m_a[k].sid.sat = sats_a[k];
+    m_a[k].sid.constellation = sats_a[k] >= 120 ? CONSTELLATION_SBAS
+                                                : CONSTELLATION_GPS;
+    m_b[k].sid.sat = sats_b[k];
+    m_b[k].sid.constellation = sats_b[k] >= 120 ? CONSTELLATION_SBAS
+                                                : CONSTELLATION_GPS;
+    m_a[k].raw_pseudorange = 2e7 + 1000 * k;
+    m_b[k].raw_pseudorange = 2e7 + 3000 * k;
+    m_a[k].carrier_phase = 1e8 + k;
+    m_b[k].carrier_phase = 1e8 - k;
+    m_a[k].raw_doppler = 100 * k;
+    m_b[k].raw_doppler = 70 * k;
+    m_a[k].snr = 40 - k;
+    m_b[k].snr = 30 + k;
+    m_a[k].lock_counter = k;
+    m_b[k].lock_counter = 10 * k;
+    for (u8 i = 0; i < 3; i++) {
+      m_a[k].sat_pos[i] = k + i;
+      m_b[k].sat_pos[i] = 10 * k + i;
+      m_a[k].sat_vel[i] = -k - i;
+      m_b[k].sat_vel[i] = -10 * k - i;
+    }
+  }
+
+  u8 n = single_diff(8, m_a, 8, m_b, sds);
+  fail_unless(n == 4, "single_diff found %d common signals, expected 4", n);
+  static const u16 common[] = {3, 9, 17, 120};
+  for (u8 k = 0; k < n; k++)
+    fail_unless(sds[k].sid.sat == common[k],
+                "Common signal %d is sat %d, expected %d",
+                k, sds[k].sid.sat, common[k]);
+
+  /* Add the measurements to the stores in reverse order, the stores are
+   * indexed by signal so the order doesn't matter. */
+  obs_store_init(&a);
+  obs_store_init(&b);
+  for (s8 k = 7; k >= 0; k--) {
+    obs_store_add_nav_meas(&a, 1, &m_a[k]);
+    obs_store_add_nav_meas(&b, 1, &m_b[k]);
+  }
+  fail_unless(obs_store_single_diff(&a, &b, &sd) == n,
+              "Store single differences count mismatch");
+  fail_unless(obs_store_get_sdiffs(&sd, sds_store) == n,
+              "Store single differences copy count mismatch");
+  fail_unless(memcmp(sds, sds_store, n * sizeof(sdiff_t)) == 0,
+              "Store single differences differ from single_diff()");
+
+  /* Differencing in place. */
+  fail_unless(obs_store_single_diff(&a, &b, &a) == n,
+              "In place single differences count mismatch");
+  obs_store_get_sdiffs(&a, sds_store);
+  fail_unless(memcmp(sds, sds_store, n * sizeof(sdiff_t)) == 0,
+              "In place single differences differ from single_diff()");
+}
+END_TEST
+
 Suite* observation_test_suite(void)
 {
   Suite *s = suite_create("Observation Handling");
@@ -227,6 +299,7 @@ Suite* observation_test_suite(void)
   tcase_add_test(tc_core, test_single_diff_1);
   tcase_add_test(tc_core, test_single_diff_2);
   tcase_add_test(tc_core, test_single_diff_3);
+  tcase_add_test(tc_core, test_obs_store_single_diff);
   suite_add_tcase(s, tc_core);
 
   return s;
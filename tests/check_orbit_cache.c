@@ -0,0 +1,137 @@
+#include <check.h>
+#include <math.h>
+#include <string.h>
+
+#include <libswiftnav/orbit_cache.h>
+
+static orbit_cache_t cache;
+
+static void make_ephemeris(ephemeris_t *e, u8 sat)
+{
+  memset(e, 0, sizeof(*e));
+  e->sid.sat = sat;
+  e->sid.band = BAND_L1;
+  e->sid.constellation = CONSTELLATION_GPS;
+  e->toe.wn = 1866;
+  e->toe.tow = 518400;
+  e->fit_interval = 4;
+  e->valid = 1;
+  e->healthy = 1;
+  e->kepler.toc = e->toe;
+  e->kepler.sqrta = 5153.6 + 0.05 * sat;
+  e->kepler.ecc = 0.001 * sat;
+  e->kepler.m0 = 0.5 * sat - 3.0;
+  e->kepler.w = 1.3 - 0.2 * sat;
+  e->kepler.omega0 = 0.7 * sat - 2.0;
+  e->kepler.omegadot = -8.1e-9;
+  e->kepler.inc = 0.96 + 0.002 * sat;
+  e->kepler.inc_dot = 1.8e-10;
+  e->kepler.dn = 4.7e-9;
+  e->kepler.cuc = -1.3e-6;
+  e->kepler.cus = 7.9e-6;
+  e->kepler.crc = 220.0;
+  e->kepler.crs = -25.0;
+  e->kepler.cic = 7.5e-8;
+  e->kepler.cis = -1.1e-7;
+  e->kepler.af0 = 1.2e-4;
+  e->kepler.af1 = -3.4e-12;
+  e->kepler.af2 = 1e-19;
+  e->kepler.tgd = -1.1e-8;
+}
+
+START_TEST(test_orbit_cache_accuracy)
+{
+  ephemeris_t eph[4];
+  for (u8 i = 0; i < 4; i++)
+    make_ephemeris(&eph[i], 1 + 9 * i);
+
+  orbit_cache_init(&cache);
+  double max_dp = 0, max_dv = 0, max_dc = 0;
+
+  for (double dt = -3.5 * 3600; dt < 3.5 * 3600; dt += 7.3) {
+    for (u8 i = 0; i < 4; i++) {
+      gps_time_t t = eph[i].toe;
+      t.tow += dt;
+      normalize_gps_time(&t);
+
+      double pos[3], vel[3], clock_err, clock_rate_err;
+      double ref_pos[3], ref_vel[3], ref_clock_err, ref_clock_rate_err;
+      s8 ret = orbit_cache_sat_state(&cache, &eph[i], &t, pos, vel,
+                                     &clock_err, &clock_rate_err);
+      s8 ref_ret = calc_sat_state(&eph[i], &t, ref_pos, ref_vel,
+                                  &ref_clock_err, &ref_clock_rate_err);
+      fail_unless(ret == 0 && ref_ret == 0, "Satellite state failed");
+
+      for (u8 k = 0; k < 3; k++) {
+        max_dp = fmax(max_dp, fabs(pos[k] - ref_pos[k]));
+        max_dv = fmax(max_dv, fabs(vel[k] - ref_vel[k]));
+      }
+      max_dc = fmax(max_dc, fabs(clock_err - ref_clock_err));
+      fail_unless(clock_rate_err == ref_clock_rate_err,
+                  "Clock rate error differs");
+    }
+  }
+  fail_unless(cache.misses == 4 * 7 * 3600 / ORBIT_CACHE_SPAN,
+              "Unexpected number of fits (%u)", cache.misses);
+  fail_unless(max_dp < 1e-3, "Position error %g m", max_dp);
+  fail_unless(max_dv < 1e-6, "Velocity error %g m/s", max_dv);
+  fail_unless(max_dc < 1e-15, "Clock error %g s", max_dc);
+}
+END_TEST
+
+START_TEST(test_orbit_cache_invalidate)
+{
+  ephemeris_t e;
+  make_ephemeris(&e, 5);
+  orbit_cache_init(&cache);
+
+  gps_time_t t = e.toe;
+  t.tow += 100;
+  double pos[3], vel[3], clock_err, clock_rate_err;
+  double ref_pos[3], ref_vel[3], ref_clock_err, ref_clock_rate_err;
+
+  orbit_cache_sat_state(&cache, &e, &t, pos, vel, &clock_err, &clock_rate_err);
+  t.tow += 1;
+  orbit_cache_sat_state(&cache, &e, &t, pos, vel, &clock_err, &clock_rate_err);
+  fail_unless(cache.misses == 1 && cache.hits == 1,
+              "Second lookup should hit (%u hits, %u misses)",
+              cache.hits, cache.misses);
+
+  /* A new ephemeris replaces the fit. */
+  e.kepler.m0 += 1e-3;
+  orbit_cache_sat_state(&cache, &e, &t, pos, vel, &clock_err, &clock_rate_err);
+  fail_unless(cache.misses == 2, "New ephemeris should not hit");
+  calc_sat_state(&e, &t, ref_pos, ref_vel, &ref_clock_err,
+                 &ref_clock_rate_err);
+  for (u8 k = 0; k < 3; k++)
+    fail_unless(fabs(pos[k] - ref_pos[k]) < 1e-3,
+                "Position not from the new ephemeris");
+
+  /* Near the end of the fit interval states are computed directly. */
+  t = e.toe;
+  t.tow += 4 * 3600 - ORBIT_CACHE_SPAN / 4;
+  normalize_gps_time(&t);
+  s8 ret = orbit_cache_sat_state(&cache, &e, &t, pos, vel,
+                                 &clock_err, &clock_rate_err);
+  s8 ref_ret = calc_sat_state(&e, &t, ref_pos, ref_vel, &ref_clock_err,
+                              &ref_clock_rate_err);
+  fail_unless(ret == ref_ret && cache.misses == 2 && cache.hits == 1,
+              "State near the end of the fit interval should not be cached");
+  fail_unless(memcmp(pos, ref_pos, sizeof(pos)) == 0 &&
+              memcmp(vel, ref_vel, sizeof(vel)) == 0 &&
+              clock_err == ref_clock_err,
+              "State near the end of the fit interval differs");
+}
+END_TEST
+
+Suite* orbit_cache_suite(void)
+{
+  Suite *s = suite_create("Orbit cache");
+
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_orbit_cache_accuracy);
+  tcase_add_test(tc_core, test_orbit_cache_invalidate);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -92,6 +92,124 @@ START_TEST(test_pvt_repair)
 }
 END_TEST
 
+START_TEST(test_pvt_repair_two)
+{
+  u8 n_used = 9;
+  gnss_solution soln;
+  dops_t dops;
+  pvt_raim_t raim;
+
+  navigation_measurement_t nms[9] =
+    {nm1, nm2, nm3, nm4, nm5, nm6, nm7, nm8, nm9};
+  /* nm1 is already faulty, add a second fault. */
+  nms[4].pseudorange += 20e3;
+
+  s8 code = calc_PVT_raim(n_used, nms, false, &soln, &dops, &raim);
+  fail_unless(code == 1,
+    "Return code should be 1 (pvt repair). Saw: %d\n", code);
+  fail_unless(soln.n_used == n_used - 2 && raim.n_excluded == 2,
+    "PVT solver should exclude two measurements. Saw: %d\n",
+    raim.n_excluded);
+  fail_unless(raim.excluded_sid[0].sat == nm1.sid.sat &&
+              raim.excluded_sid[1].sat == nm5.sid.sat,
+    "Wrong measurements excluded: %d, %d\n",
+    raim.excluded_sid[0].sat, raim.excluded_sid[1].sat);
+  fail_unless(raim.residual > 0 && raim.residual < 100,
+    "Residual of repaired solution too large: %f\n", raim.residual);
+  fail_unless(raim.hpl > 0 && raim.vpl > 0,
+    "Protection levels should be available\n");
+}
+END_TEST
+
+START_TEST(test_pvt_raim_ok)
+{
+  gnss_solution soln;
+  dops_t dops;
+  pvt_raim_t raim;
+
+  navigation_measurement_t nms[8] = {nm2, nm3, nm4, nm5, nm6, nm7, nm8, nm9};
+
+  s8 code = calc_PVT_raim(8, nms, false, &soln, &dops, &raim);
+  fail_unless(code == 0,
+    "Return code should be 0 (raim ok). Saw: %d\n", code);
+  fail_unless(raim.n_excluded == 0, "No measurement should be excluded\n");
+  fail_unless(raim.hpl > 0 && raim.vpl > 0,
+    "Protection levels should be available\n");
+
+  /* With fewer measurements the protection levels widen. */
+  pvt_raim_t raim6;
+  code = calc_PVT_raim(6, nms, false, &soln, &dops, &raim6);
+  fail_unless(code == 0,
+    "Return code should be 0 (raim ok). Saw: %d\n", code);
+  fail_unless(raim6.hpl >= raim.hpl && raim6.vpl >= raim.vpl,
+    "Protection levels shrank with fewer measurements\n");
+
+  code = calc_PVT_raim(6, nms, true, &soln, &dops, &raim6);
+  fail_unless(code == 2 && raim6.hpl < 0 && raim6.vpl < 0,
+    "Protection levels should be unavailable with raim disabled\n");
+}
+END_TEST
+
+START_TEST(test_pvt_batch)
+{
+  /* Epochs built from subsets of the measurements, including ones needing
+   * repair (nm1 is faulty) and ones with too few measurements. */
+  static const u8 first[] = {1, 1, 1, 0, 0, 0, 2, 3, 0, 1, 4};
+  static const u8 n_used[] = {8, 6, 5, 9, 6, 5, 7, 4, 3, 4, 5};
+  const u32 n_epochs = sizeof(n_used);
+  const navigation_measurement_t all[9] =
+    {nm1, nm2, nm3, nm4, nm5, nm6, nm7, nm8, nm9};
+
+  navigation_measurement_t nms[9 * sizeof(n_used)];
+  u32 n_nms = 0;
+  for (u32 e = 0; e < n_epochs; e++) {
+    for (u8 i = 0; i < n_used[e]; i++) {
+      nms[n_nms++] = all[first[e] + i];
+    }
+  }
+
+  for (pvt_impl_t impl = PVT_IMPL_AUTO; impl <= PVT_IMPL_AVX2; impl++) {
+    if (!pvt_impl_supported(impl))
+      continue;
+    for (u8 disable_raim = 0; disable_raim < 2; disable_raim++) {
+      s8 ret[sizeof(n_used)];
+      gnss_solution soln[sizeof(n_used)];
+      dops_t dops[sizeof(n_used)];
+      u32 n_valid = calc_PVT_batch(impl, n_epochs, n_used, nms, disable_raim,
+                                   ret, soln, dops);
+
+      u32 n_valid_ref = 0;
+      const navigation_measurement_t *epoch_nms = nms;
+      for (u32 e = 0; e < n_epochs; e++) {
+        gnss_solution soln_ref;
+        dops_t dops_ref;
+        s8 ret_ref = calc_PVT(n_used[e], epoch_nms, disable_raim,
+                              &soln_ref, &dops_ref);
+        epoch_nms += n_used[e];
+        fail_unless(ret[e] == ret_ref,
+          "Epoch %u (impl %d): return code %d, calc_PVT gave %d\n",
+          e, impl, ret[e], ret_ref);
+        if (ret_ref < 0)
+          continue;
+        n_valid_ref++;
+        fail_unless(soln[e].valid == 1 && soln[e].n_used == soln_ref.n_used,
+          "Epoch %u (impl %d): solution not valid\n", e, impl);
+        for (u8 i = 0; i < 3; i++) {
+          fail_unless(fabs(soln[e].pos_ecef[i] - soln_ref.pos_ecef[i]) < 1e-2 &&
+                      fabs(soln[e].vel_ecef[i] - soln_ref.vel_ecef[i]) < 1e-3,
+            "Epoch %u (impl %d): solution differs from calc_PVT\n", e, impl);
+        }
+        fail_unless(fabs(soln[e].clock_offset - soln_ref.clock_offset) < 1e-10 &&
+                    fabs(dops[e].gdop - dops_ref.gdop) < 1e-6,
+          "Epoch %u (impl %d): clock or DOP differs from calc_PVT\n", e, impl);
+      }
+      fail_unless(n_valid == n_valid_ref,
+        "Valid epochs: %u, calc_PVT gave %u\n", n_valid, n_valid_ref);
+    }
+  }
+}
+END_TEST
+
 START_TEST(test_disable_pvt_raim)
 {
   u8 n_used = 6;
@@ -154,8 +272,11 @@ Suite* pvt_test_suite(void)
   TCase *tc_core = tcase_create("Core");
   tcase_add_test(tc_core, test_pvt_repair);
   tcase_add_test(tc_core, test_pvt_failed_repair);
+  tcase_add_test(tc_core, test_pvt_repair_two);
+  tcase_add_test(tc_core, test_pvt_raim_ok);
   tcase_add_test(tc_core, test_disable_pvt_raim);
   tcase_add_test(tc_core, test_dops);
+  tcase_add_test(tc_core, test_pvt_batch);
   suite_add_tcase(s, tc_core);
 
   return s;
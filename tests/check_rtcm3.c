@@ -4,6 +4,8 @@
 #include <math.h>
 #include <check.h>
 
+#include <libswiftnav/bits.h>
+#include <libswiftnav/constants.h>
 #include <libswiftnav/rtcm3.h>
 
 #include "check_utils.h"
@@ -215,6 +217,374 @@ START_TEST(test_rtcm3_encode_decode)
 }
 END_TEST
 
+static void make_obs_msg(rtcm3_obs_msg_t *msg, bool glo)
+{
+  memset(msg, 0, sizeof(*msg));
+  msg->id = 2022;
+  msg->tow_ms = glo ? 43200123 : 345600200;
+  msg->sync = 1;
+  msg->smooth = 3;
+  msg->n_sat = RTCM3_MAX_OBS_SATS;
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    rtcm3_obs_t *o = &msg->obs[i];
+    o->sat = i + 1;
+    o->fcn = glo ? (s8)(i % 21) - 7 : 0;
+    o->code[1] = i % 4;
+    o->pseudorange[0] = frand(19e6, 25e6);
+    o->pseudorange[1] = o->pseudorange[0] + frand(-20, 20);
+    double lambda1 = GPS_C / (glo ? 1.602e9 + o->fcn * 0.5625e6 : 1.57542e9);
+    double lambda2 = GPS_C / (glo ? 1.246e9 + o->fcn * 0.4375e6 : 1.2276e9);
+    o->carrier_phase[0] = o->pseudorange[0] / lambda1 + frand(-500, 500);
+    o->carrier_phase[1] = o->pseudorange[0] / lambda2 + frand(-500, 500);
+    o->lock_time[0] = frand(0, 1000);
+    o->lock_time[1] = frand(0, 1000);
+    o->cnr[0] = frand(30, 50);
+    o->cnr[1] = frand(25, 45);
+    o->flags[0] = RTCM3_OBS_PR | RTCM3_OBS_CP;
+    /* Some satellites without L2. */
+    o->flags[1] = i % 5 ? RTCM3_OBS_PR | RTCM3_OBS_CP : 0;
+  }
+}
+
+static void check_obs_msg(const rtcm3_obs_msg_t *a, const rtcm3_obs_msg_t *b)
+{
+  fail_unless(a->id == b->id && a->tow_ms == b->tow_ms &&
+              a->sync == b->sync && a->smooth == b->smooth &&
+              a->n_sat == b->n_sat, "Header decode error");
+
+  for (u8 i = 0; i < a->n_sat; i++) {
+    const rtcm3_obs_t *x = &a->obs[i], *y = &b->obs[i];
+    fail_unless(x->sat == y->sat && x->fcn == y->fcn &&
+                x->code[1] == y->code[1], "[%d] satellite decode error", i);
+    for (u8 b = 0; b < 2; b++) {
+      fail_unless(x->flags[b] == y->flags[b],
+                  "[%d] L%d flags decoded as %d, expected %d",
+                  i, b + 1, y->flags[b], x->flags[b]);
+      if (x->flags[b] & RTCM3_OBS_PR)
+        fail_unless(fabs(x->pseudorange[b] - y->pseudorange[b]) <= 0.02,
+                    "[%d] L%d pseudorange error %f", i, b + 1,
+                    x->pseudorange[b] - y->pseudorange[b]);
+      if (x->flags[b] & RTCM3_OBS_CP)
+        fail_unless(fabs(x->carrier_phase[b] - y->carrier_phase[b]) < 0.003,
+                    "[%d] L%d carrier phase error %f", i, b + 1,
+                    x->carrier_phase[b] - y->carrier_phase[b]);
+      fail_unless(y->lock_time[b] <= x->lock_time[b],
+                  "[%d] L%d lock time decoded as %d, longer than %d",
+                  i, b + 1, y->lock_time[b], x->lock_time[b]);
+      fail_unless(fabs(x->cnr[b] - y->cnr[b]) <= 0.125,
+                  "[%d] L%d CNR error %f", i, b + 1, x->cnr[b] - y->cnr[b]);
+    }
+  }
+}
+
+START_TEST(test_rtcm3_encode_decode_1004_1012)
+{
+  rtcm3_obs_msg_t msg, msg_out;
+  u8 buff[1024];
+
+  seed_rng();
+
+  make_obs_msg(&msg, false);
+  u16 len = rtcm3_encode_1004(buff, &msg);
+  fail_unless(len == (64 + RTCM3_MAX_OBS_SATS * 125 + 7) / 8,
+              "1004 length %d", len);
+  fail_unless(rtcm3_decode_1012(buff, &msg_out) == -1,
+              "1004 decoded as 1012");
+  fail_unless(rtcm3_decode_1004(buff, &msg_out) == 0, "1004 decode failed");
+  check_obs_msg(&msg, &msg_out);
+
+  make_obs_msg(&msg, true);
+  len = rtcm3_encode_1012(buff, &msg);
+  fail_unless(len == (61 + RTCM3_MAX_OBS_SATS * 130 + 7) / 8,
+              "1012 length %d", len);
+  fail_unless(rtcm3_decode_1004(buff, &msg_out) == -1,
+              "1012 decoded as 1004");
+  fail_unless(rtcm3_decode_1012(buff, &msg_out) == 0, "1012 decode failed");
+  check_obs_msg(&msg, &msg_out);
+}
+END_TEST
+
+static void make_msm(rtcm3_msm_t *msg, u16 type)
+{
+  static const u8 sigs[] = {2, 15, 16};
+
+  memset(msg, 0, sizeof(*msg));
+  msg->type = type;
+  msg->id = 4001;
+  msg->epoch = 345600200;
+  msg->iods = 5;
+  msg->smooth = 2;
+  msg->n_sat = 20;
+  for (u8 i = 0; i < msg->n_sat; i++) {
+    msg->sats[i].id = 3 * i + 1;
+    msg->sats[i].ext_info = type % 10 == 4 ? 0 : i % 16;
+    double range = frand(19e6, 25e6);
+    double rate = frand(-800, 800);
+    for (u8 s = 0; s < 3; s++) {
+      /* Not every satellite tracks every signal. */
+      if ((i + s) % 4 == 3)
+        continue;
+      rtcm3_msm_cell_t *c = &msg->cells[msg->n_cell++];
+      c->sat = i;
+      c->sig = sigs[s];
+      c->flags = RTCM3_OBS_PR | RTCM3_OBS_CP;
+      if (type % 10 != 4)
+        c->flags |= RTCM3_OBS_RATE;
+      if (i == 7 && s == 1)
+        c->flags &= ~RTCM3_OBS_CP;
+      c->pseudorange = range + frand(-10, 10);
+      c->phase_range = range + frand(-10, 10);
+      c->phase_range_rate = rate + frand(-0.5, 0.5);
+      c->lock_time = frand(0, 1e6);
+      c->half_cycle = s == 2;
+      c->cnr = frand(20, 50);
+    }
+  }
+}
+
+START_TEST(test_rtcm3_encode_decode_msm)
+{
+  static const u16 types[] = {1074, 1075, 1077, 1087, 1127};
+  rtcm3_msm_t msg, msg_out;
+  u8 buff[1024];
+
+  seed_rng();
+
+  for (u8 t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+    make_msm(&msg, types[t]);
+    bool hr = types[t] % 10 == 7;
+
+    s16 len = rtcm3_encode_msm(buff, &msg);
+    fail_unless(len > 0, "MSM %d encode failed (%d)", types[t], len);
+    fail_unless(rtcm3_decode_1004(buff, NULL) == -1,
+                "MSM %d decoded as 1004", types[t]);
+    fail_unless(rtcm3_decode_msm(buff, &msg_out) == 0,
+                "MSM %d decode failed", types[t]);
+
+    fail_unless(msg_out.type == msg.type && msg_out.id == msg.id &&
+                msg_out.epoch == msg.epoch && msg_out.iods == msg.iods &&
+                msg_out.smooth == msg.smooth, "MSM %d header error", types[t]);
+    fail_unless(msg_out.n_sat == msg.n_sat && msg_out.n_cell == msg.n_cell,
+                "MSM %d decoded %d sats %d cells, expected %d %d", types[t],
+                msg_out.n_sat, msg_out.n_cell, msg.n_sat, msg.n_cell);
+    for (u8 i = 0; i < msg.n_sat; i++)
+      fail_unless(msg_out.sats[i].id == msg.sats[i].id &&
+                  msg_out.sats[i].ext_info == msg.sats[i].ext_info,
+                  "MSM %d satellite %d error", types[t], i);
+
+    double pr_res = GPS_C * 1e-3 * (hr ? 0x1p-29 : 0x1p-24);
+    double cp_res = GPS_C * 1e-3 * (hr ? 0x1p-31 : 0x1p-29);
+    for (u8 j = 0; j < msg.n_cell; j++) {
+      const rtcm3_msm_cell_t *x = &msg.cells[j], *y = &msg_out.cells[j];
+      fail_unless(x->sat == y->sat && x->sig == y->sig &&
+                  x->flags == y->flags && x->half_cycle == y->half_cycle,
+                  "MSM %d cell %d error", types[t], j);
+      fail_unless(fabs(x->pseudorange - y->pseudorange) <= pr_res,
+                  "MSM %d cell %d pseudorange error %g", types[t], j,
+                  x->pseudorange - y->pseudorange);
+      if (x->flags & RTCM3_OBS_CP)
+        fail_unless(fabs(x->phase_range - y->phase_range) <= cp_res,
+                    "MSM %d cell %d phase range error %g", types[t], j,
+                    x->phase_range - y->phase_range);
+      if (x->flags & RTCM3_OBS_RATE)
+        fail_unless(fabs(x->phase_range_rate - y->phase_range_rate) <= 5e-5,
+                    "MSM %d cell %d phase range rate error %g", types[t], j,
+                    x->phase_range_rate - y->phase_range_rate);
+      fail_unless(y->lock_time <= x->lock_time &&
+                  (hr ? y->lock_time * 1.04 + 64 : y->lock_time * 2 + 32) >
+                    x->lock_time,
+                  "MSM %d cell %d lock time %d decoded as %d", types[t], j,
+                  x->lock_time, y->lock_time);
+      fail_unless(fabs(x->cnr - y->cnr) <= (hr ? 1 / 32.0 : 0.5),
+                  "MSM %d cell %d CNR error %g", types[t], j,
+                  x->cnr - y->cnr);
+    }
+  }
+
+  /* Too many cells for the cell mask. */
+  make_msm(&msg, 1077);
+  msg.cells[msg.n_cell - 1].sig = 30;
+  msg.cells[msg.n_cell - 2].sig = 20;
+  fail_unless(rtcm3_encode_msm(buff, &msg) == -3,
+              "Should fail with more than 64 cells in the mask");
+  msg.type = 1076;
+  fail_unless(rtcm3_encode_msm(buff, &msg) == -1,
+              "Should fail for MSM6");
+}
+END_TEST
+
+START_TEST(test_rtcm3_encode_decode_1019)
+{
+  ephemeris_t e, e_out, e_out2;
+  u8 buff[64], buff2[64];
+
+  memset(&e, 0, sizeof(e));
+  e.sid.sat = 17;
+  e.sid.constellation = CONSTELLATION_GPS;
+  e.toe.wn = 1892;
+  e.toe.tow = 518400;
+  e.ura = 2.8;
+  e.fit_interval = 4;
+  e.valid = 1;
+  e.healthy = 1;
+  e.kepler.toc = e.toe;
+  e.kepler.tgd = -1.1175870895385742e-08;
+  e.kepler.crs = -27.46875;
+  e.kepler.crc = 252.09375;
+  e.kepler.cuc = -1.4212354984879494e-06;
+  e.kepler.cus = 7.0836395025253296e-06;
+  e.kepler.cic = 7.4505805969238281e-08;
+  e.kepler.cis = -1.3038516044616699e-07;
+  e.kepler.dn = 4.6933383209507e-09;
+  e.kepler.m0 = -2.1413853131787713;
+  e.kepler.ecc = 0.010658744489774108;
+  e.kepler.sqrta = 5153.6573505401611;
+  e.kepler.omega0 = 1.0460495014398342;
+  e.kepler.omegadot = -8.1003374060066032e-09;
+  e.kepler.w = 0.62153567039734006;
+  e.kepler.inc = 0.96092937362779463;
+  e.kepler.inc_dot = 3.5358901640493775e-10;
+  e.kepler.af0 = 3.9101717993617058e-05;
+  e.kepler.af1 = 2.2737367544323206e-13;
+  e.kepler.af2 = 0;
+  e.kepler.iodc = 25;
+  e.kepler.iode = 25;
+
+  fail_unless(rtcm3_encode_1019(buff, &e) == 61, "1019 length error");
+  fail_unless(rtcm3_decode_1019(buff, &e_out) == 0, "1019 decode failed");
+  fail_unless(e_out.sid.sat == e.sid.sat &&
+              e_out.sid.constellation == e.sid.constellation &&
+              e_out.toe.wn == e.toe.wn && e_out.toe.tow == e.toe.tow &&
+              e_out.kepler.toc.wn == e.kepler.toc.wn &&
+              e_out.kepler.toc.tow == e.kepler.toc.tow &&
+              e_out.ura == e.ura && e_out.fit_interval == e.fit_interval &&
+              e_out.valid && e_out.healthy &&
+              e_out.kepler.iodc == e.kepler.iodc &&
+              e_out.kepler.iode == e.kepler.iode,
+              "1019 ephemeris header decode error");
+
+  /* Compare orbits rather than each field against its scale factor. */
+  double pos[3], vel[3], clk, clk_rate, pos_out[3], vel_out[3];
+  double clk_out, clk_rate_out;
+  calc_sat_state(&e, &e.toe, pos, vel, &clk, &clk_rate);
+  calc_sat_state(&e_out, &e.toe, pos_out, vel_out, &clk_out, &clk_rate_out);
+  for (u8 k = 0; k < 3; k++)
+    fail_unless(fabs(pos[k] - pos_out[k]) < 0.01,
+                "1019 decoded position error %g m", pos[k] - pos_out[k]);
+  fail_unless(fabs(clk - clk_out) < 1e-9, "1019 decoded clock error");
+
+  /* Decoded values should encode to the same message. */
+  rtcm3_encode_1019(buff2, &e_out);
+  fail_unless(memcmp(buff, buff2, 61) == 0, "1019 re-encode differs");
+  rtcm3_decode_1019(buff2, &e_out2);
+  fail_unless(ephemeris_equal(&e_out, &e_out2), "1019 re-decode differs");
+}
+END_TEST
+
+typedef struct {
+  u32 n;
+  u16 types[16];
+} parser_log_t;
+
+static void log_msg(u16 type, const u8 *msg, u16 len, void *context)
+{
+  parser_log_t *log = context;
+  (void)len;
+  fail_unless(getbitu(msg, 0, 12) == type, "Handler type mismatch");
+  if (log->n < 16)
+    log->types[log->n] = type;
+  log->n++;
+}
+
+static void count_msg(u16 type, const u8 *msg, u16 len, void *context)
+{
+  (void)type;
+  (void)msg;
+  (void)len;
+  (*(u32 *)context)++;
+}
+
+START_TEST(test_rtcm3_parser)
+{
+  static u8 stream[8192];
+  u32 n_stream = 0;
+  rtcm3_obs_msg_t obs;
+  rtcm3_msm_t msm;
+  ephemeris_t e;
+
+  seed_rng();
+  make_obs_msg(&obs, false);
+  obs.n_sat = 8;
+  make_msm(&msm, 1077);
+  memset(&e, 0, sizeof(e));
+  e.sid.sat = 5;
+  e.kepler.sqrta = 5153.6;
+
+  /* Garbage, including preamble bytes, then valid frames with a corrupt
+   * frame in between. */
+  static const u8 garbage[] = {0x00, 0xD3, 0x12, 0xD3, 0x00, 0xFF, 0xD3};
+  memcpy(&stream[n_stream], garbage, sizeof(garbage));
+  n_stream += sizeof(garbage);
+  for (u8 k = 0; k < 4; k++) {
+    u8 *frame = &stream[n_stream];
+    u16 len;
+    switch (k) {
+    case 0: len = rtcm3_encode_1004(&frame[3], &obs); break;
+    case 1: len = rtcm3_encode_msm(&frame[3], &msm); break;
+    case 2: len = rtcm3_encode_1019(&frame[3], &e); break;
+    default: len = rtcm3_encode_1004(&frame[3], &obs); break;
+    }
+    rtcm3_write_frame(len, frame);
+    n_stream += len + 6;
+    if (k == 1) {
+      /* Corrupt copy of the MSM frame. */
+      memcpy(&stream[n_stream], frame, len + 6);
+      stream[n_stream + 20] ^= 0x10;
+      n_stream += len + 6;
+    }
+  }
+  /* A preamble inside the corrupt frame may start a false frame running
+   * past the real frames that follow, those are only found once the false
+   * frame is complete. Pad the stream so any false frame completes. */
+  memset(&stream[n_stream], 0, RTCM3_MAX_FRAME_LEN);
+  n_stream += RTCM3_MAX_FRAME_LEN;
+
+  static const u16 expected[] = {1004, 1077, 1019, 1004};
+
+  /* Feed the stream in chunks of every size from one byte up. */
+  for (u32 chunk = 1; chunk < n_stream; chunk += chunk < 16 ? 1 : 97) {
+    rtcm3_parser_t p;
+    parser_log_t log = {0};
+    u32 n_1004 = 0;
+    rtcm3_parser_init(&p);
+    rtcm3_parser_register(&p, 0, log_msg, &log);
+    rtcm3_parser_register(&p, 1004, count_msg, &n_1004);
+
+    u32 n_found = 0;
+    for (u32 i = 0; i < n_stream; i += chunk)
+      n_found += rtcm3_parser_process(&p, &stream[i],
+                                      MIN(chunk, n_stream - i));
+
+    fail_unless(n_found == 4 && p.n_frames == 4 && log.n == 4,
+                "Chunk size %d: found %d frames, expected 4", chunk, n_found);
+    fail_unless(memcmp(log.types, expected, sizeof(expected)) == 0,
+                "Chunk size %d: frames out of order", chunk);
+    fail_unless(n_1004 == 2, "Chunk size %d: 1004 handler called %d times",
+                chunk, n_1004);
+    fail_unless(p.n_crc_errors >= 1,
+                "Chunk size %d: corrupt frame not detected", chunk);
+    fail_unless(p.n_buff == 0, "Chunk size %d: %d bytes left in parser",
+                chunk, p.n_buff);
+
+    /* The start of a frame is held until the rest arrives. */
+    u32 n_skipped = p.n_skipped;
+    rtcm3_parser_process(&p, stream + sizeof(garbage), 10);
+    fail_unless(p.n_buff == 10 && p.n_frames == 4 &&
+                p.n_skipped == n_skipped,
+                "Chunk size %d: truncated frame not held", chunk);
+  }
+}
+END_TEST
 
 Suite* rtcm3_suite(void)
 {
@@ -225,6 +595,10 @@ Suite* rtcm3_suite(void)
   tcase_add_test(tc_core, test_rtcm3_write_frame);
   tcase_add_test(tc_core, test_rtcm3_read_write_header);
   tcase_add_test(tc_core, test_rtcm3_encode_decode);
+  tcase_add_test(tc_core, test_rtcm3_encode_decode_1004_1012);
+  tcase_add_test(tc_core, test_rtcm3_encode_decode_msm);
+  tcase_add_test(tc_core, test_rtcm3_encode_decode_1019);
+  tcase_add_test(tc_core, test_rtcm3_parser);
   suite_add_tcase(s, tc_core);
 
   return s;
@@ -201,6 +201,69 @@ START_TEST(test_is_prn_set)
 }
 END_TEST
 
+START_TEST(test_sid_set)
+{
+  seed_rng();
+
+  for (u32 n = 0; n < 100; n++) {
+    /* Random sorted signal arrays and their sets. */
+    gnss_signal_t a[NUM_SATS], b[NUM_SATS];
+    u32 na = 0, nb = 0;
+    for (u32 i = 0; i < NUM_SATS; i++) {
+      gnss_signal_t sid = sid_from_index(i);
+      if (rand() % 2)
+        a[na++] = sid;
+      if (rand() % 3 == 0)
+        b[nb++] = sid;
+    }
+    sid_set_t sa, sb, s;
+    sid_set_from_sids(&sa, na, a);
+    sid_set_from_sids(&sb, nb, b);
+    fail_unless(sid_set_count(&sa) == na, "Wrong count");
+
+    /* Rank and select are inverses, next visits the members in order. */
+    u32 k = 0;
+    for (u32 i = sid_set_next(&sa, 0); i < NUM_SATS;
+         i = sid_set_next(&sa, i + 1), k++) {
+      fail_unless(i == sid_to_index(a[k]), "Wrong member %u", k);
+      fail_unless(sid_set_rank(&sa, i) == k, "Wrong rank of %u", i);
+      fail_unless(sid_set_select(&sa, k) == i, "Wrong select of %u", k);
+    }
+    fail_unless(k == na, "Missed members");
+    fail_unless(sid_set_select(&sa, na) == NUM_SATS,
+                "Select past the end should return NUM_SATS");
+    fail_unless(sid_set_rank(&sa, NUM_SATS) == na, "Wrong rank of NUM_SATS");
+
+    /* The set operations agree with intersection(). */
+    gnss_signal_t a_and_b[NUM_SATS], b_and_a[NUM_SATS];
+    s32 n_and = intersection(na, sizeof(gnss_signal_t), a, a_and_b,
+                             nb, sizeof(gnss_signal_t), b, b_and_a,
+                             cmp_sid_sid);
+    sid_set_and(&s, &sa, &sb);
+    fail_unless(sid_set_count(&s) == (u32)n_and, "Wrong intersection");
+    for (s32 i = 0; i < n_and; i++)
+      fail_unless(sid_set_contains(&s, a_and_b[i]), "Missing from AND");
+
+    sid_set_t s_or, s_andnot;
+    sid_set_or(&s_or, &sa, &sb);
+    sid_set_andnot(&s_andnot, &sa, &sb);
+    fail_unless(sid_set_count(&s_or) == na + nb - n_and, "Wrong union");
+    fail_unless(sid_set_count(&s_andnot) == na - n_and, "Wrong difference");
+    sid_set_or(&s, &s_andnot, &sb);
+    fail_unless(sid_set_equal(&s, &s_or), "(A \\ B) | B != A | B");
+
+    /* Removing every member of A leaves it empty. */
+    for (u32 i = 0; i < na; i++) {
+      fail_unless(sid_set_contains(&sa, a[i]), "Missing member");
+      sid_set_remove(&sa, a[i]);
+      fail_if(sid_set_contains(&sa, a[i]), "Member not removed");
+    }
+    sid_set_init(&s);
+    fail_unless(sid_set_equal(&sa, &s), "Set not empty");
+  }
+}
+END_TEST
+
 Suite* set_suite(void)
 {
   Suite *s = suite_create("Set");
@@ -218,6 +281,7 @@ Suite* set_suite(void)
   tcase_add_test(tc_intersection, test_intersection_map_10);
   TCase *tc_set = tcase_create("Set");
   tcase_add_test(tc_set, test_is_prn_set);
+  tcase_add_test(tc_set, test_sid_set);
   suite_add_tcase(s, tc_intersection);
   suite_add_tcase(s, tc_set);
 
@@ -0,0 +1,214 @@
+#include <check.h>
+#include <math.h>
+#include <string.h>
+
+#include <libswiftnav/small_matrix.h>
+#include <libswiftnav/linear_algebra.h>
+
+#include "check_utils.h"
+
+#define SMAT_TOL 1e-9
+#define D SMAT_MAX_DIM
+
+static const u32 sizes[] = {1, 2, 3, 4, 5, 8, 11, D};
+#define N_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static const smat_impl_t impls[] = {SMAT_IMPL_GENERIC, SMAT_IMPL_AVX2};
+
+static void check_close(u32 n, const double *a, const double *b,
+                        const char *what)
+{
+  for (u32 i = 0; i < n; i++)
+    fail_unless(fabs(a[i] - b[i]) < SMAT_TOL * (1 + fabs(b[i])),
+                "%s differs at %u: %f vs %f", what, i, a[i], b[i]);
+}
+
+/* Random symmetric positive definite matrix. */
+static void make_spd(u32 n, double *A)
+{
+  double B[D * D];
+  arr_frand(n * n, -1, 1, B);
+  for (u32 i = 0; i < n; i++)
+    for (u32 j = 0; j < n; j++) {
+      double x = i == j ? 0.1 : 0;
+      for (u32 k = 0; k < n; k++)
+        x += B[k*n + i] * B[k*n + j];
+      A[i*n + j] = x;
+    }
+}
+
+START_TEST(test_smat_products)
+{
+  seed_rng();
+  double A[D * D], B[D * D], C[D * D], C_ref[D * D], T[D * D];
+
+  for (u32 v = 0; v < sizeof(impls) / sizeof(impls[0]); v++) {
+    if (!smat_impl_supported(impls[v]))
+      continue;
+    smat_set_impl(impls[v]);
+
+    for (u32 x = 0; x < N_SIZES; x++) {
+      for (u32 y = 0; y < N_SIZES; y++) {
+        u32 n = sizes[x], m = sizes[y], p = sizes[(x + y) % N_SIZES];
+        arr_frand(n * m, -10, 10, A);
+        arr_frand(m * p, -10, 10, B);
+
+        smat_mul(n, m, p, A, B, C);
+        matrix_multiply(n, m, p, A, B, C_ref);
+        check_close(n * p, C, C_ref, "A B");
+
+        matrix_transpose(m, p, B, T);
+        smat_mul_abt(n, m, p, A, T, C);
+        check_close(n * p, C, C_ref, "A B'");
+
+        matrix_transpose(n, m, A, T);
+        smat_ata(n, m, A, C);
+        matrix_multiply(m, n, m, T, A, C_ref);
+        check_close(m * m, C, C_ref, "A'A");
+
+        /* A S A' with S symmetric, only its upper triangle set, in place. */
+        double S[D * D], S_full[D * D], AS[D * D];
+        make_spd(m, S_full);
+        memcpy(S, S_full, sizeof(S));
+        for (u32 i = 0; i < m; i++)
+          for (u32 j = 0; j < i; j++)
+            S[i*m + j] = 0;
+        matrix_multiply(n, m, m, A, S_full, AS);
+        matrix_transpose(n, m, A, T);
+        matrix_multiply(n, m, n, AS, T, C_ref);
+        if (n == m) {
+          smat_asat(n, m, A, S, S);
+          check_close(n * n, S, C_ref, "A S A' in place");
+        } else {
+          smat_asat(n, m, A, S, C);
+          check_close(n * n, C, C_ref, "A S A'");
+        }
+
+        /* Unit upper triangular products, the rest of U being ignored. */
+        double U[D * D], U_full[D * D];
+        arr_frand(m * m, -1, 1, U);
+        memcpy(U_full, U, sizeof(U));
+        for (u32 i = 0; i < m; i++) {
+          U_full[i*m + i] = 1;
+          for (u32 j = 0; j < i; j++)
+            U_full[i*m + j] = 0;
+        }
+        smat_mul_unit_upper(n, m, A, U, C);
+        matrix_multiply(n, m, m, A, U_full, C_ref);
+        check_close(n * m, C, C_ref, "A U");
+        memcpy(C, A, n * m * sizeof(double));
+        smat_mul_unit_upper(n, m, C, U, C);
+        check_close(n * m, C, C_ref, "A U in place");
+
+        memcpy(C, B, m * p * sizeof(double));
+        smat_unit_upper_mul(m, p, U, C);
+        matrix_multiply(m, m, p, U_full, B, C_ref);
+        check_close(m * p, C, C_ref, "U B");
+
+        memcpy(C, B, m * p * sizeof(double));
+        smat_unit_upper_tmul(m, p, U, C);
+        matrix_transpose(m, m, U_full, T);
+        matrix_multiply(m, m, p, T, B, C_ref);
+        check_close(m * p, C, C_ref, "U' B");
+      }
+    }
+  }
+  smat_set_impl(SMAT_IMPL_AUTO);
+}
+END_TEST
+
+START_TEST(test_smat_factorisations)
+{
+  seed_rng();
+  double A[D * D], L[D * D], d[D], X[D * D], X_ldl[D * D], B[D * D];
+  double C[D * D], I[D * D];
+
+  for (u32 x = 0; x < N_SIZES; x++) {
+    u32 n = sizes[x], p = sizes[N_SIZES - 1 - x];
+    make_spd(n, A);
+
+    /* A = L L' */
+    fail_unless(smat_cholesky(n, A, L) == 0);
+    smat_mul_abt(n, n, n, L, L, C);
+    check_close(n * n, C, A, "L L'");
+    for (u32 i = 0; i < n; i++)
+      for (u32 j = i + 1; j < n; j++)
+        fail_unless(L[i*n + j] == 0, "L not lower triangular");
+
+    /* A X = B */
+    arr_frand(n * p, -10, 10, B);
+    memcpy(X, B, n * p * sizeof(double));
+    smat_cholesky_solve(n, L, p, X);
+    smat_mul(n, n, p, A, X, C);
+    check_close(n * p, C, B, "Cholesky solve");
+
+    /* A^-1 */
+    smat_cholesky_inverse(n, L, X);
+    smat_mul(n, n, n, A, X, C);
+    matrix_eye(n, I);
+    check_close(n * n, C, I, "Cholesky inverse");
+
+    /* A = L D L', solved in place. */
+    memcpy(L, A, n * n * sizeof(double));
+    fail_unless(smat_ldl(n, L, L, d) == 0);
+    memcpy(X_ldl, B, n * p * sizeof(double));
+    smat_ldl_solve(n, L, d, p, X_ldl);
+    smat_mul(n, n, p, A, X_ldl, C);
+    check_close(n * p, C, B, "LDL solve");
+    for (u32 i = 0; i < n; i++)
+      fail_unless(L[i*n + i] == 1, "L not unit diagonal");
+  }
+
+  /* Indefinite and singular matrices are detected. */
+  double M[9] = {2, 1, 0,
+                 1, -3, 0,
+                 0, 0, 1};
+  fail_unless(smat_cholesky(3, M, L) == -1);
+  fail_unless(smat_ldl(3, M, L, d) == -1);
+  double G[4 * 3] = {1, 2, 3,
+                     2, 4, 6,
+                     -1, -2, -3,
+                     0.5, 1, 1.5};
+  smat_ata(4, 3, G, M);
+  fail_unless(smat_cholesky(3, M, L) == -1);
+  fail_unless(smat_ldl(3, M, L, d) == -1);
+}
+END_TEST
+
+START_TEST(test_smat_left_null_basis)
+{
+  seed_rng();
+  double A[D * D], Q[D * D], C[D * D], I[D * D];
+
+  for (u32 x = 0; x < N_SIZES; x++) {
+    for (u32 m = 0; m <= sizes[x]; m++) {
+      u32 n = sizes[x];
+      arr_frand(n * m, -10, 10, A);
+      smat_left_null_basis(n, m, A, Q);
+
+      /* Q A = 0 */
+      double Z[D * D] = {0};
+      smat_mul(n - m, n, m, Q, A, C);
+      check_close((n - m) * m, C, Z, "Q A");
+
+      /* Q Q' = I */
+      smat_mul_abt(n - m, n, n - m, Q, Q, C);
+      matrix_eye(n - m, I);
+      check_close((n - m) * (n - m), C, I, "Q Q'");
+    }
+  }
+}
+END_TEST
+
+Suite* small_matrix_suite(void)
+{
+  Suite *s = suite_create("Small Matrices");
+
+  TCase *tc_core = tcase_create("Core");
+  tcase_add_test(tc_core, test_smat_products);
+  tcase_add_test(tc_core, test_smat_factorisations);
+  tcase_add_test(tc_core, test_smat_left_null_basis);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -23,5 +23,13 @@ Suite* ionosphere_suite(void);
 Suite* signal_test_suite(void);
 Suite* track_test_suite(void);
 Suite* cnav_test_suite(void);
+Suite* nav_msg_suite(void);
+Suite* correlate_suite(void);
+Suite* code_cache_suite(void);
+Suite* orbit_cache_suite(void);
+Suite* fft_suite(void);
+Suite* acq_suite(void);
+Suite* lambda_suite(void);
+Suite* small_matrix_suite(void);
 
 #endif /* CHECK_SUITES_H */
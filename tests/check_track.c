@@ -2,10 +2,12 @@
 #include <check.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include "check_utils.h"
 
 #include <libswiftnav/track.h>
+#include <libswiftnav/track_bank.h>
 
 START_TEST(test_costas_discriminator)
 {
@@ -60,6 +62,130 @@ START_TEST(test_costas_discriminator)
 }
 END_TEST
 
+#define BANK_TEST_CHANNELS 24
+#define BANK_TEST_STEPS 500
+
+static float rand_corr(float amp)
+{
+  return amp * (2.0f * rand() / RAND_MAX - 1.0f);
+}
+
+START_TEST(test_track_bank)
+{
+  aided_tl_state_t aided[BANK_TEST_CHANNELS];
+  simple_tl_state_t simple[BANK_TEST_CHANNELS];
+  comp_tl_state_t comp[BANK_TEST_CHANNELS];
+  lock_detect_t ld[BANK_TEST_CHANNELS];
+  cn0_est_state_t cn0[BANK_TEST_CHANNELS];
+  static track_bank_t b;
+
+  /* cn0_est_init() leaves the filter history uninitialised. */
+  memset(cn0, 0, sizeof(cn0));
+
+  fail_unless(track_bank_init(&b, TRACK_BANK_MAX_CHANNELS + 1) < 0,
+              "bank larger than TRACK_BANK_MAX_CHANNELS accepted");
+  fail_unless(track_bank_init(&b, BANK_TEST_CHANNELS) == 0,
+              "track_bank_init failed");
+
+  srand(1);
+  for (u32 i = 0; i < BANK_TEST_CHANNELS; i++) {
+    float doppler = rand_corr(4000);
+    switch (i % 3) {
+    case 0:
+      /* Alternate between carrier aided and unaided code loops, with and
+       * without FLL assistance. */
+      aided_tl_init(&aided[i], 1000, doppler / 1540, 1, 0.7, 1,
+                    (i % 2) ? 1540 : 0, doppler, 10, 0.7, 1,
+                    (i % 4) ? 5 : 0);
+      break;
+    case 1:
+      simple_tl_init(&simple[i], 1000, doppler / 1540, 1, 0.7, 1,
+                     doppler, 10, 0.7, 1);
+      break;
+    case 2:
+      comp_tl_init(&comp[i], 1000, doppler / 1540, 1, 0.7, 1,
+                   doppler, 10, 0.7, 1, 0.1, 1540, i);
+      break;
+    }
+    lock_detect_init(&ld[i], 0.02, 1.5, 50, 150);
+    cn0_est_init(&cn0[i], 1e3, 40, 5, 1e3);
+
+    switch (i % 3) {
+    case 0: track_bank_set_aided(&b, i, &aided[i], &ld[i], &cn0[i]); break;
+    case 1: track_bank_set_simple(&b, i, &simple[i], &ld[i], &cn0[i]); break;
+    case 2: track_bank_set_comp(&b, i, &comp[i], &ld[i], &cn0[i]); break;
+    }
+  }
+
+  for (u32 k = 0; k < BANK_TEST_STEPS; k++) {
+    correlation_t cs[BANK_TEST_CHANNELS][3];
+    float cn0_ref[BANK_TEST_CHANNELS];
+    for (u32 i = 0; i < BANK_TEST_CHANNELS; i++) {
+      /* Some channels locked, some not. */
+      float amp = (i % 5) ? 1000 : 50;
+      for (u32 j = 0; j < 3; j++) {
+        cs[i][j].I = (j == 1 ? amp : amp / 2) + rand_corr(100);
+        cs[i][j].Q = rand_corr(100);
+      }
+      if (k == 7)
+        cs[i][1].I = 0;
+    }
+
+    for (u32 i = 0; i < BANK_TEST_CHANNELS; i++) {
+      switch (i % 3) {
+      case 0: aided_tl_update(&aided[i], cs[i]); break;
+      case 1: simple_tl_update(&simple[i], cs[i]); break;
+      case 2: comp_tl_update(&comp[i], cs[i]); break;
+      }
+      lock_detect_update(&ld[i], cs[i][1].I, cs[i][1].Q, 1e-3);
+      cn0_ref[i] = cn0_est(&cn0[i], cs[i][1].I, cs[i][1].Q);
+    }
+
+    track_bank_update(&b, cs, 1e-3);
+
+    for (u32 i = 0; i < BANK_TEST_CHANNELS; i++) {
+      lock_detect_t ld_b;
+      cn0_est_state_t cn0_b;
+      memset(&ld_b, 0, sizeof(ld_b));
+      float code_freq, carr_freq;
+      switch (i % 3) {
+      case 0: {
+        aided_tl_state_t tl;
+        track_bank_get_aided(&b, i, &tl, &ld_b, &cn0_b);
+        fail_unless(memcmp(&tl, &aided[i], sizeof(tl)) == 0,
+                    "aided loop state mismatch, channel %u step %u", i, k);
+        code_freq = aided[i].code_freq;
+        carr_freq = aided[i].carr_freq;
+      } break;
+      case 1: {
+        simple_tl_state_t tl;
+        track_bank_get_simple(&b, i, &tl, &ld_b, &cn0_b);
+        fail_unless(memcmp(&tl, &simple[i], sizeof(tl)) == 0,
+                    "simple loop state mismatch, channel %u step %u", i, k);
+        code_freq = simple[i].code_freq;
+        carr_freq = simple[i].carr_freq;
+      } break;
+      default: {
+        comp_tl_state_t tl;
+        track_bank_get_comp(&b, i, &tl, &ld_b, &cn0_b);
+        fail_unless(memcmp(&tl, &comp[i], sizeof(tl)) == 0,
+                    "comp loop state mismatch, channel %u step %u", i, k);
+        code_freq = comp[i].code_freq;
+        carr_freq = comp[i].carr_freq;
+      } break;
+      }
+      fail_unless(b.code_freq[i] == code_freq && b.carr_freq[i] == carr_freq &&
+                  b.cn0[i] == cn0_ref[i],
+                  "output mismatch, channel %u step %u", i, k);
+      fail_unless(memcmp(&ld_b, &ld[i], sizeof(ld_b)) == 0,
+                  "lock detector mismatch, channel %u step %u", i, k);
+      fail_unless(memcmp(&cn0_b, &cn0[i], sizeof(cn0_b)) == 0,
+                  "C/N0 estimator mismatch, channel %u step %u", i, k);
+    }
+  }
+}
+END_TEST
+
 Suite* track_test_suite(void)
 {
   Suite *s = suite_create("Track");
@@ -68,6 +194,10 @@ Suite* track_test_suite(void)
   tcase_add_test(tc_core, test_costas_discriminator);
   suite_add_tcase(s, tc_core);
 
+  TCase *tc_bank = tcase_create("Bank");
+  tcase_add_test(tc_bank, test_track_bank);
+  suite_add_tcase(s, tc_bank);
+
   return s;
 }
 
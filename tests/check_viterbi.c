@@ -28,10 +28,11 @@ int compare_files(FILE *f1, FILE *f2)
   return count;
 }
 
-START_TEST(test_viterbi27)
+#define HISTORY_LENGTH_BITS 64
+#define DECODE_LENGTH_BITS 32
+
+static void check_waas_decode(v27_impl_t impl)
 {
-  #define HISTORY_LENGTH_BITS 64
-  #define DECODE_LENGTH_BITS 32
 
   FILE *waas_symbols = fopen("v27_sym_waas.bin", "r");
   fail_if(NULL == waas_symbols, "Could not load WAAS data file");
@@ -61,6 +62,7 @@ START_TEST(test_viterbi27)
 
   v27_poly_init(&v27_poly, poly_bytes);
   v27_init(&v, decisions, HISTORY_LENGTH_BITS, &v27_poly, 0);
+  v27_set_impl(&v, impl);
 
   /* Perform decoding, writing output to file */
   int output = open(tmp_file, O_WRONLY | O_CREAT, 0644);
@@ -98,6 +100,69 @@ START_TEST(test_viterbi27)
   fclose(waas_bits);
   fclose(tmp);
 }
+
+START_TEST(test_viterbi27)
+{
+  check_waas_decode(V27_IMPL_AUTO);
+}
+END_TEST
+
+/* Every supported implementation decodes the WAAS data, and its metrics and
+ * decisions match the portable decoder bit for bit, including across a
+ * metric renormalization. */
+START_TEST(test_viterbi27_impls)
+{
+  #define RANDOM_BITS 2000
+  v27_impl_t impls[] = {V27_IMPL_PORTABLE, V27_IMPL_SSE2, V27_IMPL_AVX2};
+  v27_poly_t v27_poly;
+  signed char poly_bytes[] = {V27POLYA, V27POLYB};
+  v27_poly_init(&v27_poly, poly_bytes);
+
+  unsigned char syms[2 * RANDOM_BITS];
+  srand(1);
+  for (int i = 0; i < 2 * RANDOM_BITS; i++)
+    syms[i] = rand() & 0xff;
+
+  v27_t ref;
+  v27_decision_t ref_decisions[RANDOM_BITS];
+  v27_init(&ref, ref_decisions, RANDOM_BITS, &v27_poly, 0);
+  v27_set_impl(&ref, V27_IMPL_PORTABLE);
+  for (int i = 0; i < 64; i++)
+    ref.old_metrics[i] = (1 << 30) - 300 * 510 + 1000 * i;
+  v27_update(&ref, syms, RANDOM_BITS);
+  unsigned char ref_data[RANDOM_BITS / 8];
+  v27_chainback_likely(&ref, ref_data, RANDOM_BITS);
+
+  for (unsigned i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+    if (!v27_impl_supported(impls[i]))
+      continue;
+    check_waas_decode(impls[i]);
+
+    v27_t v;
+    v27_decision_t decisions[RANDOM_BITS];
+    v27_init(&v, decisions, RANDOM_BITS, &v27_poly, 0);
+    v27_set_impl(&v, impls[i]);
+    for (int j = 0; j < 64; j++)
+      v.old_metrics[j] = (1 << 30) - 300 * 510 + 1000 * j;
+    /* Uneven blocks */
+    v27_update(&v, syms, 7);
+    v27_update(&v, &syms[2 * 7], RANDOM_BITS - 7);
+
+    fail_unless(memcmp(v.old_metrics, ref.old_metrics,
+                       sizeof(ref.metrics1)) == 0,
+                "impl %d: metrics differ", impls[i]);
+    fail_unless(memcmp(v.new_metrics, ref.new_metrics,
+                       sizeof(ref.metrics1)) == 0,
+                "impl %d: metrics differ", impls[i]);
+    fail_unless(memcmp(decisions, ref_decisions, sizeof(decisions)) == 0,
+                "impl %d: decisions differ", impls[i]);
+
+    unsigned char data[RANDOM_BITS / 8];
+    v27_chainback_likely(&v, data, RANDOM_BITS);
+    fail_unless(memcmp(data, ref_data, sizeof(data)) == 0,
+                "impl %d: decoded bits differ", impls[i]);
+  }
+}
 END_TEST
 
 Suite* viterbi_suite(void)
@@ -106,6 +171,7 @@ Suite* viterbi_suite(void)
 
   TCase *tc_core = tcase_create("Core");
   tcase_add_test(tc_core, test_viterbi27);
+  tcase_add_test(tc_core, test_viterbi27_impls);
   suite_add_tcase(s, tc_core);
 
   return s;